@@ -0,0 +1,100 @@
+#ifndef RECCALOCOMMON_BINARYFILE_H
+#define RECCALOCOMMON_BINARYFILE_H
+
+// std
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace k4::recCalo {
+
+static_assert(std::endian::native == std::endian::little, "binary files are written in little-endian order");
+
+/** @class BinaryFileWriter
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/BinaryFile.h
+ *
+ *  Writer of the binary files of RecCaloCommon (CellListCache, NoisePool, NoiseLevelTable, CrosstalkMatrix): an 8-byte
+ *  magic identifying the format, a header of 64-bit values, then the arrays of the format, all in little-endian order.
+ *  The file is written to a temporary file private to the process, which commit() renames to the file name, so that
+ *  readers and concurrent jobs never see a partial file. The temporary file is removed if the file is not committed.
+ */
+
+class BinaryFileWriter {
+public:
+  static constexpr size_t kMagicSize = 8;
+
+  /** @param[in] aFileName, name of the file, its directory is created if it does not exist.
+   *  @param[in] aMagic, magic of the format.
+   *  @param[in] aHeader, header values.
+   */
+  BinaryFileWriter(const std::string& aFileName, const char (&aMagic)[kMagicSize],
+                   std::initializer_list<uint64_t> aHeader);
+  ~BinaryFileWriter();
+  BinaryFileWriter(const BinaryFileWriter&) = delete;
+  BinaryFileWriter& operator=(const BinaryFileWriter&) = delete;
+
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  void write(std::span<const T> aValues) {
+    m_file.write(reinterpret_cast<const char*>(aValues.data()), aValues.size_bytes());
+  }
+  /// Replace the file by the written one, false if any write failed
+  bool commit();
+
+private:
+  std::filesystem::path m_path;
+  std::filesystem::path m_temporary;
+  std::ofstream m_file;
+  bool m_committed = false;
+};
+
+/** @class BinaryFileReader
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/BinaryFile.h
+ *
+ *  Reader of the files written by BinaryFileWriter. The magic and the header are read when the reader is created, the
+ *  reader is false if the file cannot be opened, has another magic or is shorter than the header. The callers check
+ *  the header values against the size of the payload (the bytes after the header) before reading the arrays, which
+ *  rejects truncated files without allocating.
+ */
+
+class BinaryFileReader {
+public:
+  static constexpr size_t kMagicSize = BinaryFileWriter::kMagicSize;
+
+  /** @param[in] aFileName, name of the file.
+   *  @param[in] aMagic, magic of the format.
+   *  @param[out] aHeader, header values, its size is the number of values in the header.
+   */
+  BinaryFileReader(const std::string& aFileName, const char (&aMagic)[kMagicSize], std::span<uint64_t> aHeader);
+
+  explicit operator bool() const { return m_good; }
+  /// Position of the payload in the file, in bytes
+  uint64_t payloadOffset() const { return m_payloadOffset; }
+  /// Size of the payload, in bytes
+  uint64_t payloadSize() const { return m_payloadSize; }
+
+  /// Read the next array of aSize values
+  template <typename T>
+    requires std::is_trivially_copyable_v<T>
+  bool read(std::vector<T>& aValues, uint64_t aSize) {
+    aValues.resize(aSize);
+    m_good = m_good && m_file.read(reinterpret_cast<char*>(aValues.data()), aSize * sizeof(T));
+    return m_good;
+  }
+
+private:
+  std::ifstream m_file;
+  bool m_good = false;
+  uint64_t m_payloadOffset = 0;
+  uint64_t m_payloadSize = 0;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_BINARYFILE_H */
@@ -0,0 +1,94 @@
+#ifndef RECCALOCOMMON_CELLINDEXMAP_H
+#define RECCALOCOMMON_CELLINDEXMAP_H
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace k4::recCalo {
+
+/** @class CellIndexMap
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/CellIndexMap.h
+ *
+ *  Minimal perfect hash of a fixed set of 64-bit cellIDs to dense 32-bit indices [0, size()).
+ *  The hash follows the hash-and-displace scheme: keys are distributed in small buckets, and for each bucket a
+ *  displacement (pilot) is searched such that all keys of the bucket land in free slots of a table slightly larger
+ *  than the number of keys. The occupied slots are then ranked, which makes the hash minimal. Indices follow the order
+ *  of the sorted cellIDs, so that cells close in cellID are also close in index space.
+ *  Memory: about 1.3 bytes per cell for the hash, 4 bytes per cell for the index permutation and 8 bytes per cell for
+ *  the reverse table (index -> cellID), which is also used to reject cellIDs that are not part of the set.
+ */
+
+class CellIndexMap {
+public:
+  static constexpr uint32_t invalidIndex = UINT32_MAX;
+
+  /** Build the hash.
+   *   @param[in] aCellIds, the cellIDs (duplicates are removed).
+   *   @return false if no perfect hash could be found (should not happen in practice)
+   */
+  bool build(std::span<const uint64_t> aCellIds);
+
+  /// Dense index of the cell, invalidIndex if the cellID is not part of the set
+  uint32_t index(uint64_t aCellId) const {
+    if (m_cellIds.empty()) {
+      return invalidIndex;
+    }
+    uint64_t h = hash(aCellId, m_seed);
+    uint64_t slot = position(h, m_pilots[bucket(h)]);
+    uint32_t rank = m_rankBlocks[slot >> 6] + popcount(m_occupied[slot >> 6] & ((uint64_t(1) << (slot & 63)) - 1));
+    if (rank >= m_order.size()) {
+      return invalidIndex;
+    }
+    uint32_t idx = m_order[rank];
+    return m_cellIds[idx] == aCellId ? idx : invalidIndex;
+  }
+
+  /// CellID of the index
+  uint64_t cellID(uint32_t aIndex) const { return m_cellIds[aIndex]; }
+  /// All cellIDs, sorted, the position in this list is the index of the cell
+  std::span<const uint64_t> cellIDs() const { return m_cellIds; }
+  uint32_t size() const { return m_cellIds.size(); }
+  /// Memory used by the hash and reverse table, in bytes
+  size_t memory() const;
+
+private:
+  static uint64_t hash(uint64_t aKey, uint64_t aSeed) {
+    // splitmix64 finaliser
+    uint64_t z = aKey + aSeed + 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+  static uint32_t popcount(uint64_t aWord) { return __builtin_popcountll(aWord); }
+  /// High 64 bits of the product of a 64-bit value and a value below 2^32, i.e. aValue reduced to [0, aRange)
+  static uint64_t mulHigh(uint64_t aValue, uint64_t aRange) {
+    return ((aValue >> 32) * aRange + ((aValue & 0xffffffffULL) * aRange >> 32)) >> 32;
+  }
+  // the bucket is taken from the low bits of the hash
+  uint64_t bucket(uint64_t aHash) const { return (aHash & 0xffffffffULL) * m_numBuckets >> 32; }
+  // the pilot is mixed into the hash before the range reduction: with a linear combination (e.g. a xor), keys of a
+  // bucket which land in the same slot for one pilot would collide for all pilots
+  uint64_t position(uint64_t aHash, uint32_t aPilot) const {
+    return mulHigh(hash(aHash ^ aPilot, m_seed), m_tableSize);
+  }
+  bool tryBuild(uint64_t aSeed);
+
+  uint64_t m_seed = 0;
+  uint64_t m_numBuckets = 0;
+  uint64_t m_tableSize = 0;
+  /// displacement per bucket
+  std::vector<uint32_t> m_pilots;
+  /// occupancy bit-vector of the table, and number of occupied slots before each 64-bit block
+  std::vector<uint64_t> m_occupied;
+  std::vector<uint32_t> m_rankBlocks;
+  /// rank of the slot -> index
+  std::vector<uint32_t> m_order;
+  /// index -> cellID
+  std::vector<uint64_t> m_cellIds;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_CELLINDEXMAP_H */
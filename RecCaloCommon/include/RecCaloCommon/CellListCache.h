@@ -0,0 +1,76 @@
+#ifndef RECCALOCOMMON_CELLLISTCACHE_H
+#define RECCALOCOMMON_CELLLISTCACHE_H
+
+// std
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Gaudi
+#include "GaudiKernel/MsgStream.h"
+#include "GaudiKernel/StatusCode.h"
+
+namespace dd4hep {
+class Detector;
+}
+namespace Gaudi::Details {
+class PropertyBase;
+}
+
+namespace k4::recCalo {
+
+/** @class CellListCache
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/CellListCache.h
+ *
+ *  On-disk cache of the list of all cells of a readout, as prepared by ICalorimeterTool::prepareEmptyCells.
+ *  The cache file holds the sorted cellIDs and a key, computed from the readout (bitfield and segmentation
+ *  parameters), the structure of the TGeo geometry (volume names, number of daughters and bounding boxes) and the
+ *  configuration of the tool. A file whose key does not match is ignored and rewritten, so that a change of geometry
+ *  or configuration only costs one enumeration of the cells.
+ *  File format: 8-byte magic, key, number of cells, then the cellIDs, all as 64-bit little-endian integers.
+ */
+
+class CellListCache {
+public:
+  /** Key of the geometry seen by a readout.
+   *   @param[in] aDetector, the DD4hep detector.
+   *   @param[in] aReadoutName, name of the readout.
+   */
+  static uint64_t geometryKey(const dd4hep::Detector& aDetector, const std::string& aReadoutName);
+  /// Combine a key with the names and values of the properties of a tool (see k4::recCalo::hashCombine)
+  static uint64_t combine(uint64_t aKey, std::initializer_list<const Gaudi::Details::PropertyBase*> aProperties);
+
+  /** @param[in] aDirectory, directory of the cache files, created if it does not exist.
+   *  @param[in] aReadoutName, name of the readout, used in the file name.
+   *  @param[in] aKey, key of the geometry and configuration, also used in the file name.
+   */
+  CellListCache(const std::string& aDirectory, const std::string& aReadoutName, uint64_t aKey);
+
+  /// Read the cellIDs, false if the file does not exist, is corrupted or was written for another key
+  bool load(std::vector<uint64_t>& aCellIds) const;
+  /// Write the (sorted) cellIDs, the file is replaced atomically so that concurrent jobs can share a directory
+  bool save(std::span<const uint64_t> aCellIds) const;
+  const std::string& fileName() const { return m_fileName; }
+
+  /** Fill the map of all cells from the cache, or with aEnumerate if the cache is missing, and save the cache.
+   *   @param[out] aCells, map of all cells with zero energy.
+   *   @param[in] aValidate, enumerate the cells even if the cache is found, the enumerated cells are used (and the
+   *   cache rewritten) if they differ.
+   *   @param[in] aLog, message stream of the calling tool.
+   *   @param[in] aEnumerate, enumeration of the cells from the live geometry.
+   */
+  StatusCode
+  prepareEmptyCells(std::unordered_map<uint64_t, double>& aCells, bool aValidate, MsgStream& aLog,
+                    const std::function<StatusCode(std::unordered_map<uint64_t, double>&)>& aEnumerate) const;
+
+private:
+  uint64_t m_key;
+  std::string m_fileName;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_CELLLISTCACHE_H */
@@ -0,0 +1,50 @@
+#ifndef RECCALOCOMMON_CELLNOISEGENERATOR_H
+#define RECCALOCOMMON_CELLNOISEGENERATOR_H
+
+// std
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace k4::recCalo {
+
+/** @class CellNoiseGenerator
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/CellNoiseGenerator.h
+ *
+ *  Counter-based generator of standard-normal noise for calorimeter cells.
+ *  The random numbers are obtained by encrypting the counter (cellID, event number) with the Philox4x32-10 block
+ *  cipher keyed by (seed, run number), and transformed to a Gaussian with the Box-Muller method. The noise of a cell
+ *  therefore only depends on (seed, run, event, cellID): it is reproducible whatever the order in which the cells are
+ *  processed or the way events are scheduled on threads, and the generator has no state to protect.
+ *  The batched interface first fills blocks of uniform numbers and then transforms them, which lets the compiler
+ *  vectorise both loops.
+ */
+
+class CellNoiseGenerator {
+public:
+  explicit CellNoiseGenerator(uint64_t aSeed = 0) : m_seed(aSeed) {}
+  void setSeed(uint64_t aSeed) { m_seed = aSeed; }
+  uint64_t seed() const { return m_seed; }
+
+  /// Standard-normal random number of one cell
+  double gaussian(uint64_t aRun, uint64_t aEvent, uint64_t aCellId) const;
+
+  /** Standard-normal random numbers of a list of cells.
+   *   @param[in] aRun, aEvent, run and event numbers.
+   *   @param[in] aCellIds, cellIDs of the cells.
+   *   @param[out] aGaussians, one value per cell, must have the same size as aCellIds.
+   */
+  void gaussians(uint64_t aRun, uint64_t aEvent, std::span<const uint64_t> aCellIds,
+                 std::span<double> aGaussians) const;
+
+  /// Philox4x32-10 bijection, exposed for testing
+  static std::array<uint32_t, 4> philox(std::array<uint32_t, 4> aCounter, std::array<uint32_t, 2> aKey);
+
+private:
+  std::array<uint32_t, 2> key(uint64_t aRun) const;
+
+  uint64_t m_seed;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_CELLNOISEGENERATOR_H */
@@ -0,0 +1,27 @@
+#ifndef RECCALOCOMMON_COMPACTINDICES_H
+#define RECCALOCOMMON_COMPACTINDICES_H
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace k4::recCalo {
+
+/** Write the indices i in [0, aSize) for which aKeep(i) is true to aSelected, in increasing order.
+ *  The compaction is branch-free: every index is written at the current end of the list, and the end only advances
+ *  if the element is kept, so the cost does not depend on how predictable the selection is.
+ */
+template <typename Keep>
+void compactIndices(size_t aSize, std::vector<uint32_t>& aSelected, Keep&& aKeep) {
+  aSelected.resize(aSize);
+  size_t numSelected = 0;
+  for (size_t i = 0; i < aSize; i++) {
+    aSelected[numSelected] = i;
+    numSelected += bool(aKeep(i));
+  }
+  aSelected.resize(numSelected);
+}
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_COMPACTINDICES_H */
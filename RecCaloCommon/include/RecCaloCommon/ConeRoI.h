@@ -0,0 +1,78 @@
+#ifndef RECCALOCOMMON_CONEROI_H
+#define RECCALOCOMMON_CONEROI_H
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace k4::recCalo {
+
+/** @class ConeRoI
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/ConeRoI.h
+ *
+ *  Region of interest made of cones around a set of directions (e.g. generator particles, tracks or jet axes).
+ *  A point belongs to the region of interest if its distance sqrt(dTheta^2 + dPhi^2) to any of the cone axes is
+ *  smaller than the cone size.
+ */
+
+class ConeRoI {
+public:
+  explicit ConeRoI(double aConeSize = 0.4) : m_coneSize(aConeSize) {}
+
+  /// Add a cone around the direction given by the vector (x, y, z), null vectors are ignored
+  void addDirection(double aX, double aY, double aZ);
+  /// Add a cone around the direction given by theta and phi
+  void addAxis(double aTheta, double aPhi) { m_axes.emplace_back(aTheta, aPhi); }
+  /// Remove all cones
+  void clear() { m_axes.clear(); }
+
+  /// Check if the direction given by theta and phi is inside any of the cones
+  bool contains(double aTheta, double aPhi) const;
+  /// Check if the direction given by theta and phi is inside the cone with given index
+  bool containedInCone(size_t aIndex, double aTheta, double aPhi) const;
+
+  bool empty() const { return m_axes.empty(); }
+  double coneSize() const { return m_coneSize; }
+  /// Cone axes, as pairs of (theta, phi)
+  const std::vector<std::pair<double, double>>& axes() const { return m_axes; }
+
+private:
+  double m_coneSize;
+  std::vector<std::pair<double, double>> m_axes;
+};
+
+/** @class CellAngleTable
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/ConeRoI.h
+ *
+ *  Table of precomputed theta and phi of calorimeter cells, sorted in theta so that the cells inside a ConeRoI are
+ *  selected with a binary search per cone instead of a loop over all cells.
+ *  Fill the table with add() and call sort() once before the first selection.
+ */
+
+class CellAngleTable {
+public:
+  void add(uint64_t aCellId, double aTheta, double aPhi) { m_cells.push_back({aTheta, aPhi, aCellId}); }
+  void sort();
+  void clear() { m_cells.clear(); }
+  size_t size() const { return m_cells.size(); }
+
+  /** Select the cells inside the region of interest.
+   *   @param[in] aRoI, the region of interest.
+   *   @param[out] aCellIds, cellIDs of the cells inside the region of interest, each cell is added only once, also
+   * if it is inside several cones.
+   */
+  void select(const ConeRoI& aRoI, std::vector<uint64_t>& aCellIds) const;
+
+private:
+  struct Entry {
+    double theta;
+    double phi;
+    uint64_t cellId;
+  };
+  std::vector<Entry> m_cells;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_CONEROI_H */
@@ -0,0 +1,89 @@
+#ifndef RECCALOCOMMON_CORRECTIONFUNCTION_H
+#define RECCALOCOMMON_CORRECTIONFUNCTION_H
+
+// std
+#include <cstddef>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace k4::recCalo {
+
+/** @class CorrectionFunction
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/CorrectionFunction.h
+ *
+ *  Native evaluation of the correction formulas written in ROOT notation, replacing the TF1 interpreter.
+ *  A formula is recognised if it is polN or an arithmetic expression (+, -, *, /, ^ or **, parentheses, unary signs)
+ *  of numbers, parameters [i], the variables x and y, pi, and the functions sqrt, exp, log, log10, pow, abs, sin, cos,
+ *  tan and atan (also with the TMath:: or std:: prefix and the TMath spelling, e.g. TMath::Power). For example
+ *  [0]+[1]*x+[2]*x*x, [0]/sqrt(x)+[1], [0]+[1]/(x-[2]), (x-[1])*(x-[2]) or [0]*exp(-x/[1]).
+ *  Other formulas (e.g. the predefined TF1 functions gaus or expo) are not compiled and should be evaluated with TF1.
+ *  The formula is compiled to a program for a stack machine, evaluated for blocks of points at once.
+ *  As for TF1, the parameters are numbered from 0 to numParameters()-1.
+ */
+
+class CorrectionFunction {
+public:
+  /** Compile the formula.
+   *   @param[in] aFormula, formula in ROOT notation, of the variables x and y.
+   *   @return false if the form of the formula is not recognised.
+   */
+  bool compile(const std::string& aFormula);
+  bool isCompiled() const { return m_compiled; }
+  /// Number of parameters of the formula
+  size_t numParameters() const { return m_numParameters; }
+  /// Set the values of the parameters, aParameters must have numParameters() values
+  void setParameters(std::span<const double> aParameters);
+
+  /// Value of the formula at (aX, aY)
+  double operator()(double aX, double aY = 0.) const;
+  /** Value of the formula at all points (aX[i], aY[i]).
+   *   @param[in] aX, x of the points.
+   *   @param[in] aY, y of the points, or empty if the formula does not depend on y.
+   *   @param[out] aValues, values of the formula, of the size of aX.
+   */
+  void evaluate(std::span<const double> aX, std::span<const double> aY, std::span<double> aValues) const;
+
+  /// Operations of the stack machine
+  enum class Op {
+    // push a value
+    Number,
+    Parameter,
+    X,
+    Y,
+    // binary operations
+    Add,
+    Sub,
+    Mul,
+    Div,
+    Pow,
+    // functions of one argument
+    Neg,
+    Sqrt,
+    Exp,
+    Log,
+    Log10,
+    Abs,
+    Sin,
+    Cos,
+    Tan,
+    Atan
+  };
+  struct Instruction {
+    Op op;
+    /// value of a Number, index of a Parameter
+    double value = 0.;
+    size_t index = 0;
+  };
+  /// Maximum depth of the stack of a compiled formula
+  static constexpr size_t kMaxDepth = 32;
+
+private:
+  bool m_compiled = false;
+  size_t m_numParameters = 0;
+  std::vector<Instruction> m_program;
+  std::vector<double> m_parameters;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_CORRECTIONFUNCTION_H */
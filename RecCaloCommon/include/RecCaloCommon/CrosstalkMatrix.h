@@ -0,0 +1,62 @@
+#ifndef RECCALOCOMMON_CROSSTALKMATRIX_H
+#define RECCALOCOMMON_CROSSTALKMATRIX_H
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace k4::recCalo {
+
+/** @class CrosstalkMatrix
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/CrosstalkMatrix.h
+ *
+ *  Crosstalk neighbours and coefficients of all cells, as a sparse matrix in compressed sparse row (CSR) form: the
+ *  rows are the cells sorted by cellID, and the neighbours of row i are the entries [offsets[i], offsets[i+1]) of the
+ *  neighbour and coefficient arrays, in the order given by the crosstalk model.
+ *  File format: 8-byte magic, number of rows, number of entries, then the cellIDs, the row offsets, the neighbour
+ *  cellIDs and the coefficients, all as 64-bit little-endian values.
+ */
+
+class CrosstalkMatrix {
+public:
+  static constexpr size_t npos = SIZE_MAX;
+
+  void clear();
+  void reserve(size_t aRows, size_t aEntries);
+  /** Append the row of a cell.
+   *   @param[in] aCellId, cellID of the cell, larger than the cellID of the previous row.
+   *   @param[in] aNeighbours, pairs (cellID, crosstalk coefficient) of the crosstalk neighbours.
+   *   @return false if the rows are not appended in increasing cellID order.
+   */
+  bool addRow(uint64_t aCellId, std::span<const std::pair<uint64_t, double>> aNeighbours);
+
+  size_t size() const { return m_cellIds.size(); }
+  size_t entries() const { return m_neighbours.size(); }
+  std::span<const uint64_t> cellIds() const { return m_cellIds; }
+  /// Row of the cell, npos if the cell has no row
+  size_t find(uint64_t aCellId) const;
+  std::span<const uint64_t> neighbours(size_t aRow) const {
+    return std::span<const uint64_t>(m_neighbours).subspan(m_offsets[aRow], m_offsets[aRow + 1] - m_offsets[aRow]);
+  }
+  std::span<const double> crosstalks(size_t aRow) const {
+    return std::span<const double>(m_crosstalks).subspan(m_offsets[aRow], m_offsets[aRow + 1] - m_offsets[aRow]);
+  }
+
+  /// Write the matrix as a binary file, the file is replaced atomically
+  bool save(const std::string& aFileName) const;
+  /// Read a matrix written by save(), false if the file does not exist or is corrupted
+  bool load(const std::string& aFileName);
+
+private:
+  std::vector<uint64_t> m_cellIds;
+  std::vector<uint64_t> m_offsets{0};
+  std::vector<uint64_t> m_neighbours;
+  std::vector<double> m_crosstalks;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_CROSSTALKMATRIX_H */
@@ -0,0 +1,41 @@
+#ifndef RECCALOCOMMON_HASH_H
+#define RECCALOCOMMON_HASH_H
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+namespace k4::recCalo {
+
+/** Combine a 64-bit key with a string of bytes, for the keys of the files cached on disk (e.g. CellListCache).
+ *  FNV-1a over the length and the bytes, seeded with the previous key: the keys are stable across jobs, platforms
+ *  and versions, unlike std::hash.
+ *   @param[in] aKey, previous key, 0 for the first value.
+ *   @param[in] aValue, bytes to combine.
+ */
+inline uint64_t hashCombine(uint64_t aKey, std::string_view aValue) {
+  uint64_t h = aKey ^ 0xcbf29ce484222325ULL;
+  auto add = [&h](unsigned char c) {
+    h ^= c;
+    h *= 0x100000001b3ULL;
+  };
+  for (size_t length = aValue.size(), i = 0; i < sizeof(length); i++) {
+    add(length >> (8 * i));
+  }
+  for (char c : aValue) {
+    add(c);
+  }
+  return h;
+}
+
+/// Combine a 64-bit key with the bytes of a value
+template <typename T>
+  requires std::is_trivially_copyable_v<T>
+uint64_t hashCombineValue(uint64_t aKey, const T& aValue) {
+  return hashCombine(aKey, std::string_view(reinterpret_cast<const char*>(&aValue), sizeof(aValue)));
+}
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_HASH_H */
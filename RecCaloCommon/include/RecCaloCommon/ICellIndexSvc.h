@@ -0,0 +1,35 @@
+#ifndef RECCALOCOMMON_ICELLINDEXSVC_H
+#define RECCALOCOMMON_ICELLINDEXSVC_H
+
+// std
+#include <string>
+
+// Gaudi
+#include "GaudiKernel/IInterface.h"
+
+// k4RecCalorimeter
+#include "RecCaloCommon/CellIndexMap.h"
+
+class ICalorimeterTool;
+
+/** @class ICellIndexSvc RecCaloCommon/include/RecCaloCommon/ICellIndexSvc.h
+ *
+ *  Abstract interface of the service mapping the 64-bit cellIDs of the calorimeter cells to dense 32-bit indices.
+ *  The index of a readout is built once per job, all algorithms asking for the same readout share the same index
+ *  space, so that per-cell quantities can be stored in flat arrays of size size() instead of hash maps keyed by cellID.
+ */
+
+class ICellIndexSvc : virtual public IInterface {
+public:
+  DeclareInterfaceID(ICellIndexSvc, 2, 0);
+
+  /** Index of the cells of a readout, built at the first request of the readout.
+   *   @param[in] aReadoutName, name of the readout.
+   *   @param[in] aGeoTool, geometry tool listing all cells of the readout with prepareEmptyCells, used to build the
+   *   index if no neighbour map file is configured for the readout. May be null if the index is built from a file.
+   *   @return the index, valid until the service is finalized, nullptr if it cannot be built.
+   */
+  virtual const k4::recCalo::CellIndexMap* cellIndex(const std::string& aReadoutName, ICalorimeterTool* aGeoTool) = 0;
+};
+
+#endif /* RECCALOCOMMON_ICELLINDEXSVC_H */
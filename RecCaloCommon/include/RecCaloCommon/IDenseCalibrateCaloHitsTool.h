@@ -0,0 +1,28 @@
+#ifndef RECCALOCOMMON_IDENSECALIBRATECALOHITSTOOL_H
+#define RECCALOCOMMON_IDENSECALIBRATECALOHITSTOOL_H
+
+// std
+#include <cstdint>
+#include <span>
+
+// Gaudi
+#include "GaudiKernel/IAlgTool.h"
+
+/** @class IDenseCalibrateCaloHitsTool RecCaloCommon/include/RecCaloCommon/IDenseCalibrateCaloHitsTool.h
+ *
+ *  Abstract interface for calibration tools that can calibrate cells stored in dense arrays, as a complement to
+ *  ICalibrateCaloHitsTool which works on maps of cells.
+ */
+
+class IDenseCalibrateCaloHitsTool : virtual public IAlgTool {
+public:
+  DeclareInterfaceID(IDenseCalibrateCaloHitsTool, 1, 0);
+
+  /** Calibrate Geant4 energy deposits to the EM scale.
+   *   @param[in] aCellIds, cellIDs of the cells.
+   *   @param[in,out] aEnergies, energies of the cells, same size as aCellIds.
+   */
+  virtual void calibrate(std::span<const uint64_t> aCellIds, std::span<double> aEnergies) = 0;
+};
+
+#endif /* RECCALOCOMMON_IDENSECALIBRATECALOHITSTOOL_H */
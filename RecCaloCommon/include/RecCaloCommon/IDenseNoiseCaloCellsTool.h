@@ -0,0 +1,46 @@
+#ifndef RECCALOCOMMON_IDENSENOISECALOCELLSTOOL_H
+#define RECCALOCOMMON_IDENSENOISECALOCELLSTOOL_H
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Gaudi
+#include "GaudiKernel/IAlgTool.h"
+
+/** @class IDenseNoiseCaloCellsTool RecCaloCommon/include/RecCaloCommon/IDenseNoiseCaloCellsTool.h
+ *
+ *  Abstract interface for noise tools that can process cells stored in dense arrays, as a complement to
+ *  INoiseCaloCellsTool which works on maps of cells.
+ *  The noise of the cells of one event can be added in several consecutive blocks, so that the caller can add noise,
+ *  filter and create its output block by block while the data is in cache. The filter does not remove cells: the
+ *  indices of the cells passing the filter are written to a list, from which the caller builds its output directly.
+ */
+
+class IDenseNoiseCaloCellsTool : virtual public IAlgTool {
+public:
+  DeclareInterfaceID(IDenseNoiseCaloCellsTool, 1, 1);
+
+  /** Add random noise to cells.
+   *   @param[in] aCellIds, cellIDs of the cells.
+   *   @param[in,out] aEnergies, energies of the cells, same size as aCellIds.
+   *   @param[in] aFirst, position of the first cell of the block among all cells of the event.
+   */
+  virtual void addRandomCellNoise(std::span<const uint64_t> aCellIds, std::span<double> aEnergies, size_t aFirst) = 0;
+
+  /** Select the cells with energy above the noise threshold.
+   *   @param[in] aCellIds, cellIDs of the cells.
+   *   @param[in] aEnergies, energies of the cells, same size as aCellIds.
+   *   @param[out] aSelected, indices of the cells passing the filter, in increasing order.
+   */
+  virtual void selectCells(std::span<const uint64_t> aCellIds, std::span<const double> aEnergies,
+                           std::vector<uint32_t>& aSelected) = 0;
+
+  /// Check if the noise is drawn independently of the RndmGenSvc (counter-based generator or noise pool), so that
+  /// several instances of the tool can be called concurrently
+  virtual bool isThreadSafe() const = 0;
+};
+
+#endif /* RECCALOCOMMON_IDENSENOISECALOCELLSTOOL_H */
@@ -0,0 +1,86 @@
+#ifndef RECCALOCOMMON_NOISELEVELTABLE_H
+#define RECCALOCOMMON_NOISELEVELTABLE_H
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace k4::recCalo {
+
+/** @class NoiseLevelTable
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/NoiseLevelTable.h
+ *
+ *  Noise RMS and offset of all cells of a calorimeter, as written by the noise level map services.
+ *  The cells are added system by system together with the function evaluating their noise. The noise is evaluated in
+ *  batches of consecutive cells of one system, the batches being run concurrently, and the table is then ordered by
+ *  cellID, so that it does not depend on the number of threads.
+ *  Besides the TTree written by the services, the table can be written as a compact binary file: 8-byte magic, key of
+ *  the source of the table, number of cells, then the cellIDs, the noise RMS and the noise offsets, all as 64-bit
+ *  little-endian values. A table is only read back for the key it was written with, so that a table written from
+ *  another source is not used.
+ */
+
+class NoiseLevelTable {
+public:
+  /// Evaluation of the noise RMS and offset of a batch of cells
+  using Evaluate = std::function<void(std::span<const uint64_t> aCellIds, std::span<double> aNoiseRMS,
+                                      std::span<double> aNoiseOffset)>;
+
+  /** Add the cells of one system.
+   *   @param[in] aCellIds, cellIDs of the cells.
+   *   @param[in] aEvaluate, evaluation of the noise of the cells, the noise is zero if empty.
+   */
+  void addCells(std::vector<uint64_t> aCellIds, Evaluate aEvaluate);
+  /// Add the cells of one system, with the noise given by a noise tool (INoiseConstTool), zero if aTool is null
+  template <typename NoiseTool>
+  void addCells(std::vector<uint64_t> aCellIds, NoiseTool* aTool) {
+    if (aTool == nullptr) {
+      addCells(std::move(aCellIds), Evaluate());
+      return;
+    }
+    addCells(std::move(aCellIds), [aTool](std::span<const uint64_t> aIds, std::span<double> aRMS,
+                                          std::span<double> aOffset) {
+      for (size_t i = 0; i < aIds.size(); i++) {
+        aRMS[i] = aTool->getNoiseRMSPerCell(aIds[i]);
+        aOffset[i] = aTool->getNoiseOffsetPerCell(aIds[i]);
+      }
+    });
+  }
+
+  /** Evaluate the noise of all added cells and order the table by cellID. A cell added more than once keeps the noise
+   *  of its first occurrence.
+   *   @param[in] aNumThreads, number of threads (0: TBB default, 1: serial), the evaluation functions must then be
+   *   safe to call concurrently.
+   *   @param[in] aBatchSize, number of cells per batch.
+   */
+  void evaluate(int aNumThreads, size_t aBatchSize);
+
+  size_t size() const { return m_cellIds.size(); }
+  std::span<const uint64_t> cellIds() const { return m_cellIds; }
+  std::span<const double> noiseRMS() const { return m_noiseRMS; }
+  std::span<const double> noiseOffset() const { return m_noiseOffset; }
+
+  /// Write the table as a binary file for the source identified by aKey, the file is replaced atomically
+  bool save(const std::string& aFileName, uint64_t aKey = 0) const;
+  /// Read a table written by save(), false if the file does not exist, is corrupted or was written for another key
+  bool load(const std::string& aFileName, uint64_t aKey = 0);
+
+private:
+  /// Cells of one system, before the evaluation
+  struct System {
+    std::vector<uint64_t> cellIds;
+    Evaluate evaluate;
+  };
+  std::vector<System> m_systems;
+
+  std::vector<uint64_t> m_cellIds;
+  std::vector<double> m_noiseRMS;
+  std::vector<double> m_noiseOffset;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_NOISELEVELTABLE_H */
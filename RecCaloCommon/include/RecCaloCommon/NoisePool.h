@@ -0,0 +1,82 @@
+#ifndef RECCALOCOMMON_NOISEPOOL_H
+#define RECCALOCOMMON_NOISEPOOL_H
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace k4::recCalo {
+
+/** @class NoisePool
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/NoisePool.h
+ *
+ *  Pool of standard-normal values generated once per job, from which the noise of each event is gathered.
+ *  The pool size is a power of two. For each event a rotation (offset, odd stride) is derived from (seed, run, event),
+ *  and the i-th value of the event is pool[(offset + i * stride) mod size]: within an event the values are all
+ *  distinct as long as the number of requested values does not exceed the pool size, and two events see different
+ *  pairings of pool values, which keeps the correlation between cells and between events negligible for pools much
+ *  larger than the detector.
+ *  The pool is either generated in memory with CellNoiseGenerator, or mapped from a file written by save().
+ *  File format: 8-byte magic, number of values (64-bit), then the values as float32, all little-endian.
+ */
+
+class NoisePool {
+public:
+  struct Rotation {
+    uint64_t offset = 0;
+    uint64_t stride = 1;
+  };
+
+  NoisePool() = default;
+  ~NoisePool();
+  NoisePool(const NoisePool&) = delete;
+  NoisePool& operator=(const NoisePool&) = delete;
+
+  /** Generate the pool in memory.
+   *   @param[in] aSize, minimal number of values, rounded up to a power of two.
+   *   @param[in] aSeed, seed of the generator.
+   */
+  void generate(size_t aSize, uint64_t aSeed);
+  /** Map the pool from a file written by save().
+   *   @return false if the file cannot be mapped, is corrupted or truncated
+   */
+  bool map(const std::string& aFileName);
+  /// Write the pool to a file that can be mapped later, the file is replaced atomically
+  bool save(const std::string& aFileName) const;
+
+  void setSeed(uint64_t aSeed) { m_seed = aSeed; }
+  /// Rotation of the pool used for an event
+  Rotation rotation(uint64_t aRun, uint64_t aEvent) const;
+  /// Fill aValues with the values of the event, starting from the aFirst-th value
+  void gather(const Rotation& aRotation, std::span<double> aValues, uint64_t aFirst = 0) const {
+    const uint64_t mask = m_size - 1;
+    uint64_t position = aRotation.offset + aFirst * aRotation.stride;
+    for (auto& value : aValues) {
+      value = m_data[position & mask];
+      position += aRotation.stride;
+    }
+  }
+
+  /// Number of values in the pool, 0 if the pool is not initialised
+  size_t size() const { return m_size; }
+  /// Memory used by the pool, in bytes
+  size_t memory() const { return m_size * sizeof(float); }
+
+private:
+  void unmap();
+
+  uint64_t m_seed = 0;
+  size_t m_size = 0;
+  const float* m_data = nullptr;
+  /// storage if the pool is generated in memory
+  std::vector<float> m_storage;
+  /// mapped region if the pool is read from a file
+  void* m_mapped = nullptr;
+  size_t m_mappedLength = 0;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_NOISEPOOL_H */
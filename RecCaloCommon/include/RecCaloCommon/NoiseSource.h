@@ -0,0 +1,91 @@
+#ifndef RECCALOCOMMON_NOISESOURCE_H
+#define RECCALOCOMMON_NOISESOURCE_H
+
+// std
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Gaudi
+#include "GaudiKernel/AlgTool.h"
+#include "GaudiKernel/StatusCode.h"
+
+// edm4hep
+#include "edm4hep/EventHeaderCollection.h"
+
+// k4FWCore
+#include "k4FWCore/DataHandle.h"
+
+// RecCaloCommon
+#include "RecCaloCommon/CellNoiseGenerator.h"
+#include "RecCaloCommon/NoisePool.h"
+
+namespace k4::recCalo {
+
+/** @class NoiseSource
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/NoiseSource.h
+ *
+ *  Standard-normal noise of the cells drawn independently of the RndmGenSvc, shared by the cell noise tools: either
+ *  from the counter-based generator (CellNoiseGenerator) or from a pool of pre-generated values (NoisePool), both
+ *  keyed by the run and event numbers of the event header.
+ *  The source declares its properties on the tool owning it, and is only enabled if counterBasedRNG or the noise pool
+ *  is configured; otherwise the tool draws its noise from the RndmGenSvc.
+ */
+
+class NoiseSource {
+public:
+  /// @param[in] aOwner, tool owning the source, on which the properties and the event header handle are declared
+  explicit NoiseSource(AlgTool* aOwner);
+
+  /// Set up the generator, the pool and the event header handle, to be called from the initialize of the owner
+  StatusCode initialize();
+  /// Release the event header handle, to be called from the finalize of the owner
+  void finalize();
+
+  /// Check if the noise is drawn from this source, rather than from the RndmGenSvc
+  bool isEnabled() const { return m_eventHeader != nullptr; }
+
+  /** Standard-normal noise of a block of cells of the current event.
+   *   @param[in] aCellIds, cellIDs of the cells.
+   *   @param[in] aFirst, position of the first cell of the block among all cells of the event.
+   *   @return one value per cell, valid until the next call
+   */
+  std::span<const double> gaussians(std::span<const uint64_t> aCellIds, size_t aFirst);
+  /// Standard-normal noise of all cells of a map, in the iteration order of the map, valid until the next call
+  std::span<const double> gaussians(const std::unordered_map<uint64_t, double>& aCells);
+
+private:
+  AlgTool* m_owner;
+
+  /// Generate the noise with the counter-based generator instead of RndmGenSvc
+  Gaudi::Property<bool> m_counterBasedRNG;
+  /// Seed of the counter-based generator and of the noise pool
+  Gaudi::Property<uint64_t> m_noiseSeed;
+  /// Name of the event header collection providing the run and event numbers
+  Gaudi::Property<std::string> m_eventHeaderName;
+  /// Size of the pool of pre-generated noise values, as a number of values (not bytes), each using 4 bytes of memory
+  Gaudi::Property<uint64_t> m_noisePoolSize;
+  /// File with the pre-generated noise values
+  Gaudi::Property<std::string> m_noisePoolFile;
+  /// File to which the generated noise pool is written
+  Gaudi::Property<std::string> m_noisePoolOutputFile;
+
+  /// Handle for the event header, only created if the source is enabled
+  std::unique_ptr<k4FWCore::DataHandle<edm4hep::EventHeaderCollection>> m_eventHeader;
+  /// Counter-based noise generator
+  CellNoiseGenerator m_generator;
+  /// Pool of pre-generated noise values, gathered with a different rotation for each event
+  NoisePool m_pool;
+  /// Whether the events were found to have more cells than the pool has values
+  bool m_poolOverflowReported = false;
+  /// Buffers of the cellIDs of a map and of the noise values
+  std::vector<uint64_t> m_cellIds;
+  std::vector<double> m_values;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_NOISESOURCE_H */
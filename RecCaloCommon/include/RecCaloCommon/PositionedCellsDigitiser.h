@@ -0,0 +1,153 @@
+#ifndef RECCALOCOMMON_POSITIONEDCELLSDIGITISER_H
+#define RECCALOCOMMON_POSITIONEDCELLSDIGITISER_H
+
+// std
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Gaudi
+#include "GaudiKernel/CommonMessaging.h"
+#include "GaudiKernel/SmartIF.h"
+#include "GaudiKernel/StatusCode.h"
+
+// edm4hep
+#include "edm4hep/CaloHitSimCaloHitLinkCollection.h"
+#include "edm4hep/CalorimeterHitCollection.h"
+#include "edm4hep/SimCalorimeterHitCollection.h"
+#include "edm4hep/Vector3f.h"
+
+// RecCaloCommon
+#include "RecCaloCommon/IDenseNoiseCaloCellsTool.h"
+
+class ICalibrateCaloHitsTool;
+class ICaloReadCrosstalkMap;
+class ICalorimeterTool;
+class ICellPositionsTool;
+class INoiseCaloCellsTool;
+namespace dd4hep::DDSegmentation {
+class BitFieldCoder;
+}
+
+namespace k4::recCalo {
+
+/** @class PositionedCellsDigitiser
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/PositionedCellsDigitiser.h
+ *
+ *  Digitisation of the Geant4 hits of one readout into positioned calorimeter cells, shared by
+ *  CreatePositionedCaloCells and CreateMultiReadoutCaloCells:
+ *  1/ Merge Geant4 energy deposits with same cellID
+ *  2/ Emulate cross-talk (if switched on)
+ *  3/ Calibrate to electromagnetic scale (if calibration switched on)
+ *  4/ Add random noise to each cell (if noise switched on)
+ *  5/ Filter cells and remove those with energy below threshold (if noise + filtering switched on)
+ *  6/ Add cell positions and type (for Pandora), and the hit<->cell links
+ *  Each instance keeps the cell maps and caches of its readout, so that instances for different readouts (with
+ *  different tools) can be used concurrently.
+ */
+
+class PositionedCellsDigitiser {
+public:
+  struct Settings {
+    /// Add crosstalk to cells?
+    bool addCrosstalk = false;
+    /// Calibrate to EM scale?
+    bool doCellCalibration = true;
+    /// Add noise to cells?
+    bool addCellNoise = true;
+    /// Save only cells with energy above threshold?
+    bool filterCellNoise = false;
+    /// Are the cells to digitise given in each event with resetCells(aCellIds)? (no backup of the empty cells)
+    bool cellsGivenPerEvent = false;
+  };
+  /// Tools of the readout, only those required by the settings need to be set
+  struct Tools {
+    ICalibrateCaloHitsTool* calibTool = nullptr;
+    INoiseCaloCellsTool* noiseTool = nullptr;
+    ICalorimeterTool* geoTool = nullptr;
+    ICellPositionsTool* positionsTool = nullptr;
+    ICaloReadCrosstalkMap* crosstalkTool = nullptr;
+  };
+
+  PositionedCellsDigitiser();
+  PositionedCellsDigitiser(PositionedCellsDigitiser&&);
+  PositionedCellsDigitiser& operator=(PositionedCellsDigitiser&&);
+  ~PositionedCellsDigitiser();
+
+  /** Prepare the digitisation, with the map of all cells of the calorimeter if noise is added.
+   *   @param[in] aSettings, steps of the digitisation.
+   *   @param[in] aTools, tools of the readout.
+   *   @param[in] aCellIDEncoding, cellID encoding of the hits.
+   *   @param[in] aLog, component printing the messages.
+   */
+  StatusCode initialize(const Settings& aSettings, const Tools& aTools, const std::string& aCellIDEncoding,
+                        const CommonMessagingBase& aLog);
+
+  /// Clear the cells of the previous event: reset all cells to zero energy if noise is added, otherwise remove them.
+  /// Cells with energy deposits which are not among the cells of the calorimeter are always removed.
+  void resetCells();
+  /// Clear the cells of the previous event and digitise only the given cells (and the cells with hits)
+  void resetCells(std::span<const uint64_t> aCellIds);
+
+  /** Digitise the hits of one event into cells, after resetCells.
+   *   @param[in] aHits, Geant4 hits.
+   *   @param[out] aCells, created cells.
+   *   @param[out] aLinks, created hit<->cell links, may be null.
+   *   @param[in] aAccept, if set, hits and crosstalk transfers in cells for which it returns false are ignored.
+   */
+  void digitise(const edm4hep::SimCalorimeterHitCollection& aHits, edm4hep::CalorimeterHitCollection& aCells,
+                edm4hep::CaloHitSimCaloHitLinkCollection* aLinks,
+                const std::function<bool(uint64_t)>& aAccept = {});
+
+  /// Retrieve the cell position, from the cache if available
+  edm4hep::Vector3f cellPosition(uint64_t aCellId);
+  /// Cells of the event, with their digitised energy after digitise
+  const std::unordered_map<uint64_t, double>& cells() const { return m_cellsMap; }
+  /// Interface of the noise tool filtering dense arrays of cells, if the noise tool provides it
+  const SmartIF<IDenseNoiseCaloCellsTool>& denseNoiseTool() const { return m_denseNoiseTool; }
+
+private:
+  /// Determine the calorimeter type (for Pandora) from the system of a cell
+  void setCaloType(uint64_t aCellId);
+  /// Are the cells of the previous event reset to zero energy by resetCells(), instead of restored or cleared?
+  bool resetToZero() const {
+    return m_settings.addCellNoise && !m_settings.cellsGivenPerEvent &&
+           (!m_settings.filterCellNoise || m_denseNoiseTool);
+  }
+  /// Add energy to a cell, remembering the cells added to the map of all cells
+  void addEnergy(uint64_t aCellId, double aEnergy);
+
+  Settings m_settings;
+  Tools m_tools;
+  const CommonMessagingBase* m_log = nullptr;
+  std::unique_ptr<dd4hep::DDSegmentation::BitFieldCoder> m_decoder;
+  SmartIF<IDenseNoiseCaloCellsTool> m_denseNoiseTool;
+  /// Maps of cell IDs (corresponding to DD4hep IDs) vs digitised cell energies
+  std::unordered_map<uint64_t, double> m_cellsMap;
+  /// Maps of cell IDs on transfer of signals due to crosstalk
+  std::unordered_map<uint64_t, double> m_crosstalkCellsMap;
+  /// Maps of cell IDs with zero energy, for all cells in calo (needed if addNoise and filterNoise are both set)
+  std::unordered_map<uint64_t, double> m_emptyCellsMap;
+  /// Cells added to the map of all cells in the event as they are not known to the geometry tool, removed in the next
+  std::vector<uint64_t> m_unknownCells;
+  /// Cells flattened for the dense noise filter, and indices of the cells passing the filter
+  std::vector<uint64_t> m_cellIds;
+  std::vector<double> m_cellEnergies;
+  std::vector<uint32_t> m_selectedCells;
+  /// Pairs (cellID, hit index) sorted by cellID, for the hit<->cell links
+  std::vector<std::pair<uint64_t, uint32_t>> m_sortedHits;
+  /// Cache position vs cellID
+  std::unordered_map<uint64_t, edm4hep::Vector3f> m_positionsCache;
+  /// For cell type - for PandoraPFA
+  int m_calotype = -99; // -99 not initialized, -1 unknown, 0 em, 1 had, 2 muon
+  int m_caloid = 0;     // 0 unknown, 1 ecal, 2 hcal, 3 yoke
+  int m_layout = 0;     // 0 any, 1 barrel, 2 endcap
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_POSITIONEDCELLSDIGITISER_H */
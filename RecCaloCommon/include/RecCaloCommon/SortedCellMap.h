@@ -0,0 +1,78 @@
+#ifndef RECCALOCOMMON_SORTEDCELLMAP_H
+#define RECCALOCOMMON_SORTEDCELLMAP_H
+
+// std
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace k4::recCalo {
+
+/** @class SortedCellMap
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/SortedCellMap.h
+ *
+ *  Compact map of cellID to cell energy, stored as a flat vector sorted by cellID (16 bytes per cell). It provides
+ *  the subset of the std::unordered_map interface used for cell lookups (find, end, size), so that algorithms can be
+ *  written for both containers. Cells are appended in chunks and sort() has to be called before the first lookup.
+ */
+
+class SortedCellMap {
+public:
+  using value_type = std::pair<uint64_t, double>;
+  using const_iterator = std::vector<value_type>::const_iterator;
+
+  void reserve(size_t aSize) { m_cells.reserve(aSize); }
+  void clear() { m_cells.clear(); }
+
+  /// Append a chunk of cells
+  void append(std::span<const uint64_t> aCellIds, std::span<const double> aEnergies) {
+    for (size_t i = 0; i < aCellIds.size(); i++) {
+      m_cells.emplace_back(aCellIds[i], aEnergies[i]);
+    }
+  }
+
+  /// Sort the cells by cellID, for cells appended more than once the last energy is kept
+  void sort() {
+    std::stable_sort(m_cells.begin(), m_cells.end(),
+                     [](const value_type& lhs, const value_type& rhs) { return lhs.first < rhs.first; });
+    auto last = m_cells.end();
+    if (!m_cells.empty()) {
+      // keep the last entry of each run of equal cellIDs
+      auto out = m_cells.begin();
+      for (auto it = m_cells.begin(); it != m_cells.end(); ++it) {
+        if (it + 1 != m_cells.end() && (it + 1)->first == it->first) {
+          continue;
+        }
+        *out++ = *it;
+      }
+      last = out;
+    }
+    m_cells.erase(last, m_cells.end());
+  }
+
+  const_iterator find(uint64_t aCellId) const {
+    auto it = std::lower_bound(m_cells.begin(), m_cells.end(), aCellId,
+                               [](const value_type& lhs, uint64_t rhs) { return lhs.first < rhs; });
+    if (it == m_cells.end() || it->first != aCellId) {
+      return m_cells.end();
+    }
+    return it;
+  }
+
+  const_iterator begin() const { return m_cells.begin(); }
+  const_iterator end() const { return m_cells.end(); }
+  size_t size() const { return m_cells.size(); }
+  /// Number of cells which fit in the allocated memory
+  size_t capacity() const { return m_cells.capacity(); }
+  bool empty() const { return m_cells.empty(); }
+  /// Memory used by the cells, in bytes
+  size_t memory() const { return m_cells.capacity() * sizeof(value_type); }
+
+private:
+  std::vector<value_type> m_cells;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_SORTEDCELLMAP_H */
@@ -0,0 +1,99 @@
+#ifndef RECCALOCOMMON_THREADLOCALHISTOGRAM_H
+#define RECCALOCOMMON_THREADLOCALHISTOGRAM_H
+
+// std
+#include <cstddef>
+#include <vector>
+
+// TBB
+#include <tbb/enumerable_thread_specific.h>
+
+class TH1;
+
+namespace k4::recCalo {
+
+/** @class ThreadLocalHistogram
+ * k4RecCalorimeter/RecCaloCommon/include/RecCaloCommon/ThreadLocalHistogram.h
+ *
+ *  Monitoring histogram safe to fill from concurrent events. The fills are binned with the axes of a ROOT TH1 or TH2
+ *  and accumulated in memory private to each thread. Each histogram is booked in a Registry, usually one per
+ *  algorithm, and Registry::merge() adds the fills of all its histograms to the ROOT histograms, typically in the
+ *  finalize of the algorithm, before the histogram service writes them. After the merge, the contents, errors,
+ *  statistics and number of entries of the ROOT histogram are those obtained by filling it directly (up to the
+ *  rounding of the single precision contents of TH1F and TH2F, summed here in double precision).
+ *  The axes of the histogram must not be extendable. The ROOT histogram must not be filled directly while fills
+ *  are accumulated. As the registry refers to the histograms, they can be neither copied nor moved: use a
+ *  std::deque, not a std::vector, for a variable number of histograms.
+ */
+
+class ThreadLocalHistogram {
+public:
+  /// Histograms merged together, e.g. all histograms of an algorithm
+  class Registry {
+  public:
+    /// Add the fills accumulated by all threads to the ROOT histograms and reset them, not safe during the fills
+    void merge();
+
+  private:
+    friend class ThreadLocalHistogram;
+    std::vector<ThreadLocalHistogram*> m_histograms;
+  };
+
+  ThreadLocalHistogram() = default;
+  ThreadLocalHistogram(const ThreadLocalHistogram&) = delete;
+  ThreadLocalHistogram& operator=(const ThreadLocalHistogram&) = delete;
+
+  /** Accumulate the fills of a histogram.
+   *   @param[in] aHistogram, TH1 or TH2 with fixed axes, usually registered to the histogram service which owns it.
+   *   @param[in] aRegistry, registry merging the histogram.
+   */
+  void book(TH1* aHistogram, Registry& aRegistry);
+  /// ROOT histogram, holding the accumulated fills after Registry::merge()
+  TH1* histogram() const { return m_histogram; }
+
+  /// Fill a 1D histogram, as TH1::Fill(x, w)
+  void fill(double aX, double aWeight = 1.);
+  /// Fill a 2D histogram, as TH2::Fill(x, y, w)
+  void fill2D(double aX, double aY, double aWeight = 1.);
+
+private:
+  /// Add the fills accumulated by all threads to the ROOT histogram and reset them
+  void merge();
+
+  /// Axis of the histogram, bin 0 is the underflow and bin numBins + 1 the overflow
+  struct Axis {
+    int numBins = 0;
+    double min = 0.;
+    double max = 0.;
+    /// bin edges if the bins are not of equal width
+    std::vector<double> edges;
+    int bin(double aValue) const;
+  };
+  /// Fills accumulated by one thread: contents and sums of squares of weights of all bins, and the statistics
+  struct Contents {
+    std::vector<double> sumw;
+    std::vector<double> sumw2;
+    double entries = 0.;
+    bool weighted = false;
+    double tsumw = 0.;
+    double tsumw2 = 0.;
+    double tsumwx = 0.;
+    double tsumwx2 = 0.;
+    double tsumwy = 0.;
+    double tsumwy2 = 0.;
+    double tsumwxy = 0.;
+  };
+  Contents& local();
+
+  TH1* m_histogram = nullptr;
+  Axis m_xAxis;
+  Axis m_yAxis;
+  /// number of bins including the underflow and overflow bins
+  size_t m_numBins = 0;
+  /// fills outside of the axes are included in the statistics
+  bool m_statOverflows = false;
+  tbb::enumerable_thread_specific<Contents> m_contents;
+};
+
+} /* namespace k4::recCalo */
+#endif /* RECCALOCOMMON_THREADLOCALHISTOGRAM_H */
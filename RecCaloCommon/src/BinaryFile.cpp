@@ -0,0 +1,63 @@
+#include "RecCaloCommon/BinaryFile.h"
+
+// std
+#include <cstring>
+
+// POSIX
+#include <unistd.h>
+
+namespace k4::recCalo {
+
+BinaryFileWriter::BinaryFileWriter(const std::string& aFileName, const char (&aMagic)[kMagicSize],
+                                   std::initializer_list<uint64_t> aHeader)
+    : m_path(aFileName) {
+  std::error_code error;
+  if (m_path.has_parent_path()) {
+    std::filesystem::create_directories(m_path.parent_path(), error);
+  }
+  // written to a file private to this process and renamed, readers never see a partial file
+  m_temporary = m_path;
+  m_temporary += ".tmp" + std::to_string(getpid());
+  m_file.open(m_temporary, std::ios::binary | std::ios::trunc);
+  m_file.write(aMagic, kMagicSize);
+  write(std::span<const uint64_t>(aHeader.begin(), aHeader.size()));
+}
+
+BinaryFileWriter::~BinaryFileWriter() {
+  if (!m_committed) {
+    m_file.close();
+    std::error_code error;
+    std::filesystem::remove(m_temporary, error);
+  }
+}
+
+bool BinaryFileWriter::commit() {
+  m_file.close();
+  if (!m_file) {
+    return false;
+  }
+  std::error_code error;
+  std::filesystem::rename(m_temporary, m_path, error);
+  if (error) {
+    return false;
+  }
+  m_committed = true;
+  return true;
+}
+
+BinaryFileReader::BinaryFileReader(const std::string& aFileName, const char (&aMagic)[kMagicSize],
+                                   std::span<uint64_t> aHeader)
+    : m_file(aFileName, std::ios::binary) {
+  char magic[kMagicSize];
+  if (!m_file.read(magic, kMagicSize) || std::memcmp(magic, aMagic, kMagicSize) != 0 ||
+      !m_file.read(reinterpret_cast<char*>(aHeader.data()), aHeader.size_bytes())) {
+    return;
+  }
+  m_payloadOffset = m_file.tellg();
+  m_file.seekg(0, std::ios::end);
+  m_payloadSize = uint64_t(m_file.tellg()) - m_payloadOffset;
+  m_file.seekg(m_payloadOffset);
+  m_good = bool(m_file);
+}
+
+} /* namespace k4::recCalo */
@@ -0,0 +1,129 @@
+#include "RecCaloCommon/CellIndexMap.h"
+
+// std
+#include <algorithm>
+#include <numeric>
+
+namespace k4::recCalo {
+
+namespace {
+  /// average number of keys per bucket
+  constexpr double kBucketLoad = 4.;
+  /// fraction of occupied slots in the table
+  constexpr double kTableLoad = 0.97;
+  /// maximum number of pilots tried per bucket before changing the seed
+  constexpr uint32_t kMaxPilot = 1u << 20;
+  /// maximum number of seeds tried
+  constexpr int kMaxSeeds = 16;
+} // namespace
+
+bool CellIndexMap::build(std::span<const uint64_t> aCellIds) {
+  m_cellIds.assign(aCellIds.begin(), aCellIds.end());
+  std::sort(m_cellIds.begin(), m_cellIds.end());
+  m_cellIds.erase(std::unique(m_cellIds.begin(), m_cellIds.end()), m_cellIds.end());
+  m_cellIds.shrink_to_fit();
+  if (m_cellIds.empty()) {
+    return true;
+  }
+  m_numBuckets = std::max<uint64_t>(1, m_cellIds.size() / kBucketLoad);
+  m_tableSize = std::max<uint64_t>(m_cellIds.size(), m_cellIds.size() / kTableLoad + 1);
+  // the slots are reduced from the hash with a 64x32-bit multiplication, and the indices are 32-bit
+  if (m_tableSize > UINT32_MAX) {
+    m_cellIds.clear();
+    return false;
+  }
+  for (int iSeed = 0; iSeed < kMaxSeeds; iSeed++) {
+    if (tryBuild(hash(iSeed, 0x6a09e667f3bcc908ULL))) {
+      return true;
+    }
+  }
+  m_cellIds.clear();
+  return false;
+}
+
+bool CellIndexMap::tryBuild(uint64_t aSeed) {
+  m_seed = aSeed;
+  const uint32_t numKeys = m_cellIds.size();
+
+  // distribute the keys in buckets
+  std::vector<uint64_t> hashes(numKeys);
+  std::vector<uint32_t> bucketSize(m_numBuckets + 1, 0);
+  for (uint32_t i = 0; i < numKeys; i++) {
+    hashes[i] = hash(m_cellIds[i], m_seed);
+    bucketSize[bucket(hashes[i]) + 1]++;
+  }
+  std::vector<uint32_t> bucketStart(bucketSize);
+  std::partial_sum(bucketStart.begin(), bucketStart.end(), bucketStart.begin());
+  std::vector<uint32_t> keysInBuckets(numKeys);
+  {
+    std::vector<uint32_t> fill(bucketStart.begin(), bucketStart.end() - 1);
+    for (uint32_t i = 0; i < numKeys; i++) {
+      keysInBuckets[fill[bucket(hashes[i])]++] = i;
+    }
+  }
+
+  // place the largest buckets first
+  std::vector<uint32_t> bucketOrder(m_numBuckets);
+  std::iota(bucketOrder.begin(), bucketOrder.end(), 0);
+  std::stable_sort(bucketOrder.begin(), bucketOrder.end(), [&bucketSize](uint32_t lhs, uint32_t rhs) {
+    return bucketSize[lhs + 1] > bucketSize[rhs + 1];
+  });
+
+  m_pilots.assign(m_numBuckets, 0);
+  m_occupied.assign((m_tableSize + 63) / 64 + 1, 0);
+  std::vector<uint32_t> slotKey(m_tableSize, 0);
+  std::vector<uint64_t> slots;
+  for (auto iBucket : bucketOrder) {
+    const uint32_t size = bucketSize[iBucket + 1];
+    if (size == 0) {
+      break;
+    }
+    bool placed = false;
+    for (uint32_t pilot = 0; pilot < kMaxPilot && !placed; pilot++) {
+      slots.clear();
+      placed = true;
+      for (uint32_t k = bucketStart[iBucket]; k < bucketStart[iBucket] + size; k++) {
+        uint64_t slot = position(hashes[keysInBuckets[k]], pilot);
+        if ((m_occupied[slot >> 6] >> (slot & 63)) & 1 || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+          placed = false;
+          break;
+        }
+        slots.push_back(slot);
+      }
+      if (placed) {
+        m_pilots[iBucket] = pilot;
+        for (uint32_t k = 0; k < size; k++) {
+          m_occupied[slots[k] >> 6] |= uint64_t(1) << (slots[k] & 63);
+          slotKey[slots[k]] = keysInBuckets[bucketStart[iBucket] + k];
+        }
+      }
+    }
+    if (!placed) {
+      return false;
+    }
+  }
+
+  // rank the occupied slots
+  m_rankBlocks.assign(m_occupied.size(), 0);
+  m_order.clear();
+  m_order.reserve(numKeys);
+  uint32_t rank = 0;
+  for (size_t iBlock = 0; iBlock < m_occupied.size(); iBlock++) {
+    m_rankBlocks[iBlock] = rank;
+    rank += popcount(m_occupied[iBlock]);
+  }
+  for (uint64_t slot = 0; slot < m_tableSize; slot++) {
+    if ((m_occupied[slot >> 6] >> (slot & 63)) & 1) {
+      m_order.push_back(slotKey[slot]);
+    }
+  }
+  return true;
+}
+
+size_t CellIndexMap::memory() const {
+  return m_pilots.size() * sizeof(uint32_t) + m_occupied.size() * sizeof(uint64_t) +
+         m_rankBlocks.size() * sizeof(uint32_t) + m_order.size() * sizeof(uint32_t) +
+         m_cellIds.size() * sizeof(uint64_t);
+}
+
+} /* namespace k4::recCalo */
@@ -0,0 +1,150 @@
+#include "RecCaloCommon/CellListCache.h"
+
+// std
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+
+// Gaudi
+#include "Gaudi/Property.h"
+
+// DD4hep
+#include "DD4hep/Detector.h"
+#include "DD4hep/Readout.h"
+#include "DDSegmentation/MultiSegmentation.h"
+#include "DDSegmentation/Segmentation.h"
+
+// ROOT
+#include "TGeoBBox.h"
+#include "TGeoManager.h"
+#include "TGeoVolume.h"
+
+// RecCaloCommon
+#include "RecCaloCommon/BinaryFile.h"
+#include "RecCaloCommon/Hash.h"
+
+namespace k4::recCalo {
+
+namespace {
+constexpr char kMagic[8] = {'K', '4', 'C', 'E', 'L', 'L', 'S', '1'};
+
+uint64_t combineSegmentation(uint64_t aKey, const dd4hep::DDSegmentation::Segmentation& aSegmentation) {
+  aKey = hashCombine(aKey, aSegmentation.type());
+  for (const auto* parameter : aSegmentation.parameters()) {
+    aKey = hashCombine(aKey, parameter->name());
+    aKey = hashCombine(aKey, parameter->value());
+  }
+  // the parameters of a multi-segmentation do not include the ones of its sub-segmentations
+  if (const auto* multi = dynamic_cast<const dd4hep::DDSegmentation::MultiSegmentation*>(&aSegmentation)) {
+    for (const auto& entry : multi->subSegmentations()) {
+      aKey = hashCombineValue(aKey, entry.key_min);
+      aKey = hashCombineValue(aKey, entry.key_max);
+      aKey = combineSegmentation(aKey, *entry.segmentation);
+    }
+  }
+  return aKey;
+}
+} // namespace
+
+uint64_t CellListCache::combine(uint64_t aKey,
+                                std::initializer_list<const Gaudi::Details::PropertyBase*> aProperties) {
+  for (const auto* property : aProperties) {
+    aKey = hashCombine(aKey, property->name());
+    aKey = hashCombine(aKey, property->toString());
+  }
+  return aKey;
+}
+
+uint64_t CellListCache::geometryKey(const dd4hep::Detector& aDetector, const std::string& aReadoutName) {
+  auto readout = aDetector.readout(aReadoutName);
+  uint64_t key = hashCombine(0, aReadoutName);
+  key = hashCombine(key, readout.idSpec().fieldDescription());
+  key = combineSegmentation(key, *readout.segmentation().segmentation());
+  // the cells are enumerated from the placed volumes and their dimensions, the list of volumes is much cheaper to
+  // go through than the tree of placements
+  const TObjArray* volumes = aDetector.manager().GetListOfVolumes();
+  for (int i = 0; i < volumes->GetEntriesFast(); i++) {
+    const auto* volume = static_cast<const TGeoVolume*>(volumes->UncheckedAt(i));
+    key = hashCombine(key, volume->GetName());
+    key = hashCombineValue(key, volume->GetNdaughters());
+    if (const auto* box = dynamic_cast<const TGeoBBox*>(volume->GetShape())) {
+      key = hashCombineValue(key, box->GetDX());
+      key = hashCombineValue(key, box->GetDY());
+      key = hashCombineValue(key, box->GetDZ());
+    }
+  }
+  return key;
+}
+
+CellListCache::CellListCache(const std::string& aDirectory, const std::string& aReadoutName, uint64_t aKey)
+    : m_key(aKey) {
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(aKey));
+  m_fileName = (std::filesystem::path(aDirectory) / (aReadoutName + "_" + name + ".cells")).string();
+}
+
+bool CellListCache::load(std::vector<uint64_t>& aCellIds) const {
+  uint64_t header[2];
+  BinaryFileReader file(m_fileName, kMagic, header);
+  if (!file || header[0] != m_key || file.payloadSize() != header[1] * sizeof(uint64_t)) {
+    return false;
+  }
+  return file.read(aCellIds, header[1]) && std::is_sorted(aCellIds.begin(), aCellIds.end());
+}
+
+bool CellListCache::save(std::span<const uint64_t> aCellIds) const {
+  BinaryFileWriter file(m_fileName, kMagic, {m_key, aCellIds.size()});
+  file.write(aCellIds);
+  return file.commit();
+}
+
+StatusCode CellListCache::prepareEmptyCells(
+    std::unordered_map<uint64_t, double>& aCells, bool aValidate, MsgStream& aLog,
+    const std::function<StatusCode(std::unordered_map<uint64_t, double>&)>& aEnumerate) const {
+  std::vector<uint64_t> cached;
+  bool found = load(cached);
+  if (found && !aValidate) {
+    aLog << MSG::INFO << "Read " << cached.size() << " cells from cache " << m_fileName << endmsg;
+    aCells.reserve(aCells.size() + cached.size());
+    for (auto cellId : cached) {
+      aCells.emplace(cellId, 0);
+    }
+    return StatusCode::SUCCESS;
+  }
+
+  std::unordered_map<uint64_t, double> enumerated;
+  if (aEnumerate(enumerated).isFailure()) {
+    return StatusCode::FAILURE;
+  }
+  std::vector<uint64_t> cellIds;
+  cellIds.reserve(enumerated.size());
+  for (const auto& cell : enumerated) {
+    cellIds.push_back(cell.first);
+  }
+  std::sort(cellIds.begin(), cellIds.end());
+  if (found) {
+    if (cellIds == cached) {
+      aLog << MSG::INFO << "Cell cache " << m_fileName << " validated against the geometry (" << cached.size()
+           << " cells)" << endmsg;
+    } else {
+      aLog << MSG::WARNING << "Cell cache " << m_fileName << " (" << cached.size()
+           << " cells) differs from the geometry (" << cellIds.size() << " cells), rewriting it" << endmsg;
+      found = false;
+    }
+  }
+  if (!found) {
+    if (save(cellIds)) {
+      aLog << MSG::INFO << "Wrote " << cellIds.size() << " cells to cache " << m_fileName << endmsg;
+    } else {
+      aLog << MSG::WARNING << "Unable to write cell cache " << m_fileName << endmsg;
+    }
+  }
+  if (aCells.empty()) {
+    aCells = std::move(enumerated);
+  } else {
+    aCells.insert(enumerated.begin(), enumerated.end());
+  }
+  return StatusCode::SUCCESS;
+}
+
+} /* namespace k4::recCalo */
@@ -0,0 +1,84 @@
+#include "RecCaloCommon/CellNoiseGenerator.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+namespace k4::recCalo {
+
+namespace {
+  constexpr uint32_t kPhiloxM0 = 0xD2511F53;
+  constexpr uint32_t kPhiloxM1 = 0xCD9E8D57;
+  constexpr uint32_t kPhiloxW0 = 0x9E3779B9;
+  constexpr uint32_t kPhiloxW1 = 0xBB67AE85;
+  constexpr double kTwoPi = 6.283185307179586;
+  /// number of cells processed per block in the batched generation
+  constexpr size_t kBlock = 256;
+
+  inline void philoxRounds(uint32_t& c0, uint32_t& c1, uint32_t& c2, uint32_t& c3, uint32_t k0, uint32_t k1) {
+    for (int round = 0; round < 10; round++) {
+      uint64_t p0 = uint64_t(kPhiloxM0) * c0;
+      uint64_t p1 = uint64_t(kPhiloxM1) * c2;
+      uint32_t n0 = uint32_t(p1 >> 32) ^ c1 ^ k0;
+      uint32_t n2 = uint32_t(p0 >> 32) ^ c3 ^ k1;
+      c1 = uint32_t(p1);
+      c3 = uint32_t(p0);
+      c0 = n0;
+      c2 = n2;
+      k0 += kPhiloxW0;
+      k1 += kPhiloxW1;
+    }
+  }
+
+  /// uniform in (0, 1], from 53 random bits
+  inline double toUniformOpenZero(uint32_t aHi, uint32_t aLo) {
+    return ((uint64_t(aHi) << 21 ^ aLo >> 11) + 1) * 0x1p-53;
+  }
+  /// uniform in [0, 1), from 53 random bits
+  inline double toUniform(uint32_t aHi, uint32_t aLo) { return (uint64_t(aHi) << 21 ^ aLo >> 11) * 0x1p-53; }
+} // namespace
+
+std::array<uint32_t, 4> CellNoiseGenerator::philox(std::array<uint32_t, 4> aCounter, std::array<uint32_t, 2> aKey) {
+  philoxRounds(aCounter[0], aCounter[1], aCounter[2], aCounter[3], aKey[0], aKey[1]);
+  return aCounter;
+}
+
+std::array<uint32_t, 2> CellNoiseGenerator::key(uint64_t aRun) const {
+  // mix the run number into the seed so that consecutive runs do not produce related keys
+  uint64_t z = m_seed + 0x9e3779b97f4a7c15ULL * (aRun + 1);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  z ^= z >> 31;
+  return {uint32_t(z), uint32_t(z >> 32)};
+}
+
+double CellNoiseGenerator::gaussian(uint64_t aRun, uint64_t aEvent, uint64_t aCellId) const {
+  double result;
+  gaussians(aRun, aEvent, std::span<const uint64_t>(&aCellId, 1), std::span<double>(&result, 1));
+  return result;
+}
+
+void CellNoiseGenerator::gaussians(uint64_t aRun, uint64_t aEvent, std::span<const uint64_t> aCellIds,
+                                   std::span<double> aGaussians) const {
+  const auto k = key(aRun);
+  const uint32_t e0 = uint32_t(aEvent);
+  const uint32_t e1 = uint32_t(aEvent >> 32);
+  double radius[kBlock];
+  double angle[kBlock];
+  for (size_t start = 0; start < aCellIds.size(); start += kBlock) {
+    const size_t size = std::min(kBlock, aCellIds.size() - start);
+    const uint64_t* ids = aCellIds.data() + start;
+    for (size_t i = 0; i < size; i++) {
+      uint32_t c0 = uint32_t(ids[i]), c1 = uint32_t(ids[i] >> 32), c2 = e0, c3 = e1;
+      philoxRounds(c0, c1, c2, c3, k[0], k[1]);
+      radius[i] = toUniformOpenZero(c0, c1);
+      angle[i] = toUniform(c2, c3);
+    }
+    double* out = aGaussians.data() + start;
+    for (size_t i = 0; i < size; i++) {
+      out[i] = std::sqrt(-2. * std::log(radius[i])) * std::cos(kTwoPi * angle[i]);
+    }
+  }
+}
+
+} /* namespace k4::recCalo */
@@ -0,0 +1,62 @@
+#include "RecCaloCommon/ConeRoI.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+
+namespace k4::recCalo {
+
+void ConeRoI::addDirection(double aX, double aY, double aZ) {
+  if (aX == 0 && aY == 0 && aZ == 0) {
+    return;
+  }
+  addAxis(std::atan2(std::hypot(aX, aY), aZ), std::atan2(aY, aX));
+}
+
+bool ConeRoI::containedInCone(size_t aIndex, double aTheta, double aPhi) const {
+  double dTheta = aTheta - m_axes[aIndex].first;
+  double dPhi = std::remainder(aPhi - m_axes[aIndex].second, 2 * M_PI);
+  return dTheta * dTheta + dPhi * dPhi < m_coneSize * m_coneSize;
+}
+
+bool ConeRoI::contains(double aTheta, double aPhi) const {
+  for (size_t i = 0; i < m_axes.size(); i++) {
+    if (containedInCone(i, aTheta, aPhi)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void CellAngleTable::sort() {
+  std::sort(m_cells.begin(), m_cells.end(), [](const Entry& lhs, const Entry& rhs) {
+    return lhs.theta < rhs.theta || (lhs.theta == rhs.theta && lhs.cellId < rhs.cellId);
+  });
+}
+
+void CellAngleTable::select(const ConeRoI& aRoI, std::vector<uint64_t>& aCellIds) const {
+  aCellIds.clear();
+  const double coneSize = aRoI.coneSize();
+  const auto& axes = aRoI.axes();
+  for (size_t iAxis = 0; iAxis < axes.size(); iAxis++) {
+    auto begin = std::lower_bound(m_cells.begin(), m_cells.end(), axes[iAxis].first - coneSize,
+                                  [](const Entry& lhs, double rhs) { return lhs.theta < rhs; });
+    auto end = std::upper_bound(begin, m_cells.end(), axes[iAxis].first + coneSize,
+                                [](double lhs, const Entry& rhs) { return lhs < rhs.theta; });
+    for (auto it = begin; it != end; ++it) {
+      if (!aRoI.containedInCone(iAxis, it->theta, it->phi)) {
+        continue;
+      }
+      // cells in overlapping cones are collected by the first cone only
+      bool inPreviousCone = false;
+      for (size_t iPrevious = 0; iPrevious < iAxis && !inPreviousCone; iPrevious++) {
+        inPreviousCone = aRoI.containedInCone(iPrevious, it->theta, it->phi);
+      }
+      if (!inPreviousCone) {
+        aCellIds.push_back(it->cellId);
+      }
+    }
+  }
+}
+
+} /* namespace k4::recCalo */
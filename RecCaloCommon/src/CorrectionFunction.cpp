@@ -0,0 +1,410 @@
+#include "RecCaloCommon/CorrectionFunction.h"
+
+// std
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <numbers>
+#include <string_view>
+#include <utility>
+
+namespace k4::recCalo {
+
+namespace {
+using Op = CorrectionFunction::Op;
+using Instruction = CorrectionFunction::Instruction;
+
+/// Functions of one argument, by name (lower case and TMath spelling)
+constexpr std::pair<std::string_view, Op> kFunctions[] = {
+    {"sqrt", Op::Sqrt},   {"Sqrt", Op::Sqrt},   // square root
+    {"exp", Op::Exp},     {"Exp", Op::Exp},     // exponential
+    {"log", Op::Log},     {"Log", Op::Log},     // natural logarithm
+    {"log10", Op::Log10}, {"Log10", Op::Log10}, // decimal logarithm
+    {"abs", Op::Abs},     {"Abs", Op::Abs},     // absolute value
+    {"fabs", Op::Abs},                          //
+    {"sin", Op::Sin},     {"Sin", Op::Sin},     // trigonometric functions
+    {"cos", Op::Cos},     {"Cos", Op::Cos},     //
+    {"tan", Op::Tan},     {"Tan", Op::Tan},     //
+    {"atan", Op::Atan},   {"ATan", Op::Atan}};
+
+/// Recursive descent parser of an expression, writing the program in reverse Polish notation
+class Parser {
+public:
+  explicit Parser(std::string aText) : m_text(std::move(aText)) {}
+
+  bool parse(std::vector<Instruction>& aProgram) {
+    m_program = &aProgram;
+    return parseSum() && m_pos == m_text.size();
+  }
+
+private:
+  bool accept(char aChar) {
+    if (m_pos < m_text.size() && m_text[m_pos] == aChar) {
+      m_pos++;
+      return true;
+    }
+    return false;
+  }
+  void emit(Op aOp, double aValue = 0., size_t aIndex = 0) { m_program->push_back({aOp, aValue, aIndex}); }
+
+  /// Sum of products
+  bool parseSum() {
+    if (!parseProduct()) {
+      return false;
+    }
+    while (true) {
+      if (accept('+')) {
+        if (!parseProduct()) {
+          return false;
+        }
+        emit(Op::Add);
+      } else if (accept('-')) {
+        if (!parseProduct()) {
+          return false;
+        }
+        emit(Op::Sub);
+      } else {
+        return true;
+      }
+    }
+  }
+
+  /// Product of signed factors
+  bool parseProduct() {
+    if (!parseSigned()) {
+      return false;
+    }
+    while (true) {
+      if (accept('*')) {
+        if (!parseSigned()) {
+          return false;
+        }
+        emit(Op::Mul);
+      } else if (accept('/')) {
+        if (!parseSigned()) {
+          return false;
+        }
+        emit(Op::Div);
+      } else {
+        return true;
+      }
+    }
+  }
+
+  /// Factor with optional unary signs, -x^2 being -(x^2)
+  bool parseSigned() {
+    if (accept('-')) {
+      if (!parseSigned()) {
+        return false;
+      }
+      emit(Op::Neg);
+      return true;
+    }
+    if (accept('+')) {
+      return parseSigned();
+    }
+    return parsePower();
+  }
+
+  /// Primary raised to a (right-associative) power
+  bool parsePower() {
+    if (!parsePrimary()) {
+      return false;
+    }
+    if (accept('^')) {
+      if (!parseSigned()) {
+        return false;
+      }
+      emit(Op::Pow);
+    }
+    return true;
+  }
+
+  bool parsePrimary() {
+    if (m_pos == m_text.size()) {
+      return false;
+    }
+    const char c = m_text[m_pos];
+    if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+      char* end = nullptr;
+      double number = std::strtod(m_text.c_str() + m_pos, &end);
+      m_pos = end - m_text.c_str();
+      emit(Op::Number, number);
+      return true;
+    }
+    if (accept('[')) {
+      size_t begin = m_pos;
+      while (m_pos < m_text.size() && std::isdigit(static_cast<unsigned char>(m_text[m_pos]))) {
+        m_pos++;
+      }
+      if (m_pos == begin || !accept(']')) {
+        return false;
+      }
+      emit(Op::Parameter, 0., std::stoul(m_text.substr(begin, m_pos - begin - 1)));
+      return true;
+    }
+    if (accept('(')) {
+      return parseSum() && accept(')');
+    }
+    if (!std::isalpha(static_cast<unsigned char>(c))) {
+      return false;
+    }
+    size_t begin = m_pos;
+    while (m_pos < m_text.size() && (std::isalnum(static_cast<unsigned char>(m_text[m_pos])) || m_text[m_pos] == '_')) {
+      m_pos++;
+    }
+    const std::string_view name(m_text.data() + begin, m_pos - begin);
+    if (name == "x") {
+      emit(Op::X);
+      return true;
+    }
+    if (name == "y") {
+      emit(Op::Y);
+      return true;
+    }
+    if (name == "pi" || name == "Pi") {
+      // TMath::Pi() is a function call
+      if (name == "Pi" && !(accept('(') && accept(')'))) {
+        return false;
+      }
+      emit(Op::Number, std::numbers::pi);
+      return true;
+    }
+    if (name == "pow" || name == "Power") {
+      if (!accept('(') || !parseSum() || !accept(',') || !parseSum() || !accept(')')) {
+        return false;
+      }
+      emit(Op::Pow);
+      return true;
+    }
+    for (const auto& [function, op] : kFunctions) {
+      if (name == function) {
+        if (!accept('(') || !parseSum() || !accept(')')) {
+          return false;
+        }
+        emit(op);
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::string m_text;
+  size_t m_pos = 0;
+  std::vector<Instruction>* m_program = nullptr;
+};
+
+/// Normalise the spelling of the formula: no spaces, ^ for powers, no TMath:: and std:: prefixes
+std::string normalise(const std::string& aFormula) {
+  std::string text;
+  for (char c : aFormula) {
+    if (!std::isspace(static_cast<unsigned char>(c))) {
+      text += c;
+    }
+  }
+  auto replace = [&text](std::string_view aFrom, std::string_view aTo) {
+    for (size_t pos = text.find(aFrom); pos != std::string::npos; pos = text.find(aFrom, pos + aTo.size())) {
+      text.replace(pos, aFrom.size(), aTo);
+    }
+  };
+  replace("**", "^");
+  replace("TMath::", "");
+  replace("std::", "");
+  return text;
+}
+
+/// Power with the usual exponents computed without std::pow
+inline double power(double aBase, double aExponent) {
+  if (aExponent == 1.) {
+    return aBase;
+  } else if (aExponent == 2.) {
+    return aBase * aBase;
+  } else if (aExponent == 3.) {
+    return aBase * aBase * aBase;
+  } else if (aExponent == -1.) {
+    return 1. / aBase;
+  } else if (aExponent == -2.) {
+    return 1. / (aBase * aBase);
+  } else if (aExponent == 0.5) {
+    return std::sqrt(aBase);
+  } else if (aExponent == -0.5) {
+    return 1. / std::sqrt(aBase);
+  }
+  return std::pow(aBase, aExponent);
+}
+
+/** Run the program for a block of aSize points, aStack[k] being the k-th level of the stack for all points.
+ *  Operands are popped from the top of the stack, the result of an operation replaces its first operand.
+ */
+template <size_t kBlock>
+void run(const std::vector<Instruction>& aProgram, const std::vector<double>& aParameters, const double* aX,
+         const double* aY, size_t aSize, double (*aStack)[kBlock]) {
+  size_t top = 0;
+  auto unary = [&](auto aFunction) {
+    double* a = aStack[top - 1];
+    for (size_t i = 0; i < aSize; i++) {
+      a[i] = aFunction(a[i]);
+    }
+  };
+  auto binary = [&](auto aFunction) {
+    double* a = aStack[top - 2];
+    const double* b = aStack[top - 1];
+    for (size_t i = 0; i < aSize; i++) {
+      a[i] = aFunction(a[i], b[i]);
+    }
+    top--;
+  };
+  for (const auto& instruction : aProgram) {
+    switch (instruction.op) {
+    case Op::Number:
+      std::fill_n(aStack[top++], aSize, instruction.value);
+      break;
+    case Op::Parameter:
+      std::fill_n(aStack[top++], aSize, aParameters[instruction.index]);
+      break;
+    case Op::X:
+      std::copy_n(aX, aSize, aStack[top++]);
+      break;
+    case Op::Y:
+      if (aY) {
+        std::copy_n(aY, aSize, aStack[top++]);
+      } else {
+        std::fill_n(aStack[top++], aSize, 0.);
+      }
+      break;
+    case Op::Add:
+      binary([](double a, double b) { return a + b; });
+      break;
+    case Op::Sub:
+      binary([](double a, double b) { return a - b; });
+      break;
+    case Op::Mul:
+      binary([](double a, double b) { return a * b; });
+      break;
+    case Op::Div:
+      binary([](double a, double b) { return a / b; });
+      break;
+    case Op::Pow:
+      binary([](double a, double b) { return power(a, b); });
+      break;
+    case Op::Neg:
+      unary([](double a) { return -a; });
+      break;
+    case Op::Sqrt:
+      unary([](double a) { return std::sqrt(a); });
+      break;
+    case Op::Exp:
+      unary([](double a) { return std::exp(a); });
+      break;
+    case Op::Log:
+      unary([](double a) { return std::log(a); });
+      break;
+    case Op::Log10:
+      unary([](double a) { return std::log10(a); });
+      break;
+    case Op::Abs:
+      unary([](double a) { return std::abs(a); });
+      break;
+    case Op::Sin:
+      unary([](double a) { return std::sin(a); });
+      break;
+    case Op::Cos:
+      unary([](double a) { return std::cos(a); });
+      break;
+    case Op::Tan:
+      unary([](double a) { return std::tan(a); });
+      break;
+    case Op::Atan:
+      unary([](double a) { return std::atan(a); });
+      break;
+    }
+  }
+}
+} // namespace
+
+bool CorrectionFunction::compile(const std::string& aFormula) {
+  m_compiled = false;
+  m_numParameters = 0;
+  m_program.clear();
+  std::string text = normalise(aFormula);
+
+  // polN: [0] + [1]*x + ... + [N]*x^N, written in Horner form
+  if (text.size() > 3 && text.compare(0, 3, "pol") == 0 &&
+      std::all_of(text.begin() + 3, text.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); })) {
+    size_t degree = std::stoul(text.substr(3));
+    m_program.push_back({Op::Parameter, 0., degree});
+    for (size_t i = degree; i > 0; i--) {
+      m_program.push_back({Op::X});
+      m_program.push_back({Op::Mul});
+      m_program.push_back({Op::Parameter, 0., i - 1});
+      m_program.push_back({Op::Add});
+    }
+  } else if (!Parser(text).parse(m_program)) {
+    m_program.clear();
+    return false;
+  }
+
+  // the stack must fit in kMaxDepth levels, and the parameters must be numbered from 0, as in TF1
+  size_t depth = 0;
+  size_t maxDepth = 0;
+  std::vector<bool> used;
+  for (const auto& instruction : m_program) {
+    switch (instruction.op) {
+    case Op::Number:
+    case Op::X:
+    case Op::Y:
+      depth++;
+      break;
+    case Op::Parameter:
+      depth++;
+      if (instruction.index >= used.size()) {
+        used.resize(instruction.index + 1, false);
+      }
+      used[instruction.index] = true;
+      break;
+    case Op::Add:
+    case Op::Sub:
+    case Op::Mul:
+    case Op::Div:
+    case Op::Pow:
+      depth--;
+      break;
+    default:
+      break;
+    }
+    maxDepth = std::max(maxDepth, depth);
+  }
+  if (maxDepth > kMaxDepth || std::find(used.begin(), used.end(), false) != used.end()) {
+    m_program.clear();
+    return false;
+  }
+  m_numParameters = used.size();
+  m_parameters.assign(m_numParameters, 0.);
+  m_compiled = true;
+  return true;
+}
+
+void CorrectionFunction::setParameters(std::span<const double> aParameters) {
+  std::copy_n(aParameters.begin(), m_numParameters, m_parameters.begin());
+}
+
+double CorrectionFunction::operator()(double aX, double aY) const {
+  double stack[kMaxDepth][1];
+  run<1>(m_program, m_parameters, &aX, &aY, 1, stack);
+  return stack[0][0];
+}
+
+void CorrectionFunction::evaluate(std::span<const double> aX, std::span<const double> aY,
+                                  std::span<double> aValues) const {
+  // each instruction is applied to a block of points, so that the loops over the points can be vectorised
+  constexpr size_t kBlock = 64;
+  double stack[kMaxDepth][kBlock];
+  for (size_t first = 0; first < aX.size(); first += kBlock) {
+    const size_t size = std::min(kBlock, aX.size() - first);
+    run<kBlock>(m_program, m_parameters, aX.data() + first, aY.empty() ? nullptr : aY.data() + first, size, stack);
+    std::copy_n(stack[0], size, aValues.begin() + first);
+  }
+}
+
+} /* namespace k4::recCalo */
@@ -0,0 +1,78 @@
+#include "RecCaloCommon/CrosstalkMatrix.h"
+
+#include "RecCaloCommon/BinaryFile.h"
+
+// std
+#include <algorithm>
+
+namespace k4::recCalo {
+
+namespace {
+constexpr char kMagic[8] = {'K', '4', 'X', 'T', 'A', 'L', 'K', '1'};
+} // namespace
+
+void CrosstalkMatrix::clear() {
+  m_cellIds.clear();
+  m_offsets.assign(1, 0);
+  m_neighbours.clear();
+  m_crosstalks.clear();
+}
+
+void CrosstalkMatrix::reserve(size_t aRows, size_t aEntries) {
+  m_cellIds.reserve(aRows);
+  m_offsets.reserve(aRows + 1);
+  m_neighbours.reserve(aEntries);
+  m_crosstalks.reserve(aEntries);
+}
+
+bool CrosstalkMatrix::addRow(uint64_t aCellId, std::span<const std::pair<uint64_t, double>> aNeighbours) {
+  if (!m_cellIds.empty() && m_cellIds.back() >= aCellId) {
+    return false;
+  }
+  m_cellIds.push_back(aCellId);
+  for (const auto& neighbour : aNeighbours) {
+    m_neighbours.push_back(neighbour.first);
+    m_crosstalks.push_back(neighbour.second);
+  }
+  m_offsets.push_back(m_neighbours.size());
+  return true;
+}
+
+size_t CrosstalkMatrix::find(uint64_t aCellId) const {
+  auto it = std::lower_bound(m_cellIds.begin(), m_cellIds.end(), aCellId);
+  if (it == m_cellIds.end() || *it != aCellId) {
+    return npos;
+  }
+  return it - m_cellIds.begin();
+}
+
+bool CrosstalkMatrix::save(const std::string& aFileName) const {
+  BinaryFileWriter file(aFileName, kMagic, {m_cellIds.size(), m_neighbours.size()});
+  file.write(std::span<const uint64_t>(m_cellIds));
+  file.write(std::span<const uint64_t>(m_offsets));
+  file.write(std::span<const uint64_t>(m_neighbours));
+  file.write(std::span<const double>(m_crosstalks));
+  return file.commit();
+}
+
+bool CrosstalkMatrix::load(const std::string& aFileName) {
+  clear();
+  uint64_t header[2] = {0, 0};
+  BinaryFileReader file(aFileName, kMagic, header);
+  const uint64_t rows = header[0];
+  const uint64_t entries = header[1];
+  if (!file ||
+      file.payloadSize() != (2 * rows + 1) * sizeof(uint64_t) + entries * (sizeof(uint64_t) + sizeof(double))) {
+    return false;
+  }
+  bool ok = file.read(m_cellIds, rows) && file.read(m_offsets, rows + 1) && file.read(m_neighbours, entries) &&
+            file.read(m_crosstalks, entries) &&
+            std::is_sorted(m_cellIds.begin(), m_cellIds.end()) && m_offsets.front() == 0 &&
+            m_offsets.back() == entries && std::is_sorted(m_offsets.begin(), m_offsets.end());
+  if (!ok) {
+    clear();
+  }
+  return ok;
+}
+
+} /* namespace k4::recCalo */
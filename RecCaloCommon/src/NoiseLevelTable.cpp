@@ -0,0 +1,101 @@
+#include "RecCaloCommon/NoiseLevelTable.h"
+
+#include "RecCaloCommon/BinaryFile.h"
+
+// std
+#include <algorithm>
+#include <numeric>
+
+// TBB
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+namespace k4::recCalo {
+
+namespace {
+constexpr char kMagic[8] = {'K', '4', 'N', 'O', 'I', 'S', 'E', '2'};
+} // namespace
+
+void NoiseLevelTable::addCells(std::vector<uint64_t> aCellIds, Evaluate aEvaluate) {
+  m_systems.push_back({std::move(aCellIds), std::move(aEvaluate)});
+}
+
+void NoiseLevelTable::evaluate(int aNumThreads, size_t aBatchSize) {
+  aBatchSize = std::max<size_t>(aBatchSize, 1);
+  // concatenate the cells of all systems, and cut each system in batches
+  struct Batch {
+    const System* system;
+    size_t begin;
+    size_t end;
+  };
+  std::vector<Batch> batches;
+  std::vector<uint64_t> cellIds;
+  for (const auto& system : m_systems) {
+    size_t first = cellIds.size();
+    cellIds.insert(cellIds.end(), system.cellIds.begin(), system.cellIds.end());
+    for (size_t begin = first; begin < cellIds.size(); begin += aBatchSize) {
+      batches.push_back({&system, begin, std::min(begin + aBatchSize, cellIds.size())});
+    }
+  }
+  std::vector<double> noiseRMS(cellIds.size(), 0.);
+  std::vector<double> noiseOffset(cellIds.size(), 0.);
+  auto evaluateBatch = [&](const Batch& aBatch) {
+    if (aBatch.system->evaluate) {
+      size_t size = aBatch.end - aBatch.begin;
+      aBatch.system->evaluate(std::span<const uint64_t>(cellIds).subspan(aBatch.begin, size),
+                              std::span<double>(noiseRMS).subspan(aBatch.begin, size),
+                              std::span<double>(noiseOffset).subspan(aBatch.begin, size));
+    }
+  };
+  if (aNumThreads != 1) {
+    tbb::task_arena arena(aNumThreads > 0 ? aNumThreads : tbb::task_arena::automatic);
+    arena.execute([&] {
+      tbb::parallel_for(size_t(0), batches.size(), [&](size_t iBatch) { evaluateBatch(batches[iBatch]); });
+    });
+  } else {
+    for (const auto& batch : batches) {
+      evaluateBatch(batch);
+    }
+  }
+  m_systems.clear();
+
+  // order by cellID, the stable sort keeps the first occurrence of a cell in front
+  std::vector<uint32_t> order(cellIds.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return cellIds[a] < cellIds[b]; });
+  m_cellIds.clear();
+  m_noiseRMS.clear();
+  m_noiseOffset.clear();
+  m_cellIds.reserve(order.size());
+  m_noiseRMS.reserve(order.size());
+  m_noiseOffset.reserve(order.size());
+  for (auto index : order) {
+    if (!m_cellIds.empty() && m_cellIds.back() == cellIds[index]) {
+      continue;
+    }
+    m_cellIds.push_back(cellIds[index]);
+    m_noiseRMS.push_back(noiseRMS[index]);
+    m_noiseOffset.push_back(noiseOffset[index]);
+  }
+}
+
+bool NoiseLevelTable::save(const std::string& aFileName, uint64_t aKey) const {
+  BinaryFileWriter file(aFileName, kMagic, {aKey, m_cellIds.size()});
+  file.write(std::span<const uint64_t>(m_cellIds));
+  file.write(std::span<const double>(m_noiseRMS));
+  file.write(std::span<const double>(m_noiseOffset));
+  return file.commit();
+}
+
+bool NoiseLevelTable::load(const std::string& aFileName, uint64_t aKey) {
+  uint64_t header[2] = {0, 0};
+  BinaryFileReader file(aFileName, kMagic, header);
+  uint64_t size = header[1];
+  if (!file || header[0] != aKey || file.payloadSize() != size * (sizeof(uint64_t) + 2 * sizeof(double))) {
+    return false;
+  }
+  return file.read(m_cellIds, size) && file.read(m_noiseRMS, size) && file.read(m_noiseOffset, size) &&
+         std::is_sorted(m_cellIds.begin(), m_cellIds.end());
+}
+
+} /* namespace k4::recCalo */
@@ -0,0 +1,94 @@
+#include "RecCaloCommon/NoisePool.h"
+
+#include "RecCaloCommon/BinaryFile.h"
+#include "RecCaloCommon/CellNoiseGenerator.h"
+
+// std
+#include <bit>
+#include <numeric>
+
+// POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace k4::recCalo {
+
+namespace {
+constexpr char kMagic[8] = {'K', '4', 'N', 'P', 'O', 'O', 'L', '1'};
+} // namespace
+
+NoisePool::~NoisePool() { unmap(); }
+
+void NoisePool::unmap() {
+  if (m_mapped) {
+    munmap(m_mapped, m_mappedLength);
+    m_mapped = nullptr;
+    m_mappedLength = 0;
+  }
+}
+
+void NoisePool::generate(size_t aSize, uint64_t aSeed) {
+  unmap();
+  m_size = std::bit_ceil(std::max<size_t>(aSize, 2));
+  m_storage.resize(m_size);
+  // generate in blocks to limit the size of the temporary buffers
+  CellNoiseGenerator generator(aSeed);
+  constexpr size_t kBlock = 1 << 16;
+  std::vector<uint64_t> counters(std::min(kBlock, m_size));
+  std::vector<double> values(counters.size());
+  for (size_t start = 0; start < m_size; start += counters.size()) {
+    std::iota(counters.begin(), counters.end(), start);
+    generator.gaussians(0, 0, counters, values);
+    std::copy(values.begin(), values.end(), m_storage.begin() + start);
+  }
+  m_data = m_storage.data();
+}
+
+bool NoisePool::map(const std::string& aFileName) {
+  unmap();
+  uint64_t size;
+  uint64_t offset;
+  {
+    BinaryFileReader file(aFileName, kMagic, std::span<uint64_t>(&size, 1));
+    if (!file || size < 2 || !std::has_single_bit(size) || file.payloadSize() != size * sizeof(float)) {
+      return false;
+    }
+    offset = file.payloadOffset();
+  }
+  int fd = open(aFileName.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  // the header is mapped as well, as the offset of a mapping must be a multiple of the page size
+  void* mapped = mmap(nullptr, offset + size * sizeof(float), PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    return false;
+  }
+  m_storage.clear();
+  m_storage.shrink_to_fit();
+  m_mapped = mapped;
+  m_mappedLength = offset + size * sizeof(float);
+  m_size = size;
+  m_data = reinterpret_cast<const float*>(static_cast<const char*>(mapped) + offset);
+  return true;
+}
+
+bool NoisePool::save(const std::string& aFileName) const {
+  BinaryFileWriter file(aFileName, kMagic, {m_size});
+  file.write(std::span<const float>(m_data, m_size));
+  return file.commit();
+}
+
+NoisePool::Rotation NoisePool::rotation(uint64_t aRun, uint64_t aEvent) const {
+  auto random = CellNoiseGenerator::philox({uint32_t(aEvent), uint32_t(aEvent >> 32), uint32_t(aRun), 0x706f6f6c},
+                                           {uint32_t(m_seed), uint32_t(m_seed >> 32)});
+  Rotation result;
+  result.offset = (uint64_t(random[1]) << 32 | random[0]) & (m_size - 1);
+  // an odd stride is coprime with the power-of-two size: the gather visits every value once before repeating
+  result.stride = ((uint64_t(random[3]) << 32 | random[2]) & (m_size - 1)) | 1;
+  return result;
+}
+
+} /* namespace k4::recCalo */
@@ -0,0 +1,87 @@
+#include "RecCaloCommon/NoiseSource.h"
+
+namespace k4::recCalo {
+
+NoiseSource::NoiseSource(AlgTool* aOwner)
+    : m_owner(aOwner),
+      m_counterBasedRNG(
+          aOwner, "counterBasedRNG", false,
+          "Generate the noise from (seed, run, event, cellID), independently of the processing order and threading"),
+      m_noiseSeed(aOwner, "noiseSeed", 0, "Seed of the counter-based noise generator"),
+      m_eventHeaderName(aOwner, "eventHeader", "EventHeader",
+                        "Name of the event header collection (counterBasedRNG and noise pool only)"),
+      m_noisePoolSize(aOwner, "noisePoolSize", 0,
+                      "Number of standard-normal values (4 bytes each) generated at initialize "
+                      "(rounded up to a power of two), 0 to disable the pool"),
+      m_noisePoolFile(aOwner, "noisePoolFile", "", "File written with noisePoolOutputFile, mapped as noise pool"),
+      m_noisePoolOutputFile(
+          aOwner, "noisePoolOutputFile", "",
+          "File to which the pool generated with noisePoolSize is written, to be mapped with noisePoolFile by later "
+          "jobs") {}
+
+StatusCode NoiseSource::initialize() {
+  if (!m_counterBasedRNG && m_noisePoolSize == 0 && m_noisePoolFile.empty()) {
+    return StatusCode::SUCCESS;
+  }
+  m_generator.setSeed(m_noiseSeed);
+  m_eventHeader = std::make_unique<k4FWCore::DataHandle<edm4hep::EventHeaderCollection>>(
+      m_eventHeaderName, Gaudi::DataHandle::Reader, m_owner);
+
+  if (!m_noisePoolFile.empty()) {
+    if (!m_pool.map(m_noisePoolFile)) {
+      m_owner->error() << "Unable to map the file with the noise pool: " << m_noisePoolFile.value() << endmsg;
+      return StatusCode::FAILURE;
+    }
+  } else if (m_noisePoolSize > 0) {
+    m_pool.generate(m_noisePoolSize, m_noiseSeed);
+    if (!m_noisePoolOutputFile.empty() && !m_pool.save(m_noisePoolOutputFile)) {
+      m_owner->error() << "Unable to write the noise pool to the file: " << m_noisePoolOutputFile.value() << endmsg;
+      return StatusCode::FAILURE;
+    }
+  }
+  if (m_pool.size() > 0) {
+    m_pool.setSeed(m_noiseSeed);
+    m_owner->info() << "Using a pool of " << m_pool.size() << " noise values (" << m_pool.memory() / 1024 / 1024
+                    << " MB)" << endmsg;
+  } else {
+    m_owner->info() << "Using the counter-based noise generator with seed " << m_noiseSeed.value() << endmsg;
+  }
+  return StatusCode::SUCCESS;
+}
+
+void NoiseSource::finalize() { m_eventHeader.reset(); }
+
+std::span<const double> NoiseSource::gaussians(std::span<const uint64_t> aCellIds, size_t aFirst) {
+  uint64_t run = 0;
+  uint64_t event = 0;
+  const auto* headers = m_eventHeader->get();
+  if (!headers->empty()) {
+    run = (*headers)[0].getRunNumber();
+    event = (*headers)[0].getEventNumber();
+  }
+  m_values.resize(aCellIds.size());
+  if (m_pool.size() > 0) {
+    if (aFirst + aCellIds.size() > m_pool.size() && !m_poolOverflowReported) {
+      // reported once, rather than for each block of each event
+      m_poolOverflowReported = true;
+      m_owner->warning() << "More cells than the " << m_pool.size()
+                         << " values of the noise pool, the noise of some cells is repeated, increase noisePoolSize"
+                         << endmsg;
+    }
+    m_pool.gather(m_pool.rotation(run, event), m_values, aFirst);
+  } else {
+    m_generator.gaussians(run, event, aCellIds, m_values);
+  }
+  return m_values;
+}
+
+std::span<const double> NoiseSource::gaussians(const std::unordered_map<uint64_t, double>& aCells) {
+  m_cellIds.clear();
+  m_cellIds.reserve(aCells.size());
+  for (const auto& cell : aCells) {
+    m_cellIds.push_back(cell.first);
+  }
+  return gaussians(m_cellIds, 0);
+}
+
+} /* namespace k4::recCalo */
@@ -0,0 +1,270 @@
+#include "RecCaloCommon/PositionedCellsDigitiser.h"
+
+// std
+#include <algorithm>
+
+// dd4hep
+#include "DD4hep/DD4hepUnits.h"
+#include "DD4hep/DetType.h"
+#include "DD4hep/Detector.h"
+#include "DDSegmentation/BitFieldCoder.h"
+
+// k4FWCore
+#include "k4Interface/ICalibrateCaloHitsTool.h"
+#include "k4Interface/ICaloReadCrosstalkMap.h"
+#include "k4Interface/ICalorimeterTool.h"
+#include "k4Interface/ICellPositionsTool.h"
+#include "k4Interface/INoiseCaloCellsTool.h"
+
+// edm4hep
+#include "edm4hep/CalorimeterHit.h"
+
+namespace k4::recCalo {
+
+PositionedCellsDigitiser::PositionedCellsDigitiser() = default;
+
+PositionedCellsDigitiser::PositionedCellsDigitiser(PositionedCellsDigitiser&&) = default;
+
+PositionedCellsDigitiser& PositionedCellsDigitiser::operator=(PositionedCellsDigitiser&&) = default;
+
+PositionedCellsDigitiser::~PositionedCellsDigitiser() = default;
+
+StatusCode PositionedCellsDigitiser::initialize(const Settings& aSettings, const Tools& aTools,
+                                                const std::string& aCellIDEncoding, const CommonMessagingBase& aLog) {
+  m_settings = aSettings;
+  m_tools = aTools;
+  m_log = &aLog;
+  m_decoder = std::make_unique<dd4hep::DDSegmentation::BitFieldCoder>(aCellIDEncoding);
+  if (m_settings.addCellNoise || m_settings.filterCellNoise) {
+    // if the noise tool can filter dense arrays of cells, the cell map is left untouched by the filtering
+    m_denseNoiseTool = SmartIF<IDenseNoiseCaloCellsTool>(m_tools.noiseTool);
+  }
+  if (m_settings.addCellNoise) {
+    // Prepare map of all existing cells in calorimeter to add noise to all
+    if (m_tools.geoTool->prepareEmptyCells(m_cellsMap).isFailure()) {
+      aLog.error() << "Unable to create empty cells!" << endmsg;
+      return StatusCode::FAILURE;
+    }
+    aLog.verbose() << "Initialised empty cell map with size " << m_cellsMap.size() << endmsg;
+    // noise filtering erases cells from the cell map after each event, so we need
+    // to backup the empty cell map for later reuse
+    if (m_settings.filterCellNoise && !m_settings.cellsGivenPerEvent && !m_denseNoiseTool) {
+      m_emptyCellsMap = m_cellsMap;
+    }
+  }
+  return StatusCode::SUCCESS;
+}
+
+void PositionedCellsDigitiser::resetCells() {
+  if (m_settings.addCellNoise) {
+    // if cells are not filtered, the map has same size in each event, equal to the total number
+    // of cells in the calorimeter, so we can just reset the values to 0
+    // if cells are filtered, during each event they are removed from the cellsMap, so one has to
+    // restore the initial map of all empty cells
+    if (!m_settings.filterCellNoise || m_denseNoiseTool) {
+      // cells not known to the geometry tool were added by the previous event, they are removed
+      for (auto cellId : m_unknownCells) {
+        m_cellsMap.erase(cellId);
+      }
+      m_unknownCells.clear();
+      std::for_each(m_cellsMap.begin(), m_cellsMap.end(), [](std::pair<const uint64_t, double>& p) { p.second = 0; });
+    } else {
+      m_cellsMap = m_emptyCellsMap;
+    }
+  } else {
+    m_cellsMap.clear();
+  }
+}
+
+void PositionedCellsDigitiser::resetCells(std::span<const uint64_t> aCellIds) {
+  m_cellsMap.clear();
+  m_unknownCells.clear();
+  m_cellsMap.reserve(aCellIds.size());
+  for (auto cellId : aCellIds) {
+    m_cellsMap.emplace(cellId, 0.);
+  }
+}
+
+void PositionedCellsDigitiser::digitise(const edm4hep::SimCalorimeterHitCollection& aHits,
+                                        edm4hep::CalorimeterHitCollection& aCells,
+                                        edm4hep::CaloHitSimCaloHitLinkCollection* aLinks,
+                                        const std::function<bool(uint64_t)>& aAccept) {
+  // 1. Merge energy deposits into cells
+  // If running with noise, map was already prepared in initialize().
+  // Otherwise it is being created below
+  for (const auto& hit : aHits) {
+    auto id = hit.getCellID();
+    if (aAccept && !aAccept(id)) {
+      continue;
+    }
+    addEnergy(id, hit.getEnergy());
+  }
+  m_log->debug() << "Number of calorimeter cells after merging of hits: " << m_cellsMap.size() << endmsg;
+
+  // 2. Emulate cross-talk (if asked)
+  if (m_settings.addCrosstalk) {
+    // Derive the cross-talk contributions without affecting yet the nominal energy
+    // (one has to emulate crosstalk based on cells free from any cross-talk contributions)
+    m_crosstalkCellsMap.clear();
+    for (const auto& this_cell : m_cellsMap) {
+      auto vec_neighbours = m_tools.crosstalkTool->getNeighbours(this_cell.first); // a vector of neighbour IDs
+      auto vec_crosstalks = m_tools.crosstalkTool->getCrosstalks(this_cell.first); // a vector of crosstalk coefficients
+      for (unsigned int i_cell = 0; i_cell < vec_neighbours.size(); i_cell++) {
+        // signal transfer = energy deposit brought by EM shower hits * crosstalk coefficient
+        double signal_transfer = this_cell.second * vec_crosstalks[i_cell];
+        m_crosstalkCellsMap[this_cell.first] -= signal_transfer;
+        m_crosstalkCellsMap[vec_neighbours[i_cell]] += signal_transfer;
+      }
+    }
+    // apply the cross-talk contributions on the nominal cell-energy map
+    for (const auto& this_cell : m_crosstalkCellsMap) {
+      if (aAccept && !aAccept(this_cell.first)) {
+        continue;
+      }
+      addEnergy(this_cell.first, this_cell.second);
+    }
+  }
+
+  // 3. Calibrate simulation energy to EM scale
+  if (m_settings.doCellCalibration) {
+    m_tools.calibTool->calibrate(m_cellsMap);
+  }
+
+  // 4. Add noise to all cells
+  if (m_settings.addCellNoise) {
+    m_tools.noiseTool->addRandomCellNoise(m_cellsMap);
+  }
+
+  // 5. Filter cells
+  const bool denseFilter = m_settings.filterCellNoise && m_denseNoiseTool;
+  if (denseFilter) {
+    m_cellIds.clear();
+    m_cellEnergies.clear();
+    for (const auto& cell : m_cellsMap) {
+      m_cellIds.push_back(cell.first);
+      m_cellEnergies.push_back(cell.second);
+    }
+    m_denseNoiseTool->selectCells(m_cellIds, m_cellEnergies, m_selectedCells);
+  } else if (m_settings.filterCellNoise) {
+    m_tools.noiseTool->filterCellNoise(m_cellsMap);
+  }
+
+  // determine detector type (only once)
+  if (m_calotype == -99 && m_cellsMap.size() > 0) {
+    setCaloType(m_cellsMap.begin()->first);
+  }
+
+  // 6. Copy information to CaloHitCollection
+  const bool printCells = m_log->msgLevel(MSG::DEBUG);
+  auto createCell = [&](uint64_t cellid, double energy) {
+    if (m_settings.addCellNoise || energy != 0.) {
+      auto newCell = aCells.create();
+      newCell.setEnergy(energy);
+      newCell.setCellID(cellid);
+      newCell.setPosition(cellPosition(cellid));
+      // add cell type (for Pandora) - see iLCSoft/MarlinUtil/source/include/CalorimeterHitType.h
+      int layer = m_decoder->get(cellid, "layer");
+      newCell.setType(m_calotype + 10 * m_caloid + 1000 * m_layout + 10000 * layer);
+      if (printCells) {
+        m_log->debug() << "Cell energy (GeV) : " << newCell.getEnergy() << "\tcellID " << newCell.getCellID()
+                       << "\tcellType " << newCell.getType() << endmsg;
+        m_log->debug() << "Position of cell (mm) : \t" << newCell.getPosition().x << "\t" << newCell.getPosition().y
+                       << "\t" << newCell.getPosition().z << endmsg;
+      }
+    }
+  };
+  if (denseFilter) {
+    // build the output directly from the cells that passed the filter
+    for (auto index : m_selectedCells) {
+      createCell(m_cellIds[index], m_cellEnergies[index]);
+    }
+  } else {
+    for (const auto& cell : m_cellsMap) {
+      createCell(cell.first, cell.second);
+    }
+  }
+
+  // create hits<->cell links, in the same order as looping over all hits for each cell
+  if (aLinks) {
+    // pairs (cellID, hit index) sorted by cellID, and by hit index for hits of the same cell
+    m_sortedHits.clear();
+    for (size_t i = 0; i < aHits.size(); i++) {
+      m_sortedHits.emplace_back(aHits[i].getCellID(), i);
+    }
+    std::sort(m_sortedHits.begin(), m_sortedHits.end());
+    for (const auto& cell : aCells) {
+      auto cellID = cell.getCellID();
+      for (auto it = std::lower_bound(m_sortedHits.begin(), m_sortedHits.end(), std::make_pair(cellID, uint32_t(0)));
+           it != m_sortedHits.end() && it->first == cellID; ++it) {
+        auto link = aLinks->create();
+        link.setFrom(cell);
+        link.setTo(aHits[it->second]);
+      }
+    }
+  }
+}
+
+void PositionedCellsDigitiser::addEnergy(uint64_t aCellId, double aEnergy) {
+  auto [cell, inserted] = m_cellsMap.try_emplace(aCellId, 0.);
+  cell->second += aEnergy;
+  if (inserted && resetToZero()) {
+    m_unknownCells.push_back(aCellId);
+  }
+}
+
+edm4hep::Vector3f PositionedCellsDigitiser::cellPosition(uint64_t aCellId) {
+  auto cached_pos = m_positionsCache.find(aCellId);
+  if (cached_pos != m_positionsCache.end()) {
+    return cached_pos->second;
+  }
+  // retrieve position from tool
+  dd4hep::Position posCell = m_tools.positionsTool->xyzPosition(aCellId);
+  edm4hep::Vector3f edmPos;
+  edmPos.x = posCell.x() / dd4hep::mm;
+  edmPos.y = posCell.y() / dd4hep::mm;
+  edmPos.z = posCell.z() / dd4hep::mm;
+  m_positionsCache[aCellId] = edmPos;
+  return edmPos;
+}
+
+void PositionedCellsDigitiser::setCaloType(uint64_t aCellId) {
+  int system = m_decoder->get(aCellId, "system");
+  dd4hep::Detector* dd4hepgeo = &(dd4hep::Detector::getInstance());
+  for (const auto& child : dd4hepgeo->detectors()) {
+    dd4hep::DetElement det(child.second);
+    if (det.id() != system) {
+      continue;
+    }
+    dd4hep::DetType detType(det.typeFlag());
+    if (detType.is(dd4hep::DetType::CALORIMETER)) {
+      if (detType.is(dd4hep::DetType::ELECTROMAGNETIC)) {
+        m_calotype = 0;
+        m_caloid = 1;
+      } else if (detType.is(dd4hep::DetType::HADRONIC)) {
+        m_calotype = 1;
+        m_caloid = 2;
+      } else if (detType.is(dd4hep::DetType::MUON)) {
+        m_calotype = 2;
+        m_caloid = 3;
+      } else {
+        m_log->warning() << "Detector type is neither ELECTROMAGNETIC, HADRONIC nor MUON" << endmsg;
+      }
+      if (detType.is(dd4hep::DetType::BARREL)) {
+        m_layout = 1;
+      } else if (detType.is(dd4hep::DetType::ENDCAP)) {
+        m_layout = 2;
+      } else {
+        m_log->warning() << "Detector type is neither BARREL nor ENDCAP" << endmsg;
+      }
+    } else {
+      m_log->warning() << "Detector type is not CALORIMETER" << endmsg;
+      m_calotype = -1;
+      m_caloid = 0;
+    }
+    break;
+  }
+  m_log->info() << "System: " << system << ", CaloType: " << m_calotype << ", CaloId: " << m_caloid
+                << ", Layout: " << m_layout << endmsg;
+}
+
+} /* namespace k4::recCalo */
@@ -0,0 +1,144 @@
+#include "RecCaloCommon/ThreadLocalHistogram.h"
+
+// std
+#include <algorithm>
+
+// ROOT
+#include "TAxis.h"
+#include "TH1.h"
+
+namespace k4::recCalo {
+
+namespace {
+/// Copy of the binning of a ROOT axis
+void copyAxis(const TAxis& aAxis, int& aNumBins, double& aMin, double& aMax, std::vector<double>& aEdges) {
+  aNumBins = aAxis.GetNbins();
+  aMin = aAxis.GetXmin();
+  aMax = aAxis.GetXmax();
+  aEdges.clear();
+  if (aAxis.IsVariableBinSize()) {
+    aEdges.assign(aAxis.GetXbins()->GetArray(), aAxis.GetXbins()->GetArray() + aNumBins + 1);
+  }
+}
+} // namespace
+
+int ThreadLocalHistogram::Axis::bin(double aValue) const {
+  // as TAxis::FindBin, NaN is in the overflow bin
+  if (aValue < min) {
+    return 0;
+  }
+  if (!(aValue < max)) {
+    return numBins + 1;
+  }
+  if (edges.empty()) {
+    return 1 + int(numBins * (aValue - min) / (max - min));
+  }
+  return std::upper_bound(edges.begin(), edges.end(), aValue) - edges.begin();
+}
+
+void ThreadLocalHistogram::Registry::merge() {
+  for (auto* histogram : m_histograms) {
+    histogram->merge();
+  }
+}
+
+void ThreadLocalHistogram::book(TH1* aHistogram, Registry& aRegistry) {
+  if (m_histogram == nullptr) {
+    aRegistry.m_histograms.push_back(this);
+  }
+  m_histogram = aHistogram;
+  m_contents.clear();
+  copyAxis(*aHistogram->GetXaxis(), m_xAxis.numBins, m_xAxis.min, m_xAxis.max, m_xAxis.edges);
+  copyAxis(*aHistogram->GetYaxis(), m_yAxis.numBins, m_yAxis.min, m_yAxis.max, m_yAxis.edges);
+  m_numBins = aHistogram->GetNcells();
+  m_statOverflows = aHistogram->GetStatOverflowsBehaviour();
+}
+
+ThreadLocalHistogram::Contents& ThreadLocalHistogram::local() {
+  Contents& contents = m_contents.local();
+  if (contents.sumw.empty()) {
+    contents.sumw.resize(m_numBins);
+    contents.sumw2.resize(m_numBins);
+  }
+  return contents;
+}
+
+void ThreadLocalHistogram::fill(double aX, double aWeight) {
+  Contents& contents = local();
+  const int bin = m_xAxis.bin(aX);
+  contents.entries++;
+  contents.weighted |= (aWeight != 1.);
+  contents.sumw[bin] += aWeight;
+  contents.sumw2[bin] += aWeight * aWeight;
+  if ((bin == 0 || bin > m_xAxis.numBins) && !m_statOverflows) {
+    return;
+  }
+  contents.tsumw += aWeight;
+  contents.tsumw2 += aWeight * aWeight;
+  contents.tsumwx += aWeight * aX;
+  contents.tsumwx2 += aWeight * aX * aX;
+}
+
+void ThreadLocalHistogram::fill2D(double aX, double aY, double aWeight) {
+  Contents& contents = local();
+  const int binX = m_xAxis.bin(aX);
+  const int binY = m_yAxis.bin(aY);
+  contents.entries++;
+  contents.weighted |= (aWeight != 1.);
+  const size_t bin = binY * (m_xAxis.numBins + 2) + binX;
+  contents.sumw[bin] += aWeight;
+  contents.sumw2[bin] += aWeight * aWeight;
+  if ((binX == 0 || binX > m_xAxis.numBins || binY == 0 || binY > m_yAxis.numBins) && !m_statOverflows) {
+    return;
+  }
+  contents.tsumw += aWeight;
+  contents.tsumw2 += aWeight * aWeight;
+  contents.tsumwx += aWeight * aX;
+  contents.tsumwx2 += aWeight * aX * aX;
+  contents.tsumwy += aWeight * aY;
+  contents.tsumwy2 += aWeight * aY * aY;
+  contents.tsumwxy += aWeight * aX * aY;
+}
+
+void ThreadLocalHistogram::merge() {
+  if (m_histogram == nullptr) {
+    return;
+  }
+  // the statistics are read before the contents are changed, as they are recomputed from the contents if empty
+  double stats[TH1::kNstat] = {0.};
+  m_histogram->GetStats(stats);
+  double entries = m_histogram->GetEntries();
+  for (const auto& contents : m_contents) {
+    if (contents.sumw.empty()) {
+      continue;
+    }
+    // as TH1::Fill, weights different from 1 enable the sums of squares of weights
+    if (contents.weighted && m_histogram->GetSumw2N() == 0 && !m_histogram->TestBit(TH1::kIsNotW)) {
+      m_histogram->Sumw2();
+    }
+    const bool sumw2 = m_histogram->GetSumw2N() > 0;
+    for (size_t bin = 0; bin < m_numBins; bin++) {
+      if (contents.sumw[bin] != 0.) {
+        m_histogram->AddBinContent(bin, contents.sumw[bin]);
+      }
+      if (sumw2) {
+        m_histogram->GetSumw2()->fArray[bin] += contents.sumw2[bin];
+      }
+    }
+    entries += contents.entries;
+    stats[0] += contents.tsumw;
+    stats[1] += contents.tsumw2;
+    stats[2] += contents.tsumwx;
+    stats[3] += contents.tsumwx2;
+    if (m_histogram->GetDimension() > 1) {
+      stats[4] += contents.tsumwy;
+      stats[5] += contents.tsumwy2;
+      stats[6] += contents.tsumwxy;
+    }
+  }
+  m_histogram->PutStats(stats);
+  m_histogram->SetEntries(entries);
+  m_contents.clear();
+}
+
+} /* namespace k4::recCalo */
@@ -0,0 +1,96 @@
+// Check that CellIndexMap builds a minimal perfect hash for many small, sequential and random sets of cellIDs: every
+// cellID of the set gets a distinct index in [0, size()), equal to its position among the sorted cellIDs, and cellIDs
+// which are not part of the set are rejected.
+
+// k4RecCalorimeter
+#include "RecCaloCommon/CellIndexMap.h"
+
+// std
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+int check(const std::string& aName, std::vector<uint64_t> aCellIds, std::mt19937_64& aGenerator) {
+  k4::recCalo::CellIndexMap map;
+  if (!map.build(aCellIds)) {
+    printf("%s: no perfect hash found for %zu cells\n", aName.c_str(), aCellIds.size());
+    return 1;
+  }
+  std::sort(aCellIds.begin(), aCellIds.end());
+  aCellIds.erase(std::unique(aCellIds.begin(), aCellIds.end()), aCellIds.end());
+  if (map.size() != aCellIds.size()) {
+    printf("%s: %u cells instead of %zu\n", aName.c_str(), map.size(), aCellIds.size());
+    return 1;
+  }
+  for (uint32_t i = 0; i < aCellIds.size(); i++) {
+    if (map.index(aCellIds[i]) != i || map.cellID(i) != aCellIds[i]) {
+      printf("%s: cell %llu has index %u instead of %u\n", aName.c_str(), static_cast<unsigned long long>(aCellIds[i]),
+             map.index(aCellIds[i]), i);
+      return 1;
+    }
+  }
+  for (int i = 0; i < 100; i++) {
+    uint64_t cellId = aGenerator();
+    if (!std::binary_search(aCellIds.begin(), aCellIds.end(), cellId) &&
+        map.index(cellId) != k4::recCalo::CellIndexMap::invalidIndex) {
+      printf("%s: cell %llu is not part of the set but has index %u\n", aName.c_str(),
+             static_cast<unsigned long long>(cellId), map.index(cellId));
+      return 1;
+    }
+  }
+  return 0;
+}
+} // namespace
+
+int main() {
+  std::mt19937_64 generator(2024);
+  int failures = 0;
+  int numSets = 0;
+
+  // small sets of sequential cellIDs, with a few strides and offsets as for the fields of a cellID
+  for (uint64_t size = 1; size <= 300; size++) {
+    for (uint64_t stride : {1ULL, 2ULL, 1ULL << 8, 1ULL << 32}) {
+      for (uint64_t first : {0ULL, 25ULL, 1ULL << 40}) {
+        std::vector<uint64_t> cellIds(size);
+        for (uint64_t i = 0; i < size; i++) {
+          cellIds[i] = first + i * stride;
+        }
+        failures += check("sequential " + std::to_string(size) + " x " + std::to_string(stride), cellIds, generator);
+        numSets++;
+      }
+    }
+  }
+
+  // random sets
+  for (size_t size : {15, 19, 23, 50, 200, 1000}) {
+    for (int iSet = 0; iSet < 200; iSet++) {
+      std::vector<uint64_t> cellIds(size);
+      for (auto& cellId : cellIds) {
+        cellId = generator();
+      }
+      failures += check("random " + std::to_string(size), cellIds, generator);
+      numSets++;
+    }
+  }
+
+  // a larger set, with duplicates
+  {
+    std::vector<uint64_t> cellIds(200000);
+    for (auto& cellId : cellIds) {
+      cellId = generator() % 150000;
+    }
+    failures += check("random with duplicates", cellIds, generator);
+    numSets++;
+  }
+
+  if (failures > 0) {
+    printf("%d of %d sets failed\n", failures, numSets);
+    return 1;
+  }
+  printf("CellIndexMap built a minimal perfect hash for %d sets of cells\n", numSets);
+  return 0;
+}
@@ -0,0 +1,87 @@
+// Check that CorrectionFunction gives the same values as TF1 for the correction formulas used in the options files
+// and for other valid ROOT syntax, on a grid of points in the ranges used by CorrectCaloClusters.
+
+// k4RecCalorimeter
+#include "RecCaloCommon/CorrectionFunction.h"
+
+// ROOT
+#include "TF1.h"
+#include "TF2.h"
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+int main() {
+  const std::vector<std::string> formulas = {
+      // upstream, downstream and benchmark corrections of the options files
+      "[0]+[1]/(x-[2])", "[0]+[1]*x", "[0]+[1]/sqrt(x)", "[0]+[1]/x", "[0]/sqrt(x)+[1]", "[0]", "[0]/x+[1]",
+      "[0]+[1]/(x+[2])", "[0]+[1]*x+[2]*x*x+[3]*x*x*x", "[0]+[1]/(x+[2])**2",
+      // other valid syntax
+      "pol3", "[0]+(x-[1])*(x-[2])", "[0]*exp(-x/[1])", "[0]*log(x*2)", "[0]*(-2)+x", "x+-2*[0]", "-x^2*[0]",
+      "[0]*pow(x,[1])", "TMath::Sqrt(x)*[0]+TMath::Log(x)", "[0]+[1]*y/x", "[0]*sqrt(x)+[1]*cos(y*pi/180)"};
+  const std::vector<double> parameters = {0.13, 1.7, -0.37, 2.1e-3};
+
+  int failures = 0;
+  for (size_t i = 0; i < formulas.size(); i++) {
+    const auto& formula = formulas[i];
+    k4::recCalo::CorrectionFunction compiled;
+    if (!compiled.compile(formula)) {
+      printf("formula %s not compiled\n", formula.c_str());
+      failures++;
+      continue;
+    }
+    const bool hasY = formula.find('y') != std::string::npos;
+    std::string name = "func" + std::to_string(i);
+    std::unique_ptr<TF1> function(hasY ? new TF2(name.c_str(), formula.c_str(), 0., 500., 0., 180.)
+                                       : new TF1(name.c_str(), formula.c_str(), 0., 500.));
+    if (compiled.numParameters() != size_t(function->GetNpar())) {
+      printf("formula %s: %zu parameters instead of %d\n", formula.c_str(), compiled.numParameters(),
+             function->GetNpar());
+      failures++;
+      continue;
+    }
+    function->SetParameters(parameters.data());
+    compiled.setParameters(parameters);
+
+    // energies from 0.5 to 500 GeV, angles from 0 to 180 degrees
+    std::vector<double> x, y;
+    for (int ix = 0; ix < 100; ix++) {
+      for (int iy = 0; iy < (hasY ? 19 : 1); iy++) {
+        x.push_back(0.5 * std::pow(1000., ix / 99.));
+        y.push_back(10. * iy);
+      }
+    }
+    std::vector<double> values(x.size());
+    compiled.evaluate(x, hasY ? y : std::vector<double>(), values);
+    for (size_t j = 0; j < x.size(); j++) {
+      const double expected = function->Eval(x[j], y[j]);
+      const double tolerance = 1e-10 * std::max(1., std::abs(expected));
+      if (std::abs(values[j] - expected) > tolerance || std::abs(compiled(x[j], y[j]) - expected) > tolerance) {
+        printf("formula %s at (%g, %g): %.17g instead of %.17g\n", formula.c_str(), x[j], y[j], values[j], expected);
+        failures++;
+        break;
+      }
+    }
+  }
+
+  // formulas which are not compiled, and have to be evaluated with TF1
+  for (const char* formula : {"gaus", "[0]*expo", "[1]*x", "sqrt(x", "x+", "erf(x)"}) {
+    k4::recCalo::CorrectionFunction compiled;
+    if (compiled.compile(formula)) {
+      printf("formula %s should not be compiled\n", formula);
+      failures++;
+    }
+  }
+
+  if (failures > 0) {
+    printf("%d failures\n", failures);
+    return 1;
+  }
+  printf("CorrectionFunction agrees with TF1 for %zu formulas\n", formulas.size());
+  return 0;
+}
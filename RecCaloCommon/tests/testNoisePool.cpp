@@ -0,0 +1,84 @@
+// Check that the noise gathered from a NoisePool is standard-normal and that neither the noise of one cell in
+// different events, nor the noise of different cells in the same events, is correlated.
+
+// k4RecCalorimeter
+#include "RecCaloCommon/NoisePool.h"
+
+// std
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+int main() {
+  constexpr size_t kPoolSize = 1 << 20;
+  constexpr size_t kCells = 256;
+  constexpr size_t kEvents = 4000;
+
+  k4::recCalo::NoisePool pool;
+  pool.generate(kPoolSize, 42);
+  pool.setSeed(7);
+
+  // noise[event][cell]
+  std::vector<std::vector<double>> noise(kEvents, std::vector<double>(kCells));
+  for (size_t event = 0; event < kEvents; event++) {
+    pool.gather(pool.rotation(1, event), noise[event]);
+  }
+
+  // per-cell mean and RMS
+  std::vector<double> mean(kCells, 0.), rms(kCells, 0.);
+  for (size_t cell = 0; cell < kCells; cell++) {
+    for (size_t event = 0; event < kEvents; event++) {
+      mean[cell] += noise[event][cell];
+    }
+    mean[cell] /= kEvents;
+    for (size_t event = 0; event < kEvents; event++) {
+      rms[cell] += std::pow(noise[event][cell] - mean[cell], 2);
+    }
+    rms[cell] = std::sqrt(rms[cell] / kEvents);
+  }
+
+  // correlation coefficients are expected to be ~N(0, 1/sqrt(kEvents)): allow 6 sigma
+  const double tolerance = 6. / std::sqrt(kEvents);
+  int failures = 0;
+  for (size_t cell = 0; cell < kCells; cell++) {
+    if (std::abs(mean[cell]) > tolerance || std::abs(rms[cell] - 1.) > tolerance) {
+      printf("cell %zu: mean %f rms %f\n", cell, mean[cell], rms[cell]);
+      failures++;
+    }
+  }
+
+  double maxCellCorrelation = 0.;
+  for (size_t cellA = 0; cellA < kCells; cellA++) {
+    for (size_t cellB = cellA + 1; cellB < kCells; cellB++) {
+      double covariance = 0.;
+      for (size_t event = 0; event < kEvents; event++) {
+        covariance += (noise[event][cellA] - mean[cellA]) * (noise[event][cellB] - mean[cellB]);
+      }
+      double correlation = covariance / kEvents / rms[cellA] / rms[cellB];
+      maxCellCorrelation = std::max(maxCellCorrelation, std::abs(correlation));
+    }
+  }
+  if (maxCellCorrelation > tolerance) {
+    printf("correlation between cells too large: %f\n", maxCellCorrelation);
+    failures++;
+  }
+
+  // correlation of each cell with itself in the next event
+  double maxEventCorrelation = 0.;
+  for (size_t cell = 0; cell < kCells; cell++) {
+    double covariance = 0.;
+    for (size_t event = 1; event < kEvents; event++) {
+      covariance += (noise[event][cell] - mean[cell]) * (noise[event - 1][cell] - mean[cell]);
+    }
+    double correlation = covariance / (kEvents - 1) / rms[cell] / rms[cell];
+    maxEventCorrelation = std::max(maxEventCorrelation, std::abs(correlation));
+  }
+  if (maxEventCorrelation > tolerance) {
+    printf("correlation between events too large: %f\n", maxEventCorrelation);
+    failures++;
+  }
+
+  printf("max correlation between cells %f, between events %f, tolerance %f\n", maxCellCorrelation,
+         maxEventCorrelation, tolerance);
+  return failures == 0 ? 0 : 1;
+}
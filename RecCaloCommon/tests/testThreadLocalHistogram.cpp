@@ -0,0 +1,153 @@
+// Check that filling histograms through ThreadLocalHistogram from several threads gives the same contents, errors,
+// statistics and number of entries as filling the ROOT histograms directly, including the fills in the underflow and
+// overflow bins, weights different from 1 and histograms with sums of squares of weights.
+
+// k4RecCalorimeter
+#include "RecCaloCommon/ThreadLocalHistogram.h"
+
+// ROOT
+#include "TH1F.h"
+#include "TH2F.h"
+
+// TBB
+#include <tbb/parallel_for.h>
+#include <tbb/task_arena.h>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+struct Fill {
+  double x;
+  double y;
+  double weight;
+};
+
+bool close(double aValue, double aExpected) {
+  // contents of TH1F and TH2F are single precision, summed in a different order
+  return std::abs(aValue - aExpected) <= 1e-4 * std::max(1., std::abs(aExpected));
+}
+
+int compare(const TH1& aHistogram, const TH1& aExpected) {
+  int failures = 0;
+  if (!close(aHistogram.GetEntries(), aExpected.GetEntries())) {
+    printf("%s: %g entries instead of %g\n", aExpected.GetName(), aHistogram.GetEntries(), aExpected.GetEntries());
+    failures++;
+  }
+  if ((aHistogram.GetSumw2N() > 0) != (aExpected.GetSumw2N() > 0)) {
+    printf("%s: sums of squares of weights %s\n", aExpected.GetName(),
+           aHistogram.GetSumw2N() > 0 ? "not expected" : "missing");
+    failures++;
+  }
+  double stats[TH1::kNstat] = {0.};
+  double expectedStats[TH1::kNstat] = {0.};
+  aHistogram.GetStats(stats);
+  aExpected.GetStats(expectedStats);
+  for (int i = 0; i < TH1::kNstat; i++) {
+    if (!close(stats[i], expectedStats[i])) {
+      printf("%s: statistics %d is %.9g instead of %.9g\n", aExpected.GetName(), i, stats[i], expectedStats[i]);
+      failures++;
+    }
+  }
+  // all bins, with the underflow and overflow bins
+  for (int bin = 0; bin < aExpected.GetNcells(); bin++) {
+    if (!close(aHistogram.GetBinContent(bin), aExpected.GetBinContent(bin)) ||
+        !close(aHistogram.GetBinError(bin), aExpected.GetBinError(bin))) {
+      printf("%s: bin %d is %.9g +- %.9g instead of %.9g +- %.9g\n", aExpected.GetName(), bin,
+             aHistogram.GetBinContent(bin), aHistogram.GetBinError(bin), aExpected.GetBinContent(bin),
+             aExpected.GetBinError(bin));
+      failures++;
+    }
+  }
+  return failures;
+}
+} // namespace
+
+int main() {
+  TH1::AddDirectory(false);
+  constexpr int numThreads = 4;
+  constexpr size_t numFills = 100000;
+
+  // fills over a range wider than the axes, to fill the underflow and overflow bins
+  std::mt19937_64 generator(12345);
+  std::normal_distribution<double> position(0., 6.);
+  std::uniform_real_distribution<double> weight(0.1, 3.);
+  std::vector<Fill> fills(numFills);
+  std::vector<Fill> weightedFills(numFills);
+  for (size_t i = 0; i < numFills; i++) {
+    fills[i] = {position(generator), position(generator), 1.};
+    weightedFills[i] = {fills[i].x, fills[i].y, weight(generator)};
+  }
+
+  struct Case {
+    std::string name;
+    bool twoDimensions;
+    bool sumw2;
+    const std::vector<Fill>* fills;
+  };
+  const std::vector<Case> cases = {{"h1", false, false, &fills},
+                                   {"h1Weighted", false, false, &weightedFills},
+                                   {"h1Sumw2", false, true, &fills},
+                                   {"h2", true, false, &fills},
+                                   {"h2Weighted", true, false, &weightedFills},
+                                   {"h2Sumw2", true, true, &weightedFills}};
+
+  tbb::task_arena arena(numThreads);
+  int failures = 0;
+  for (const auto& test : cases) {
+    auto book = [&test](const std::string& aName) -> std::unique_ptr<TH1> {
+      std::unique_ptr<TH1> histogram;
+      if (test.twoDimensions) {
+        histogram = std::make_unique<TH2F>(aName.c_str(), aName.c_str(), 20, -10., 10., 15, -10., 5.);
+      } else {
+        histogram = std::make_unique<TH1F>(aName.c_str(), aName.c_str(), 50, -10., 10.);
+      }
+      if (test.sumw2) {
+        histogram->Sumw2();
+      }
+      return histogram;
+    };
+    auto expected = book(test.name + "Direct");
+    auto merged = book(test.name + "ThreadLocal");
+    k4::recCalo::ThreadLocalHistogram::Registry registry;
+    k4::recCalo::ThreadLocalHistogram histogram;
+    histogram.book(merged.get(), registry);
+
+    // fills in two runs, merged after each run, to check that the merge adds to the previous fills
+    const auto& testFills = *test.fills;
+    for (size_t begin : {size_t(0), testFills.size() / 3}) {
+      const size_t end = begin == 0 ? testFills.size() / 3 : testFills.size();
+      for (size_t i = begin; i < end; i++) {
+        if (test.twoDimensions) {
+          static_cast<TH2*>(expected.get())->Fill(testFills[i].x, testFills[i].y, testFills[i].weight);
+        } else {
+          expected->Fill(testFills[i].x, testFills[i].weight);
+        }
+      }
+      arena.execute([&] {
+        tbb::parallel_for(begin, end, [&](size_t i) {
+          if (test.twoDimensions) {
+            histogram.fill2D(testFills[i].x, testFills[i].y, testFills[i].weight);
+          } else {
+            histogram.fill(testFills[i].x, testFills[i].weight);
+          }
+        });
+      });
+      registry.merge();
+      failures += compare(*merged, *expected);
+    }
+  }
+
+  if (failures > 0) {
+    printf("%d failures\n", failures);
+    return 1;
+  }
+  printf("ThreadLocalHistogram agrees with direct filling for %zu histograms\n", cases.size());
+  return 0;
+}
@@ -14,16 +14,53 @@
 #include "GaudiKernel/ITHistSvc.h"
 
 #include "Math/Factory.h"
-#include "Math/Functor.h"
+#include "Math/IFunction.h"
 #include "Math/Minimizer.h"
 #include "TH1F.h"
 #include "TMath.h"
 
+// TBB
+#include <tbb/parallel_for.h>
+
+// std
+#include <algorithm>
+#include <array>
+#include <functional>
+
 // Include the <cmath> header for std::fabs
 #include <cmath>
 
 DECLARE_COMPONENT(CalibrateBenchmarkMethod)
 
+namespace {
+/// number of parameters of the benchmark formula
+constexpr size_t kNumParameters = 6;
+/// number of events of the blocks over which the chi2 is summed
+constexpr size_t kEventsPerBlock = 4096;
+
+/// Function of the parameters computed together with its gradient by aFunction(parameters, gradient or nullptr)
+class GradientFunction : public ROOT::Math::IMultiGradFunction {
+public:
+  GradientFunction(std::function<double(const double*, double*)> aFunction, unsigned int aDim)
+      : m_function(std::move(aFunction)), m_dim(aDim) {}
+  unsigned int NDim() const override { return m_dim; }
+  ROOT::Math::IMultiGenFunction* Clone() const override { return new GradientFunction(*this); }
+  void Gradient(const double* aX, double* aGradient) const override { m_function(aX, aGradient); }
+  void FdF(const double* aX, double& aValue, double* aGradient) const override { aValue = m_function(aX, aGradient); }
+
+private:
+  double DoEval(const double* aX) const override { return m_function(aX, nullptr); }
+  double DoDerivative(const double* aX, unsigned int aCoordinate) const override {
+    std::vector<double> gradient(m_dim);
+    m_function(aX, gradient.data());
+    return gradient[aCoordinate];
+  }
+
+  std::function<double(const double*, double*)> m_function;
+  unsigned int m_dim;
+};
+} // namespace
+
 CalibrateBenchmarkMethod::CalibrateBenchmarkMethod(const std::string& aName, ISvcLocator* aSvcLoc)
     : Gaudi::Algorithm(aName, aSvcLoc), m_geoSvc("GeoSvc", aName), m_histSvc("THistSvc", aName),
       m_totalEnergyECal(nullptr), m_totalEnergyHCal(nullptr), m_totalEnergyBoth(nullptr), m_parameters(nullptr) {
@@ -89,6 +126,11 @@ StatusCode CalibrateBenchmarkMethod::initialize() {
   m_energyInLayerECal.resize(m_numLayersECal);
   m_energyInLayerHCal.resize(m_numLayersHCal);
 
+  if (m_numThreads != 1) {
+    m_arena.initialize(m_numThreads > 0 ? int(m_numThreads) : tbb::task_arena::automatic);
+    info() << "Chi2 of the minimization evaluated on " << m_arena.max_concurrency() << " threads" << endmsg;
+  }
+
   return StatusCode::SUCCESS;
 }
 
@@ -190,33 +232,105 @@ StatusCode CalibrateBenchmarkMethod::execute(const EventContext&) const {
   return StatusCode::SUCCESS;
 }
 
-// minimisation function for the benchmark method
-double CalibrateBenchmarkMethod::chiSquareFitBarrel(const double* parameter) const {
+template <bool withGradient>
+void CalibrateBenchmarkMethod::sumChiSquare(const double* parameter, size_t aBegin, size_t aEnd,
+                                            double* aSums) const {
+  const double* generatedEnergies = m_vecGeneratedEnergy.data();
+  const double* totalEnergiesInECal = m_vecTotalEnergyinECal.data();
+  const double* totalEnergiesInHCal = m_vecTotalEnergyinHCal.data();
+  const double* energiesInFirstLayerECal = m_vecEnergyInFirstLayerECal.data();
+  const double* energiesInLastLayerECal = m_vecEnergyInLastLayerECal.data();
+  const double* energiesInFirstLayerHCal = m_vecEnergyInFirstLayerHCal.data();
+
+  // the energy loss sqrt(|p0 * p1 * c|) is sqrt(|p0 * p1|) sqrt(|c|), with the derivatives energyLoss / (2 p0) and
+  // energyLoss / (2 p1), taken as 0 where it vanishes: the factors depending only on the parameters are computed once,
+  // so that the loop has no branch and no division by a parameter
+  const double energyLossScale = std::sqrt(std::fabs(parameter[0] * parameter[1]));
+  const double energyLossFactor0 = parameter[0] != 0. ? 0.5 * parameter[2] / parameter[0] : 0.;
+  const double energyLossFactor1 = parameter[1] != 0. ? 0.5 * parameter[2] / parameter[1] : 0.;
+
+  // sums kept in local variables and reduced by the simd loop, so that the loop over the events is vectorised (this
+  // file is compiled with -fopenmp-simd and -fno-math-errno, see CMakeLists.txt)
   double fitvalue = 0.;
-  // loop over all events, vector of a size of #evts is filled with the energies
+  double derivatives[kNumParameters] = {0.};
   // ECal calibrated to EM scale, HCal calibrated to HAD scale
-  for (uint i = 0; i < m_vecTotalEnergyinECal.size(); i++) {
-    double generatedEnergy = m_vecGeneratedEnergy.at(i);
-    double totalEnergyInECal = m_vecTotalEnergyinECal.at(i);
-    double totalEnergyInHCal = m_vecTotalEnergyinHCal.at(i);
-    double energyInFirstLayerECal = m_vecEnergyInFirstLayerECal.at(i);
-    double energyInLastLayerECal = m_vecEnergyInLastLayerECal.at(i);
-    double energyInFirstLayerHCal = m_vecEnergyInFirstLayerHCal.at(i);
-
-    double benchmarkEnergy =
-        parameter[0] * totalEnergyInECal + parameter[1] * totalEnergyInHCal +
-        parameter[2] *
-            std::sqrt(std::fabs(energyInLastLayerECal * parameter[0] * energyInFirstLayerHCal * parameter[1])) +
-        parameter[3] * std::pow(totalEnergyInECal * parameter[0], 2) + parameter[4] * energyInFirstLayerECal +
-        parameter[5];
+#pragma omp simd reduction(+ : fitvalue, derivatives[:kNumParameters])
+  for (size_t i = aBegin; i < aEnd; i++) {
+    const double generatedEnergy = generatedEnergies[i];
+    const double totalEnergyInECal = totalEnergiesInECal[i];
+    const double scaledEnergyInECal = totalEnergyInECal * parameter[0];
+    const double energyLoss =
+        energyLossScale * std::sqrt(std::fabs(energiesInLastLayerECal[i] * energiesInFirstLayerHCal[i]));
 
     // general formula below gives possibility to fit also parameter[1] to scale E_HCal_total and a contant term
     // parameter[5] to include residuals parameter[0] scales ECal to HAD scale parameter[1] scales HCal to HAD scale
     // (fixed to 1 if HCal is already calibrated at HAD scale at the input level) parameter[2] energy losses between
     // ECal and HCal parameter[3] corrects for non-compensation of ECal parameter[4] upstream correction parameter[5]
     // residuals
+    const double benchmarkEnergy = parameter[0] * totalEnergyInECal + parameter[1] * totalEnergiesInHCal[i] +
+                                   parameter[2] * energyLoss + parameter[3] * scaledEnergyInECal * scaledEnergyInECal +
+                                   parameter[4] * energiesInFirstLayerECal[i] + parameter[5];
+
+    const double residual = generatedEnergy - benchmarkEnergy;
+    fitvalue += residual * residual / generatedEnergy;
+
+    if constexpr (withGradient) {
+      // d(chi2)/d(benchmarkEnergy) times d(benchmarkEnergy)/d(parameter[k])
+      const double weight = -2. * residual / generatedEnergy;
+      derivatives[0] += weight * (totalEnergyInECal + energyLossFactor0 * energyLoss +
+                                  2. * parameter[3] * scaledEnergyInECal * totalEnergyInECal);
+      derivatives[1] += weight * (totalEnergiesInHCal[i] + energyLossFactor1 * energyLoss);
+      derivatives[2] += weight * energyLoss;
+      derivatives[3] += weight * scaledEnergyInECal * scaledEnergyInECal;
+      derivatives[4] += weight * energiesInFirstLayerECal[i];
+      derivatives[5] += weight;
+    }
+  }
+  aSums[0] += fitvalue;
+  if constexpr (withGradient) {
+    for (size_t k = 0; k < kNumParameters; k++) {
+      aSums[k + 1] += derivatives[k];
+    }
+  }
+}
 
-    fitvalue += std::pow((generatedEnergy - benchmarkEnergy), 2) / generatedEnergy;
+// minimisation function for the benchmark method
+double CalibrateBenchmarkMethod::chiSquareFitBarrel(const double* parameter, double* aGradient) const {
+  // the events are split in blocks of fixed size, the chi2 and its gradient are summed over the events of each block
+  // (concurrently for several blocks) and then over the blocks in their order, so that the sums do not depend on the
+  // number of threads
+  const size_t numEvents = m_vecTotalEnergyinECal.size();
+  const size_t numBlocks = (numEvents + kEventsPerBlock - 1) / kEventsPerBlock;
+  std::vector<std::array<double, kNumParameters + 1>> blockSums(numBlocks);
+  auto sumBlock = [&](size_t iBlock) {
+    blockSums[iBlock].fill(0.);
+    const size_t begin = iBlock * kEventsPerBlock;
+    const size_t end = std::min(begin + kEventsPerBlock, numEvents);
+    if (aGradient != nullptr) {
+      sumChiSquare<true>(parameter, begin, end, blockSums[iBlock].data());
+    } else {
+      sumChiSquare<false>(parameter, begin, end, blockSums[iBlock].data());
+    }
+  };
+  if (m_numThreads != 1 && numBlocks > 1) {
+    m_arena.execute([&] { tbb::parallel_for(size_t(0), numBlocks, sumBlock); });
+  } else {
+    for (size_t iBlock = 0; iBlock < numBlocks; iBlock++) {
+      sumBlock(iBlock);
+    }
+  }
+
+  double fitvalue = 0.;
+  if (aGradient != nullptr) {
+    std::fill(aGradient, aGradient + kNumParameters, 0.);
+  }
+  for (const auto& sums : blockSums) {
+    fitvalue += sums[0];
+    if (aGradient != nullptr) {
+      for (size_t k = 0; k < kNumParameters; k++) {
+        aGradient[k] += sums[k + 1];
+      }
+    }
   }
   return fitvalue;
 }
@@ -250,8 +364,10 @@ void CalibrateBenchmarkMethod::registerHistogram(const std::string& path, TH1F*&
 void CalibrateBenchmarkMethod::runMinimization(int n_param, const std::vector<double>& variable,
                                                const std::vector<double>& steps,
                                                const std::vector<int>& fixedParameters) const {
-  // Set up the functor (the function to be minimized)
-  ROOT::Math::Functor f(this, &CalibrateBenchmarkMethod::chiSquareFitBarrel, n_param);
+  // Set up the function to be minimized, with its analytic gradient
+  GradientFunction f(
+      [this](const double* aParameters, double* aGradient) { return chiSquareFitBarrel(aParameters, aGradient); },
+      n_param);
 
   // Initialize the minimizer
   ROOT::Math::Minimizer* minimizer = ROOT::Math::Factory::CreateMinimizer("Minuit2", "Migrad");
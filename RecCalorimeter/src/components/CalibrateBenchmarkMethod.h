@@ -9,6 +9,9 @@
 class IGeoSvc;
 class TH1F;
 
+// TBB
+#include <tbb/task_arena.h>
+
 // EDM4HEP
 namespace edm4hep {
 class CalorimeterHitCollection;
@@ -35,6 +38,9 @@ class ITHistSvc;
  * and correct output cluster energy. To obtain the actual parameters run
  * RecCalorimeter/tests/options/fcc_ee_caloBenchmarkCalibration.py
  *
+ * The chi2 and its analytic gradient are summed over blocks of events, concurrently if numThreads is different from 1,
+ * and the sums of the blocks are added in a fixed order, so the fit result does not depend on the number of threads.
+ *
  *  Based on work done by Anna Zaborowska, Jana Faltova and Juraj Smiesko
  *
  *  @author Michaela Mlynarikova
@@ -64,7 +70,11 @@ private:
   /// Pointer to the interface of histogram service
   ServiceHandle<ITHistSvc> m_histSvc;
 
-  double chiSquareFitBarrel(const double* par) const;
+  /// chi2 of the benchmark method, and its gradient in aGradient if not null
+  double chiSquareFitBarrel(const double* par, double* aGradient = nullptr) const;
+  /// Add the chi2 and, if withGradient, its gradient for the events [aBegin, aEnd) to aSums
+  template <bool withGradient>
+  void sumChiSquare(const double* par, size_t aBegin, size_t aEnd, double* aSums) const;
   void registerHistogram(const std::string& path, TH1F*& histogramName);
   void runMinimization(int n_param, const std::vector<double>& variable, const std::vector<double>& steps,
                        const std::vector<int>& fixedParameters) const;
@@ -108,7 +118,7 @@ private:
   Gaudi::Property<uint> m_systemIDECal{this, "ECalSystemID", 4, "ID of ECal system"};
   Gaudi::Property<uint> m_systemIDHCal{this, "HCalSystemID", 8, "ID of the HCal system"};
 
-  /// vectors containing the energy deposits to be used for minimization
+  /// vectors containing the energy deposits to be used for minimization, one entry per event
   mutable std::vector<double> m_vecGeneratedEnergy;
   mutable std::vector<double> m_vecTotalEnergyinECal;
   mutable std::vector<double> m_vecTotalEnergyinHCal;
@@ -122,5 +132,10 @@ private:
   // tried again in the future)
   Gaudi::Property<std::vector<int>> m_fixedParameters = {
       this, "fixedParameters", {1, 5}, "Fixed parameters that will not be minimized"};
+
+  /// Number of threads evaluating the chi2 during the minimization
+  Gaudi::Property<int> m_numThreads{this, "numThreads", 1,
+                                    "Number of threads evaluating the chi2 (0: TBB default, 1: serial)"};
+  mutable tbb::task_arena m_arena;
 };
 #endif /* RECCALORIMETER_CALIBRATEBENCHMARKMETHOD_H */
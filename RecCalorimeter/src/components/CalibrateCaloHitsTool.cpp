@@ -5,6 +5,7 @@ DECLARE_COMPONENT(CalibrateCaloHitsTool)
 CalibrateCaloHitsTool::CalibrateCaloHitsTool(const std::string& type, const std::string& name, const IInterface* parent)
     : AlgTool(type, name, parent) {
   declareInterface<ICalibrateCaloHitsTool>(this);
+  declareInterface<IDenseCalibrateCaloHitsTool>(this);
 }
 
 StatusCode CalibrateCaloHitsTool::initialize() {
@@ -22,4 +23,11 @@ void CalibrateCaloHitsTool::calibrate(std::unordered_map<uint64_t, double>& aHit
                 [this](std::pair<const uint64_t, double>& p) { p.second *= m_invSamplingFraction; });
 }
 
+void CalibrateCaloHitsTool::calibrate(std::span<const uint64_t>, std::span<double> aEnergies) {
+  const double invSamplingFraction = m_invSamplingFraction;
+  for (auto& energy : aEnergies) {
+    energy *= invSamplingFraction;
+  }
+}
+
 StatusCode CalibrateCaloHitsTool::finalize() { return AlgTool::finalize(); }
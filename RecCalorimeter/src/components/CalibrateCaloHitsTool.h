@@ -7,6 +7,9 @@
 // k4FWCore
 #include "k4Interface/ICalibrateCaloHitsTool.h"
 
+// k4RecCalorimeter
+#include "RecCaloCommon/IDenseCalibrateCaloHitsTool.h"
+
 #include <vector>
 
 /** @class CalibrateCaloHitsTool
@@ -21,7 +24,9 @@
  *  @date   2016-09
  */
 
-class CalibrateCaloHitsTool : public AlgTool, virtual public ICalibrateCaloHitsTool {
+class CalibrateCaloHitsTool : public AlgTool,
+                              virtual public ICalibrateCaloHitsTool,
+                              virtual public IDenseCalibrateCaloHitsTool {
 public:
   CalibrateCaloHitsTool(const std::string& type, const std::string& name, const IInterface* parent);
   ~CalibrateCaloHitsTool() = default;
@@ -31,6 +36,9 @@ public:
   /** @brief  Calibrate Geant4 hit energy to EM scale
    */
   virtual void calibrate(std::unordered_map<uint64_t, double>& aHits) final;
+  /** @brief  Calibrate Geant4 hit energy to EM scale, for cells stored in dense arrays
+   */
+  virtual void calibrate(std::span<const uint64_t> aCellIds, std::span<double> aEnergies) final;
 
 private:
   /// Value of 1/sampling fraction
@@ -12,6 +12,7 @@ DECLARE_COMPONENT(CalibrateInLayersTool)
 CalibrateInLayersTool::CalibrateInLayersTool(const std::string& type, const std::string& name, const IInterface* parent)
     : AlgTool(type, name, parent), m_geoSvc("GeoSvc", "CalibrateInLayers") {
   declareInterface<ICalibrateCaloHitsTool>(this);
+  declareInterface<IDenseCalibrateCaloHitsTool>(this);
 }
 
 StatusCode CalibrateInLayersTool::initialize() {
@@ -23,25 +24,73 @@ StatusCode CalibrateInLayersTool::initialize() {
     error() << "Readout <<" << m_readoutName << ">> does not exist." << endmsg;
     return StatusCode::FAILURE;
   }
+  if (m_samplingFraction.empty()) {
+    error() << "No sampling fraction values provided!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+  // precompute the position of the layer field and the sampling fraction for each of its possible values
+  auto decoder = m_geoSvc->getDetector()->readout(m_readoutName).idSpec().decoder();
+  const auto& layerField = (*decoder)[m_layerFieldName.value()];
+  if (layerField.isSigned()) {
+    error() << "Layer field " << m_layerFieldName.value()
+            << " is signed, which the shift and mask decoding of the sampling fraction lookup table does not support"
+            << endmsg;
+    return StatusCode::FAILURE;
+  }
+  if (layerField.width() > 20) {
+    error() << "Layer field " << m_layerFieldName.value() << " is too wide (" << layerField.width()
+            << " bits) for the sampling fraction lookup table" << endmsg;
+    return StatusCode::FAILURE;
+  }
+  m_layerOffset = layerField.offset();
+  m_layerMask = (uint64_t(1) << layerField.width()) - 1;
+  m_numValidLayers = m_samplingFraction.size();
+  m_samplingFractionTable.resize(m_layerMask + 1);
+  for (uint64_t value = 0; value <= m_layerMask; value++) {
+    // shift layer id if the numbering does not start at 0, out-of-range layers use the last sampling fraction
+    uint layer = value - m_firstLayerId;
+    m_samplingFractionTable[value] =
+        layer < m_samplingFraction.size() ? m_samplingFraction[layer] : m_samplingFraction.value().back();
+  }
   return StatusCode::SUCCESS;
 }
 
 void CalibrateInLayersTool::calibrate(std::unordered_map<uint64_t, double>& aHits) {
-  auto decoder = m_geoSvc->getDetector()->readout(m_readoutName).idSpec().decoder();
   // Loop through energy deposits, multiply energy to get cell energy at electromagnetic scale
-  std::for_each(aHits.begin(), aHits.end(), [this, decoder](std::pair<const uint64_t, double>& p) {
-    dd4hep::DDSegmentation::CellID cID = p.first;
+  for (auto& hit : aHits) {
     // shift layer id if the numbering does not start at 0
-    uint layer = decoder->get(cID, m_layerFieldName) - m_firstLayerId;
-    if (layer < m_samplingFraction.size()) {
-      p.second /= m_samplingFraction[layer];
-    } else {
-      p.second /= m_samplingFraction[m_samplingFraction.size() - 1];
+    uint layer = ((hit.first >> m_layerOffset) & m_layerMask) - m_firstLayerId;
+    hit.second /= samplingFraction(hit.first);
+    if (layer >= m_numValidLayers) {
       warning() << "Size of sampling fraction values is smaller than the number of existing layers."
                 << " Taking the sampling fraction for last layer."
                 << " Layer ID: " << layer << endmsg;
     }
-  });
+  }
+}
+
+void CalibrateInLayersTool::calibrate(std::span<const uint64_t> aCellIds, std::span<double> aEnergies) {
+  // gather the sampling fraction of each cell from the lookup table and divide, no branch in the loop
+  size_t numMissing = 0;
+  for (size_t i = 0; i < aCellIds.size(); i++) {
+    uint64_t value = (aCellIds[i] >> m_layerOffset) & m_layerMask;
+    numMissing += uint(value - m_firstLayerId) >= m_numValidLayers;
+    aEnergies[i] /= m_samplingFractionTable[value];
+  }
+  if (numMissing > 0) {
+    warnMissingLayers(aCellIds);
+  }
+}
+
+void CalibrateInLayersTool::warnMissingLayers(std::span<const uint64_t> aCellIds) {
+  for (auto cellId : aCellIds) {
+    uint layer = ((cellId >> m_layerOffset) & m_layerMask) - m_firstLayerId;
+    if (layer >= m_numValidLayers) {
+      warning() << "Size of sampling fraction values is smaller than the number of existing layers."
+                << " Taking the sampling fraction for last layer."
+                << " Layer ID: " << layer << endmsg;
+    }
+  }
 }
 
 StatusCode CalibrateInLayersTool::finalize() { return AlgTool::finalize(); }
@@ -9,6 +9,9 @@
 #include "k4Interface/ICalibrateCaloHitsTool.h"
 class IGeoSvc;
 
+// k4RecCalorimeter
+#include "RecCaloCommon/IDenseCalibrateCaloHitsTool.h"
+
 #include <vector>
 
 /** @class CalibrateInLayersTool Reconstruction/RecCalorimeter/src/components/CalibrateInLayersTool.h
@@ -22,11 +25,16 @@ class IGeoSvc;
  *  It is used for calorimeters with varying sampling fraction in radial distance.
  *  Sampling fraction for each layer is used for the calibration of the deposits within this layer.
  *  Sampling fractions for layers may be obtained using SamplingFractionInLayers algorithm.
+ *  The layer field is decoded with a shift and a mask computed at initialisation, and the sampling fraction is looked
+ *  up in a table indexed by the raw field value, so that the calibration of dense arrays of cells vectorises. The
+ *  layer field must therefore be unsigned.
  *
  *  @author Anna Zaborowska
  */
 
-class CalibrateInLayersTool : public AlgTool, virtual public ICalibrateCaloHitsTool {
+class CalibrateInLayersTool : public AlgTool,
+                              virtual public ICalibrateCaloHitsTool,
+                              virtual public IDenseCalibrateCaloHitsTool {
 public:
   CalibrateInLayersTool(const std::string& type, const std::string& name, const IInterface* parent);
   ~CalibrateInLayersTool() = default;
@@ -42,8 +50,18 @@ public:
   /** @brief  Calibrate Geant4 hit energy to EM scale
    */
   virtual void calibrate(std::unordered_map<uint64_t, double>& aHits) final;
+  /** @brief  Calibrate Geant4 hit energy to EM scale, for cells stored in dense arrays
+   */
+  virtual void calibrate(std::span<const uint64_t> aCellIds, std::span<double> aEnergies) final;
 
 private:
+  /// Sampling fraction of the cell, from the lookup table
+  double samplingFraction(uint64_t aCellId) const {
+    return m_samplingFractionTable[(aCellId >> m_layerOffset) & m_layerMask];
+  }
+  /// Warn about the cells in layers without a sampling fraction
+  void warnMissingLayers(std::span<const uint64_t> aCellIds);
+
   /// Pointer to the geometry service
   ServiceHandle<IGeoSvc> m_geoSvc;
   /// Name of the detector readout
@@ -55,5 +73,12 @@ private:
   /// Values of sampling fraction
   Gaudi::Property<std::vector<double>> m_samplingFraction{
       this, "samplingFraction", {}, "Values of sampling fraction per layer"};
+  /// Offset and (unshifted) mask of the layer field in the cellID
+  unsigned m_layerOffset = 0;
+  uint64_t m_layerMask = 0;
+  /// Sampling fraction per raw value of the layer field, the last value is used for layers out of range
+  std::vector<double> m_samplingFractionTable;
+  /// Number of raw values of the layer field that have a sampling fraction, starting from m_firstLayerId
+  uint64_t m_numValidLayers = 0;
 };
 #endif /* RECCALORIMETER_CALIBRATEINLAYERSTOOL_H */
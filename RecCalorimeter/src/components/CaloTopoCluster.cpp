@@ -59,6 +59,13 @@ StatusCode CaloTopoCluster::initialize() {
     error() << "Unable to retrieve the topo cluster input tool!!!" << endmsg;
     return StatusCode::FAILURE;
   }
+  if (m_streamInput) {
+    m_chunkedInputTool = SmartIF<ITopoClusterChunkedInputTool>(m_inputTool.get());
+    if (!m_chunkedInputTool) {
+      error() << "Input tool " << m_inputTool.typeAndName() << " does not provide the cells in chunks!" << endmsg;
+      return StatusCode::FAILURE;
+    }
+  }
   if (!m_neighboursTool.retrieve()) {
     error() << "Unable to retrieve the cells neighbours tool!!!" << endmsg;
     return StatusCode::FAILURE;
@@ -90,9 +97,51 @@ StatusCode CaloTopoCluster::initialize() {
 
 StatusCode CaloTopoCluster::execute(const EventContext&) const {
 
-  std::unordered_map<uint64_t, double> allCells;
   std::vector<std::pair<uint64_t, double>> firstSeeds;
 
+  if (m_streamInput) {
+    // get input cells subsystem by subsystem, finding the seeds on the way
+    k4::recCalo::SortedCellMap allCells;
+    const size_t maxCells = m_maxCellMemory * 1024 * 1024 / sizeof(k4::recCalo::SortedCellMap::value_type);
+    bool overBudget = false;
+    StatusCode sc_readCells = m_chunkedInputTool->cellChunks(
+        [&](std::span<const uint64_t> aCellIds, std::span<const double> aEnergies) {
+          if (m_maxCellMemory > 0) {
+            const size_t numCells = allCells.size() + aCellIds.size();
+            if (numCells > maxCells) {
+              overBudget = true;
+              return StatusCode::FAILURE;
+            }
+            // grow the array geometrically but never beyond the limit, so that its capacity, and not only its size,
+            // stays within maxCellMemory (the reallocations and the sort still need temporary buffers on top of it)
+            if (numCells > allCells.capacity()) {
+              allCells.reserve(std::min(std::max(numCells, 2 * allCells.capacity()), maxCells));
+            }
+          }
+          allCells.append(aCellIds, aEnergies);
+          findingSeeds(aCellIds, aEnergies, m_seedSigma, firstSeeds);
+          return StatusCode::SUCCESS;
+        });
+    if (overBudget) {
+      m_numSkippedEvents++;
+      warning() << "Number of active cells exceeds the memory limit of " << m_maxCellMemory.value()
+                << " MB, event is skipped!" << endmsg;
+      m_clusterCollection.createAndPut();
+      m_clusterCellsCollection.createAndPut();
+      return StatusCode::SUCCESS;
+    }
+    if (sc_readCells.isFailure()) {
+      error() << "Unable to read input cells!" << endmsg;
+      return StatusCode::FAILURE;
+    }
+    allCells.sort();
+    debug() << "Active Cells          :    " << allCells.size() << endmsg;
+    debug() << "Number of seeds found :    " << firstSeeds.size() << endmsg;
+    return buildClusters(allCells, firstSeeds);
+  }
+
+  std::unordered_map<uint64_t, double> allCells;
+
   // get input cell map from input tool
   StatusCode sc_prepareCellMap = m_inputTool->cellIDMap(allCells);
   if (sc_prepareCellMap.isFailure()) {
@@ -101,14 +150,20 @@ StatusCode CaloTopoCluster::execute(const EventContext&) const {
   }
   debug() << "Active Cells          :    " << allCells.size() << endmsg;
 
-  // Create output collections
-  auto edmClusters = m_clusterCollection.createAndPut();
-  std::unique_ptr<edm4hep::CalorimeterHitCollection> edmClusterCells(new edm4hep::CalorimeterHitCollection());
-
   // Finds seeds
   CaloTopoCluster::findingSeeds(allCells, m_seedSigma, firstSeeds);
   debug() << "Number of seeds found :    " << firstSeeds.size() << endmsg;
 
+  return buildClusters(allCells, firstSeeds);
+}
+
+template <typename CellMap>
+StatusCode CaloTopoCluster::buildClusters(const CellMap& allCells,
+                                          std::vector<std::pair<uint64_t, double>>& firstSeeds) const {
+  // Create output collections
+  auto edmClusters = m_clusterCollection.createAndPut();
+  std::unique_ptr<edm4hep::CalorimeterHitCollection> edmClusterCells(new edm4hep::CalorimeterHitCollection());
+
   // decending order of seeds
   std::sort(firstSeeds.begin(), firstSeeds.end(),
             [](const std::pair<uint64_t, double>& lhs, const std::pair<uint64_t, double>& rhs) {
@@ -127,6 +182,7 @@ StatusCode CaloTopoCluster::execute(const EventContext&) const {
   debug() << "Building " << preClusterCollection.size() << " cluster." << endmsg;
   double checkTotEnergy = 0.;
   int clusterWithMixedCells = 0;
+  size_t clusteredCells = 0;
   for (auto i : preClusterCollection) {
     edm4hep::MutableCluster cluster;
     // auto& clusterCore = cluster.core();
@@ -147,7 +203,12 @@ StatusCode CaloTopoCluster::execute(const EventContext&) const {
       //      auto cellID = pair.first;
       // get CalorimeterHit by cellID
       auto newCell = edmClusterCells->create();
-      newCell.setEnergy(allCells[cID]);
+      auto itCell = allCells.find(cID);
+      if (itCell == allCells.end()) {
+        info() << "Problem in finding cell ID in map." << endmsg;
+      } else {
+        newCell.setEnergy(itCell->second);
+      }
       newCell.setCellID(cID);
       newCell.setType(pair.second);
       energy += newCell.getEnergy();
@@ -188,10 +249,7 @@ StatusCode CaloTopoCluster::execute(const EventContext&) const {
       sumEta += posCell.Eta() * newCell.getEnergy();
 
       cluster.addToHits(newCell);
-      auto er = allCells.erase(cID);
-
-      if (er != 1)
-        info() << "Problem in erasing cell ID from map." << endmsg;
+      clusteredCells++;
     }
     cluster.setEnergy(energy);
     cluster.setPosition(edm4hep::Vector3f(posX / energy, posY / energy, posZ / energy));
@@ -219,7 +277,7 @@ StatusCode CaloTopoCluster::execute(const EventContext&) const {
   m_clusterCellsCollection.put(std::move(edmClusterCells));
   debug() << "Number of clusters with cells in E and HCal:        " << clusterWithMixedCells << endmsg;
   debug() << "Total energy of clusters:                           " << checkTotEnergy << endmsg;
-  debug() << "Leftover cells :                                    " << allCells.size() << endmsg;
+  debug() << "Leftover cells :                                    " << allCells.size() - clusteredCells << endmsg;
   return StatusCode::SUCCESS;
 }
 
@@ -240,9 +298,21 @@ void CaloTopoCluster::findingSeeds(const std::unordered_map<uint64_t, double>& a
   }
 }
 
+void CaloTopoCluster::findingSeeds(std::span<const uint64_t> aCellIds, std::span<const double> aEnergies,
+                                   int aNumSigma, std::vector<std::pair<uint64_t, double>>& aSeeds) const {
+  for (size_t i = 0; i < aCellIds.size(); i++) {
+    // retrieve the noise const and offset assigned to cell
+    double threshold =
+        m_noiseTool->getNoiseOffsetPerCell(aCellIds[i]) + (m_noiseTool->getNoiseRMSPerCell(aCellIds[i]) * aNumSigma);
+    if (abs(aEnergies[i]) > threshold) {
+      aSeeds.emplace_back(aCellIds[i], aEnergies[i]);
+    }
+  }
+}
+
+template <typename CellMap>
 StatusCode CaloTopoCluster::buildingProtoCluster(
-    int aNumSigma, int aLastNumSigma, std::vector<std::pair<uint64_t, double>>& aSeeds,
-    const std::unordered_map<uint64_t, double>& aCells,
+    int aNumSigma, int aLastNumSigma, std::vector<std::pair<uint64_t, double>>& aSeeds, const CellMap& aCells,
     std::map<uint, std::vector<std::pair<uint64_t, int>>>& aPreClusterCollection) const {
   // Map of cellIDs to clusterIds
   std::map<uint64_t, uint> clusterOfCell;
@@ -303,8 +373,9 @@ StatusCode CaloTopoCluster::buildingProtoCluster(
   return StatusCode::SUCCESS;
 }
 
+template <typename CellMap>
 std::vector<std::pair<uint64_t, uint>> CaloTopoCluster::searchForNeighbours(
-    const uint64_t aCellId, uint& aClusterID, int aNumSigma, const std::unordered_map<uint64_t, double>& aCells,
+    const uint64_t aCellId, uint& aClusterID, int aNumSigma, const CellMap& aCells,
     std::map<uint64_t, uint>& aClusterOfCell,
     std::map<uint, std::vector<std::pair<uint64_t, int>>>& aPreClusterCollection, bool aAllowClusterMerge) const {
   // Fill vector to be returned, next cell ids and cluster id for which neighbours are found
@@ -395,4 +466,10 @@ std::vector<std::pair<uint64_t, uint>> CaloTopoCluster::searchForNeighbours(
   return addedNeighbourIds;
 }
 
-StatusCode CaloTopoCluster::finalize() { return Gaudi::Algorithm::finalize(); }
+StatusCode CaloTopoCluster::finalize() {
+  if (m_numSkippedEvents > 0) {
+    warning() << m_numSkippedEvents.load() << " events were skipped as their cells exceed the memory limit of "
+              << m_maxCellMemory.value() << " MB" << endmsg;
+  }
+  return Gaudi::Algorithm::finalize();
+}
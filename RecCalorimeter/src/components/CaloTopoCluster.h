@@ -16,6 +16,15 @@
 #include "k4Interface/INoiseConstTool.h"
 #include "k4Interface/ITopoClusterInputTool.h"
 
+// RecCaloCommon
+#include "RecCaloCommon/SortedCellMap.h"
+
+#include "ITopoClusterChunkedInputTool.h"
+
+// std
+#include <atomic>
+#include <span>
+
 class IGeoSvc;
 
 // EDM4HEP
@@ -46,6 +55,11 @@ namespace DDSegmentation {
  * "lastNeighbourSigma". In case that a neighbour is found that has already been assigned to another cluster, both
  * clusters are merged and assigned to the "older" clusterID, this is the one originating from a higher seed energy. The
  * iteration over neighburing cellIDs is continued.
+ *  If streamInput is set, the input tool hands the cells over one subsystem at a time. Seeds are found per subsystem
+ * and the cells are kept in a compact sorted array instead of a hash map. The number of cells of this array can be
+ * limited with maxCellMemory, events exceeding the limit are skipped (empty cluster collections are written) and
+ * counted in finalize. The limit is an estimate of the memory of the cells, not a bound on the memory used by the
+ * event: the sorting buffer and the other containers of the clustering come on top of it.
  *  @author Coralie Neubueser
  */
 
@@ -63,6 +77,15 @@ public:
   virtual void findingSeeds(const std::unordered_map<uint64_t, double>& aCells, int aNumSigma,
                             std::vector<std::pair<uint64_t, double>>& aSeeds) const;
 
+  /**  Find cells with a signal to noise ratio > nSigma in a chunk of cells.
+   *   @param[in] aCellIds, the cellIDs of the cells in the chunk.
+   *   @param[in] aEnergies, the energies of the cells in the chunk.
+   *   @param[in] aNumSigma, the signal to noise ratio that the cell has to exceed to become seed.
+   *   @param[in] aSeeds, the vector of seed cell ids anf their energy to build proto-clusters, appended.
+   */
+  void findingSeeds(std::span<const uint64_t> aCellIds, std::span<const double> aEnergies, int aNumSigma,
+                    std::vector<std::pair<uint64_t, double>>& aSeeds) const;
+
   /** Building proto-clusters from the found seeds.
    * First the function initialises a cluster in the preClusterCollection for the seed cells,
    * then it calls the CaloTopoCluster::searchForNeighbours function to retrieve the vector of next cellIDs to add and
@@ -75,8 +98,9 @@ public:
    *   @param[in] aPreClusterCollection, map that is filled with clusterID pointing to the associated cells, in a pair
    * of cellID and cellType.
    */
+  template <typename CellMap>
   StatusCode buildingProtoCluster(int aNumSigma, int aLastNumSigma, std::vector<std::pair<uint64_t, double>>& aSeeds,
-                                  const std::unordered_map<uint64_t, double>& aCells,
+                                  const CellMap& aCells,
                                   std::map<uint, std::vector<std::pair<uint64_t, int>>>& aPreClusterCollection) const;
 
   /** Search for neighbours and add them to preClusterCollection
@@ -91,12 +115,20 @@ public:
    *   @param[in] aAllowClusterMerge, bool to allow for clusters to be merged, set to false in case of last iteration in
    * CaloTopoCluster::buildingProtoCluster. return vector of pairs with cellID and energy of found neighbours.
    */
+  template <typename CellMap>
   std::vector<std::pair<uint64_t, uint>>
-  searchForNeighbours(const uint64_t aCellId, uint& aClusterID, int aNumSigma,
-                      const std::unordered_map<uint64_t, double>& aCells, std::map<uint64_t, uint>& aClusterOfCell,
+  searchForNeighbours(const uint64_t aCellId, uint& aClusterID, int aNumSigma, const CellMap& aCells,
+                      std::map<uint64_t, uint>& aClusterOfCell,
                       std::map<uint, std::vector<std::pair<uint64_t, int>>>& aPreClusterCollection,
                       bool aAllowClusterMerge) const;
 
+  /** Build the clusters from the seeds and write them to the output collections.
+   *   @param[in] aCells, map of all cells (std::unordered_map or k4::recCalo::SortedCellMap).
+   *   @param[in] aSeeds, vector of seeding cells.
+   */
+  template <typename CellMap>
+  StatusCode buildClusters(const CellMap& aCells, std::vector<std::pair<uint64_t, double>>& aSeeds) const;
+
   StatusCode execute(const EventContext&) const;
 
   StatusCode finalize();
@@ -115,6 +147,8 @@ private:
   SmartIF<IGeoSvc> m_geoSvc;
   /// Handle for the input tool
   mutable ToolHandle<ITopoClusterInputTool> m_inputTool{"TopoClusterInput", this};
+  /// Chunked interface of the input tool (if streamInput is set)
+  SmartIF<ITopoClusterChunkedInputTool> m_chunkedInputTool;
   /// Handle for the cells noise tool
   mutable ToolHandle<INoiseConstTool> m_noiseTool{"TopoCaloNoisyCells", this};
   /// Handle for neighbours tool
@@ -145,6 +179,15 @@ private:
   Gaudi::Property<int> m_neighbourSigma{this, "neighbourSigma", 2, "number of sigma in noise threshold"};
   /// Last neighbour threshold in sigma
   Gaudi::Property<int> m_lastNeighbourSigma{this, "lastNeighbourSigma", 0, "number of sigma in noise threshold"};
+  /// Stream the input cells one subsystem at a time
+  Gaudi::Property<bool> m_streamInput{this, "streamInput", false,
+                                      "Read the input cells one subsystem at a time into a compact cell array"};
+  /// Limit on the cells when streaming the input, as an estimate of their memory
+  Gaudi::Property<double> m_maxCellMemory{
+      this, "maxCellMemory", 0.,
+      "Max estimated memory [MB] of the cell array if streamInput is set, events above are skipped (0 for no limit)"};
+  /// Number of events skipped as their cells exceed maxCellMemory
+  mutable std::atomic<size_t> m_numSkippedEvents = 0;
   /// General decoder to encode the calorimeter sub-system to determine which positions tool to use
   dd4hep::DDSegmentation::BitFieldCoder* m_decoder = new dd4hep::DDSegmentation::BitFieldCoder("system:4");
 };
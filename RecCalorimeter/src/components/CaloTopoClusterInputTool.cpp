@@ -11,6 +11,11 @@
 #include "DD4hep/Detector.h"
 #include "DD4hep/Readout.h"
 
+// std
+#include <array>
+#include <utility>
+#include <vector>
+
 DECLARE_COMPONENT(CaloTopoClusterInputTool)
 
 CaloTopoClusterInputTool::CaloTopoClusterInputTool(const std::string& type, const std::string& name,
@@ -24,6 +29,7 @@ CaloTopoClusterInputTool::CaloTopoClusterInputTool(const std::string& type, cons
   declareProperty("hcalEndcapCells", m_hcalEndcapCells, "");
   declareProperty("hcalFwdCells", m_hcalFwdCells, "");
   declareInterface<ITopoClusterInputTool>(this);
+  declareInterface<ITopoClusterChunkedInputTool>(this);
 }
 
 StatusCode CaloTopoClusterInputTool::initialize() {
@@ -43,75 +49,43 @@ StatusCode CaloTopoClusterInputTool::initialize() {
 StatusCode CaloTopoClusterInputTool::finalize() { return AlgTool::finalize(); }
 
 StatusCode CaloTopoClusterInputTool::cellIDMap(std::unordered_map<uint64_t, double>& aCells) {
-  [[maybe_unused]] uint totalNumberOfCells = 0;
-
-  // 1. ECAL barrel
-  // Get the input collection with calorimeter cells
-  const edm4hep::CalorimeterHitCollection* ecalBarrelCells = m_ecalBarrelCells.get();
-  debug() << "Input Ecal barrel cell collection size: " << ecalBarrelCells->size() << endmsg;
-  // Loop over a collection of calorimeter cells and build calo towers
-  for (const auto& iCell : *ecalBarrelCells) {
-    aCells.insert_or_assign(iCell.getCellID(), iCell.getEnergy());
-  }
-  totalNumberOfCells += ecalBarrelCells->size();
-
-  // 2. ECAL endcap calorimeter
-  const edm4hep::CalorimeterHitCollection* ecalEndcapCells = m_ecalEndcapCells.get();
-  debug() << "Input Ecal endcap cell collection size: " << ecalEndcapCells->size() << endmsg;
-  // Loop over a collection of calorimeter cells and build calo towers
-  for (const auto& iCell : *ecalEndcapCells) {
-    aCells.insert_or_assign(iCell.getCellID(), iCell.getEnergy());
-  }
-  totalNumberOfCells += ecalEndcapCells->size();
-
-  // 3. ECAL forward calorimeter
-  const edm4hep::CalorimeterHitCollection* ecalFwdCells = m_ecalFwdCells.get();
-  debug() << "Input Ecal forward cell collection size: " << ecalFwdCells->size() << endmsg;
-  // Loop over a collection of calorimeter cells and build calo towers
-  for (const auto& iCell : *ecalFwdCells) {
-    aCells.insert_or_assign(iCell.getCellID(), iCell.getEnergy());
-  }
-  totalNumberOfCells += ecalFwdCells->size();
-
-  // 4. HCAL barrel
-  const edm4hep::CalorimeterHitCollection* hcalBarrelCells = m_hcalBarrelCells.get();
-  debug() << "Input hadronic barrel cell collection size: " << hcalBarrelCells->size() << endmsg;
-  // Loop over a collection of calorimeter cells and build calo towers
-  for (const auto& iCell : *hcalBarrelCells) {
-    aCells.insert_or_assign(iCell.getCellID(), iCell.getEnergy());
-  }
-  totalNumberOfCells += hcalBarrelCells->size();
-
-  // 5. HCAL extended barrel
-  const edm4hep::CalorimeterHitCollection* hcalExtBarrelCells = m_hcalExtBarrelCells.get();
-  debug() << "Input hadronic extended barrel cell collection size: " << hcalExtBarrelCells->size() << endmsg;
-  // Loop over a collection of calorimeter cells and build calo towers
-  for (const auto& iCell : *hcalExtBarrelCells) {
-    aCells.insert_or_assign(iCell.getCellID(), iCell.getEnergy());
-  }
-  totalNumberOfCells += hcalExtBarrelCells->size();
-
-  // 6. HCAL endcap calorimeter
-  const edm4hep::CalorimeterHitCollection* hcalEndcapCells = m_hcalEndcapCells.get();
-  debug() << "Input Hcal endcap cell collection size: " << hcalEndcapCells->size() << endmsg;
-  // Loop over a collection of calorimeter cells and build calo towers
-  for (const auto& iCell : *hcalEndcapCells) {
-    aCells.insert_or_assign(iCell.getCellID(), iCell.getEnergy());
-  }
-  totalNumberOfCells += hcalEndcapCells->size();
+  return cellChunks([&aCells](std::span<const uint64_t> aCellIds, std::span<const double> aEnergies) {
+    for (size_t i = 0; i < aCellIds.size(); i++) {
+      aCells.insert_or_assign(aCellIds[i], aEnergies[i]);
+    }
+    return StatusCode::SUCCESS;
+  });
+}
 
-  // 7. HCAL forward calorimeter
-  const edm4hep::CalorimeterHitCollection* hcalFwdCells = m_hcalFwdCells.get();
-  debug() << "Input Hcal forward cell collection size: " << hcalFwdCells->size() << endmsg;
-  // Loop over a collection of calorimeter cells and build calo towers
-  for (const auto& iCell : *hcalFwdCells) {
-    aCells.insert_or_assign(iCell.getCellID(), iCell.getEnergy());
+StatusCode CaloTopoClusterInputTool::cellChunks(const ChunkConsumer& aConsumer) {
+  const std::array<std::pair<const char*, k4FWCore::DataHandle<edm4hep::CalorimeterHitCollection>*>, 7> subsystems = {
+      {{"Ecal barrel", &m_ecalBarrelCells},
+       {"Ecal endcap", &m_ecalEndcapCells},
+       {"Ecal forward", &m_ecalFwdCells},
+       {"hadronic barrel", &m_hcalBarrelCells},
+       {"hadronic extended barrel", &m_hcalExtBarrelCells},
+       {"Hcal endcap", &m_hcalEndcapCells},
+       {"Hcal forward", &m_hcalFwdCells}}};
+
+  // buffers reused for all subsystems, so only one subsystem is held in memory at a time
+  std::vector<uint64_t> cellIds;
+  std::vector<double> energies;
+  for (const auto& subsystem : subsystems) {
+    // Get the input collection with calorimeter cells
+    const edm4hep::CalorimeterHitCollection* cells = subsystem.second->get();
+    debug() << "Input " << subsystem.first << " cell collection size: " << cells->size() << endmsg;
+    cellIds.clear();
+    energies.clear();
+    cellIds.reserve(cells->size());
+    energies.reserve(cells->size());
+    for (const auto& iCell : *cells) {
+      cellIds.push_back(iCell.getCellID());
+      energies.push_back(iCell.getEnergy());
+    }
+    StatusCode sc = aConsumer(cellIds, energies);
+    if (sc.isFailure()) {
+      return sc;
+    }
   }
-  totalNumberOfCells += hcalFwdCells->size();
-
-  // if (totalNumberOfCells != aCells.size()){
-  // error() << "Map size != total number of cells! " << endmsg;
-  // return StatusCode::FAILURE;
-  // }
   return StatusCode::SUCCESS;
 }
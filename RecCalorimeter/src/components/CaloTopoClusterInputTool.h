@@ -7,6 +7,8 @@
 #include "k4FWCore/DataHandle.h"
 #include "k4Interface/ITopoClusterInputTool.h"
 
+#include "ITopoClusterChunkedInputTool.h"
+
 class IGeoSvc;
 
 // datamodel
@@ -28,11 +30,14 @@ namespace DDSegmentation {
  *  This tool runs over all calorimeter systems (ECAL barrel, HCAL barrel + extended barrel, calorimeter endcaps,
  * forward calorimeters). If not all systems are available or not wanted to be used, create an empty collection using
  * CreateDummyCellsCollection algorithm.
+ *  The cells can either be copied into a single map (cellIDMap) or handed over one subsystem at a time (cellChunks).
  *
  *  @author Coralie Neubueser
  */
 
-class CaloTopoClusterInputTool : public AlgTool, virtual public ITopoClusterInputTool {
+class CaloTopoClusterInputTool : public AlgTool,
+                                 virtual public ITopoClusterInputTool,
+                                 virtual public ITopoClusterChunkedInputTool {
 public:
   CaloTopoClusterInputTool(const std::string& type, const std::string& name, const IInterface* parent);
   virtual ~CaloTopoClusterInputTool() = default;
@@ -53,6 +58,12 @@ public:
    */
   virtual StatusCode cellIDMap(std::unordered_map<uint64_t, double>& aCells) final;
 
+  /** cellChunks
+   * Hands the cellIDs and energies of the cells over to the consumer, one subsystem at a time.
+   *  @return status code
+   */
+  virtual StatusCode cellChunks(const ChunkConsumer& aConsumer) final;
+
 private:
   /// Handle for electromagnetic barrel cells (input collection)
   mutable k4FWCore::DataHandle<edm4hep::CalorimeterHitCollection> m_ecalBarrelCells{"ecalBarrelCells",
@@ -0,0 +1,110 @@
+#include "CellIndexSvc.h"
+
+// k4FWCore
+#include "k4Interface/ICalorimeterTool.h"
+
+// ROOT
+#include "TFile.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+DECLARE_COMPONENT(CellIndexSvc)
+
+CellIndexSvc::CellIndexSvc(const std::string& aName, ISvcLocator* aSL) : base_class(aName, aSL) {}
+
+StatusCode CellIndexSvc::initialize() {
+  {
+    StatusCode sc = Service::initialize();
+    if (sc.isFailure())
+      return sc;
+  }
+  // the readouts with a neighbour map are indexed right away
+  for (const auto& [readoutName, fileName] : m_neighbourMapFiles) {
+    std::vector<uint64_t> cellIds;
+    if (readNeighbourMap(fileName, cellIds).isFailure() || !buildIndex(readoutName, cellIds)) {
+      return StatusCode::FAILURE;
+    }
+  }
+  return StatusCode::SUCCESS;
+}
+
+const k4::recCalo::CellIndexMap* CellIndexSvc::cellIndex(const std::string& aReadoutName,
+                                                         ICalorimeterTool* aGeoTool) {
+  std::lock_guard<std::mutex> lock(m_mapsMutex);
+  auto map = m_maps.find(aReadoutName);
+  if (map != m_maps.end()) {
+    return &map->second;
+  }
+  if (aGeoTool == nullptr) {
+    error() << "No neighbour map file nor geometry tool to index the cells of readout " << aReadoutName << endmsg;
+    return nullptr;
+  }
+  std::unordered_map<uint64_t, double> cells;
+  if (aGeoTool->prepareEmptyCells(cells).isFailure()) {
+    error() << "Unable to get the list of cells of readout " << aReadoutName << " from the geometry tool" << endmsg;
+    return nullptr;
+  }
+  std::vector<uint64_t> cellIds;
+  cellIds.reserve(cells.size());
+  for (const auto& cell : cells) {
+    cellIds.push_back(cell.first);
+  }
+  return buildIndex(aReadoutName, cellIds);
+}
+
+const k4::recCalo::CellIndexMap* CellIndexSvc::buildIndex(const std::string& aReadoutName,
+                                                          std::vector<uint64_t>& aCellIds) {
+  k4::recCalo::CellIndexMap& map = m_maps[aReadoutName];
+  if (!map.build(aCellIds)) {
+    error() << "Unable to build the perfect hash of the cellIDs of readout " << aReadoutName << endmsg;
+    m_maps.erase(aReadoutName);
+    return nullptr;
+  }
+  if (map.size() == 0) {
+    error() << "No cells found in readout " << aReadoutName << endmsg;
+    m_maps.erase(aReadoutName);
+    return nullptr;
+  }
+  info() << "Indexed " << map.size() << " cells of readout " << aReadoutName << ", using "
+         << double(map.memory()) / map.size() << " bytes per cell" << endmsg;
+  return &map;
+}
+
+StatusCode CellIndexSvc::readNeighbourMap(const std::string& aFileName, std::vector<uint64_t>& aCellIds) const {
+  if (gSystem->AccessPathName(aFileName.c_str())) {
+    error() << "Provided neighbours map file not found!" << endmsg;
+    error() << "File path: " << aFileName << endmsg;
+    return StatusCode::FAILURE;
+  }
+  std::unique_ptr<TFile> inFile(TFile::Open(aFileName.c_str(), "READ"));
+  if (!inFile || inFile->IsZombie()) {
+    error() << "Unable to open the provided file with neighbours map!" << endmsg;
+    error() << "File path: " << aFileName << endmsg;
+    return StatusCode::FAILURE;
+  }
+  TTree* tree = nullptr;
+  inFile->GetObject("neighbours", tree);
+  if (!tree) {
+    error() << "No TTree 'neighbours' in " << aFileName << endmsg;
+    return StatusCode::FAILURE;
+  }
+  // only the cellIDs are needed, do not read the neighbour lists
+  ULong64_t readCellId;
+  tree->SetBranchStatus("*", false);
+  tree->SetBranchStatus("cellId", true);
+  tree->SetBranchAddress("cellId", &readCellId);
+  aCellIds.reserve(aCellIds.size() + tree->GetEntries());
+  for (Long64_t i = 0; i < tree->GetEntries(); i++) {
+    tree->GetEntry(i);
+    aCellIds.push_back(readCellId);
+  }
+  debug() << aFileName << " provided " << tree->GetEntries() << " cells" << endmsg;
+  delete tree;
+  inFile->Close();
+  return StatusCode::SUCCESS;
+}
+
+StatusCode CellIndexSvc::finalize() {
+  m_maps.clear();
+  return Service::finalize();
+}
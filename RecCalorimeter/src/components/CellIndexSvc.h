@@ -0,0 +1,50 @@
+#ifndef RECCALORIMETER_CELLINDEXSVC_H
+#define RECCALORIMETER_CELLINDEXSVC_H
+
+// std
+#include <map>
+#include <mutex>
+
+// Gaudi
+#include "GaudiKernel/Service.h"
+
+// k4RecCalorimeter
+#include "RecCaloCommon/CellIndexMap.h"
+#include "RecCaloCommon/ICellIndexSvc.h"
+
+/** @class CellIndexSvc k4RecCalorimeter/RecCalorimeter/src/components/CellIndexSvc.h
+ *
+ *  Service assigning a dense 32-bit index to every cell of a readout, one index per readout name.
+ *  The list of cells of a readout is read from the neighbour map file configured for the readout in
+ *  neighbourMapFiles (branch "cellId" of the TTree "neighbours", as read by TopoCaloNeighbours), in initialize, or
+ *  otherwise taken from the geometry tool of the first client asking for the readout (all cells returned by
+ *  prepareEmptyCells). The cellIDs are mapped to indices with a minimal perfect hash, see k4::recCalo::CellIndexMap.
+ *  Indices follow the order of the sorted cellIDs.
+ */
+
+class CellIndexSvc : public extends<Service, ICellIndexSvc> {
+public:
+  CellIndexSvc(const std::string& aName, ISvcLocator* aSL);
+  virtual ~CellIndexSvc() = default;
+
+  virtual StatusCode initialize() final;
+  virtual StatusCode finalize() final;
+
+  virtual const k4::recCalo::CellIndexMap* cellIndex(const std::string& aReadoutName,
+                                                     ICalorimeterTool* aGeoTool) final;
+
+private:
+  /// Read the cellIDs of the neighbour map stored in a file
+  StatusCode readNeighbourMap(const std::string& aFileName, std::vector<uint64_t>& aCellIds) const;
+  /// Build and store the index of a readout, nullptr on failure
+  const k4::recCalo::CellIndexMap* buildIndex(const std::string& aReadoutName, std::vector<uint64_t>& aCellIds);
+
+  /// Names of the files containing the neighbour map (TTree "neighbours" with branch "cellId"), by readout name
+  Gaudi::Property<std::map<std::string, std::string>> m_neighbourMapFiles{
+      this, "neighbourMapFiles", {}, "Files with the neighbour map by readout name, all cells of the map are indexed"};
+  /// cellID <-> index, by readout name
+  std::map<std::string, k4::recCalo::CellIndexMap> m_maps;
+  std::mutex m_mapsMutex;
+};
+
+#endif /* RECCALORIMETER_CELLINDEXSVC_H */
@@ -26,6 +26,9 @@
 // ROOT
 #include "TF2.h"
 
+// std
+#include <algorithm>
+
 // Include the <cmath> header for std::fabs
 #include <cmath>
 
@@ -163,23 +166,24 @@ StatusCode CorrectCaloClusters::initialize() {
 
   // Prepare upstream and downstream correction functions
   {
-    StatusCode sc = initializeCorrFunctions(m_upstreamFunctions, m_upstreamFormulas, m_upstreamParams, "upstream");
+    StatusCode sc = initializeCorrFunctions(m_upstreamFunctions, m_upstreamCompiled, m_upstreamFormulas,
+                                            m_upstreamParams, "upstream");
     if (sc.isFailure()) {
       error() << "Initialization of upstream correction functions not successful!" << endmsg;
       return sc;
     }
   }
   {
-    StatusCode sc =
-        initializeCorrFunctions(m_downstreamFunctions, m_downstreamFormulas, m_downstreamParams, "downstream");
+    StatusCode sc = initializeCorrFunctions(m_downstreamFunctions, m_downstreamCompiled, m_downstreamFormulas,
+                                            m_downstreamParams, "downstream");
     if (sc.isFailure()) {
       error() << "Initialization of downstream correction functions not successful!" << endmsg;
       return sc;
     }
   }
   {
-    StatusCode sc =
-        initializeCorrFunctions(m_benchmarkFunctions, m_benchmarkFormulas, m_benchmarkParametrization, "benchmark");
+    StatusCode sc = initializeCorrFunctions(m_benchmarkFunctions, m_benchmarkCompiled, m_benchmarkFormulas,
+                                            m_benchmarkParametrization, "benchmark");
     if (sc.isFailure()) {
       error() << "Initialization of benchmark correction functions not successful!" << endmsg;
       return sc;
@@ -190,7 +194,8 @@ StatusCode CorrectCaloClusters::initialize() {
   for (size_t i = 0; i < m_upstreamFunctions.size(); ++i) {
     for (size_t j = 0; j < m_upstreamFunctions[i].size(); ++j) {
       auto func = m_upstreamFunctions.at(i).at(j);
-      info() << "  " << func->GetName() << ": " << func->GetExpFormula() << endmsg;
+      info() << "  " << func->GetName() << ": " << func->GetExpFormula()
+             << (m_upstreamCompiled.at(i).at(j).isCompiled() ? " (compiled)" : " (TF1)") << endmsg;
       for (int k = 0; k < func->GetNpar(); ++k) {
         info() << "    " << func->GetParName(k) << ": " << func->GetParameter(k) << endmsg;
       }
@@ -201,7 +206,8 @@ StatusCode CorrectCaloClusters::initialize() {
   for (size_t i = 0; i < m_downstreamFunctions.size(); ++i) {
     for (size_t j = 0; j < m_downstreamFunctions[i].size(); ++j) {
       auto func = m_downstreamFunctions.at(i).at(j);
-      info() << "  " << func->GetName() << ": " << func->GetExpFormula() << endmsg;
+      info() << "  " << func->GetName() << ": " << func->GetExpFormula()
+             << (m_downstreamCompiled.at(i).at(j).isCompiled() ? " (compiled)" : " (TF1)") << endmsg;
       for (int k = 0; k < func->GetNpar(); ++k) {
         info() << "    " << func->GetParName(k) << ": " << func->GetParameter(k) << endmsg;
       }
@@ -212,7 +218,8 @@ StatusCode CorrectCaloClusters::initialize() {
   for (size_t i = 0; i < m_benchmarkFunctions.size(); ++i) {
     for (size_t j = 0; j < m_benchmarkFunctions[i].size(); ++j) {
       auto func = m_benchmarkFunctions.at(i).at(j);
-      info() << "  " << func->GetName() << ": " << func->GetExpFormula() << endmsg;
+      info() << "  " << func->GetName() << ": " << func->GetExpFormula()
+             << (m_benchmarkCompiled.at(i).at(j).isCompiled() ? " (compiled)" : " (TF1)") << endmsg;
       for (int k = 0; k < func->GetNpar(); ++k) {
         info() << "    " << func->GetParName(k) << ": " << func->GetParameter(k) << endmsg;
       }
@@ -298,10 +305,11 @@ CorrectCaloClusters::initializeOutputClusters(const edm4hep::ClusterCollection*
   return outClusters;
 }
 
-StatusCode CorrectCaloClusters::initializeCorrFunctions(std::vector<std::vector<TF1*>>& functions,
-                                                        std::vector<std::vector<std::string>> formulas,
-                                                        std::vector<std::vector<double>> parameters,
-                                                        const std::string& funcNameStem) {
+StatusCode CorrectCaloClusters::initializeCorrFunctions(
+    std::vector<std::vector<TF1*>>& functions,
+    std::vector<std::vector<k4::recCalo::CorrectionFunction>>& compiledFunctions,
+    std::vector<std::vector<std::string>> formulas, std::vector<std::vector<double>> parameters,
+    const std::string& funcNameStem) {
 
   for (size_t i = 0; i < formulas.size(); ++i) {
     auto& formulaVec = formulas[i];
@@ -344,32 +352,110 @@ StatusCode CorrectCaloClusters::initializeCorrFunctions(std::vector<std::vector<
       }
     }
 
+    // compile the formulas of a recognised form, with the parameters of their TF1
+    std::vector<k4::recCalo::CorrectionFunction> compiledVec(funcVec.size());
+    if (m_compiledCorrections) {
+      for (size_t j = 0; j < funcVec.size(); ++j) {
+        auto& compiled = compiledVec[j];
+        if (!compiled.compile(formulaVec.at(j)) || compiled.numParameters() != size_t(funcVec[j]->GetNpar())) {
+          debug() << "Formula " << formulaVec.at(j) << " not recognised, evaluated with TF1" << endmsg;
+          compiled = k4::recCalo::CorrectionFunction();
+          continue;
+        }
+        compiled.setParameters(std::span<const double>(funcVec[j]->GetParameters(), funcVec[j]->GetNpar()));
+        if (!agreesWithTF1(funcVec[j], compiled, hasY)) {
+          warning() << "Compiled formula " << formulaVec.at(j) << " differs from TF1, evaluated with TF1" << endmsg;
+          compiled = k4::recCalo::CorrectionFunction();
+        }
+      }
+    }
+
     functions.emplace_back(funcVec);
+    compiledFunctions.emplace_back(std::move(compiledVec));
   }
   return StatusCode::SUCCESS;
 }
 
+bool CorrectCaloClusters::agreesWithTF1(const TF1* function, const k4::recCalo::CorrectionFunction& compiledFunction,
+                                        bool hasY) const {
+  // energies from 0.5 to 500 GeV, angles from 0 to 180 degrees, as the ranges of the TF1
+  for (int ix = 0; ix < 50; ++ix) {
+    const double x = 0.5 * std::pow(1000., ix / 49.);
+    for (int iy = 0; iy < (hasY ? 10 : 1); ++iy) {
+      const double y = 20. * iy;
+      const double expected = function->Eval(x, y);
+      const double value = compiledFunction(x, y);
+      if (std::isnan(expected) && std::isnan(value)) {
+        continue;
+      }
+      if (!(std::abs(value - expected) <= 1e-9 * std::max(1., std::abs(expected)))) {
+        debug() << "Compiled formula gives " << value << " instead of " << expected << " at (" << x << ", " << y
+                << ")" << endmsg;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void CorrectCaloClusters::evaluateCorrFunction(const TF1* function,
+                                               const k4::recCalo::CorrectionFunction& compiledFunction,
+                                               std::span<const double> x, std::span<const double> y,
+                                               std::span<double> values) const {
+  if (compiledFunction.isCompiled()) {
+    compiledFunction.evaluate(x, y, values);
+    return;
+  }
+  for (size_t j = 0; j < x.size(); ++j) {
+    values[j] = function->Eval(x[j], y.empty() ? 0. : y[j]);
+  }
+}
+
 StatusCode CorrectCaloClusters::applyUpstreamCorr(const edm4hep::ClusterCollection* inClusters,
                                                   edm4hep::ClusterCollection* outClusters) const {
+  // variables of the correction functions for all clusters
+  const size_t numClusters = inClusters->size();
+  std::vector<double> clusterEnergies(numClusters);
+  std::vector<double> clusterThetas(numClusters);
+  for (size_t j = 0; j < numClusters; ++j) {
+    clusterEnergies[j] = inClusters->at(j).getEnergy();
+    clusterThetas[j] = getClusterTheta(inClusters->at(j));
+  }
+
+  std::vector<double> energiesInFirstLayer(numClusters);
+  std::vector<double> corrs;
   for (size_t i = 0; i < m_readoutNames.size(); ++i) {
-    for (size_t j = 0; j < inClusters->size(); ++j) {
-      double energyInFirstLayer =
+    for (size_t j = 0; j < numClusters; ++j) {
+      energiesInFirstLayer[j] =
           getEnergyInLayer(inClusters->at(j), m_readoutNames[i], m_systemIDs[i], m_firstLayerIDs[i]);
-      if (energyInFirstLayer < 0) {
+    }
+
+    // corrs[k * numClusters + j]: term k of the correction of cluster j
+    const size_t numFunctions = m_upstreamFunctions.at(i).size();
+    corrs.resize(numFunctions * numClusters);
+    for (size_t k = 0; k < numFunctions; ++k) {
+      std::span<double> values(corrs.data() + k * numClusters, numClusters);
+      evaluateCorrFunction(m_upstreamFunctions.at(i).at(k), m_upstreamCompiled.at(i).at(k), clusterEnergies,
+                           clusterThetas, values);
+      for (size_t j = 0; j < numClusters; ++j) {
+        values[j] *= std::pow(energiesInFirstLayer[j], k);
+      }
+    }
+
+    for (size_t j = 0; j < numClusters; ++j) {
+      if (energiesInFirstLayer[j] < 0) {
         warning() << "Energy in first calorimeter layer negative, ignoring upstream energy correction!" << endmsg;
         continue;
       }
 
-      const double clusterTheta = getClusterTheta(inClusters->at(j));
-      verbose() << "Energy in first layer: " << energyInFirstLayer << endmsg;
-      verbose() << "Cluster energy: " << inClusters->at(j).getEnergy() << endmsg;
-      verbose() << "Cluster theta: " << clusterTheta << endmsg;
+      verbose() << "Energy in first layer: " << energiesInFirstLayer[j] << endmsg;
+      verbose() << "Cluster energy: " << clusterEnergies[j] << endmsg;
+      verbose() << "Cluster theta: " << clusterThetas[j] << endmsg;
 
       verbose() << "Upstream correction:" << endmsg;
       double upstreamCorr = 0.;
-      for (size_t k = 0; k < m_upstreamFunctions.at(i).size(); ++k) {
-        auto func = m_upstreamFunctions.at(i).at(k);
-        double corr = func->Eval(inClusters->at(j).getEnergy(), clusterTheta) * std::pow(energyInFirstLayer, k);
+      for (size_t k = 0; k < numFunctions; ++k) {
+        double corr = corrs[k * numClusters + j];
         verbose() << "    upsilon_" << k << " * E_firstLayer^" << k << ": " << corr << endmsg;
         upstreamCorr += corr;
       }
@@ -385,25 +471,49 @@ StatusCode CorrectCaloClusters::applyUpstreamCorr(const edm4hep::ClusterCollecti
 
 StatusCode CorrectCaloClusters::applyDownstreamCorr(const edm4hep::ClusterCollection* inClusters,
                                                     edm4hep::ClusterCollection* outClusters) const {
+  // variables of the correction functions for all clusters
+  const size_t numClusters = inClusters->size();
+  std::vector<double> clusterEnergies(numClusters);
+  std::vector<double> clusterThetas(numClusters);
+  for (size_t j = 0; j < numClusters; ++j) {
+    clusterEnergies[j] = inClusters->at(j).getEnergy();
+    clusterThetas[j] = getClusterTheta(inClusters->at(j));
+  }
+
+  std::vector<double> energiesInLastLayer(numClusters);
+  std::vector<double> corrs;
   for (size_t i = 0; i < m_readoutNames.size(); ++i) {
-    for (size_t j = 0; j < inClusters->size(); ++j) {
-      double energyInLastLayer =
+    for (size_t j = 0; j < numClusters; ++j) {
+      energiesInLastLayer[j] =
           getEnergyInLayer(inClusters->at(j), m_readoutNames[i], m_systemIDs[i], m_lastLayerIDs[i]);
-      if (energyInLastLayer < 0) {
+    }
+
+    // corrs[k * numClusters + j]: term k of the correction of cluster j
+    const size_t numFunctions = m_downstreamFunctions.at(i).size();
+    corrs.resize(numFunctions * numClusters);
+    for (size_t k = 0; k < numFunctions; ++k) {
+      std::span<double> values(corrs.data() + k * numClusters, numClusters);
+      evaluateCorrFunction(m_downstreamFunctions.at(i).at(k), m_downstreamCompiled.at(i).at(k), clusterEnergies,
+                           clusterThetas, values);
+      for (size_t j = 0; j < numClusters; ++j) {
+        values[j] *= std::pow(energiesInLastLayer[j], k);
+      }
+    }
+
+    for (size_t j = 0; j < numClusters; ++j) {
+      if (energiesInLastLayer[j] < 0) {
         warning() << "Energy in last calorimeter layer negative, ignoring downstream energy correction!" << endmsg;
         continue;
       }
 
-      const double clusterTheta = getClusterTheta(inClusters->at(j));
-      verbose() << "Energy in last layer: " << energyInLastLayer << endmsg;
-      verbose() << "Cluster energy: " << inClusters->at(j).getEnergy() << endmsg;
-      verbose() << "Cluster theta: " << clusterTheta << endmsg;
+      verbose() << "Energy in last layer: " << energiesInLastLayer[j] << endmsg;
+      verbose() << "Cluster energy: " << clusterEnergies[j] << endmsg;
+      verbose() << "Cluster theta: " << clusterThetas[j] << endmsg;
 
       verbose() << "Downstream correction:" << endmsg;
       double downstreamCorr = 0.;
-      for (size_t k = 0; k < m_downstreamFunctions.at(i).size(); ++k) {
-        auto func = m_downstreamFunctions.at(i).at(k);
-        double corr = func->Eval(inClusters->at(j).getEnergy(), clusterTheta) * std::pow(energyInLastLayer, k);
+      for (size_t k = 0; k < numFunctions; ++k) {
+        double corr = corrs[k * numClusters + j];
         verbose() << "    delta_" << k << " * E_lastLayer^" << k << ": " << corr << endmsg;
         downstreamCorr += corr;
       }
@@ -434,7 +544,14 @@ StatusCode CorrectCaloClusters::applyBenchmarkCorr(const edm4hep::ClusterCollect
     }
   }
 
-  for (size_t j = 0; j < inClusters->size(); ++j) {
+  const size_t numClusters = inClusters->size();
+  std::vector<double> energiesInLastLayerECal(numClusters);
+  std::vector<double> energiesInFirstLayerECal(numClusters);
+  std::vector<double> energiesInFirstLayerHCal(numClusters);
+  std::vector<double> totalEnergiesInECal(numClusters);
+  std::vector<double> totalEnergiesInHCal(numClusters);
+  std::vector<double> approximateBenchmarkEnergies(numClusters);
+  for (size_t j = 0; j < numClusters; ++j) {
     double energyInLastLayerECal = getEnergyInLayer(inClusters->at(j), m_readoutNames[ecal_index],
                                                     m_systemIDs[ecal_index], m_lastLayerIDs[ecal_index]);
 
@@ -449,40 +566,64 @@ StatusCode CorrectCaloClusters::applyBenchmarkCorr(const edm4hep::ClusterCollect
     double totalEnergyInHCal = getTotalEnergy(inClusters->at(j), m_readoutNames[hcal_index], m_systemIDs[hcal_index]);
 
     // calculate approximate benchmark energy using non energy dependent benchmark parameters
-    double approximateBenchmarkEnergy =
+    approximateBenchmarkEnergies[j] =
         m_benchmarkParamsApprox[0] * totalEnergyInECal + m_benchmarkParamsApprox[1] * totalEnergyInHCal +
         m_benchmarkParamsApprox[2] * sqrt(abs(energyInLastLayerECal * m_benchmarkParamsApprox[0] *
                                               energyInFirstLayerHCal * m_benchmarkParamsApprox[1])) +
         m_benchmarkParamsApprox[3] * pow(totalEnergyInECal * m_benchmarkParamsApprox[0], 2) +
         m_benchmarkParamsApprox[4] * energyInFirstLayerECal + m_benchmarkParamsApprox[5];
 
-    // Calculate energy-dependent benchmark parameters p[0]-p[5]
-    auto benchmarkFormulasHighEne = m_benchmarkFunctions.at(0);
-    int nParam = benchmarkFormulasHighEne.size();
-    std::vector<double> benchmarkParameters(nParam, -1.);
+    energiesInLastLayerECal[j] = energyInLastLayerECal;
+    energiesInFirstLayerECal[j] = energyInFirstLayerECal;
+    energiesInFirstLayerHCal[j] = energyInFirstLayerHCal;
+    totalEnergiesInECal[j] = totalEnergyInECal;
+    totalEnergiesInHCal[j] = totalEnergyInHCal;
+  }
 
-    if (m_benchmarkEneSwitch > 0.) {
-      auto benchmarkFormulasLowEne = m_benchmarkFunctions.at(1);
-      // ensure smooth transition between low- and high-energy formulas (parameter l controls how fast the transition
-      // is)
-      int l = 2;
-      double transition = 0.5 * (1 + tanh(l * (approximateBenchmarkEnergy - m_benchmarkEneSwitch) / 2));
-      verbose() << "Using two formulas for benchmark calibration, the second formula provided will be used to correct "
-                   "energies below benchmarkEneSwitch threshold."
-                << endmsg;
-      for (size_t k = 0; k < benchmarkFormulasHighEne.size(); ++k) {
-        auto func_low_ene = benchmarkFormulasLowEne.at(k);
-        auto func_high_ene = benchmarkFormulasHighEne.at(k);
-        benchmarkParameters[k] = (1 - transition) * func_low_ene->Eval(approximateBenchmarkEnergy) +
-                                 transition * func_high_ene->Eval(approximateBenchmarkEnergy);
-      }
-    } else {
-      verbose() << "Using one formula for benchmark calibration." << endmsg;
-      for (size_t k = 0; k < benchmarkFormulasHighEne.size(); ++k) {
-        auto func = benchmarkFormulasHighEne.at(k);
-        benchmarkParameters[k] = func->Eval(approximateBenchmarkEnergy);
+  // Calculate energy-dependent benchmark parameters p[0]-p[5] of all clusters
+  // allBenchmarkParameters[k * numClusters + j]: parameter k of cluster j
+  const auto& benchmarkFormulasHighEne = m_benchmarkFunctions.at(0);
+  const size_t nParam = benchmarkFormulasHighEne.size();
+  std::vector<double> allBenchmarkParameters(nParam * numClusters, -1.);
+  if (m_benchmarkEneSwitch > 0.) {
+    const auto& benchmarkFormulasLowEne = m_benchmarkFunctions.at(1);
+    verbose() << "Using two formulas for benchmark calibration, the second formula provided will be used to correct "
+                 "energies below benchmarkEneSwitch threshold."
+              << endmsg;
+    std::vector<double> valuesLowEne(numClusters);
+    for (size_t k = 0; k < nParam; ++k) {
+      std::span<double> values(allBenchmarkParameters.data() + k * numClusters, numClusters);
+      evaluateCorrFunction(benchmarkFormulasHighEne.at(k), m_benchmarkCompiled.at(0).at(k),
+                           approximateBenchmarkEnergies, {}, values);
+      evaluateCorrFunction(benchmarkFormulasLowEne.at(k), m_benchmarkCompiled.at(1).at(k), approximateBenchmarkEnergies,
+                           {}, valuesLowEne);
+      for (size_t j = 0; j < numClusters; ++j) {
+        // ensure smooth transition between low- and high-energy formulas (parameter l controls how fast the
+        // transition is)
+        int l = 2;
+        double transition = 0.5 * (1 + tanh(l * (approximateBenchmarkEnergies[j] - m_benchmarkEneSwitch) / 2));
+        values[j] = (1 - transition) * valuesLowEne[j] + transition * values[j];
       }
     }
+  } else {
+    verbose() << "Using one formula for benchmark calibration." << endmsg;
+    for (size_t k = 0; k < nParam; ++k) {
+      std::span<double> values(allBenchmarkParameters.data() + k * numClusters, numClusters);
+      evaluateCorrFunction(benchmarkFormulasHighEne.at(k), m_benchmarkCompiled.at(0).at(k),
+                           approximateBenchmarkEnergies, {}, values);
+    }
+  }
+
+  std::vector<double> benchmarkParameters(nParam, -1.);
+  for (size_t j = 0; j < numClusters; ++j) {
+    for (size_t k = 0; k < nParam; ++k) {
+      benchmarkParameters[k] = allBenchmarkParameters[k * numClusters + j];
+    }
+    const double energyInLastLayerECal = energiesInLastLayerECal[j];
+    const double energyInFirstLayerECal = energiesInFirstLayerECal[j];
+    const double energyInFirstLayerHCal = energiesInFirstLayerHCal[j];
+    const double totalEnergyInECal = totalEnergiesInECal[j];
+    const double totalEnergyInHCal = totalEnergiesInHCal[j];
 
     // Get final benchmark energy using the energy dependent benchmark parameters
     double benchmarkEnergy =
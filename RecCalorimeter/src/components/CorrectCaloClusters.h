@@ -16,6 +16,12 @@ class ITHistSvc;
 // ROOT
 #include "TF2.h"
 
+// RecCaloCommon
+#include "RecCaloCommon/CorrectionFunction.h"
+
+// std
+#include <span>
+
 // EDM4HEP
 namespace edm4hep {
 class Cluster;
@@ -55,6 +61,12 @@ namespace DDSegmentation {
  * correction; for ECal+HCal simulation apply only benchmark correction should be applied To obtain the actual
  * parameters run RecCalorimeter/tests/options/fcc_ee_caloBenchmarkCalibration.py which calls CalibrateBenchmarkMethod
  *
+ *  With compiledCorrections, the formulas of a recognised form (see k4::recCalo::CorrectionFunction: polynomials and
+ *  arithmetic expressions of x, y, parameters and the usual functions) are evaluated by native code instead of the
+ *  TF1 interpreter. At initialisation each compiled formula is compared to its TF1 on a grid of points, the formulas
+ *  that are not recognised or that differ are evaluated with TF1. Each correction function is evaluated at once for
+ *  all clusters of the event.
+ *
  *  Based on similar corrections by Jana Faltova and Anna Zaborowska.
  *
  *  @author Juraj Smiesko, benchmark calibration added by Michaela Mlynarikova
@@ -87,10 +99,34 @@ private:
    * @return                  Status code.
    */
   StatusCode initializeCorrFunctions(std::vector<std::vector<TF1*>>& functions,
+                                     std::vector<std::vector<k4::recCalo::CorrectionFunction>>& compiledFunctions,
                                      std::vector<std::vector<std::string>> formulas,
                                      std::vector<std::vector<double>> parameters,
                                      const std::string& funcNameStem = "upDownBenchmark");
 
+  /**
+   * Check that the compiled formula gives the same values as its TF1 on a grid of points in the range of the TF1.
+   *
+   * @param[in]  function          Correction function.
+   * @param[in]  compiledFunction  Compiled correction function, with the parameters of the TF1.
+   * @param[in]  hasY              Does the formula depend on the second variable?
+   *
+   * @return                       False if the values differ at any point.
+   */
+  bool agreesWithTF1(const TF1* function, const k4::recCalo::CorrectionFunction& compiledFunction, bool hasY) const;
+
+  /**
+   * Evaluate a correction function for all clusters, with native code if the formula was compiled.
+   *
+   * @param[in]  function          Correction function.
+   * @param[in]  compiledFunction  Compiled correction function, used if its formula was recognised.
+   * @param[in]  x                 First variable of the function for every cluster.
+   * @param[in]  y                 Second variable of the function for every cluster, or empty.
+   * @param[out] values            Values of the function for every cluster.
+   */
+  void evaluateCorrFunction(const TF1* function, const k4::recCalo::CorrectionFunction& compiledFunction,
+                            std::span<const double> x, std::span<const double> y, std::span<double> values) const;
+
   /**
    * Apply upstream correction to the output clusters.
    *
@@ -172,6 +208,10 @@ private:
   std::vector<std::vector<TF1*>> m_downstreamFunctions;
   /// Pointers to benchmark method correction functions
   std::vector<std::vector<TF1*>> m_benchmarkFunctions;
+  /// Compiled upstream, downstream and benchmark method correction functions, not compiled if not recognised
+  std::vector<std::vector<k4::recCalo::CorrectionFunction>> m_upstreamCompiled;
+  std::vector<std::vector<k4::recCalo::CorrectionFunction>> m_downstreamCompiled;
+  std::vector<std::vector<k4::recCalo::CorrectionFunction>> m_benchmarkCompiled;
 
   /// IDs of the detectors
   Gaudi::Property<std::vector<int>> m_systemIDs{this, "systemIDs", {4, 8}, "IDs of systems"};
@@ -229,6 +269,9 @@ private:
   Gaudi::Property<bool> m_downstreamCorr{this, "downstreamCorr", true};
   /// Flag if benchmark correction should be applied
   Gaudi::Property<bool> m_benchmarkCorr{this, "benchmarkCorr", false};
+  /// Flag if the formulas of a recognised form should be evaluated by native code instead of TF1
+  Gaudi::Property<bool> m_compiledCorrections{this, "compiledCorrections", true,
+                                              "Evaluate the formulas of a recognised form without TF1"};
 };
 
 #endif /* RECCALORIMETER_CORRECTCALOCLUSTERS_H */
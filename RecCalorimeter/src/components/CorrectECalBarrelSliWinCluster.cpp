@@ -59,89 +59,100 @@ StatusCode CorrectECalBarrelSliWinCluster::initialize() {
   }
 
   // create control histograms
-  m_hEnergyPreAnyCorrections =
-      new TH1F("energyPreAnyCorrections", "Energy of cluster before any correction", 3000, energyStart, energyEnd);
-  if (m_histSvc->regHist("/rec/energyPreAnyCorrections", m_hEnergyPreAnyCorrections).isFailure()) {
+  m_hEnergyPreAnyCorrections.book(
+      new TH1F("energyPreAnyCorrections", "Energy of cluster before any correction", 3000, energyStart, energyEnd),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/energyPreAnyCorrections", m_hEnergyPreAnyCorrections.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hEnergyPostAllCorrections =
-      new TH1F("energyPostAllCorrections", "Energy of cluster after all corrections", 3000, energyStart, energyEnd);
-  if (m_histSvc->regHist("/rec/energyPostAllCorrections", m_hEnergyPostAllCorrections).isFailure()) {
+  m_hEnergyPostAllCorrections.book(
+      new TH1F("energyPostAllCorrections", "Energy of cluster after all corrections", 3000, energyStart, energyEnd),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/energyPostAllCorrections", m_hEnergyPostAllCorrections.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hEnergyPostAllCorrectionsAndScaling =
-      new TH1F("energyPostAllCorrectionsAndScaling", "Energy of cluster after all corrections and scaling", 3000,
-               energyStart, energyEnd);
-  if (m_histSvc->regHist("/rec/energyPostAllCorrectionsAndScaling", m_hEnergyPostAllCorrectionsAndScaling)
+  m_hEnergyPostAllCorrectionsAndScaling.book(new TH1F("energyPostAllCorrectionsAndScaling",
+                                                      "Energy of cluster after all corrections and scaling", 3000,
+                                                      energyStart, energyEnd),
+                                             m_histograms);
+  if (m_histSvc->regHist("/rec/energyPostAllCorrectionsAndScaling", m_hEnergyPostAllCorrectionsAndScaling.histogram())
           .isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hEnergyFractionInLayers = new TH1F("energyFractionInLayers", "Fraction of energy deposited in given layer",
-                                       m_numLayers, 0.5, m_numLayers + 0.5);
-  if (m_histSvc->regHist("/rec/energyFractionInLayers", m_hEnergyFractionInLayers).isFailure()) {
+  m_hEnergyFractionInLayers.book(new TH1F("energyFractionInLayers", "Fraction of energy deposited in given layer",
+                                          m_numLayers, 0.5, m_numLayers + 0.5),
+                                 m_histograms);
+  if (m_histSvc->regHist("/rec/energyFractionInLayers", m_hEnergyFractionInLayers.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hPileupEnergy = new TH1F("pileupCorrectionEnergy", "Energy added to a cluster as a correction for correlated noise",
-                             1000, -10, 10);
-  if (m_histSvc->regHist("/rec/pileupCorrectionEnergy", m_hPileupEnergy).isFailure()) {
+  m_hPileupEnergy.book(new TH1F("pileupCorrectionEnergy",
+                                "Energy added to a cluster as a correction for correlated noise", 1000, -10, 10),
+                       m_histograms);
+  if (m_histSvc->regHist("/rec/pileupCorrectionEnergy", m_hPileupEnergy.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hUpstreamEnergy = new TH1F("upstreamCorrectionEnergy",
-                               "Energy added to a cluster as a correction for upstream material", 1000, -10, 10);
-  if (m_histSvc->regHist("/rec/upstreamCorrectionEnergy", m_hUpstreamEnergy).isFailure()) {
+  m_hUpstreamEnergy.book(new TH1F("upstreamCorrectionEnergy",
+                                  "Energy added to a cluster as a correction for upstream material", 1000, -10, 10),
+                         m_histograms);
+  if (m_histSvc->regHist("/rec/upstreamCorrectionEnergy", m_hUpstreamEnergy.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hDiffEta =
-      new TH1F("diffEta", "#eta resolution", 10 * ceil(2 * m_etaMax / m_dEta), -m_etaMax / 10., m_etaMax / 10.);
-  if (m_histSvc->regHist("/rec/diffEta", m_hDiffEta).isFailure()) {
+  m_hDiffEta.book(
+      new TH1F("diffEta", "#eta resolution", 10 * ceil(2 * m_etaMax / m_dEta), -m_etaMax / 10., m_etaMax / 10.),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/diffEta", m_hDiffEta.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hDiffEtaResWeight = new TH1F("diffEtaResWeight", "#eta resolution", 10 * ceil(2 * m_etaMax / m_dEta),
-                                 -m_etaMax / 10., m_etaMax / 10.);
-  if (m_histSvc->regHist("/rec/diffEtaResWeight", m_hDiffEtaResWeight).isFailure()) {
+  m_hDiffEtaResWeight.book(new TH1F("diffEtaResWeight", "#eta resolution", 10 * ceil(2 * m_etaMax / m_dEta),
+                                    -m_etaMax / 10., m_etaMax / 10.),
+                           m_histograms);
+  if (m_histSvc->regHist("/rec/diffEtaResWeight", m_hDiffEtaResWeight.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hDiffEtaResWeight2point = new TH1F("diffEtaResWeight2point", "#eta resolution", 10 * ceil(2 * m_etaMax / m_dEta),
-                                       -m_etaMax / 10., m_etaMax / 10.);
-  if (m_histSvc->regHist("/rec/diffEtaResWeight2point", m_hDiffEtaResWeight2point).isFailure()) {
+  m_hDiffEtaResWeight2point.book(new TH1F("diffEtaResWeight2point", "#eta resolution", 10 * ceil(2 * m_etaMax / m_dEta),
+                                          -m_etaMax / 10., m_etaMax / 10.),
+                                 m_histograms);
+  if (m_histSvc->regHist("/rec/diffEtaResWeight2point", m_hDiffEtaResWeight2point.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
   for (uint i = 0; i < m_numLayers; i++) {
-    m_hDiffEtaLayer.push_back(new TH1F(("diffEtaLayer" + std::to_string(i)).c_str(),
-                                       ("#eta resolution for layer " + std::to_string(i)).c_str(),
-                                       10 * ceil(2 * m_etaMax / m_dEta), -m_etaMax / 10., m_etaMax / 10.));
-    if (m_histSvc->regHist("/rec/diffEta_layer" + std::to_string(i), m_hDiffEtaLayer.back()).isFailure()) {
+    m_hDiffEtaLayer.emplace_back().book(new TH1F(("diffEtaLayer" + std::to_string(i)).c_str(),
+                                                 ("#eta resolution for layer " + std::to_string(i)).c_str(),
+                                                 10 * ceil(2 * m_etaMax / m_dEta), -m_etaMax / 10., m_etaMax / 10.),
+                                        m_histograms);
+    if (m_histSvc->regHist("/rec/diffEta_layer" + std::to_string(i), m_hDiffEtaLayer.back().histogram()).isFailure()) {
       error() << "Couldn't register histogram" << endmsg;
       return StatusCode::FAILURE;
     }
   }
-  m_hEta = new TH1F("eta", "#eta", 1000, -m_etaMax, m_etaMax);
-  if (m_histSvc->regHist("/rec/eta", m_hEta).isFailure()) {
+  m_hEta.book(new TH1F("eta", "#eta", 1000, -m_etaMax, m_etaMax), m_histograms);
+  if (m_histSvc->regHist("/rec/eta", m_hEta.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hDiffPhi =
-      new TH1F("diffPhi", "#varphi resolution", 10 * ceil(2 * m_phiMax / m_dPhi), -m_phiMax / 10., m_phiMax / 10.);
-  if (m_histSvc->regHist("/rec/diffPhi", m_hDiffPhi).isFailure()) {
+  m_hDiffPhi.book(
+      new TH1F("diffPhi", "#varphi resolution", 10 * ceil(2 * m_phiMax / m_dPhi), -m_phiMax / 10., m_phiMax / 10.),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/diffPhi", m_hDiffPhi.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hPhi = new TH1F("phi", "#varphi", 1000, -m_phiMax, m_phiMax);
-  if (m_histSvc->regHist("/rec/phi", m_hPhi).isFailure()) {
+  m_hPhi.book(new TH1F("phi", "#varphi", 1000, -m_phiMax, m_phiMax), m_histograms);
+  if (m_histSvc->regHist("/rec/phi", m_hPhi.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hNumCells = new TH1F("numCells", "number of cells", 2000, -0.5, 1999.5);
-  if (m_histSvc->regHist("/rec/numCells", m_hNumCells).isFailure()) {
+  m_hNumCells.book(new TH1F("numCells", "number of cells", 2000, -0.5, 1999.5), m_histograms);
+  if (m_histSvc->regHist("/rec/numCells", m_hNumCells.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
@@ -392,7 +403,7 @@ StatusCode CorrectECalBarrelSliWinCluster::execute(const EventContext&) const {
       noise = m_constPileupNoise * m_gauss.shoot() * std::sqrt(static_cast<int>(m_mu));
     }
     newCluster.setEnergy(newCluster.getEnergy() + noise);
-    m_hPileupEnergy->Fill(noise);
+    m_hPileupEnergy.fill(noise);
 
     // 3. Correct for energy upstream
     // correct for presampler based on energy in the first layer layer:
@@ -415,38 +426,42 @@ StatusCode CorrectECalBarrelSliWinCluster::execute(const EventContext&) const {
     double presamplerShift = P00 + P01 * cluster.getEnergy();
     double presamplerScale = P10 + P11 * sqrt(cluster.getEnergy());
     double energyFront = presamplerShift + presamplerScale * sumEnFirstLayer * m_samplingFraction[0];
-    m_hUpstreamEnergy->Fill(energyFront);
+    m_hUpstreamEnergy.fill(energyFront);
     newCluster.setEnergy(newCluster.getEnergy() + energyFront);
 
     // Fill histograms
-    m_hEnergyPreAnyCorrections->Fill(oldEnergy);
-    m_hEnergyPostAllCorrections->Fill(newCluster.getEnergy());
-    m_hEnergyPostAllCorrectionsAndScaling->Fill(newCluster.getEnergy() / m_response);
+    m_hEnergyPreAnyCorrections.fill(oldEnergy);
+    m_hEnergyPostAllCorrections.fill(newCluster.getEnergy());
+    m_hEnergyPostAllCorrectionsAndScaling.fill(newCluster.getEnergy() / m_response);
 
     // Position resolution
-    m_hEta->Fill(newEta);
-    m_hPhi->Fill(phi);
+    m_hEta.fill(newEta);
+    m_hPhi.fill(phi);
     verbose() << " energy " << energy << "   numCells = " << numCells << " old energy = " << oldEnergy << " newEta "
               << newEta << "   phi = " << phi << " theta = " << 2 * atan(exp(-newEta)) << endmsg;
-    m_hNumCells->Fill(numCells);
+    m_hNumCells.fill(numCells);
     // Fill histograms for single particle events
     if (particle->size() == 1) {
-      m_hDiffEta->Fill(newEta - etaVertex);
-      m_hDiffEtaResWeight->Fill(newEtaErrorRes - etaVertex);
-      m_hDiffEtaResWeight2point->Fill(newEtaErrorRes2point - etaVertex);
+      m_hDiffEta.fill(newEta - etaVertex);
+      m_hDiffEtaResWeight.fill(newEtaErrorRes - etaVertex);
+      m_hDiffEtaResWeight2point.fill(newEtaErrorRes2point - etaVertex);
       for (uint iLayer = 0; iLayer < m_numLayers; iLayer++) {
-        m_hDiffEtaLayer[iLayer]->Fill(sumEtaLayer[iLayer] - etaVertex);
+        m_hDiffEtaLayer[iLayer].fill(sumEtaLayer[iLayer] - etaVertex);
         if (energy > 0)
-          m_hEnergyFractionInLayers->Fill(iLayer + 1, sumEnLayer[iLayer] / energy);
+          m_hEnergyFractionInLayers.fill(iLayer + 1, sumEnLayer[iLayer] / energy);
       }
-      m_hDiffPhi->Fill(phi - phiVertex);
+      m_hDiffPhi.fill(phi - phiVertex);
     }
   }
 
   return StatusCode::SUCCESS;
 }
 
-StatusCode CorrectECalBarrelSliWinCluster::finalize() { return Gaudi::Algorithm::finalize(); }
+StatusCode CorrectECalBarrelSliWinCluster::finalize() {
+  // add the fills of all threads to the histograms written by the histogram service
+  m_histograms.merge();
+  return Gaudi::Algorithm::finalize();
+}
 
 StatusCode CorrectECalBarrelSliWinCluster::initNoiseFromFile() {
   // Check if file exists
@@ -12,6 +12,9 @@ class ITHistSvc;
 #include "GaudiKernel/RndmGenerators.h"
 #include "GaudiKernel/ToolHandle.h"
 
+// RecCaloCommon
+#include "RecCaloCommon/ThreadLocalHistogram.h"
+
 // EDM4HEP
 namespace edm4hep {
 class ClusterCollection;
@@ -30,6 +33,9 @@ namespace DDSegmentation {
 
 #include "TH1F.h"
 
+// std
+#include <deque>
+
 /** @class CorrectECalBarrelSliWinCluster
  *
  *  Apply corrections to a reconstructed cluster in EMCal barrel.
@@ -100,28 +106,30 @@ private:
   ServiceHandle<ITHistSvc> m_histSvc;
   /// Pointer to the geometry service
   ServiceHandle<IGeoSvc> m_geoSvc;
+  /// Histograms filled per thread, merged in finalize
+  k4::recCalo::ThreadLocalHistogram::Registry m_histograms;
   /// Histogram of energy before any correction
-  mutable TH1F* m_hEnergyPreAnyCorrections;
+  mutable k4::recCalo::ThreadLocalHistogram m_hEnergyPreAnyCorrections;
   /// Histogram of energy after all corrections
-  mutable TH1F* m_hEnergyPostAllCorrections;
+  mutable k4::recCalo::ThreadLocalHistogram m_hEnergyPostAllCorrections;
   /// Histogram of energy after all corrections and scaled to restore response = 1
-  mutable TH1F* m_hEnergyPostAllCorrectionsAndScaling;
+  mutable k4::recCalo::ThreadLocalHistogram m_hEnergyPostAllCorrectionsAndScaling;
   /// Ratio of energy in layers
-  mutable TH1F* m_hEnergyFractionInLayers;
+  mutable k4::recCalo::ThreadLocalHistogram m_hEnergyFractionInLayers;
   /// Histogram of eta resolution
-  mutable TH1F* m_hDiffEta;
-  mutable TH1F* m_hDiffEtaResWeight;
-  mutable TH1F* m_hDiffEtaResWeight2point;
+  mutable k4::recCalo::ThreadLocalHistogram m_hDiffEta;
+  mutable k4::recCalo::ThreadLocalHistogram m_hDiffEtaResWeight;
+  mutable k4::recCalo::ThreadLocalHistogram m_hDiffEtaResWeight2point;
   /// Histogram of eta resolution per layer
-  std::vector<TH1F*> m_hDiffEtaLayer;
+  mutable std::deque<k4::recCalo::ThreadLocalHistogram> m_hDiffEtaLayer;
   /// Histogram of phi resolution
-  mutable TH1F* m_hDiffPhi;
+  mutable k4::recCalo::ThreadLocalHistogram m_hDiffPhi;
   /// Histogram of eta
-  mutable TH1F* m_hEta;
+  mutable k4::recCalo::ThreadLocalHistogram m_hEta;
   /// Histogram of phi
-  mutable TH1F* m_hPhi;
+  mutable k4::recCalo::ThreadLocalHistogram m_hPhi;
   /// Number of cells inside cluster
-  mutable TH1F* m_hNumCells;
+  mutable k4::recCalo::ThreadLocalHistogram m_hNumCells;
   /// Energy of the centre of energy distribution histograms
   Gaudi::Property<double> m_response{this, "response", 0.95, "Reconstructed energy (in the cluster) used for scaling"};
   /// Energy of the centre of energy distribution histograms
@@ -155,7 +163,7 @@ private:
   /// map of system Id to decoder, created based on m_readoutName and m_systemId
   mutable std::map<uint, dd4hep::DDSegmentation::BitFieldCoder*> m_decoder;
   /// Histogram of pileup noise added to energy of clusters
-  mutable TH1F* m_hPileupEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_hPileupEnergy;
   /// Random Number Service
   SmartIF<IRndmGenSvc> m_randSvc;
   /// Gaussian random number generator used for the generation of random noise hits
@@ -202,7 +210,7 @@ private:
   /// segmentation of detetor in phi (for number of bins in histograms)
   Gaudi::Property<double> m_dPhi{this, "dPhi", 2 * M_PI / 704, "Segmentation in phi"};
   /// Histogram of upstream energy added to energy of clusters
-  mutable TH1F* m_hUpstreamEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_hUpstreamEnergy;
   /// Size of the window in phi for the final cluster building, optimised for each layer  (in units of cell size)
   /// If empty use same size for each layer, as in *nPhiFinal*
   Gaudi::Property<std::vector<int>> m_nPhiFinal{this, "nPhiOptimFinal", {}};
@@ -16,8 +16,13 @@
 
 DECLARE_COMPONENT(CreateCaloCells)
 
+namespace {
+/// Number of cells processed per block in the fused execution path
+constexpr size_t kFusedBlockSize = 4096;
+} // namespace
+
 CreateCaloCells::CreateCaloCells(const std::string& name, ISvcLocator* svcLoc)
-    : Gaudi::Algorithm(name, svcLoc), m_geoSvc("GeoSvc", name) {
+    : Gaudi::Algorithm(name, svcLoc), m_geoSvc("GeoSvc", name), m_cellIndexSvc("CellIndexSvc", name) {
   declareProperty("hits", m_hits, "Hits from which to create cells (input)");
   declareProperty("cells", m_cells, "The created calorimeter cells (output)");
 
@@ -38,6 +43,7 @@ StatusCode CreateCaloCells::initialize() {
   info() << "remove cells below threshold : " << m_filterCellNoise << endmsg;
   info() << "add position information to the cell : " << m_addPosition << endmsg;
   info() << "emulate crosstalk : " << m_addCrosstalk << endmsg;
+  info() << "fused cell loop : " << m_fusedCellLoop << endmsg;
 
   // Initialization of tools
   // Cell crosstalk tool
@@ -53,6 +59,7 @@ StatusCode CreateCaloCells::initialize() {
       error() << "Unable to retrieve the calo cells calibration tool!!!" << endmsg;
       return StatusCode::FAILURE;
     }
+    m_denseCalibTool = SmartIF<IDenseCalibrateCaloHitsTool>(m_calibTool.get());
   }
   // Cell noise tool
   if (m_addCellNoise || m_filterCellNoise) {
@@ -65,19 +72,40 @@ StatusCode CreateCaloCells::initialize() {
       error() << "Unable to retrieve the geometry tool!!!" << endmsg;
       return StatusCode::FAILURE;
     }
-    // Prepare map of all existing cells in calorimeter to add noise to all
-    StatusCode sc_prepareCells = m_geoTool->prepareEmptyCells(m_cellsMap);
-    if (sc_prepareCells.isFailure()) {
-      error() << "Unable to create empty cells!" << endmsg;
-      return StatusCode::FAILURE;
+    // Prepare map of all existing cells in calorimeter to add noise to all, the fused path uses the cell index instead
+    if (!m_fusedCellLoop) {
+      StatusCode sc_prepareCells = m_geoTool->prepareEmptyCells(m_cellsMap);
+      if (sc_prepareCells.isFailure()) {
+        error() << "Unable to create empty cells!" << endmsg;
+        return StatusCode::FAILURE;
+      }
+      verbose() << "Initialised empty cell map with size " << m_cellsMap.size() << endmsg;
     }
-    verbose() << "Initialised empty cell map with size " << m_cellsMap.size() << endmsg;
-    // noise filtering erases cells from the cell map after each event, so we need
+    // if the noise tool can filter dense arrays of cells, the cell map is left untouched by the filtering
+    m_denseNoiseTool = SmartIF<IDenseNoiseCaloCellsTool>(m_noiseTool.get());
+    // otherwise noise filtering erases cells from the cell map after each event, so we need
     // to backup the empty cell map for later reuse
-    if (m_addCellNoise && m_filterCellNoise) {
+    if (m_addCellNoise && m_filterCellNoise && !m_denseNoiseTool && !m_fusedCellLoop) {
       m_emptyCellsMap = m_cellsMap;
     }
   }
+  if (m_fusedCellLoop) {
+    if (!m_addCellNoise || !m_denseNoiseTool) {
+      error() << "fusedCellLoop requires addCellNoise and a noise tool supporting dense arrays of cells!" << endmsg;
+      return StatusCode::FAILURE;
+    }
+    // the dense arrays over the cells of the shared cell index replace the map of all cells
+    if (!m_cellIndexSvc) {
+      error() << "Unable to locate the cell index service" << endmsg;
+      return StatusCode::FAILURE;
+    }
+    m_cellIndex = m_cellIndexSvc->cellIndex(m_readoutName, m_geoTool.get());
+    if (!m_cellIndex) {
+      error() << "Unable to index the cells of readout " << m_readoutName.value() << endmsg;
+      return StatusCode::FAILURE;
+    }
+    m_cellDeposits.assign(m_cellIndex->size(), 0.);
+  }
   if (m_addPosition) {
     m_volman = m_geoSvc->getDetector()->volumeManager();
   }
@@ -98,26 +126,51 @@ StatusCode CreateCaloCells::execute(const EventContext&) const {
   const edm4hep::SimCalorimeterHitCollection* hits = m_hits.get();
   debug() << "Input Hit collection size: " << hits->size() << endmsg;
 
+  if (m_fusedCellLoop) {
+    edm4hep::CalorimeterHitCollection* edmCellsCollection = new edm4hep::CalorimeterHitCollection();
+    executeFused(*hits, *edmCellsCollection);
+    m_cells.put(edmCellsCollection);
+    debug() << "Output Cell collection size: " << edmCellsCollection->size() << endmsg;
+    return StatusCode::SUCCESS;
+  }
+
   // 0. Clear all cells
+  const bool resetToZero = m_addCellNoise && (!m_filterCellNoise || m_denseNoiseTool);
   if (m_addCellNoise) {
     // if cells are not filtered, the map has same size in each event, equal to the total number
     // of cells in the calorimeter, so we can just reset the values to 0
     // if cells are filtered, during each event they are removed from the cellsMap, so one has to
     // restore the initial map of all empty cells
-    if (!m_filterCellNoise)
+    if (resetToZero) {
+      // cells not known to the geometry tool were added by the previous event, they are removed
+      for (auto cellId : m_unknownCells) {
+        m_cellsMap.erase(cellId);
+      }
+      m_unknownCells.clear();
       std::for_each(m_cellsMap.begin(), m_cellsMap.end(), [](std::pair<const uint64_t, double>& p) { p.second = 0; });
-    else
+    } else {
       m_cellsMap = m_emptyCellsMap;
+    }
   } else {
     m_cellsMap.clear();
   }
+  auto addEnergy = [&](uint64_t cellId, double energy) {
+    auto [cell, inserted] = m_cellsMap.try_emplace(cellId, 0.);
+    cell->second += energy;
+    if (inserted && resetToZero) {
+      m_unknownCells.push_back(cellId);
+    }
+  };
 
   // 1. Merge energy deposits into cells
   // If running with noise map already was prepared. Otherwise it is being
   // created below
   for (const auto& hit : *hits) {
     verbose() << "CellID : " << hit.getCellID() << endmsg;
-    m_cellsMap[hit.getCellID()] += hit.getEnergy();
+    addEnergy(hit.getCellID(), hit.getEnergy());
+  }
+  if (!m_unknownCells.empty()) {
+    debug() << m_unknownCells.size() << " cells with energy deposits are not known to the geometry tool" << endmsg;
   }
   debug() << "Number of calorimeter cells after merging of hits: " << m_cellsMap.size() << endmsg;
 
@@ -145,7 +198,7 @@ StatusCode CreateCaloCells::execute(const EventContext&) const {
 
     // apply the cross-talk contributions on the nominal cell-energy map
     for (const auto& this_cell : m_CrosstalkCellsMap) {
-      m_cellsMap[this_cell.first] += this_cell.second;
+      addEnergy(this_cell.first, this_cell.second);
     }
   }
 
@@ -160,28 +213,29 @@ StatusCode CreateCaloCells::execute(const EventContext&) const {
   }
 
   // 5. Filter cells
-  if (m_filterCellNoise) {
+  const bool denseFilter = m_filterCellNoise && m_denseNoiseTool;
+  if (denseFilter) {
+    m_cellIds.clear();
+    m_cellEnergies.clear();
+    for (const auto& cell : m_cellsMap) {
+      m_cellIds.push_back(cell.first);
+      m_cellEnergies.push_back(cell.second);
+    }
+    m_denseNoiseTool->selectCells(m_cellIds, m_cellEnergies, m_selectedCells);
+  } else if (m_filterCellNoise) {
     m_noiseTool->filterCellNoise(m_cellsMap);
   }
 
   // 6. Copy information to CaloHitCollection
   edm4hep::CalorimeterHitCollection* edmCellsCollection = new edm4hep::CalorimeterHitCollection();
-  for (const auto& cell : m_cellsMap) {
-    if (m_addCellNoise || (!m_addCellNoise && cell.second != 0)) {
-      auto newCell = edmCellsCollection->create();
-      newCell.setEnergy(cell.second);
-      uint64_t cellid = cell.first;
-      newCell.setCellID(cellid);
-      if (m_addPosition) {
-        auto detelement = m_volman.lookupDetElement(cellid);
-        const auto& transformMatrix = detelement.nominal().worldTransformation();
-        double outGlobal[3];
-        double inLocal[] = {0, 0, 0};
-        transformMatrix.LocalToMaster(inLocal, outGlobal);
-        edm4hep::Vector3f position =
-            edm4hep::Vector3f(outGlobal[0] / dd4hep::mm, outGlobal[1] / dd4hep::mm, outGlobal[2] / dd4hep::mm);
-        newCell.setPosition(position);
-      }
+  if (denseFilter) {
+    // build the output directly from the cells that passed the filter
+    for (auto index : m_selectedCells) {
+      createCell(*edmCellsCollection, m_cellIds[index], m_cellEnergies[index]);
+    }
+  } else {
+    for (const auto& cell : m_cellsMap) {
+      createCell(*edmCellsCollection, cell.first, cell.second);
     }
   }
 
@@ -193,4 +247,120 @@ StatusCode CreateCaloCells::execute(const EventContext&) const {
   return StatusCode::SUCCESS;
 }
 
+void CreateCaloCells::executeFused(const edm4hep::SimCalorimeterHitCollection& aHits,
+                                   edm4hep::CalorimeterHitCollection& aCells) const {
+  // 1. Merge energy deposits into cells, only the cells with deposits are stored in the map
+  m_touchedCellsMap.clear();
+  for (const auto& hit : aHits) {
+    m_touchedCellsMap[hit.getCellID()] += hit.getEnergy();
+  }
+
+  // 2. Emulate cross-talk (if asked), cells without deposits do not transfer any signal
+  if (m_addCrosstalk) {
+    m_CrosstalkCellsMap.clear();
+    for (const auto& this_cell : m_touchedCellsMap) {
+      auto vec_neighbours = m_crosstalksTool->getNeighbours(this_cell.first);
+      auto vec_crosstalks = m_crosstalksTool->getCrosstalks(this_cell.first);
+      for (unsigned int i_cell = 0; i_cell < vec_neighbours.size(); i_cell++) {
+        double signal_transfer = this_cell.second * vec_crosstalks[i_cell];
+        m_CrosstalkCellsMap[this_cell.first] -= signal_transfer;
+        m_CrosstalkCellsMap[vec_neighbours[i_cell]] += signal_transfer;
+      }
+    }
+    for (const auto& this_cell : m_CrosstalkCellsMap) {
+      m_touchedCellsMap[this_cell.first] += this_cell.second;
+    }
+  }
+
+  // 3. Calibrate simulation energy to EM scale, the calibration of empty cells is a no-op
+  const bool denseCalibration = m_doCellCalibration && m_denseCalibTool;
+  if (m_doCellCalibration && !denseCalibration) {
+    m_calibTool->calibrate(m_touchedCellsMap);
+  }
+
+  // copy the deposits to the dense array, cells unknown to the geometry tool are kept aside
+  m_touchedCells.clear();
+  m_cellsMap.clear();
+  for (const auto& cell : m_touchedCellsMap) {
+    uint32_t index = m_cellIndex->index(cell.first);
+    if (index == k4::recCalo::CellIndexMap::invalidIndex) {
+      m_cellsMap.emplace(cell);
+      continue;
+    }
+    m_cellDeposits[index] = cell.second;
+    m_touchedCells.push_back(index);
+  }
+
+  if (denseCalibration) {
+    // gather the touched cells into contiguous arrays, calibrate them in one call and scatter them back
+    m_touchedCellIds.resize(m_touchedCells.size());
+    m_cellEnergies.resize(m_touchedCells.size());
+    for (size_t i = 0; i < m_touchedCells.size(); i++) {
+      m_touchedCellIds[i] = m_cellIndex->cellID(m_touchedCells[i]);
+      m_cellEnergies[i] = m_cellDeposits[m_touchedCells[i]];
+    }
+    m_denseCalibTool->calibrate(m_touchedCellIds, m_cellEnergies);
+    for (size_t i = 0; i < m_touchedCells.size(); i++) {
+      m_cellDeposits[m_touchedCells[i]] = m_cellEnergies[i];
+    }
+    m_calibTool->calibrate(m_cellsMap);
+  }
+
+  // 4.-6. Add noise, filter and create the output cells, block by block, the energies of the block are in
+  // m_cellEnergies and aFirst is the position of the block among all cells of the event
+  auto processBlock = [&](std::span<const uint64_t> aBlockIds, size_t aFirst) {
+    m_denseNoiseTool->addRandomCellNoise(aBlockIds, m_cellEnergies, aFirst);
+    if (m_filterCellNoise) {
+      m_denseNoiseTool->selectCells(aBlockIds, m_cellEnergies, m_selectedCells);
+      for (auto index : m_selectedCells) {
+        createCell(aCells, aBlockIds[index], m_cellEnergies[index]);
+      }
+    } else {
+      for (size_t index = 0; index < aBlockIds.size(); index++) {
+        createCell(aCells, aBlockIds[index], m_cellEnergies[index]);
+      }
+    }
+  };
+  auto cellIds = m_cellIndex->cellIDs();
+  for (size_t first = 0; first < cellIds.size(); first += kFusedBlockSize) {
+    auto blockIds = cellIds.subspan(first, std::min(kFusedBlockSize, cellIds.size() - first));
+    m_cellEnergies.assign(m_cellDeposits.begin() + first, m_cellDeposits.begin() + first + blockIds.size());
+    processBlock(blockIds, first);
+  }
+  for (auto index : m_touchedCells) {
+    m_cellDeposits[index] = 0.;
+  }
+
+  // cells with deposits that are not part of the geometry tool cells (not expected) form a last block, placed after
+  // all known cells so that their noise differs from the noise of the first cells
+  if (!m_cellsMap.empty()) {
+    warning() << m_cellsMap.size() << " cells with energy deposits are not known to the geometry tool" << endmsg;
+    m_cellIds.clear();
+    m_cellEnergies.clear();
+    for (const auto& cell : m_cellsMap) {
+      m_cellIds.push_back(cell.first);
+      m_cellEnergies.push_back(cell.second);
+    }
+    processBlock(m_cellIds, cellIds.size());
+  }
+}
+
+void CreateCaloCells::createCell(edm4hep::CalorimeterHitCollection& aCells, uint64_t aCellId, double aEnergy) const {
+  if (m_addCellNoise || (!m_addCellNoise && aEnergy != 0)) {
+    auto newCell = aCells.create();
+    newCell.setEnergy(aEnergy);
+    newCell.setCellID(aCellId);
+    if (m_addPosition) {
+      auto detelement = m_volman.lookupDetElement(aCellId);
+      const auto& transformMatrix = detelement.nominal().worldTransformation();
+      double outGlobal[3];
+      double inLocal[] = {0, 0, 0};
+      transformMatrix.LocalToMaster(inLocal, outGlobal);
+      edm4hep::Vector3f position =
+          edm4hep::Vector3f(outGlobal[0] / dd4hep::mm, outGlobal[1] / dd4hep::mm, outGlobal[2] / dd4hep::mm);
+      newCell.setPosition(position);
+    }
+  }
+}
+
 StatusCode CreateCaloCells::finalize() { return Gaudi::Algorithm::finalize(); }
@@ -23,6 +23,12 @@
 #include "DD4hep/Volumes.h"
 #include "TGeoManager.h"
 
+// k4RecCalorimeter
+#include "RecCaloCommon/CellIndexMap.h"
+#include "RecCaloCommon/ICellIndexSvc.h"
+#include "RecCaloCommon/IDenseCalibrateCaloHitsTool.h"
+#include "RecCaloCommon/IDenseNoiseCaloCellsTool.h"
+
 class IGeoSvc;
 
 /** @class CreateCaloCells
@@ -38,6 +44,13 @@ class IGeoSvc;
  *  5/ Filter cells and remove those with energy below threshold (if noise +
  * filtering switched on)
  *
+ *  With fusedCellLoop, steps 1-3 only touch the cells with energy deposits, and the noise, the filtering and the
+ *  creation of the output cells are done block by block in a single pass over dense arrays of all cells (ordered by
+ *  cellID), without any hash map lookup. This requires a noise tool implementing IDenseNoiseCaloCellsTool. If the
+ *  calibration tool implements IDenseCalibrateCaloHitsTool, the cells with deposits are calibrated as a dense array.
+ *  The dense index of the cells of readoutName is taken from CellIndexSvc, shared with the other algorithms of the
+ *  readout, and built from the geometry tool if the readout is not indexed yet.
+ *
  *  Tools called:
  *    - CalibrateCaloHitsTool
  *    - NoiseCaloCellsTool
@@ -62,6 +75,12 @@ public:
   StatusCode finalize();
 
 private:
+  /// Steps 1-6 of the fused execution path
+  void executeFused(const edm4hep::SimCalorimeterHitCollection& aHits,
+                    edm4hep::CalorimeterHitCollection& aCells) const;
+  /// Create an output cell
+  void createCell(edm4hep::CalorimeterHitCollection& aCells, uint64_t aCellId, double aEnergy) const;
+
   /// Handle for the calorimeter cells crosstalk tool
   mutable ToolHandle<ICaloReadCrosstalkMap> m_crosstalksTool{"ReadCaloCrosstalkMap", this};
   /// Handle for tool to calibrate Geant4 energy to EM scale tool
@@ -82,6 +101,11 @@ private:
                                           "Save only cells with energy above threshold?"};
   // Add position information to the cells? (based on Volumes, not cells, could be improved)
   Gaudi::Property<bool> m_addPosition{this, "addPosition", false, "Add position information to the cells?"};
+  /// Process noise, filtering and output in a single pass over dense arrays of cells?
+  Gaudi::Property<bool> m_fusedCellLoop{
+      this, "fusedCellLoop", false,
+      "Add noise, filter and create the output cells in a single pass over dense arrays (requires addCellNoise and a "
+      "noise tool supporting dense arrays)"};
 
   /// Handle for calo hits (input collection)
   mutable k4FWCore::DataHandle<edm4hep::SimCalorimeterHitCollection> m_hits{"hits", Gaudi::DataHandle::Reader, this};
@@ -93,7 +117,8 @@ private:
   k4FWCore::MetaDataHandle<std::string> m_cellsCellIDEncoding{m_cells, edm4hep::labels::CellIDEncoding,
                                                               Gaudi::DataHandle::Writer};
   /// Name of the detector readout
-  Gaudi::Property<std::string> m_readoutName{this, "readoutName", "ECalBarrelPhiEta", "Name of the detector readout"};
+  Gaudi::Property<std::string> m_readoutName{this, "readoutName", "ECalBarrelPhiEta",
+                                             "Name of the detector readout, key of the cell index with fusedCellLoop"};
   /// Name of active volumes
   Gaudi::Property<std::string> m_activeVolumeName{this, "activeVolumeName", "_sensitive", "Name of the active volumes"};
   /// Name of active layers for sampling calorimeter
@@ -113,6 +138,8 @@ private:
 
   /// Pointer to the geometry service
   ServiceHandle<IGeoSvc> m_geoSvc;
+  /// Pointer to the cell index service, used with fusedCellLoop
+  ServiceHandle<ICellIndexSvc> m_cellIndexSvc;
   dd4hep::VolumeManager m_volman;
   /// Maps of cell IDs (corresponding to DD4hep IDs) on final energies to be used for clustering
   mutable std::unordered_map<uint64_t, double> m_cellsMap;
@@ -120,6 +147,25 @@ private:
   mutable std::unordered_map<uint64_t, double> m_CrosstalkCellsMap;
   /// Maps of cell IDs with zero energy, for all cells in calo (needed if addCellNoise and filterCellNoise are both set)
   mutable std::unordered_map<uint64_t, double> m_emptyCellsMap;
+  /// Cells added to the map of all cells in the event as they are not known to the geometry tool, removed in the next
+  mutable std::vector<uint64_t> m_unknownCells;
+  /// Interface of the noise tool filtering dense arrays of cells, if the noise tool provides it
+  SmartIF<IDenseNoiseCaloCellsTool> m_denseNoiseTool;
+  /// Cells flattened for the dense noise filter, and indices of the cells passing the filter
+  mutable std::vector<uint64_t> m_cellIds;
+  mutable std::vector<double> m_cellEnergies;
+  mutable std::vector<uint32_t> m_selectedCells;
+  /// All cells of the calorimeter, sorted by cellID, for the fused execution path, owned by the cell index service
+  const k4::recCalo::CellIndexMap* m_cellIndex = nullptr;
+  /// Energy deposits per cell index, only the cells listed in m_touchedCells are non-zero
+  mutable std::vector<double> m_cellDeposits;
+  mutable std::vector<uint32_t> m_touchedCells;
+  /// Cells with energy deposits, calibrated before being copied to the dense array unless m_denseCalibTool is set
+  mutable std::unordered_map<uint64_t, double> m_touchedCellsMap;
+  /// Interface of the calibration tool working on dense arrays of cells, if the calibration tool provides it
+  SmartIF<IDenseCalibrateCaloHitsTool> m_denseCalibTool;
+  /// CellIDs of the cells with deposits, for the dense calibration
+  mutable std::vector<uint64_t> m_touchedCellIds;
 };
 
 #endif /* RECCALORIMETER_CREATECALOCELLS_H */
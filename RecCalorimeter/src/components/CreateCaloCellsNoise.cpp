@@ -64,6 +64,8 @@ StatusCode CreateCaloCellsNoise::initialize() {
       error() << "Unable to create empty cells!" << endmsg;
       return StatusCode::FAILURE;
     }
+    // if the noise tool can filter dense arrays of cells, the cell map is left untouched by the filtering
+    m_denseNoiseTool = SmartIF<IDenseNoiseCaloCellsTool>(m_noiseTool.get());
   }
   if (m_addPosition) {
     m_volman = m_geoSvc->getDetector()->volumeManager();
@@ -98,20 +100,28 @@ StatusCode CreateCaloCellsNoise::execute(const EventContext&) const {
   }
 
   // 3. Add noise to all cells
+  const bool denseFilter = m_addCellNoise && m_filterCellNoise && m_denseNoiseTool;
   if (m_addCellNoise) {
     m_noiseTool->addRandomCellNoise(m_cellsMap);
-    if (m_filterCellNoise) {
+    if (denseFilter) {
+      m_cellIds.clear();
+      m_cellEnergies.clear();
+      for (const auto& cell : m_cellsMap) {
+        m_cellIds.push_back(cell.first);
+        m_cellEnergies.push_back(cell.second);
+      }
+      m_denseNoiseTool->selectCells(m_cellIds, m_cellEnergies, m_selectedCells);
+    } else if (m_filterCellNoise) {
       m_noiseTool->filterCellNoise(m_cellsMap);
     }
   }
 
   // 4. Copy information to CaloHitCollection
   edm4hep::CalorimeterHitCollection* edmCellsCollection = new edm4hep::CalorimeterHitCollection();
-  for (const auto& cell : m_cellsMap) {
-    if (m_addCellNoise || (!m_addCellNoise && cell.second != 0)) {
+  auto createCell = [&](uint64_t cellid, double energy) {
+    if (m_addCellNoise || (!m_addCellNoise && energy != 0)) {
       auto newCell = edmCellsCollection->create();
-      newCell.setEnergy(cell.second);
-      uint64_t cellid = cell.first;
+      newCell.setEnergy(energy);
       newCell.setCellID(cellid);
       if (m_addPosition) {
         auto detelement = m_volman.lookupDetElement(cellid);
@@ -124,6 +134,16 @@ StatusCode CreateCaloCellsNoise::execute(const EventContext&) const {
         newCell.setPosition(position);
       }
     }
+  };
+  if (denseFilter) {
+    // build the output directly from the cells that passed the filter
+    for (auto index : m_selectedCells) {
+      createCell(m_cellIds[index], m_cellEnergies[index]);
+    }
+  } else {
+    for (const auto& cell : m_cellsMap) {
+      createCell(cell.first, cell.second);
+    }
   }
 
   // push the CaloHitCollection to event store
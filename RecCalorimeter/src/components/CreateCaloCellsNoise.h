@@ -22,6 +22,9 @@
 // ROOT
 #include "TGeoManager.h"
 
+// k4RecCalorimeter
+#include "RecCaloCommon/IDenseNoiseCaloCellsTool.h"
+
 class IGeoSvc;
 
 /** @class CreateCaloCells
@@ -102,6 +105,12 @@ private:
   dd4hep::VolumeManager m_volman;
   /// Map of cell IDs (corresponding to DD4hep IDs) and energy
   mutable std::unordered_map<uint64_t, double> m_cellsMap;
+  /// Interface of the noise tool filtering dense arrays of cells, if the noise tool provides it
+  SmartIF<IDenseNoiseCaloCellsTool> m_denseNoiseTool;
+  /// Cells flattened for the dense noise filter, and indices of the cells passing the filter
+  mutable std::vector<uint64_t> m_cellIds;
+  mutable std::vector<double> m_cellEnergies;
+  mutable std::vector<uint32_t> m_selectedCells;
 };
 
 #endif /* RECCALORIMETER_CREATECALOCELLS_H */
@@ -54,92 +54,107 @@ StatusCode CreateCaloClusters::initialize() {
     error() << "Unable to locate Histogram Service" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_totEnergy = new TH1F("totalEnergy", "total energy in all clusters per event", 5000, 0, 5);
-  if (m_histSvc->regHist("/rec/totEnergy", m_totEnergy).isFailure()) {
+  m_totEnergy.book(new TH1F("totalEnergy", "total energy in all clusters per event", 5000, 0, 5), m_histograms);
+  if (m_histSvc->regHist("/rec/totEnergy", m_totEnergy.histogram()).isFailure()) {
     error() << "Couldn't register hist of total energy" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_totCalibEnergy =
-      new TH1F("totalCalibEnergy", "total energy in all clusters after calobration per event", 5000, 0, 5);
-  if (m_histSvc->regHist("/rec/totCalibEnergy", m_totCalibEnergy).isFailure()) {
+  m_totCalibEnergy.book(
+      new TH1F("totalCalibEnergy", "total energy in all clusters after calobration per event", 5000, 0, 5),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/totCalibEnergy", m_totCalibEnergy.histogram()).isFailure()) {
     error() << "Couldn't register hist of total energy after calibration" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_totBenchmarkEnergy =
+  m_totBenchmarkEnergy.book(
       new TH1F("totBenchmarkEnergy",
                "total energy in all clusters after calobration and correction for lost energy in cryostat per event",
-               5000, 0, 5);
-  if (m_histSvc->regHist("/rec/totBenchmarkEnergy", m_totBenchmarkEnergy).isFailure()) {
+               5000, 0, 5),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/totBenchmarkEnergy", m_totBenchmarkEnergy.histogram()).isFailure()) {
     error() << "Couldn't register hist of total energy after calibration and cryo correction" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_clusterEnergy = new TH1F("clusterEnergy", "energy of cluster", 20100, -100, 20000);
-  if (m_histSvc->regHist("/rec/clusterEnergy", m_clusterEnergy).isFailure()) {
+  m_clusterEnergy.book(new TH1F("clusterEnergy", "energy of cluster", 20100, -100, 20000), m_histograms);
+  if (m_histSvc->regHist("/rec/clusterEnergy", m_clusterEnergy.histogram()).isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_sharedClusterEnergy = new TH1F("sharedClusterEnergy", "energy in shared clusters per event", 20100, -100, 20000);
-  if (m_histSvc->regHist("/rec/sharedClusterEnergy", m_sharedClusterEnergy).isFailure()) {
+  m_sharedClusterEnergy.book(
+      new TH1F("sharedClusterEnergy", "energy in shared clusters per event", 20100, -100, 20000),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/sharedClusterEnergy", m_sharedClusterEnergy.histogram()).isFailure()) {
     error() << "Couldn't register hist of energy in shared clusters per event" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_clusterEnergyCalibrated = new TH1F("clusterEnergyCalibrated", "energy of calibrated cluster", 20100, -100, 20000);
-  if (m_histSvc->regHist("/rec/clusterEnergyCalibrated", m_clusterEnergyCalibrated).isFailure()) {
+  m_clusterEnergyCalibrated.book(
+      new TH1F("clusterEnergyCalibrated", "energy of calibrated cluster", 20100, -100, 20000),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/clusterEnergyCalibrated", m_clusterEnergyCalibrated.histogram()).isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_clusterEnergyBenchmark =
-      new TH1F("clusterEnergyBenchmark", "energy of calibrated and energy loss corrected cluster", 20100, -100, 20000);
-  if (m_histSvc->regHist("/rec/clusterEnergyBenchmark", m_clusterEnergyBenchmark).isFailure()) {
+  m_clusterEnergyBenchmark.book(
+      new TH1F("clusterEnergyBenchmark", "energy of calibrated and energy loss corrected cluster", 20100, -100, 20000),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/clusterEnergyBenchmark", m_clusterEnergyBenchmark.histogram()).isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_nCluster = new TH1F("nCluster", "number of cluster", 20000, 0, 20000);
-  if (m_histSvc->regHist("/rec/nCluster", m_nCluster).isFailure()) {
+  m_nCluster.book(new TH1F("nCluster", "number of cluster", 20000, 0, 20000), m_histograms);
+  if (m_histSvc->regHist("/rec/nCluster", m_nCluster.histogram()).isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_nCluster_1GeV = new TH1F("nCluster_1GeV", "number of cluster with energy > 1GeV", 20000, 0, 20000);
-  if (m_histSvc->regHist("/rec/nCluster_1GeV", m_nCluster_1GeV).isFailure()) {
+  m_nCluster_1GeV.book(new TH1F("nCluster_1GeV", "number of cluster with energy > 1GeV", 20000, 0, 20000),
+                       m_histograms);
+  if (m_histSvc->regHist("/rec/nCluster_1GeV", m_nCluster_1GeV.histogram()).isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_nCluster_halfTrueEnergy =
-      new TH1F("nCluster_halfTrueEnergy", "number of cluster with energy > Etrue/2", 20000, 0, 20000);
-  if (m_histSvc->regHist("/rec/nCluster_halfTrueEnergy", m_nCluster_halfTrueEnergy).isFailure()) {
+  m_nCluster_halfTrueEnergy.book(
+      new TH1F("nCluster_halfTrueEnergy", "number of cluster with energy > Etrue/2", 20000, 0, 20000),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/nCluster_halfTrueEnergy", m_nCluster_halfTrueEnergy.histogram()).isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_energyCalibCluster_1GeV =
-      new TH1F("energyCalibCluster_1GeV", "energy of calibrated cluster with energy > 1GeV", 20100, -10, 20000);
-  if (m_histSvc->regHist("/rec/energyCalibCluster_1GeV", m_energyCalibCluster_1GeV).isFailure()) {
+  m_energyCalibCluster_1GeV.book(
+      new TH1F("energyCalibCluster_1GeV", "energy of calibrated cluster with energy > 1GeV", 20100, -10, 20000),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/energyCalibCluster_1GeV", m_energyCalibCluster_1GeV.histogram()).isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_energyCalibCluster_halfTrueEnergy = new TH1F(
-      "energyCalibCluster_halfTrueEnergy", "energy of calibrated cluster with energy > Etrue/2", 20100, -100, 20000);
-  if (m_histSvc->regHist("/rec/energyCalibCluster_halfTrueEnergy", m_energyCalibCluster_halfTrueEnergy).isFailure()) {
+  m_energyCalibCluster_halfTrueEnergy.book(new TH1F("energyCalibCluster_halfTrueEnergy",
+                                                    "energy of calibrated cluster with energy > Etrue/2", 20100, -100,
+                                                    20000),
+                                           m_histograms);
+  if (m_histSvc->regHist("/rec/energyCalibCluster_halfTrueEnergy", m_energyCalibCluster_halfTrueEnergy.histogram())
+          .isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_fractionEMcluster = new TH1F("fractionEMcluster", "fraction of EM cluster", 11, -0.05, 1.05);
-  if (m_histSvc->regHist("/rec/fractionEMcluster", m_fractionEMcluster).isFailure()) {
+  m_fractionEMcluster.book(new TH1F("fractionEMcluster", "fraction of EM cluster", 11, -0.05, 1.05), m_histograms);
+  if (m_histSvc->regHist("/rec/fractionEMcluster", m_fractionEMcluster.histogram()).isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_benchmark = new TH1F("benchmark", "added energy due to benchmark correction", 20000, 0, 20000);
-  if (m_histSvc->regHist("/rec/benchmark", m_benchmark).isFailure()) {
+  m_benchmark.book(new TH1F("benchmark", "added energy due to benchmark correction", 20000, 0, 20000), m_histograms);
+  if (m_histSvc->regHist("/rec/benchmark", m_benchmark.histogram()).isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_energyScale = new TH1F("energyScale", "energy scale of cluster", 3, 0., 3.);
-  if (m_histSvc->regHist("/rec/energyScale", m_energyScale).isFailure()) {
+  m_energyScale.book(new TH1F("energyScale", "energy scale of cluster", 3, 0., 3.), m_histograms);
+  if (m_histSvc->regHist("/rec/energyScale", m_energyScale.histogram()).isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_energyScaleVsClusterEnergy = new TH2F(
-      "energyScaleVsClusterEnergy", "energy scale of cluster versus energy of cluster", 3, 0., 3., 20000, 0, 20000);
-  if (m_histSvc->regHist("/rec/energyScaleVsClusterEnergy", m_energyScaleVsClusterEnergy).isFailure()) {
+  m_energyScaleVsClusterEnergy.book(new TH2F("energyScaleVsClusterEnergy",
+                                             "energy scale of cluster versus energy of cluster", 3, 0., 3., 20000, 0,
+                                             20000),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/energyScaleVsClusterEnergy", m_energyScaleVsClusterEnergy.histogram()).isFailure()) {
     error() << "Couldn't register 2D hist" << endmsg;
     return StatusCode::FAILURE;
   }
@@ -185,7 +200,7 @@ StatusCode CreateCaloClusters::execute(const EventContext&) const {
 
   if (m_doCalibration) {
     for (auto cluster : *clusters) {
-      m_clusterEnergy->Fill(cluster.getEnergy());
+      m_clusterEnergy.fill(cluster.getEnergy());
       // 1. Identify clusters with cells in different sub-systems
       bool cellsInBoth = false;
       std::map<uint, double> energyBoth;
@@ -195,11 +210,11 @@ StatusCode CreateCaloClusters::execute(const EventContext&) const {
       double lastBenchmarkTerm = 0.;
       if (cluster.getEnergy() > 1) {
         nClusters_1GeV++;
-        m_energyCalibCluster_1GeV->Fill(cluster.getEnergy());
+        m_energyCalibCluster_1GeV.fill(cluster.getEnergy());
       }
       if (cluster.getEnergy() > Etruth / 2.) {
         nClusters_halfTrueEnergy++;
-        m_energyCalibCluster_halfTrueEnergy->Fill(cluster.getEnergy());
+        m_energyCalibCluster_halfTrueEnergy.fill(cluster.getEnergy());
       }
       // Loop over cluster cells
       for (uint it = 0; it < cluster.hits_size(); it++) {
@@ -236,7 +251,7 @@ StatusCode CreateCaloClusters::execute(const EventContext&) const {
       // 2. Calibrate the cluster if it contains cells in both systems
       if (cellsInBoth) {
         sharedClusters++;
-        m_sharedClusterEnergy->Fill(cluster.getEnergy());
+        m_sharedClusterEnergy.fill(cluster.getEnergy());
         // Calculate the fraction of energy in ECal
         auto energyFraction = energyBoth[m_systemIdECal] / cluster.getEnergy();
         debug() << "Energy fraction in ECal : " << energyFraction << endmsg;
@@ -245,8 +260,8 @@ StatusCode CreateCaloClusters::execute(const EventContext&) const {
         energyBoth[m_systemIdECal] = energyBoth[m_systemIdECal] * m_ehECal;
         bool calibECal = true;
         clustersHad++;
-        m_energyScale->Fill(1);
-        m_energyScaleVsClusterEnergy->Fill(1., cluster.getEnergy());
+        m_energyScale.fill(1);
+        m_energyScaleVsClusterEnergy.fill2D(1., cluster.getEnergy());
         totClusterEnergy += cluster.getEnergy();
 
         // Building new calibrated cluster
@@ -293,7 +308,7 @@ StatusCode CreateCaloClusters::execute(const EventContext&) const {
           energy += cellEnergy;
         }
         // Fill histogram with calibrated energy
-        m_clusterEnergyCalibrated->Fill(energy);
+        m_clusterEnergyCalibrated.fill(energy);
         totCalibClusterEnergy += energy;
 
         edm4hep::Vector3f newClusterPosition = edm4hep::Vector3f(posX / energy, posY / energy, posZ / energy);
@@ -314,7 +329,7 @@ StatusCode CreateCaloClusters::execute(const EventContext&) const {
 
           totBenchmarkCorr += corr;
           // Fill histogram with corrected energy
-          m_clusterEnergyBenchmark->Fill(energy);
+          m_clusterEnergyBenchmark.fill(energy);
           totBenchmarkEnergy += energy;
         }
         newCluster.setEnergy(energy);
@@ -345,28 +360,30 @@ StatusCode CreateCaloClusters::execute(const EventContext&) const {
   if (sharedClusters > 0) {
     info() << "Clusters calibrated to EM scale       : " << clustersEM / float(sharedClusters) * 100 << " % " << endmsg;
     info() << "Clusters calibrated to hadron scale : " << clustersHad / float(sharedClusters) * 100 << " % " << endmsg;
-    m_fractionEMcluster->Fill(clustersEM / float(sharedClusters));
+    m_fractionEMcluster.fill(clustersEM / float(sharedClusters));
   }
   debug() << "Output Cluster collection size: " << edmClusters->size() << endmsg;
 
-  m_totEnergy->Fill(totClusterEnergy / std::floor(Etruth));
-  m_totCalibEnergy->Fill(totCalibClusterEnergy / std::floor(Etruth));
-  m_totBenchmarkEnergy->Fill(totBenchmarkEnergy / std::floor(Etruth));
-  m_benchmark->Fill(totBenchmarkCorr);
+  m_totEnergy.fill(totClusterEnergy / std::floor(Etruth));
+  m_totCalibEnergy.fill(totCalibClusterEnergy / std::floor(Etruth));
+  m_totBenchmarkEnergy.fill(totBenchmarkEnergy / std::floor(Etruth));
+  m_benchmark.fill(totBenchmarkCorr);
 
-  m_nCluster_1GeV->Fill(nClusters_1GeV);
-  m_nCluster_halfTrueEnergy->Fill(nClusters_halfTrueEnergy);
+  m_nCluster_1GeV.fill(nClusters_1GeV);
+  m_nCluster_halfTrueEnergy.fill(nClusters_halfTrueEnergy);
 
   return StatusCode::SUCCESS;
 }
 
 StatusCode CreateCaloClusters::finalize() {
-  float allCluster = m_totEnergy->GetEntries();
-  m_clusterEnergy->Scale(1 / allCluster);
-  m_sharedClusterEnergy->Scale(1 / allCluster);
-  m_clusterEnergyCalibrated->Scale(1 / allCluster);
-  m_clusterEnergyBenchmark->Scale(1 / allCluster);
-  m_energyScale->Scale(1 / allCluster);
+  // add the fills of all threads to the histograms before they are normalised
+  m_histograms.merge();
+  float allCluster = m_totEnergy.histogram()->GetEntries();
+  m_clusterEnergy.histogram()->Scale(1 / allCluster);
+  m_sharedClusterEnergy.histogram()->Scale(1 / allCluster);
+  m_clusterEnergyCalibrated.histogram()->Scale(1 / allCluster);
+  m_clusterEnergyBenchmark.histogram()->Scale(1 / allCluster);
+  m_energyScale.histogram()->Scale(1 / allCluster);
 
   return Gaudi::Algorithm::finalize();
 }
@@ -12,6 +12,9 @@
 #include "k4Interface/ICellPositionsTool.h"
 #include "k4Interface/INoiseConstTool.h"
 
+// RecCaloCommon
+#include "RecCaloCommon/ThreadLocalHistogram.h"
+
 // DD4hep
 #include "DDSegmentation/Segmentation.h"
 
@@ -29,9 +32,6 @@ namespace DDSegmentation {
 }
 } // namespace DD4hep
 
-class TH2F;
-class TH1F;
-
 /** @class CreateCaloClusters
  *
  * Applies hadronic calibration to cluster.
@@ -83,22 +83,24 @@ private:
   /// Handle for tool to get positions in HCal Barrel and Ext Barrel, no Segmentation
   ToolHandle<ICellPositionsTool> m_cellPositionsHCalNoSegTool{"CellPositionsHCalBarrelNoSegTool", this};
 
-  mutable TH1F* m_energyScale;
-  mutable TH1F* m_benchmark;
-  mutable TH1F* m_fractionEMcluster;
-  mutable TH2F* m_energyScaleVsClusterEnergy;
-  mutable TH1F* m_totEnergy;
-  mutable TH1F* m_totCalibEnergy;
-  mutable TH1F* m_totBenchmarkEnergy;
-  mutable TH1F* m_clusterEnergy;
-  mutable TH1F* m_sharedClusterEnergy;
-  mutable TH1F* m_clusterEnergyCalibrated;
-  mutable TH1F* m_clusterEnergyBenchmark;
-  mutable TH1F* m_nCluster;
-  mutable TH1F* m_nCluster_1GeV;
-  mutable TH1F* m_nCluster_halfTrueEnergy;
-  mutable TH1F* m_energyCalibCluster_1GeV;
-  mutable TH1F* m_energyCalibCluster_halfTrueEnergy;
+  /// Histograms filled per thread, merged in finalize
+  k4::recCalo::ThreadLocalHistogram::Registry m_histograms;
+  mutable k4::recCalo::ThreadLocalHistogram m_energyScale;
+  mutable k4::recCalo::ThreadLocalHistogram m_benchmark;
+  mutable k4::recCalo::ThreadLocalHistogram m_fractionEMcluster;
+  mutable k4::recCalo::ThreadLocalHistogram m_energyScaleVsClusterEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_totEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_totCalibEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_totBenchmarkEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_clusterEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_sharedClusterEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_clusterEnergyCalibrated;
+  mutable k4::recCalo::ThreadLocalHistogram m_clusterEnergyBenchmark;
+  mutable k4::recCalo::ThreadLocalHistogram m_nCluster;
+  mutable k4::recCalo::ThreadLocalHistogram m_nCluster_1GeV;
+  mutable k4::recCalo::ThreadLocalHistogram m_nCluster_halfTrueEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_energyCalibCluster_1GeV;
+  mutable k4::recCalo::ThreadLocalHistogram m_energyCalibCluster_halfTrueEnergy;
 
   /// bool if calibration is applied
   bool m_doCalibration = true;
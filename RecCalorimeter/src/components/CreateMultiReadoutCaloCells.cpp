@@ -0,0 +1,216 @@
+#include "CreateMultiReadoutCaloCells.h"
+
+// Gaudi
+#include "GaudiKernel/ThreadLocalContext.h"
+
+// TBB
+#include <tbb/parallel_for.h>
+
+DECLARE_COMPONENT(CreateMultiReadoutCaloCells)
+
+namespace {
+/// Set the event context of the current thread, the previous context is restored when leaving the scope
+class ScopedEventContext {
+public:
+  explicit ScopedEventContext(const EventContext& aContext) : m_previous(Gaudi::Hive::currentContext()) {
+    Gaudi::Hive::setCurrentContext(aContext);
+  }
+  ~ScopedEventContext() { Gaudi::Hive::setCurrentContext(m_previous); }
+  ScopedEventContext(const ScopedEventContext&) = delete;
+  ScopedEventContext& operator=(const ScopedEventContext&) = delete;
+
+private:
+  EventContext m_previous;
+};
+} // namespace
+
+CreateMultiReadoutCaloCells::CreateMultiReadoutCaloCells(const std::string& name, ISvcLocator* svcLoc)
+    : Gaudi::Algorithm(name, svcLoc), m_calibTools(this), m_noiseTools(this), m_geoTools(this),
+      m_cellPositionsTools(this), m_crosstalkTools(this) {
+  declareProperty("calibTools", m_calibTools, "Tools to calibrate Geant4 energy to EM scale, one per readout");
+  declareProperty("noiseTools", m_noiseTools, "Calorimeter cells noise tools, one per readout");
+  declareProperty("geometryTools", m_geoTools, "Geometry tools, one per readout");
+  declareProperty("positionsTools", m_cellPositionsTools, "Cell positions tools, one per readout");
+  declareProperty("crosstalkTools", m_crosstalkTools, "Cell crosstalk tools, one per readout");
+}
+
+CreateMultiReadoutCaloCells::~CreateMultiReadoutCaloCells() {
+  for (auto& readout : m_readouts) {
+    delete readout.hitsCellIDEncoding;
+    delete readout.cellsCellIDEncoding;
+    delete readout.hits;
+    delete readout.cells;
+    delete readout.links;
+  }
+}
+
+StatusCode CreateMultiReadoutCaloCells::initialize() {
+  StatusCode sc = Gaudi::Algorithm::initialize();
+  if (sc.isFailure())
+    return sc;
+
+  const size_t numReadouts = m_hitsNames.size();
+  info() << "CreateMultiReadoutCaloCells initialized for " << numReadouts << " readouts" << endmsg;
+  info() << "do calibration : " << m_doCellCalibration << endmsg;
+  info() << "add cell noise : " << m_addCellNoise << endmsg;
+  info() << "remove cells below threshold : " << m_filterCellNoise << endmsg;
+  info() << "emulate crosstalk : " << m_addCrosstalk << endmsg;
+
+  // Check the configuration of the readouts
+  if (numReadouts == 0) {
+    error() << "No input hit collections given!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+  if (m_cellsNames.size() != numReadouts || (!m_linksNames.empty() && m_linksNames.size() != numReadouts)) {
+    error() << "The number of cell (and link) collections must match the number of hit collections!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+  if (m_cellPositionsTools.size() != numReadouts || (m_doCellCalibration && m_calibTools.size() != numReadouts) ||
+      ((m_addCellNoise || m_filterCellNoise) && m_noiseTools.size() != numReadouts) ||
+      (m_addCellNoise && m_geoTools.size() != numReadouts) ||
+      (m_addCrosstalk && m_crosstalkTools.size() != numReadouts)) {
+    error() << "The number of tools in each tool array must match the number of hit collections!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+
+  // Initialization of tools
+  if (m_cellPositionsTools.retrieve().isFailure()) {
+    error() << "Unable to retrieve the cell positions tools!!!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+  if (m_addCrosstalk && m_crosstalkTools.retrieve().isFailure()) {
+    error() << "Unable to retrieve the cell crosstalk tools!!!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+  if (m_doCellCalibration && m_calibTools.retrieve().isFailure()) {
+    error() << "Unable to retrieve the calo cells calibration tools!!!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+  if ((m_addCellNoise || m_filterCellNoise) && m_noiseTools.retrieve().isFailure()) {
+    error() << "Unable to retrieve the calo cells noise tools!!!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+  if (m_addCellNoise && m_geoTools.retrieve().isFailure()) {
+    error() << "Unable to retrieve the geometry tools!!!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+
+  m_readouts.resize(numReadouts);
+  for (size_t i = 0; i < numReadouts; i++) {
+    auto& readout = m_readouts[i];
+    readout.hits = new k4FWCore::DataHandle<edm4hep::SimCalorimeterHitCollection>(m_hitsNames[i],
+                                                                                  Gaudi::DataHandle::Reader, this);
+    readout.cells = new k4FWCore::DataHandle<edm4hep::CalorimeterHitCollection>(m_cellsNames[i],
+                                                                                Gaudi::DataHandle::Writer, this);
+    if (!m_linksNames.empty()) {
+      readout.links = new k4FWCore::DataHandle<edm4hep::CaloHitSimCaloHitLinkCollection>(
+          m_linksNames[i], Gaudi::DataHandle::Writer, this);
+    }
+    // Copy over the CellIDEncoding string from the input collection to the output collection
+    readout.hitsCellIDEncoding = new k4FWCore::MetaDataHandle<std::string>(
+        *readout.hits, edm4hep::labels::CellIDEncoding, Gaudi::DataHandle::Reader);
+    readout.cellsCellIDEncoding = new k4FWCore::MetaDataHandle<std::string>(
+        *readout.cells, edm4hep::labels::CellIDEncoding, Gaudi::DataHandle::Writer);
+    auto hitsEncoding = readout.hitsCellIDEncoding->get_optional();
+    if (!hitsEncoding.has_value()) {
+      error() << "Missing cellID encoding for input collection " << m_hitsNames[i] << endmsg;
+      return StatusCode::FAILURE;
+    }
+    readout.cellsCellIDEncoding->put(hitsEncoding.value());
+
+    // Prepare the digitisation, with the map of all existing cells in calorimeter to add noise to all
+    k4::recCalo::PositionedCellsDigitiser::Settings settings;
+    settings.addCrosstalk = m_addCrosstalk;
+    settings.doCellCalibration = m_doCellCalibration;
+    settings.addCellNoise = m_addCellNoise;
+    settings.filterCellNoise = m_filterCellNoise;
+    k4::recCalo::PositionedCellsDigitiser::Tools tools;
+    tools.calibTool = m_doCellCalibration ? m_calibTools[i].get() : nullptr;
+    tools.noiseTool = (m_addCellNoise || m_filterCellNoise) ? m_noiseTools[i].get() : nullptr;
+    tools.geoTool = m_addCellNoise ? m_geoTools[i].get() : nullptr;
+    tools.positionsTool = m_cellPositionsTools[i].get();
+    tools.crosstalkTool = m_addCrosstalk ? m_crosstalkTools[i].get() : nullptr;
+    if (readout.digitiser.initialize(settings, tools, hitsEncoding.value(), *this).isFailure()) {
+      error() << "Unable to prepare the digitisation of " << m_hitsNames[i] << "!" << endmsg;
+      return StatusCode::FAILURE;
+    }
+  }
+
+  // the tools of different readouts can run concurrently, except the noise tools drawing from the RndmGenSvc and the
+  // noise tools given for several readouts, whose buffers would be shared
+  m_parallel = numReadouts > 1 && m_numThreads != 1;
+  if (m_parallel && m_addCellNoise) {
+    for (size_t i = 0; i < numReadouts && m_parallel; i++) {
+      const auto& denseNoiseTool = m_readouts[i].digitiser.denseNoiseTool();
+      if (!denseNoiseTool || !denseNoiseTool->isThreadSafe()) {
+        warning() << "Noise tool " << m_noiseTools[i].typeAndName() << " uses the RndmGenSvc, readouts are "
+                  << "digitised serially. Use counterBasedRNG or a noise pool to digitise them concurrently." << endmsg;
+        m_parallel = false;
+      }
+      for (size_t j = 0; j < i && m_parallel; j++) {
+        if (m_noiseTools[j].get() == m_noiseTools[i].get()) {
+          warning() << "Noise tool " << m_noiseTools[i].typeAndName() << " is given for readouts " << m_hitsNames[j]
+                    << " and " << m_hitsNames[i] << ", readouts are digitised serially. Give each readout its own "
+                    << "noise tool to digitise them concurrently." << endmsg;
+          m_parallel = false;
+        }
+      }
+    }
+  }
+  if (m_parallel) {
+    m_arena.initialize(m_numThreads > 0 ? int(m_numThreads) : tbb::task_arena::automatic);
+    info() << "Readouts digitised concurrently on " << m_arena.max_concurrency() << " threads" << endmsg;
+  }
+
+  return StatusCode::SUCCESS;
+}
+
+StatusCode CreateMultiReadoutCaloCells::execute(const EventContext& evtCtx) const {
+  // Get the input collections in the calling thread, the event store is only accessed outside of the tasks
+  std::vector<const edm4hep::SimCalorimeterHitCollection*> hits;
+  hits.reserve(m_readouts.size());
+  for (size_t i = 0; i < m_readouts.size(); i++) {
+    hits.push_back(m_readouts[i].hits->get());
+    debug() << "Input Hit collection " << m_hitsNames[i] << " size: " << hits.back()->size() << endmsg;
+  }
+
+  if (m_parallel) {
+    m_arena.execute([&] {
+      tbb::parallel_for(size_t(0), m_readouts.size(), [&](size_t i) {
+        // the tools reading from the event store (e.g. the event header for the noise) need the event context
+        ScopedEventContext context(evtCtx);
+        digitise(i, *hits[i]);
+      });
+    });
+  } else {
+    for (size_t i = 0; i < m_readouts.size(); i++) {
+      digitise(i, *hits[i]);
+    }
+  }
+
+  // push the collections to event store
+  for (size_t i = 0; i < m_readouts.size(); i++) {
+    auto& readout = m_readouts[i];
+    debug() << "Output Cell collection " << m_cellsNames[i] << " size: " << readout.outputCells->size() << endmsg;
+    readout.cells->put(readout.outputCells);
+    readout.outputCells = nullptr;
+    if (readout.links) {
+      readout.links->put(readout.outputLinks);
+      readout.outputLinks = nullptr;
+    }
+  }
+
+  return StatusCode::SUCCESS;
+}
+
+void CreateMultiReadoutCaloCells::digitise(size_t aIndex, const edm4hep::SimCalorimeterHitCollection& aHits) const {
+  auto& readout = m_readouts[aIndex];
+  readout.outputCells = new edm4hep::CalorimeterHitCollection();
+  if (readout.links) {
+    readout.outputLinks = new edm4hep::CaloHitSimCaloHitLinkCollection();
+  }
+  readout.digitiser.resetCells();
+  readout.digitiser.digitise(aHits, *readout.outputCells, readout.outputLinks);
+}
+
+StatusCode CreateMultiReadoutCaloCells::finalize() { return Gaudi::Algorithm::finalize(); }
@@ -0,0 +1,111 @@
+#ifndef RECCALORIMETER_CREATEMULTIREADOUTCALOCELLS_H
+#define RECCALORIMETER_CREATEMULTIREADOUTCALOCELLS_H
+
+#include "edm4hep/Constants.h"
+
+// k4FWCore
+#include "k4FWCore/DataHandle.h"
+#include "k4FWCore/MetaDataHandle.h"
+#include "k4Interface/ICalibrateCaloHitsTool.h"
+#include "k4Interface/ICaloReadCrosstalkMap.h"
+#include "k4Interface/ICalorimeterTool.h"
+#include "k4Interface/ICellPositionsTool.h"
+#include "k4Interface/INoiseCaloCellsTool.h"
+
+// Gaudi
+#include "Gaudi/Algorithm.h"
+#include "GaudiKernel/ToolHandle.h"
+
+// edm4hep
+#include "edm4hep/CaloHitSimCaloHitLinkCollection.h"
+#include "edm4hep/CalorimeterHitCollection.h"
+#include "edm4hep/SimCalorimeterHitCollection.h"
+
+// TBB
+#include <tbb/task_arena.h>
+
+// RecCaloCommon
+#include "RecCaloCommon/PositionedCellsDigitiser.h"
+
+/** @class CreateMultiReadoutCaloCells
+ *
+ *  Algorithm for creating positioned calorimeter cells from Geant4 hits of several readouts in one algorithm.
+ *  Each readout i is digitised as in CreatePositionedCaloCells (without region-of-interest mode), with the same
+ *  k4::recCalo::PositionedCellsDigitiser, from the hit collection hits[i] into the cell collection cells[i] (and the
+ *  hit<->cell links links[i], if given), using the i-th tool of each of the tool arrays calibTools, noiseTools,
+ *  geometryTools, positionsTools (and crosstalkTools).
+ *  The outputs are the same as those of one CreatePositionedCaloCells per readout.
+ *
+ *  With numThreads different from 1, the readouts are digitised concurrently on a TBB task arena (0: TBB default).
+ *  As every readout has its own tools, the tools are never called concurrently. The noise tools must however not
+ *  draw from the shared RndmGenSvc, nor be shared by several readouts as they keep per-event buffers: if noise is
+ *  added and one of the noise tools is not thread safe (see IDenseNoiseCaloCellsTool::isThreadSafe) or is given for
+ *  more than one readout, the readouts are digitised serially.
+ */
+
+class CreateMultiReadoutCaloCells : public Gaudi::Algorithm {
+
+public:
+  CreateMultiReadoutCaloCells(const std::string& name, ISvcLocator* svcLoc);
+
+  StatusCode initialize();
+
+  StatusCode execute(const EventContext&) const;
+
+  StatusCode finalize();
+
+  virtual ~CreateMultiReadoutCaloCells();
+
+private:
+  /// Per-readout state, only accessed by the task digitising the readout
+  struct Readout {
+    k4FWCore::DataHandle<edm4hep::SimCalorimeterHitCollection>* hits = nullptr;
+    k4FWCore::DataHandle<edm4hep::CalorimeterHitCollection>* cells = nullptr;
+    k4FWCore::DataHandle<edm4hep::CaloHitSimCaloHitLinkCollection>* links = nullptr;
+    k4FWCore::MetaDataHandle<std::string>* hitsCellIDEncoding = nullptr;
+    k4FWCore::MetaDataHandle<std::string>* cellsCellIDEncoding = nullptr;
+    /// Digitisation of the hits of the readout into positioned cells
+    k4::recCalo::PositionedCellsDigitiser digitiser;
+    /// Output collections of the event, put in the event store after all readouts are digitised
+    edm4hep::CalorimeterHitCollection* outputCells = nullptr;
+    edm4hep::CaloHitSimCaloHitLinkCollection* outputLinks = nullptr;
+  };
+
+  /// Digitise the hits of the i-th readout
+  void digitise(size_t aIndex, const edm4hep::SimCalorimeterHitCollection& aHits) const;
+
+  /// Tools for each readout
+  mutable ToolHandleArray<ICalibrateCaloHitsTool> m_calibTools;
+  mutable ToolHandleArray<INoiseCaloCellsTool> m_noiseTools;
+  ToolHandleArray<ICalorimeterTool> m_geoTools;
+  mutable ToolHandleArray<ICellPositionsTool> m_cellPositionsTools;
+  mutable ToolHandleArray<ICaloReadCrosstalkMap> m_crosstalkTools;
+
+  /// Names of the collections for each readout
+  Gaudi::Property<std::vector<std::string>> m_hitsNames{
+      this, "hits", {}, "Hits from which to create cells (input), one collection per readout"};
+  Gaudi::Property<std::vector<std::string>> m_cellsNames{
+      this, "cells", {}, "The created calorimeter cells (output), one collection per readout"};
+  Gaudi::Property<std::vector<std::string>> m_linksNames{
+      this, "links", {}, "The links between hits and cells (output), one collection per readout or none"};
+
+  /// Add crosstalk to cells?
+  Gaudi::Property<bool> m_addCrosstalk{this, "addCrosstalk", false, "Add crosstalk effect?"};
+  /// Calibrate to EM scale?
+  Gaudi::Property<bool> m_doCellCalibration{this, "doCellCalibration", true, "Calibrate to EM scale?"};
+  /// Add noise to cells?
+  Gaudi::Property<bool> m_addCellNoise{this, "addCellNoise", true, "Add noise to cells?"};
+  /// Save only cells with energy above threshold?
+  Gaudi::Property<bool> m_filterCellNoise{this, "filterCellNoise", false,
+                                          "Save only cells with energy above threshold?"};
+  /// Number of threads used to digitise the readouts concurrently
+  Gaudi::Property<int> m_numThreads{this, "numThreads", 1,
+                                    "Number of threads digitising the readouts (0: TBB default, 1: serial)"};
+
+  mutable std::vector<Readout> m_readouts;
+  /// Digitise the readouts concurrently?
+  bool m_parallel = false;
+  mutable tbb::task_arena m_arena;
+};
+
+#endif /* RECCALORIMETER_CREATEMULTIREADOUTCALOCELLS_H */
@@ -1,9 +1,5 @@
 #include "CreatePositionedCaloCells.h"
 
-// dd4hep
-#include "DD4hep/DetType.h"
-#include "DD4hep/Detector.h"
-
 // k4geo
 #include "detectorCommon/DetUtils_k4geo.h"
 
@@ -23,11 +19,14 @@ CreatePositionedCaloCells::CreatePositionedCaloCells(const std::string& name, IS
   declareProperty("calibTool", m_calibTool, "Handle for tool to calibrate Geant4 energy to EM scale tool");
   declareProperty("noiseTool", m_noiseTool, "Handle for the calorimeter cells noise tool");
   declareProperty("geometryTool", m_geoTool, "Handle for the geometry tool");
-
-  m_decoder = nullptr;
 }
 
-CreatePositionedCaloCells::~CreatePositionedCaloCells() { delete m_decoder; }
+CreatePositionedCaloCells::~CreatePositionedCaloCells() {
+  for (auto handle : m_roiParticleHandles)
+    delete handle;
+  for (auto handle : m_roiRecoParticleHandles)
+    delete handle;
+}
 
 StatusCode CreatePositionedCaloCells::initialize() {
   StatusCode sc = Gaudi::Algorithm::initialize();
@@ -39,6 +38,7 @@ StatusCode CreatePositionedCaloCells::initialize() {
   info() << "add cell noise : " << m_addCellNoise << endmsg;
   info() << "remove cells below threshold : " << m_filterCellNoise << endmsg;
   info() << "emulate crosstalk : " << m_addCrosstalk << endmsg;
+  info() << "region-of-interest mode : " << m_roiMode << endmsg;
 
   // Initialization of tools
 
@@ -68,24 +68,12 @@ StatusCode CreatePositionedCaloCells::initialize() {
       return StatusCode::FAILURE;
     }
   }
+  // Geometry settings
   if (m_addCellNoise) {
-    // Geometry settings
     if (!m_geoTool.retrieve()) {
       error() << "Unable to retrieve the geometry tool!!!" << endmsg;
       return StatusCode::FAILURE;
     }
-    // Prepare map of all existing cells in calorimeter to add noise to all
-    StatusCode sc_prepareCells = m_geoTool->prepareEmptyCells(m_cellsMap);
-    if (sc_prepareCells.isFailure()) {
-      error() << "Unable to create empty cells!" << endmsg;
-      return StatusCode::FAILURE;
-    }
-    verbose() << "Initialised empty cell map with size " << m_cellsMap.size() << endmsg;
-    // noise filtering erases cells from the cell map after each event, so we need
-    // to backup the empty cell map for later reuse
-    if (m_filterCellNoise) {
-      m_emptyCellsMap = m_cellsMap;
-    }
   }
 
   // Copy over the CellIDEncoding string from the input collection to the output collection
@@ -95,13 +83,50 @@ StatusCode CreatePositionedCaloCells::initialize() {
     return StatusCode::FAILURE;
   }
   m_cellsCellIDEncoding.put(hitsEncoding.value());
-  m_decoder = new dd4hep::DDSegmentation::BitFieldCoder(hitsEncoding.value());
 
-  // these variables will be initilized in the execute() method
-  // once the system ID is extracted from one cell
-  m_calotype = -99; // -99 not initialized, -1 unknown, 0 em, 1 had, 2 muon
-  m_caloid = 0;     // 0 unknown, 1 ecal, 2 hcal, 3 yoke
-  m_layout = 0;     // 0 any, 1 barrel, 2 endcap
+  // Prepare the digitisation, with the map of all existing cells in calorimeter to add noise to all
+  // (in RoI mode the map is rebuilt in each event)
+  k4::recCalo::PositionedCellsDigitiser::Settings settings;
+  settings.addCrosstalk = m_addCrosstalk;
+  settings.doCellCalibration = m_doCellCalibration;
+  settings.addCellNoise = m_addCellNoise;
+  settings.filterCellNoise = m_filterCellNoise;
+  settings.cellsGivenPerEvent = m_roiMode;
+  k4::recCalo::PositionedCellsDigitiser::Tools tools;
+  tools.calibTool = m_doCellCalibration ? m_calibTool.get() : nullptr;
+  tools.noiseTool = (m_addCellNoise || m_filterCellNoise) ? m_noiseTool.get() : nullptr;
+  tools.geoTool = m_addCellNoise ? m_geoTool.get() : nullptr;
+  tools.positionsTool = m_cellPositionsTool.get();
+  tools.crosstalkTool = m_addCrosstalk ? m_crosstalkTool.get() : nullptr;
+  if (m_digitiser.initialize(settings, tools, hitsEncoding.value(), *this).isFailure()) {
+    return StatusCode::FAILURE;
+  }
+
+  if (m_roiMode) {
+    // create handles for the collections defining the region of interest
+    for (const auto& col : m_roiParticles) {
+      m_roiParticleHandles.push_back(
+          new k4FWCore::DataHandle<edm4hep::MCParticleCollection>(col, Gaudi::DataHandle::Reader, this));
+    }
+    for (const auto& col : m_roiRecoParticles) {
+      m_roiRecoParticleHandles.push_back(
+          new k4FWCore::DataHandle<edm4hep::ReconstructedParticleCollection>(col, Gaudi::DataHandle::Reader, this));
+    }
+    if (m_roiParticleHandles.empty() && m_roiRecoParticleHandles.empty()) {
+      error() << "Region-of-interest mode requires at least one collection in roiParticles or roiRecoParticles!"
+              << endmsg;
+      return StatusCode::FAILURE;
+    }
+    // precompute the direction of all cells, the noise is then sampled only for the cells in the RoI
+    if (m_addCellNoise) {
+      for (const auto& cell : m_digitiser.cells()) {
+        dd4hep::Position posCell = m_cellPositionsTool->xyzPosition(cell.first);
+        m_cellAngles.add(cell.first, posCell.Theta(), posCell.Phi());
+      }
+      m_cellAngles.sort();
+      debug() << "Precomputed theta and phi of " << m_cellAngles.size() << " cells" << endmsg;
+    }
+  }
 
   return StatusCode::SUCCESS;
 }
@@ -111,167 +136,43 @@ StatusCode CreatePositionedCaloCells::execute(const EventContext&) const {
   const edm4hep::SimCalorimeterHitCollection* hits = m_hits.get();
   debug() << "Input Hit collection size: " << hits->size() << endmsg;
 
-  // 0. Clear all cells
-  if (m_addCellNoise) {
-    // if cells are not filtered, the map has same size in each event, equal to the total number
-    // of cells in the calorimeter, so we can just reset the values to 0
-    // if cells are filtered, during each event they are removed from the cellsMap, so one has to
-    // restore the initial map of all empty cells
-    if (!m_filterCellNoise)
-      std::for_each(m_cellsMap.begin(), m_cellsMap.end(), [](std::pair<const uint64_t, double>& p) { p.second = 0; });
-    else
-      m_cellsMap = m_emptyCellsMap;
-  } else {
-    m_cellsMap.clear();
-  }
-
-  // 1. Merge energy deposits into cells
-  // If running with noise, map was already prepared in initialize().
-  // Otherwise it is being created below
-  for (const auto& hit : *hits) {
-    auto id = hit.getCellID();
-    verbose() << "CellID : " << id << endmsg;
-    m_cellsMap[id] += hit.getEnergy();
-  }
-  debug() << "Number of calorimeter cells after merging of hits: " << m_cellsMap.size() << endmsg;
-
-  // 2. Emulate cross-talk (if asked)
-  if (m_addCrosstalk) {
-    // Derive the cross-talk contributions without affecting yet the nominal energy
-    // (one has to emulate crosstalk based on cells free from any cross-talk contributions)
-    m_crosstalkCellsMap.clear(); // this is a temporary map to hold energy exchange due to cross-talk, without affecting
-                                 // yet the nominal energy
-    // loop over cells with nominal energies
-    for (const auto& this_cell : m_cellsMap) {
-      uint64_t this_cellId = this_cell.first;
-      auto vec_neighbours = m_crosstalkTool->getNeighbours(this_cellId); // a vector of neighbour IDs
-      auto vec_crosstalks = m_crosstalkTool->getCrosstalks(this_cellId); // a vector of crosstalk coefficients
-      // loop over crosstalk neighbours of the cell under study
-      for (unsigned int i_cell = 0; i_cell < vec_neighbours.size(); i_cell++) {
-        // signal transfer = energy deposit brought by EM shower hits * crosstalk coefficient
-        double signal_transfer = this_cell.second * vec_crosstalks[i_cell];
-        // for the cell under study, record the signal transfer that will be subtracted from its final cell energy
-        m_crosstalkCellsMap[this_cellId] -= signal_transfer;
-        // for the crosstalk neighbour, record the signal transfer that will be added to its final cell energy
-        m_crosstalkCellsMap[vec_neighbours[i_cell]] += signal_transfer;
+  // Define the region of interest
+  k4::recCalo::ConeRoI roi(m_roiConeSize);
+  if (m_roiMode) {
+    for (auto handle : m_roiParticleHandles) {
+      for (const auto& part : *handle->get()) {
+        roi.addDirection(part.getMomentum().x, part.getMomentum().y, part.getMomentum().z);
       }
     }
-
-    // apply the cross-talk contributions on the nominal cell-energy map
-    for (const auto& this_cell : m_crosstalkCellsMap) {
-      m_cellsMap[this_cell.first] += this_cell.second;
-    }
-  }
-
-  // 3. Calibrate simulation energy to EM scale
-  if (m_doCellCalibration) {
-    m_calibTool->calibrate(m_cellsMap);
-  }
-
-  // 4. Add noise to all cells
-  if (m_addCellNoise) {
-    m_noiseTool->addRandomCellNoise(m_cellsMap);
-  }
-
-  // 5. Filter cells
-  if (m_filterCellNoise) {
-    m_noiseTool->filterCellNoise(m_cellsMap);
-  }
-
-  // determine detector type (only once)
-  if (m_calotype == -99 && m_cellsMap.size() > 0) {
-    info() << "Determining calorimeter type for input collection " << m_hits.objKey() << endmsg;
-    uint cellid = m_cellsMap.begin()->first;
-    int system = m_decoder->get(cellid, "system");
-    debug() << "System: " << system << endmsg;
-    dd4hep::Detector* dd4hepgeo = &(dd4hep::Detector::getInstance());
-    const dd4hep::Detector::HandleMap& children = dd4hepgeo->detectors();
-    for (dd4hep::Detector::HandleMap::const_iterator i = children.begin(); i != children.end(); ++i) {
-      dd4hep::DetElement det((*i).second);
-      int id = det.id();
-      if (id == system) {
-        dd4hep::DetType detType(det.typeFlag());
-        if (detType.is(dd4hep::DetType::CALORIMETER)) {
-          if (detType.is(dd4hep::DetType::ELECTROMAGNETIC)) {
-            m_calotype = 0;
-            m_caloid = 1;
-          } else if (detType.is(dd4hep::DetType::HADRONIC)) {
-            m_calotype = 1;
-            m_caloid = 2;
-          } else if (detType.is(dd4hep::DetType::MUON)) {
-            m_calotype = 2;
-            m_caloid = 3;
-          } else {
-            warning() << "Detector type is neither ELECTROMAGNETIC, HADRONIC nor MUON" << endmsg;
-          }
-          if (detType.is(dd4hep::DetType::BARREL)) {
-            m_layout = 1;
-          } else if (detType.is(dd4hep::DetType::ENDCAP)) {
-            m_layout = 2;
-          } else {
-            warning() << "Detector type is neither BARREL nor ENDCAP" << endmsg;
-          }
-        } else {
-          warning() << "Detector type is not CALORIMETER" << endmsg;
-          m_calotype = -1;
-          m_caloid = 0;
-        }
-        break;
+    for (auto handle : m_roiRecoParticleHandles) {
+      for (const auto& part : *handle->get()) {
+        roi.addDirection(part.getMomentum().x, part.getMomentum().y, part.getMomentum().z);
       }
     }
-    info() << "CaloType: " << m_calotype << endmsg;
-    info() << "CaloId: " << m_caloid << endmsg;
-    info() << "Layout: " << m_layout << endmsg;
+    debug() << "Number of RoI cones: " << roi.axes().size() << endmsg;
   }
 
-  // 6. Copy information to CaloHitCollection
-  edm4hep::CalorimeterHitCollection* edmCellsCollection = new edm4hep::CalorimeterHitCollection();
-  for (const auto& cell : m_cellsMap) {
-    if (m_addCellNoise || (!m_addCellNoise && cell.second != 0.)) {
-      auto newCell = edmCellsCollection->create();
-      newCell.setEnergy(cell.second);
-      uint64_t cellid = cell.first;
-      newCell.setCellID(cellid);
-
-      // add cell position
-      auto cached_pos = m_positions_cache.find(cellid);
-      if (cached_pos == m_positions_cache.end()) {
-        // retrieve position from tool
-        dd4hep::Position posCell = m_cellPositionsTool->xyzPosition(cellid);
-        edm4hep::Vector3f edmPos;
-        edmPos.x = posCell.x() / dd4hep::mm;
-        edmPos.y = posCell.y() / dd4hep::mm;
-        edmPos.z = posCell.z() / dd4hep::mm;
-        m_positions_cache[cellid] = edmPos;
-        newCell.setPosition(edmPos);
-      } else {
-        newCell.setPosition(cached_pos->second);
-      }
-
-      // add cell type (for Pandora) - see iLCSoft/MarlinUtil/source/include/CalorimeterHitType.h
-      int layer = m_decoder->get(cellid, "layer");
-      newCell.setType(m_calotype + 10 * m_caloid + 1000 * m_layout + 10000 * layer);
-
-      debug() << "Cell energy (GeV) : " << newCell.getEnergy() << "\tcellID " << newCell.getCellID() << "\tcellType "
-              << newCell.getType() << endmsg;
-      debug() << "Position of cell (mm) : \t" << newCell.getPosition().x << "\t" << newCell.getPosition().y << "\t"
-              << newCell.getPosition().z << endmsg;
+  // 0. Clear all cells
+  if (m_roiMode) {
+    // only the cells within the RoI are created, so the noise is sampled only for them
+    std::vector<uint64_t> roiCells;
+    if (m_addCellNoise) {
+      m_cellAngles.select(roi, roiCells);
+      debug() << "Number of calorimeter cells in RoI: " << roiCells.size() << endmsg;
     }
+    m_digitiser.resetCells(roiCells);
+  } else {
+    m_digitiser.resetCells();
   }
 
-  // create hits<->cell links
+  // 1.-6. Digitise the hits into positioned cells
+  edm4hep::CalorimeterHitCollection* edmCellsCollection = new edm4hep::CalorimeterHitCollection();
   edm4hep::CaloHitSimCaloHitLinkCollection* edmCellHitLinksCollection = new edm4hep::CaloHitSimCaloHitLinkCollection();
-  for (const auto& cell : *edmCellsCollection) {
-    auto cellID = cell.getCellID();
-    for (const auto& hit : *hits) {
-      auto hitID = hit.getCellID();
-      if (hitID == cellID) {
-        // create Sim<->Reco hit associations
-        auto link = edmCellHitLinksCollection->create();
-        link.setFrom(cell);
-        link.setTo(hit);
-      }
-    }
+  if (m_roiMode) {
+    m_digitiser.digitise(*hits, *edmCellsCollection, edmCellHitLinksCollection,
+                         [&](uint64_t aCellId) { return cellInRoI(aCellId, roi); });
+  } else {
+    m_digitiser.digitise(*hits, *edmCellsCollection, edmCellHitLinksCollection);
   }
 
   // push the CaloHitCollection to event store
@@ -283,4 +184,14 @@ StatusCode CreatePositionedCaloCells::execute(const EventContext&) const {
   return StatusCode::SUCCESS;
 }
 
+bool CreatePositionedCaloCells::cellInRoI(uint64_t aCellId, const k4::recCalo::ConeRoI& aRoI) const {
+  // with noise, the cell map was prepared with all the cells of the RoI
+  if (m_addCellNoise) {
+    return m_digitiser.cells().find(aCellId) != m_digitiser.cells().end();
+  }
+  auto pos = m_digitiser.cellPosition(aCellId);
+  dd4hep::Position posCell(pos.x, pos.y, pos.z);
+  return aRoI.contains(posCell.Theta(), posCell.Phi());
+}
+
 StatusCode CreatePositionedCaloCells::finalize() { return Gaudi::Algorithm::finalize(); }
@@ -19,15 +19,21 @@
 // edm4hep
 #include "edm4hep/CaloHitSimCaloHitLinkCollection.h"
 #include "edm4hep/CalorimeterHitCollection.h"
+#include "edm4hep/MCParticleCollection.h"
+#include "edm4hep/ReconstructedParticleCollection.h"
 #include "edm4hep/SimCalorimeterHitCollection.h"
 
+// RecCaloCommon
+#include "RecCaloCommon/ConeRoI.h"
+#include "RecCaloCommon/PositionedCellsDigitiser.h"
+
 /** @class CreatePositionedCaloCells
  *
  *  Algorithm for creating positioned calorimeter cells from Geant4 hits.
  *  Based on CreateCaloCells, adding a positioning tool so that output
  *  cells from the digitisation contain the correct position in 3D space.
  *
- *  Flow of the program:
+ *  Flow of the program (see k4::recCalo::PositionedCellsDigitiser):
  *  1/ Merge Geant4 energy deposits with same cellID
  *  2/ Emulate cross-talk (if switched on)
  *  3/ Calibrate to electromagnetic scale (if calibration switched on)
@@ -36,6 +42,11 @@
  *     filtering switched on)
  *  6/ Add cell positions
  *
+ *  In region-of-interest mode (roiMode = true) only cells within cones of size roiConeSize (in theta-phi) around the
+ *  momenta of the objects in the roiParticles (MCParticle) and roiRecoParticles (ReconstructedParticle) collections
+ *  are created, and noise is sampled only for these cells. The theta and phi of all calorimeter cells are precomputed
+ *  at initialisation if noise is added. Crosstalk from cells outside the region of interest is not emulated.
+ *
  *  Tools called:
  *    - CalibrateCaloHitsTool
  *    - NoiseCaloCellsTool
@@ -82,6 +93,16 @@ private:
   /// Save only cells with energy above threshold?
   Gaudi::Property<bool> m_filterCellNoise{this, "filterCellNoise", false,
                                           "Save only cells with energy above threshold?"};
+  /// Create cells only in a region of interest?
+  Gaudi::Property<bool> m_roiMode{this, "roiMode", false, "Create cells only within cones around the RoI objects?"};
+  /// Size of the region of interest cones
+  Gaudi::Property<double> m_roiConeSize{this, "roiConeSize", 0.4, "Size of the RoI cones in theta-phi"};
+  /// Names of the MCParticle collections defining the region of interest
+  Gaudi::Property<std::vector<std::string>> m_roiParticles{
+      this, "roiParticles", {}, "Names of MCParticle collections with the RoI directions"};
+  /// Names of the ReconstructedParticle collections defining the region of interest
+  Gaudi::Property<std::vector<std::string>> m_roiRecoParticles{
+      this, "roiRecoParticles", {}, "Names of ReconstructedParticle collections with the RoI directions"};
 
   /// Handle for calo hits (input collection)
   mutable k4FWCore::DataHandle<edm4hep::SimCalorimeterHitCollection> m_hits{"hits", Gaudi::DataHandle::Reader, this};
@@ -96,20 +117,16 @@ private:
   /// Handle for the cellID encoding of the output cell collection
   k4FWCore::MetaDataHandle<std::string> m_cellsCellIDEncoding{m_cells, edm4hep::labels::CellIDEncoding,
                                                               Gaudi::DataHandle::Writer};
-  /// Maps of cell IDs (corresponding to DD4hep IDs) vs digitised cell energies
-  mutable std::unordered_map<uint64_t, double> m_cellsMap;
-  /// Maps of cell IDs (corresponding to DD4hep IDs) on transfer of signals due to crosstalk
-  mutable std::unordered_map<uint64_t, double> m_crosstalkCellsMap;
-  /// Maps of cell IDs with zero energy, for all cells in calo (needed if addNoise and filterNoise are both set)
-  mutable std::unordered_map<uint64_t, double> m_emptyCellsMap;
-  /// Cache position vs cellID
-  mutable std::unordered_map<dd4hep::DDSegmentation::CellID, edm4hep::Vector3f> m_positions_cache{};
-
-  /// For cell type - for PandoraPFA
-  mutable int m_calotype;
-  mutable int m_caloid;
-  mutable int m_layout;
-  dd4hep::DDSegmentation::BitFieldCoder* m_decoder;
+  /// Digitisation of the hits into positioned cells
+  mutable k4::recCalo::PositionedCellsDigitiser m_digitiser;
+  /// Input handles for the RoI collections
+  std::vector<k4FWCore::DataHandle<edm4hep::MCParticleCollection>*> m_roiParticleHandles;
+  std::vector<k4FWCore::DataHandle<edm4hep::ReconstructedParticleCollection>*> m_roiRecoParticleHandles;
+  /// Theta and phi of all cells in calo, for the selection of the cells in the RoI (needed if roiMode and addNoise)
+  k4::recCalo::CellAngleTable m_cellAngles;
+
+  /// Check if the cell is within the region of interest
+  bool cellInRoI(uint64_t aCellId, const k4::recCalo::ConeRoI& aRoI) const;
 };
 
 #endif /* RECCALORIMETER_CREATEPOSITIONEDCALOCELLS_H */
@@ -0,0 +1,33 @@
+#ifndef RECCALORIMETER_ITOPOCLUSTERCHUNKEDINPUTTOOL_H
+#define RECCALORIMETER_ITOPOCLUSTERCHUNKEDINPUTTOOL_H
+
+// std
+#include <cstdint>
+#include <functional>
+#include <span>
+
+// Gaudi
+#include "GaudiKernel/IAlgTool.h"
+
+/** @class ITopoClusterChunkedInputTool RecCalorimeter/src/components/ITopoClusterChunkedInputTool.h
+ *
+ *  Abstract interface for tools providing the input cells of the topo-clustering one calorimeter subsystem at a time,
+ *  so that the consumer does not need to hold a copy of all cells in an intermediate map.
+ */
+
+class ITopoClusterChunkedInputTool : virtual public IAlgTool {
+public:
+  DeclareInterfaceID(ITopoClusterChunkedInputTool, 1, 0);
+
+  /// Function called for each subsystem with the cellIDs and energies of its cells
+  using ChunkConsumer = std::function<StatusCode(std::span<const uint64_t>, std::span<const double>)>;
+
+  /** Hand the input cells over one subsystem at a time.
+   *   @param[in] aConsumer, called once per subsystem, the spans are only valid during the call. Processing stops
+   * at the first chunk for which the consumer returns a failure.
+   *   @return status code of the last call to the consumer
+   */
+  virtual StatusCode cellChunks(const ChunkConsumer& aConsumer) = 0;
+};
+
+#endif /* RECCALORIMETER_ITOPOCLUSTERCHUNKEDINPUTTOOL_H */
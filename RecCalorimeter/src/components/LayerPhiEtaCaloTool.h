@@ -34,12 +34,17 @@ public:
    *   n_eta is number of eta bins in that layer,
    *   n_phi is number of phi bins (the same for each layer).
    *   For more explanation please [see reconstruction documentation](@ref md_reconstruction_doc_reccalorimeter).
+   *   If '\b cellCacheDirectory' is set, the sorted list of cellIDs is read from a cache file keyed by the geometry
+   *   and the configuration of the tool, and written there if it does not exist yet.
    *   @param[out] aCells map of existing cells (and deposited energy, set to 0)
    *   return Status code.
    */
   virtual StatusCode prepareEmptyCells(std::unordered_map<uint64_t, double>& aCells) final;
 
 private:
+  /// Enumerate all existing cells from the geometry
+  StatusCode enumerateCells(std::unordered_map<uint64_t, double>& aCells);
+
   /// Pointer to the geometry service
   SmartIF<IGeoSvc> m_geoSvc;
   /// Name of the detector readout
@@ -57,6 +62,13 @@ private:
   /// Temporary: for use with Tile Calo
   Gaudi::Property<std::vector<double>> m_activeVolumesEta{
       this, "activeVolumesEta", {1.2524, 1.2234, 1.1956, 1.15609, 1.1189, 1.08397, 1.0509, 0.9999, 0.9534, 0.91072}};
+  /// Directory of the cache of cellIDs, no cache if empty
+  Gaudi::Property<std::string> m_cellCacheDirectory{this, "cellCacheDirectory", "",
+                                                    "Directory of the cache of cellIDs, no cache if empty"};
+  /// Enumerate the cells even if they are found in the cache, and check that they agree
+  Gaudi::Property<bool> m_validateCellCache{
+      this, "validateCellCache", false,
+      "Enumerate the cells even if they are found in the cache, and check that they agree"};
 };
 
 #endif /* RECCALORIMETER_TUBELAYERPHIETACALOTOOL_H */
@@ -57,344 +57,389 @@ StatusCode MassInv::initialize() {
   }
 
   // create control histograms
-  m_hEnergyPreAnyCorrections =
-      new TH1F("energyPreAnyCorrections", "Energy of cluster before any correction", 3000, energyStart, energyEnd);
-  if (m_histSvc->regHist("/rec/energyPreAnyCorrections", m_hEnergyPreAnyCorrections).isFailure()) {
+  m_hEnergyPreAnyCorrections.book(
+      new TH1F("energyPreAnyCorrections", "Energy of cluster before any correction", 3000, energyStart, energyEnd),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/energyPreAnyCorrections", m_hEnergyPreAnyCorrections.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hEnergyPostAllCorrections =
-      new TH1F("energyPostAllCorrections", "Energy of cluster after all corrections", 3000, energyStart, energyEnd);
-  if (m_histSvc->regHist("/rec/energyPostAllCorrections", m_hEnergyPostAllCorrections).isFailure()) {
+  m_hEnergyPostAllCorrections.book(
+      new TH1F("energyPostAllCorrections", "Energy of cluster after all corrections", 3000, energyStart, energyEnd),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/energyPostAllCorrections", m_hEnergyPostAllCorrections.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hEnergyPostAllCorrectionsAndScaling =
-      new TH1F("energyPostAllCorrectionsAndScaling", "Energy of cluster after all corrections and scaling", 3000,
-               energyStart, energyEnd);
-  if (m_histSvc->regHist("/rec/energyPostAllCorrectionsAndScaling", m_hEnergyPostAllCorrectionsAndScaling)
+  m_hEnergyPostAllCorrectionsAndScaling.book(new TH1F("energyPostAllCorrectionsAndScaling",
+                                                      "Energy of cluster after all corrections and scaling", 3000,
+                                                      energyStart, energyEnd),
+                                             m_histograms);
+  if (m_histSvc->regHist("/rec/energyPostAllCorrectionsAndScaling", m_hEnergyPostAllCorrectionsAndScaling.histogram())
           .isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hPileupEnergy = new TH1F("pileupCorrectionEnergy", "Energy added to a cluster as a correction for correlated noise",
-                             1000, -10, 10);
-  if (m_histSvc->regHist("/rec/pileupCorrectionEnergy", m_hPileupEnergy).isFailure()) {
+  m_hPileupEnergy.book(new TH1F("pileupCorrectionEnergy",
+                                "Energy added to a cluster as a correction for correlated noise", 1000, -10, 10),
+                       m_histograms);
+  if (m_histSvc->regHist("/rec/pileupCorrectionEnergy", m_hPileupEnergy.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hUpstreamEnergy = new TH1F("upstreamCorrectionEnergy",
-                               "Energy added to a cluster as a correction for upstream material", 1000, -10, 10);
-  if (m_histSvc->regHist("/rec/upstreamCorrectionEnergy", m_hUpstreamEnergy).isFailure()) {
+  m_hUpstreamEnergy.book(new TH1F("upstreamCorrectionEnergy",
+                                  "Energy added to a cluster as a correction for upstream material", 1000, -10, 10),
+                         m_histograms);
+  if (m_histSvc->regHist("/rec/upstreamCorrectionEnergy", m_hUpstreamEnergy.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hDiffEta =
-      new TH1F("diffEta", "#eta resolution", 10 * ceil(2 * m_etaMax / m_dEta), -m_etaMax / 10., m_etaMax / 10.);
-  if (m_histSvc->regHist("/rec/diffEta", m_hDiffEta).isFailure()) {
+  m_hDiffEta.book(
+      new TH1F("diffEta", "#eta resolution", 10 * ceil(2 * m_etaMax / m_dEta), -m_etaMax / 10., m_etaMax / 10.),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/diffEta", m_hDiffEta.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
   for (uint i = 0; i < m_numLayers; i++) {
-    m_hDiffEtaLayer.push_back(new TH1F(("diffEtaLayer" + std::to_string(i)).c_str(),
-                                       ("#eta resolution for layer " + std::to_string(i)).c_str(),
-                                       10 * ceil(2 * m_etaMax / m_dEta), -m_etaMax / 10., m_etaMax / 10.));
-    if (m_histSvc->regHist("/rec/diffEta_layer" + std::to_string(i), m_hDiffEtaLayer.back()).isFailure()) {
+    m_hDiffEtaLayer.emplace_back().book(new TH1F(("diffEtaLayer" + std::to_string(i)).c_str(),
+                                                 ("#eta resolution for layer " + std::to_string(i)).c_str(),
+                                                 10 * ceil(2 * m_etaMax / m_dEta), -m_etaMax / 10., m_etaMax / 10.),
+                                        m_histograms);
+    if (m_histSvc->regHist("/rec/diffEta_layer" + std::to_string(i), m_hDiffEtaLayer.back().histogram()).isFailure()) {
       error() << "Couldn't register histogram" << endmsg;
       return StatusCode::FAILURE;
     }
-    m_hDiffEtaHitLayer.push_back(new TH1F(("diffEtaHitLayer" + std::to_string(i)).c_str(),
-                                          ("#eta hot distribution for layer " + std::to_string(i)).c_str(),
-                                          10 * ceil(2 * m_etaMax / m_dEta), -m_etaMax / 10., m_etaMax / 10.));
-    if (m_histSvc->regHist("/rec/diffEtaHit_layer" + std::to_string(i), m_hDiffEtaHitLayer.back()).isFailure()) {
+    m_hDiffEtaHitLayer.emplace_back().book(new TH1F(("diffEtaHitLayer" + std::to_string(i)).c_str(),
+                                                    ("#eta hot distribution for layer " + std::to_string(i)).c_str(),
+                                                    10 * ceil(2 * m_etaMax / m_dEta), -m_etaMax / 10., m_etaMax / 10.),
+                                           m_histograms);
+    if (m_histSvc->regHist("/rec/diffEtaHit_layer" + std::to_string(i), m_hDiffEtaHitLayer.back().histogram())
+            .isFailure()) {
       error() << "Couldn't register histogram" << endmsg;
       return StatusCode::FAILURE;
     }
   }
-  m_hEta = new TH1F("eta", "#eta", 1000, -m_etaMax, m_etaMax);
-  if (m_histSvc->regHist("/rec/eta", m_hEta).isFailure()) {
+  m_hEta.book(new TH1F("eta", "#eta", 1000, -m_etaMax, m_etaMax), m_histograms);
+  if (m_histSvc->regHist("/rec/eta", m_hEta.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hDiffPhi =
-      new TH1F("diffPhi", "#varphi resolution", 10 * ceil(2 * m_phiMax / m_dPhi), -m_phiMax / 10., m_phiMax / 10.);
-  if (m_histSvc->regHist("/rec/diffPhi", m_hDiffPhi).isFailure()) {
+  m_hDiffPhi.book(
+      new TH1F("diffPhi", "#varphi resolution", 10 * ceil(2 * m_phiMax / m_dPhi), -m_phiMax / 10., m_phiMax / 10.),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/diffPhi", m_hDiffPhi.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hPhi = new TH1F("phi", "#varphi", 1000, -m_phiMax, m_phiMax);
-  if (m_histSvc->regHist("/rec/phi", m_hPhi).isFailure()) {
+  m_hPhi.book(new TH1F("phi", "#varphi", 1000, -m_phiMax, m_phiMax), m_histograms);
+  if (m_histSvc->regHist("/rec/phi", m_hPhi.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
   double thetaMin = 2. * atan(exp(-static_cast<double>(m_etaMax)));
   double thetaMax = 2. * atan(exp(static_cast<double>(m_etaMax)));
-  m_hDiffTheta = new TH1F("diffTheta", "#theta resolution", 10 * ceil((thetaMax - thetaMin) / 0.01), -0.25, 0.25);
-  if (m_histSvc->regHist("/rec/diffTheta", m_hDiffTheta).isFailure()) {
+  m_hDiffTheta.book(new TH1F("diffTheta", "#theta resolution", 10 * ceil((thetaMax - thetaMin) / 0.01), -0.25, 0.25),
+                    m_histograms);
+  if (m_histSvc->regHist("/rec/diffTheta", m_hDiffTheta.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hDiffTheta2point =
-      new TH1F("diffTheta2point", "#theta resolution", 10 * ceil((thetaMax - thetaMin) / 0.01), -0.25, 0.25);
-  if (m_histSvc->regHist("/rec/diffTheta2point", m_hDiffTheta2point).isFailure()) {
+  m_hDiffTheta2point.book(
+      new TH1F("diffTheta2point", "#theta resolution", 10 * ceil((thetaMax - thetaMin) / 0.01), -0.25, 0.25),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/diffTheta2point", m_hDiffTheta2point.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hDiffZ = new TH1F("diffZ", "z resolution", 1e4, -10, 10);
-  if (m_histSvc->regHist("/rec/diffZ", m_hDiffZ).isFailure()) {
+  m_hDiffZ.book(new TH1F("diffZ", "z resolution", 1e4, -10, 10), m_histograms);
+  if (m_histSvc->regHist("/rec/diffZ", m_hDiffZ.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hNumCells = new TH1F("numCells", "number of cells", 2000, -0.5, 1999.5);
-  if (m_histSvc->regHist("/rec/numCells", m_hNumCells).isFailure()) {
+  m_hNumCells.book(new TH1F("numCells", "number of cells", 2000, -0.5, 1999.5), m_histograms);
+  if (m_histSvc->regHist("/rec/numCells", m_hNumCells.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hDiPT = new TH1F("diPT", "transverse momentum of diparticles", 5000, 0, 500);
-  if (m_histSvc->regHist("/rec/diPT", m_hDiPT).isFailure()) {
+  m_hDiPT.book(new TH1F("diPT", "transverse momentum of diparticles", 5000, 0, 500), m_histograms);
+  if (m_histSvc->regHist("/rec/diPT", m_hDiPT.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hDiPTScaled = new TH1F("diPTScaled",
-                           ("transverse momentum of diparticles with cluster energy scaled to " +
-                            std::to_string(round(1. / m_response * 100) / 100))
-                               .c_str(),
-                           5000, 0, 500);
-  if (m_histSvc->regHist("/rec/diPTScaled", m_hDiPTScaled).isFailure()) {
+  m_hDiPTScaled.book(new TH1F("diPTScaled",
+                              ("transverse momentum of diparticles with cluster energy scaled to " +
+                               std::to_string(round(1. / m_response * 100) / 100))
+                                  .c_str(),
+                              5000, 0, 500),
+                     m_histograms);
+  if (m_histSvc->regHist("/rec/diPTScaled", m_hDiPTScaled.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInv = new TH1F("massInv", "invariant mass", 5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInv", m_hMassInv).isFailure()) {
+  m_hMassInv.book(new TH1F("massInv", "invariant mass", 5000, 0, 500), m_histograms);
+  if (m_histSvc->regHist("/rec/massInv", m_hMassInv.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaled = new TH1F(
-      "massInvScaled",
-      ("invariant mass with cluster energy scaled to " + std::to_string(round(1. / m_response * 100) / 100)).c_str(),
-      5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaled", m_hMassInvScaled).isFailure()) {
-    error() << "Couldn't register histogram" << endmsg;
-    return StatusCode::FAILURE;
-  }
-  m_hMassInvScaled100 = new TH1F("massInvScaled100",
-                                 ("invariant mass for pT>100GeV with cluster energy scaled to " +
+  m_hMassInvScaled.book(new TH1F("massInvScaled",
+                                 ("invariant mass with cluster energy scaled to " +
                                   std::to_string(round(1. / m_response * 100) / 100))
                                      .c_str(),
-                                 5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaled100", m_hMassInvScaled100).isFailure()) {
+                                 5000, 0, 500),
+                        m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaled", m_hMassInvScaled.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaled200 = new TH1F("massInvScaled200",
-                                 ("invariant mass for pT>200GeV with cluster energy scaled to " +
-                                  std::to_string(round(1. / m_response * 100) / 100))
-                                     .c_str(),
-                                 5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaled200", m_hMassInvScaled200).isFailure()) {
+  m_hMassInvScaled100.book(new TH1F("massInvScaled100",
+                                    ("invariant mass for pT>100GeV with cluster energy scaled to " +
+                                     std::to_string(round(1. / m_response * 100) / 100))
+                                        .c_str(),
+                                    5000, 0, 500),
+                           m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaled100", m_hMassInvScaled100.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaled300 = new TH1F("massInvScaled300",
-                                 ("invariant mass for pT>300GeV with cluster energy scaled to " +
-                                  std::to_string(round(1. / m_response * 100) / 100))
-                                     .c_str(),
-                                 5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaled300", m_hMassInvScaled300).isFailure()) {
+  m_hMassInvScaled200.book(new TH1F("massInvScaled200",
+                                    ("invariant mass for pT>200GeV with cluster energy scaled to " +
+                                     std::to_string(round(1. / m_response * 100) / 100))
+                                        .c_str(),
+                                    5000, 0, 500),
+                           m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaled200", m_hMassInvScaled200.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated = new TH1F(
-      "massInvScaledIsolated",
-      ("invariant mass with cluster energy scaled to " + std::to_string(round(1. / m_response * 100) / 100)).c_str(),
-      5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated", m_hMassInvScaledIsolated).isFailure()) {
+  m_hMassInvScaled300.book(new TH1F("massInvScaled300",
+                                    ("invariant mass for pT>300GeV with cluster energy scaled to " +
+                                     std::to_string(round(1. / m_response * 100) / 100))
+                                        .c_str(),
+                                    5000, 0, 500),
+                           m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaled300", m_hMassInvScaled300.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated100 = new TH1F("massInvScaledIsolated100",
-                                         ("invariant mass for pT>100GeV with cluster energy scaled to " +
+  m_hMassInvScaledIsolated.book(new TH1F("massInvScaledIsolated",
+                                         ("invariant mass with cluster energy scaled to " +
                                           std::to_string(round(1. / m_response * 100) / 100))
                                              .c_str(),
-                                         5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated100", m_hMassInvScaledIsolated100).isFailure()) {
+                                         5000, 0, 500),
+                                m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated", m_hMassInvScaledIsolated.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated200 = new TH1F("massInvScaledIsolated200",
-                                         ("invariant mass for pT>200GeV with cluster energy scaled to " +
-                                          std::to_string(round(1. / m_response * 100) / 100))
-                                             .c_str(),
-                                         5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated200", m_hMassInvScaledIsolated200).isFailure()) {
+  m_hMassInvScaledIsolated100.book(new TH1F("massInvScaledIsolated100",
+                                            ("invariant mass for pT>100GeV with cluster energy scaled to " +
+                                             std::to_string(round(1. / m_response * 100) / 100))
+                                                .c_str(),
+                                            5000, 0, 500),
+                                   m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated100", m_hMassInvScaledIsolated100.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated300 = new TH1F("massInvScaledIsolated300",
-                                         ("invariant mass for pT>300GeV with cluster energy scaled to " +
-                                          std::to_string(round(1. / m_response * 100) / 100))
-                                             .c_str(),
-                                         5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated300", m_hMassInvScaledIsolated300).isFailure()) {
+  m_hMassInvScaledIsolated200.book(new TH1F("massInvScaledIsolated200",
+                                            ("invariant mass for pT>200GeV with cluster energy scaled to " +
+                                             std::to_string(round(1. / m_response * 100) / 100))
+                                                .c_str(),
+                                            5000, 0, 500),
+                                   m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated200", m_hMassInvScaledIsolated200.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated2 = new TH1F(
-      "massInvScaledIsolated2",
-      ("invariant mass with cluster energy scaled to " + std::to_string(round(1. / m_response * 100) / 100)).c_str(),
-      5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated2", m_hMassInvScaledIsolated2).isFailure()) {
+  m_hMassInvScaledIsolated300.book(new TH1F("massInvScaledIsolated300",
+                                            ("invariant mass for pT>300GeV with cluster energy scaled to " +
+                                             std::to_string(round(1. / m_response * 100) / 100))
+                                                .c_str(),
+                                            5000, 0, 500),
+                                   m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated300", m_hMassInvScaledIsolated300.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated2100 = new TH1F("massInvScaledIsolated2100",
-                                          ("invariant mass for pT>100GeV with cluster energy scaled to " +
+  m_hMassInvScaledIsolated2.book(new TH1F("massInvScaledIsolated2",
+                                          ("invariant mass with cluster energy scaled to " +
                                            std::to_string(round(1. / m_response * 100) / 100))
                                               .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated2100", m_hMassInvScaledIsolated2100).isFailure()) {
+                                          5000, 0, 500),
+                                 m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated2", m_hMassInvScaledIsolated2.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated2200 = new TH1F("massInvScaledIsolated2200",
-                                          ("invariant mass for pT>200GeV with cluster energy scaled to " +
-                                           std::to_string(round(1. / m_response * 100) / 100))
-                                              .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated2200", m_hMassInvScaledIsolated2200).isFailure()) {
+  m_hMassInvScaledIsolated2100.book(new TH1F("massInvScaledIsolated2100",
+                                             ("invariant mass for pT>100GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated2100", m_hMassInvScaledIsolated2100.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated2300 = new TH1F("massInvScaledIsolated2300",
-                                          ("invariant mass for pT>300GeV with cluster energy scaled to " +
-                                           std::to_string(round(1. / m_response * 100) / 100))
-                                              .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated2300", m_hMassInvScaledIsolated2300).isFailure()) {
+  m_hMassInvScaledIsolated2200.book(new TH1F("massInvScaledIsolated2200",
+                                             ("invariant mass for pT>200GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated2200", m_hMassInvScaledIsolated2200.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated3 = new TH1F(
-      "massInvScaledIsolated3",
-      ("invariant mass with cluster energy scaled to " + std::to_string(round(1. / m_response * 100) / 100)).c_str(),
-      5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated3", m_hMassInvScaledIsolated3).isFailure()) {
+  m_hMassInvScaledIsolated2300.book(new TH1F("massInvScaledIsolated2300",
+                                             ("invariant mass for pT>300GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated2300", m_hMassInvScaledIsolated2300.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated3100 = new TH1F("massInvScaledIsolated3100",
-                                          ("invariant mass for pT>100GeV with cluster energy scaled to " +
+  m_hMassInvScaledIsolated3.book(new TH1F("massInvScaledIsolated3",
+                                          ("invariant mass with cluster energy scaled to " +
                                            std::to_string(round(1. / m_response * 100) / 100))
                                               .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated3100", m_hMassInvScaledIsolated3100).isFailure()) {
+                                          5000, 0, 500),
+                                 m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated3", m_hMassInvScaledIsolated3.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated3200 = new TH1F("massInvScaledIsolated3200",
-                                          ("invariant mass for pT>200GeV with cluster energy scaled to " +
-                                           std::to_string(round(1. / m_response * 100) / 100))
-                                              .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated3200", m_hMassInvScaledIsolated3200).isFailure()) {
+  m_hMassInvScaledIsolated3100.book(new TH1F("massInvScaledIsolated3100",
+                                             ("invariant mass for pT>100GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated3100", m_hMassInvScaledIsolated3100.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated3300 = new TH1F("massInvScaledIsolated3300",
-                                          ("invariant mass for pT>300GeV with cluster energy scaled to " +
-                                           std::to_string(round(1. / m_response * 100) / 100))
-                                              .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated3300", m_hMassInvScaledIsolated3300).isFailure()) {
+  m_hMassInvScaledIsolated3200.book(new TH1F("massInvScaledIsolated3200",
+                                             ("invariant mass for pT>200GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated3200", m_hMassInvScaledIsolated3200.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated4 = new TH1F(
-      "massInvScaledIsolated4",
-      ("invariant mass with cluster energy scaled to " + std::to_string(round(1. / m_response * 100) / 100)).c_str(),
-      5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated4", m_hMassInvScaledIsolated4).isFailure()) {
+  m_hMassInvScaledIsolated3300.book(new TH1F("massInvScaledIsolated3300",
+                                             ("invariant mass for pT>300GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated3300", m_hMassInvScaledIsolated3300.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated4100 = new TH1F("massInvScaledIsolated4100",
-                                          ("invariant mass for pT>100GeV with cluster energy scaled to " +
+  m_hMassInvScaledIsolated4.book(new TH1F("massInvScaledIsolated4",
+                                          ("invariant mass with cluster energy scaled to " +
                                            std::to_string(round(1. / m_response * 100) / 100))
                                               .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated4100", m_hMassInvScaledIsolated4100).isFailure()) {
+                                          5000, 0, 500),
+                                 m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated4", m_hMassInvScaledIsolated4.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated4200 = new TH1F("massInvScaledIsolated4200",
-                                          ("invariant mass for pT>200GeV with cluster energy scaled to " +
-                                           std::to_string(round(1. / m_response * 100) / 100))
-                                              .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated4200", m_hMassInvScaledIsolated4200).isFailure()) {
+  m_hMassInvScaledIsolated4100.book(new TH1F("massInvScaledIsolated4100",
+                                             ("invariant mass for pT>100GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated4100", m_hMassInvScaledIsolated4100.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated4300 = new TH1F("massInvScaledIsolated4300",
-                                          ("invariant mass for pT>300GeV with cluster energy scaled to " +
-                                           std::to_string(round(1. / m_response * 100) / 100))
-                                              .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated4300", m_hMassInvScaledIsolated4300).isFailure()) {
+  m_hMassInvScaledIsolated4200.book(new TH1F("massInvScaledIsolated4200",
+                                             ("invariant mass for pT>200GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated4200", m_hMassInvScaledIsolated4200.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated5 = new TH1F(
-      "massInvScaledIsolated5",
-      ("invariant mass with cluster energy scaled to " + std::to_string(round(1. / m_response * 100) / 100)).c_str(),
-      5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated5", m_hMassInvScaledIsolated5).isFailure()) {
+  m_hMassInvScaledIsolated4300.book(new TH1F("massInvScaledIsolated4300",
+                                             ("invariant mass for pT>300GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated4300", m_hMassInvScaledIsolated4300.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated5100 = new TH1F("massInvScaledIsolated5100",
-                                          ("invariant mass for pT>100GeV with cluster energy scaled to " +
+  m_hMassInvScaledIsolated5.book(new TH1F("massInvScaledIsolated5",
+                                          ("invariant mass with cluster energy scaled to " +
                                            std::to_string(round(1. / m_response * 100) / 100))
                                               .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated5100", m_hMassInvScaledIsolated5100).isFailure()) {
+                                          5000, 0, 500),
+                                 m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated5", m_hMassInvScaledIsolated5.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated5200 = new TH1F("massInvScaledIsolated5200",
-                                          ("invariant mass for pT>200GeV with cluster energy scaled to " +
-                                           std::to_string(round(1. / m_response * 100) / 100))
-                                              .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated5200", m_hMassInvScaledIsolated5200).isFailure()) {
+  m_hMassInvScaledIsolated5100.book(new TH1F("massInvScaledIsolated5100",
+                                             ("invariant mass for pT>100GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated5100", m_hMassInvScaledIsolated5100.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledIsolated5300 = new TH1F("massInvScaledIsolated5300",
-                                          ("invariant mass for pT>300GeV with cluster energy scaled to " +
-                                           std::to_string(round(1. / m_response * 100) / 100))
-                                              .c_str(),
-                                          5000, 0, 500);
-  if (m_histSvc->regHist("/rec/massInvScaledIsolated5300", m_hMassInvScaledIsolated5300).isFailure()) {
+  m_hMassInvScaledIsolated5200.book(new TH1F("massInvScaledIsolated5200",
+                                             ("invariant mass for pT>200GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated5200", m_hMassInvScaledIsolated5200.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hMassInvScaledPt = new TH2F(
-      "massInvPtScaled",
-      ("invariant mass vs p_T with cluster energy scaled to " + std::to_string(round(1. / m_response * 100) / 100))
-          .c_str(),
-      5000, 0, 500, 5000, 0, 1000);
-  if (m_histSvc->regHist("/rec/massInPtScaled", m_hMassInvScaledPt).isFailure()) {
+  m_hMassInvScaledIsolated5300.book(new TH1F("massInvScaledIsolated5300",
+                                             ("invariant mass for pT>300GeV with cluster energy scaled to " +
+                                              std::to_string(round(1. / m_response * 100) / 100))
+                                                 .c_str(),
+                                             5000, 0, 500),
+                                    m_histograms);
+  if (m_histSvc->regHist("/rec/massInvScaledIsolated5300", m_hMassInvScaledIsolated5300.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hHCalEnergy = new TH1F("HCalenergy", "Energy deposited in HCal behind EM clusters", 10000, 0, 100);
-  if (m_histSvc->regHist("/rec/energyHCal", m_hHCalEnergy).isFailure()) {
+  m_hMassInvScaledPt.book(new TH2F("massInvPtScaled",
+                                   ("invariant mass vs p_T with cluster energy scaled to " +
+                                    std::to_string(round(1. / m_response * 100) / 100))
+                                       .c_str(),
+                                   5000, 0, 500, 5000, 0, 1000),
+                          m_histograms);
+  if (m_histSvc->regHist("/rec/massInPtScaled", m_hMassInvScaledPt.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
-  m_hHCalTotalEnergy = new TH1F("HCalenergyTotal", "Total deposited energy in HCal", 10000, 0, 1000);
-  if (m_histSvc->regHist("/rec/energyTotalHCal", m_hHCalTotalEnergy).isFailure()) {
+  m_hHCalEnergy.book(new TH1F("HCalenergy", "Energy deposited in HCal behind EM clusters", 10000, 0, 100),
+                     m_histograms);
+  if (m_histSvc->regHist("/rec/energyHCal", m_hHCalEnergy.histogram()).isFailure()) {
+    error() << "Couldn't register histogram" << endmsg;
+    return StatusCode::FAILURE;
+  }
+  m_hHCalTotalEnergy.book(new TH1F("HCalenergyTotal", "Total deposited energy in HCal", 10000, 0, 1000), m_histograms);
+  if (m_histSvc->regHist("/rec/energyTotalHCal", m_hHCalTotalEnergy.histogram()).isFailure()) {
     error() << "Couldn't register histogram" << endmsg;
     return StatusCode::FAILURE;
   }
@@ -607,7 +652,7 @@ StatusCode MassInv::execute(const EventContext&) const {
         double eta = segmentation->eta(cell->getCellID());
         sumEtaLayer[layer] += (weightLog * eta);
         sumWeightLayer[layer] += weightLog;
-        m_hDiffEtaHitLayer[layer]->Fill(eta - etaVertex);
+        m_hDiffEtaHitLayer[layer].fill(eta - etaVertex);
       }
       // calculate eta position weighting with energy deposited in layer
       // this energy is a good estimator of 1/sigma^2 of (eta_barycentre-eta_MC) distribution
@@ -615,7 +660,7 @@ StatusCode MassInv::execute(const EventContext&) const {
         if (sumWeightLayer[iLayer] > 1e-10) {
           sumEtaLayer[iLayer] /= sumWeightLayer[iLayer];
           newEta += sumEtaLayer[iLayer] * sumEnLayer[iLayer];
-          m_hDiffEtaLayer[iLayer]->Fill(sumEtaLayer[iLayer] - etaVertex);
+          m_hDiffEtaLayer[iLayer].fill(sumEtaLayer[iLayer] - etaVertex);
         }
       }
       newEta /= energy;
@@ -646,7 +691,7 @@ StatusCode MassInv::execute(const EventContext&) const {
         double presamplerShift = P00 + P01 * cluster.getEnergy();
         double presamplerScale = P10 + P11 * sqrt(cluster.getEnergy());
         double energyFront = presamplerShift + presamplerScale * sumEnFirstLayer * m_samplingFraction[0];
-        m_hUpstreamEnergy->Fill(energyFront);
+        m_hUpstreamEnergy.fill(energyFront);
         newCluster.setEnergy(newCluster.getEnergy() + energyFront);
       }
     }
@@ -662,19 +707,19 @@ StatusCode MassInv::execute(const EventContext&) const {
       noise = m_constPileupNoise * m_gauss.shoot() * std::sqrt(static_cast<int>(m_mu));
     }
     newCluster.setEnergy(newCluster.getEnergy() + noise);
-    m_hPileupEnergy->Fill(noise);
+    m_hPileupEnergy.fill(noise);
 
     // Fill histograms
-    m_hEnergyPreAnyCorrections->Fill(oldEnergy);
-    m_hEnergyPostAllCorrections->Fill(newCluster.getEnergy());
-    m_hEnergyPostAllCorrectionsAndScaling->Fill(newCluster.getEnergy() / m_response);
+    m_hEnergyPreAnyCorrections.fill(oldEnergy);
+    m_hEnergyPostAllCorrections.fill(newCluster.getEnergy());
+    m_hEnergyPostAllCorrectionsAndScaling.fill(newCluster.getEnergy() / m_response);
 
     // Position resolution
-    m_hEta->Fill(newEta);
-    m_hPhi->Fill(oldPhi);
+    m_hEta.fill(newEta);
+    m_hPhi.fill(oldPhi);
     verbose() << " energy " << energy << "   numCells = " << numCells << " old energy = " << oldEnergy << " newEta "
               << newEta << "   phi = " << oldPhi << " theta = " << 2 * atan(exp(-newEta)) << endmsg;
-    m_hNumCells->Fill(numCells);
+    m_hNumCells.fill(numCells);
     // // Calculate pointing resolution
     // TGraphErrors gZR = TGraphErrors();
     // for (uint iLayer = 0; iLayer < m_numLayers; iLayer++) {
@@ -683,13 +728,13 @@ StatusCode MassInv::execute(const EventContext&) const {
     //   gZR.SetPointError(iLayer, m_layerWidth[iLayer], 1/sumEnLayer[iLayer]);
     // }
     // auto result = gZR.Fit("pol1","S");
-    // m_hDiffZ->Fill(result.Get()->Parameter(1) - zVertex);
+    // m_hDiffZ.fill(result.Get()->Parameter(1) - zVertex);
 
     // Fill histograms for single particle events
     if (particle->size() == 1) {
-      m_hDiffEta->Fill(newEta - etaVertex);
-      m_hDiffPhi->Fill(oldPhi - phiVertex);
-      m_hDiffTheta->Fill(2 * atan(exp(-newEta)) - thetaVertex);
+      m_hDiffEta.fill(newEta - etaVertex);
+      m_hDiffPhi.fill(oldPhi - phiVertex);
+      m_hDiffTheta.fill(2 * atan(exp(-newEta)) - thetaVertex);
     }
 
     // For invariant mass calculation
@@ -732,8 +777,8 @@ StatusCode MassInv::execute(const EventContext&) const {
   for (const auto& candidate1 : clustersMassInv) {
     for (const auto& candidate2 : clustersMassInv) {
       if (candidate1 != candidate2) {
-        m_hMassInv->Fill((candidate1 + candidate2).Mag() * m_massInvCorrection);
-        m_hDiPT->Fill((candidate1 + candidate2).Pt());
+        m_hMassInv.fill((candidate1 + candidate2).Mag() * m_massInvCorrection);
+        m_hDiPT.fill((candidate1 + candidate2).Pt());
       }
     }
   }
@@ -744,17 +789,17 @@ StatusCode MassInv::execute(const EventContext&) const {
               [](TLorentzVector photon1, TLorentzVector photon2) { return photon1.Pt() > photon2.Pt(); });
     double diPhotonMass = (clustersMassInvScaled[0] + clustersMassInvScaled[1]).Mag() * m_massInvCorrection;
     double diPhotonPt = (clustersMassInvScaled[0] + clustersMassInvScaled[1]).Pt();
-    m_hDiPTScaled->Fill(diPhotonPt);
-    m_hMassInvScaled->Fill(diPhotonMass);
-    m_hMassInvScaledPt->Fill(diPhotonMass, diPhotonPt);
+    m_hDiPTScaled.fill(diPhotonPt);
+    m_hMassInvScaled.fill(diPhotonMass);
+    m_hMassInvScaledPt.fill2D(diPhotonMass, diPhotonPt);
     if (diPhotonPt > 100) {
-      m_hMassInvScaled100->Fill(diPhotonMass);
+      m_hMassInvScaled100.fill(diPhotonMass);
     }
     if (diPhotonPt > 200) {
-      m_hMassInvScaled200->Fill(diPhotonMass);
+      m_hMassInvScaled200.fill(diPhotonMass);
     }
     if (diPhotonPt > 300) {
-      m_hMassInvScaled300->Fill(diPhotonMass);
+      m_hMassInvScaled300.fill(diPhotonMass);
     }
 
     // create towers
@@ -779,7 +824,7 @@ StatusCode MassInv::execute(const EventContext&) const {
             sumWindow += m_towers[iEtaWindow][phiNeighbour(iPhiWindow, m_nPhiTower)];
           }
         }
-        m_hHCalEnergy->Fill(sumWindow);
+        m_hHCalEnergy.fill(sumWindow);
         if (sumWindow > m_hcalEnergyThreshold) {
           clustersMassInvScaled.erase(photonCandidate);
           photonCandidate--;
@@ -796,7 +841,7 @@ StatusCode MassInv::execute(const EventContext&) const {
             sumWindow += m_towers[iEtaWindow][phiNeighbour(iPhiWindow, m_nPhiTower)];
           }
         }
-        m_hHCalEnergy->Fill(sumWindow);
+        m_hHCalEnergy.fill(sumWindow);
         if (sumWindow > m_hcalEnergyThreshold * 0.1) {
           clustersMassInvScaled2.erase(photonCandidate);
           photonCandidate--;
@@ -813,7 +858,7 @@ StatusCode MassInv::execute(const EventContext&) const {
             sumWindow += m_towers[iEtaWindow][phiNeighbour(iPhiWindow, m_nPhiTower)];
           }
         }
-        m_hHCalEnergy->Fill(sumWindow);
+        m_hHCalEnergy.fill(sumWindow);
         if (sumWindow > m_hcalEnergyThreshold * 0.2) {
           clustersMassInvScaled3.erase(photonCandidate);
           photonCandidate--;
@@ -830,7 +875,7 @@ StatusCode MassInv::execute(const EventContext&) const {
             sumWindow += m_towers[iEtaWindow][phiNeighbour(iPhiWindow, m_nPhiTower)];
           }
         }
-        m_hHCalEnergy->Fill(sumWindow);
+        m_hHCalEnergy.fill(sumWindow);
         if (sumWindow > m_hcalEnergyThreshold * 0.3) {
           clustersMassInvScaled4.erase(photonCandidate);
           photonCandidate--;
@@ -847,7 +892,7 @@ StatusCode MassInv::execute(const EventContext&) const {
             sumWindow += m_towers[iEtaWindow][phiNeighbour(iPhiWindow, m_nPhiTower)];
           }
         }
-        m_hHCalEnergy->Fill(sumWindow);
+        m_hHCalEnergy.fill(sumWindow);
         if (sumWindow > m_hcalEnergyThreshold * 0.4) {
           clustersMassInvScaled5.erase(photonCandidate);
           photonCandidate--;
@@ -856,63 +901,63 @@ StatusCode MassInv::execute(const EventContext&) const {
     }
     double diPhotonMassIsolated = (clustersMassInvScaled[0] + clustersMassInvScaled[1]).Mag() * m_massInvCorrection;
     double diPhotonPtIsolated = (clustersMassInvScaled[0] + clustersMassInvScaled[1]).Pt();
-    m_hMassInvScaledIsolated->Fill(diPhotonMassIsolated);
+    m_hMassInvScaledIsolated.fill(diPhotonMassIsolated);
     if (diPhotonPtIsolated > 100) {
-      m_hMassInvScaledIsolated100->Fill(diPhotonMassIsolated);
+      m_hMassInvScaledIsolated100.fill(diPhotonMassIsolated);
     }
     if (diPhotonPtIsolated > 200) {
-      m_hMassInvScaledIsolated200->Fill(diPhotonMassIsolated);
+      m_hMassInvScaledIsolated200.fill(diPhotonMassIsolated);
     }
     if (diPhotonPtIsolated > 300) {
-      m_hMassInvScaledIsolated300->Fill(diPhotonMassIsolated);
+      m_hMassInvScaledIsolated300.fill(diPhotonMassIsolated);
     }
     double diPhotonMassIsolated2 = (clustersMassInvScaled2[0] + clustersMassInvScaled2[1]).Mag() * m_massInvCorrection;
     double diPhotonPtIsolated2 = (clustersMassInvScaled2[0] + clustersMassInvScaled2[1]).Pt();
-    m_hMassInvScaledIsolated2->Fill(diPhotonMassIsolated2);
+    m_hMassInvScaledIsolated2.fill(diPhotonMassIsolated2);
     if (diPhotonPtIsolated2 > 100) {
-      m_hMassInvScaledIsolated2100->Fill(diPhotonMassIsolated2);
+      m_hMassInvScaledIsolated2100.fill(diPhotonMassIsolated2);
     }
     if (diPhotonPtIsolated2 > 200) {
-      m_hMassInvScaledIsolated2200->Fill(diPhotonMassIsolated2);
+      m_hMassInvScaledIsolated2200.fill(diPhotonMassIsolated2);
     }
     if (diPhotonPtIsolated2 > 300) {
-      m_hMassInvScaledIsolated2300->Fill(diPhotonMassIsolated2);
+      m_hMassInvScaledIsolated2300.fill(diPhotonMassIsolated2);
     }
     double diPhotonMassIsolated3 = (clustersMassInvScaled3[0] + clustersMassInvScaled3[1]).Mag() * m_massInvCorrection;
     double diPhotonPtIsolated3 = (clustersMassInvScaled3[0] + clustersMassInvScaled3[1]).Pt();
-    m_hMassInvScaledIsolated3->Fill(diPhotonMassIsolated3);
+    m_hMassInvScaledIsolated3.fill(diPhotonMassIsolated3);
     if (diPhotonPtIsolated3 > 100) {
-      m_hMassInvScaledIsolated3100->Fill(diPhotonMassIsolated3);
+      m_hMassInvScaledIsolated3100.fill(diPhotonMassIsolated3);
     }
     if (diPhotonPtIsolated3 > 200) {
-      m_hMassInvScaledIsolated3200->Fill(diPhotonMassIsolated3);
+      m_hMassInvScaledIsolated3200.fill(diPhotonMassIsolated3);
     }
     if (diPhotonPtIsolated3 > 300) {
-      m_hMassInvScaledIsolated3300->Fill(diPhotonMassIsolated3);
+      m_hMassInvScaledIsolated3300.fill(diPhotonMassIsolated3);
     }
     double diPhotonMassIsolated4 = (clustersMassInvScaled4[0] + clustersMassInvScaled4[1]).Mag() * m_massInvCorrection;
     double diPhotonPtIsolated4 = (clustersMassInvScaled4[0] + clustersMassInvScaled4[1]).Pt();
-    m_hMassInvScaledIsolated4->Fill(diPhotonMassIsolated4);
+    m_hMassInvScaledIsolated4.fill(diPhotonMassIsolated4);
     if (diPhotonPtIsolated4 > 100) {
-      m_hMassInvScaledIsolated4100->Fill(diPhotonMassIsolated4);
+      m_hMassInvScaledIsolated4100.fill(diPhotonMassIsolated4);
     }
     if (diPhotonPtIsolated4 > 200) {
-      m_hMassInvScaledIsolated4200->Fill(diPhotonMassIsolated4);
+      m_hMassInvScaledIsolated4200.fill(diPhotonMassIsolated4);
     }
     if (diPhotonPtIsolated4 > 300) {
-      m_hMassInvScaledIsolated4300->Fill(diPhotonMassIsolated4);
+      m_hMassInvScaledIsolated4300.fill(diPhotonMassIsolated4);
     }
     double diPhotonMassIsolated5 = (clustersMassInvScaled5[0] + clustersMassInvScaled5[1]).Mag() * m_massInvCorrection;
     double diPhotonPtIsolated5 = (clustersMassInvScaled5[0] + clustersMassInvScaled5[1]).Pt();
-    m_hMassInvScaledIsolated5->Fill(diPhotonMassIsolated5);
+    m_hMassInvScaledIsolated5.fill(diPhotonMassIsolated5);
     if (diPhotonPtIsolated5 > 100) {
-      m_hMassInvScaledIsolated5100->Fill(diPhotonMassIsolated5);
+      m_hMassInvScaledIsolated5100.fill(diPhotonMassIsolated5);
     }
     if (diPhotonPtIsolated5 > 200) {
-      m_hMassInvScaledIsolated5200->Fill(diPhotonMassIsolated5);
+      m_hMassInvScaledIsolated5200.fill(diPhotonMassIsolated5);
     }
     if (diPhotonPtIsolated5 > 300) {
-      m_hMassInvScaledIsolated5300->Fill(diPhotonMassIsolated5);
+      m_hMassInvScaledIsolated5300.fill(diPhotonMassIsolated5);
     }
     debug() << "Number of photon candidates: " << clustersMassInvScaled.size() << endmsg;
     debug() << "Number of photon candidates: " << clustersMassInvScaled2.size() << endmsg;
@@ -923,7 +968,11 @@ StatusCode MassInv::execute(const EventContext&) const {
   return StatusCode::SUCCESS;
 }
 
-StatusCode MassInv::finalize() { return Gaudi::Algorithm::finalize(); }
+StatusCode MassInv::finalize() {
+  // add the fills of all threads to the histograms written by the histogram service
+  m_histograms.merge();
+  return Gaudi::Algorithm::finalize();
+}
 
 StatusCode MassInv::initNoiseFromFile() {
   // Check if file exists
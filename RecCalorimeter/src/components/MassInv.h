@@ -9,6 +9,9 @@
 // Key4HEP
 #include "k4FWCore/DataHandle.h"
 #include "k4Interface/ITowerTool.h"
+
+// RecCaloCommon
+#include "RecCaloCommon/ThreadLocalHistogram.h"
 class IGeoSvc;
 class IRndmGenSvc;
 class ITHistSvc;
@@ -31,6 +34,9 @@ namespace DDSegmentation {
 #include "TH1F.h"
 #include "TH2F.h"
 
+// std
+#include <deque>
+
 /** @class MassInv
  *
  *  Apply corrections to a reconstructed cluster.
@@ -99,72 +105,74 @@ private:
   ServiceHandle<ITHistSvc> m_histSvc;
   /// Pointer to the geometry service
   ServiceHandle<IGeoSvc> m_geoSvc;
+  /// Histograms filled per thread, merged in finalize
+  k4::recCalo::ThreadLocalHistogram::Registry m_histograms;
   /// Histogram of energy before any correction
-  TH1F* m_hEnergyPreAnyCorrections;
+  mutable k4::recCalo::ThreadLocalHistogram m_hEnergyPreAnyCorrections;
   /// Histogram of energy after all corrections
-  TH1F* m_hEnergyPostAllCorrections;
+  mutable k4::recCalo::ThreadLocalHistogram m_hEnergyPostAllCorrections;
   /// Histogram of energy after all corrections and scaled to restore response = 1
-  TH1F* m_hEnergyPostAllCorrectionsAndScaling;
+  mutable k4::recCalo::ThreadLocalHistogram m_hEnergyPostAllCorrectionsAndScaling;
   /// Histogram of eta resolution
-  TH1F* m_hDiffEta;
+  mutable k4::recCalo::ThreadLocalHistogram m_hDiffEta;
   /// Histogram of theta resolution (calculated from all eta position and all layers)
-  TH1F* m_hDiffTheta;
+  mutable k4::recCalo::ThreadLocalHistogram m_hDiffTheta;
   /// Histogram of theta resolution (calculated from eta position from 2 most significant layers)
-  TH1F* m_hDiffTheta2point;
+  mutable k4::recCalo::ThreadLocalHistogram m_hDiffTheta2point;
   /// Histogram of impact parameter (z) resolution
-  TH1F* m_hDiffZ;
+  mutable k4::recCalo::ThreadLocalHistogram m_hDiffZ;
   std::vector<double> m_layerR = {1930, 1985, 2075, 2165, 2255, 2345, 2435, 2525};
   std::vector<double> m_layerWidth = {20, 90, 90, 90, 90, 90, 90, 90};
   /// Histogram of eta resolution per layer
-  std::vector<TH1F*> m_hDiffEtaLayer;
+  mutable std::deque<k4::recCalo::ThreadLocalHistogram> m_hDiffEtaLayer;
   /// Histogram of eta resolution per layer - calculated as eta_MC - eta_hit (not sum(eta_hit))
-  std::vector<TH1F*> m_hDiffEtaHitLayer;
+  mutable std::deque<k4::recCalo::ThreadLocalHistogram> m_hDiffEtaHitLayer;
   /// Histogram of phi resolution
-  TH1F* m_hDiffPhi;
+  mutable k4::recCalo::ThreadLocalHistogram m_hDiffPhi;
   /// Histogram of eta
-  TH1F* m_hEta;
+  mutable k4::recCalo::ThreadLocalHistogram m_hEta;
   /// Histogram of phi
-  TH1F* m_hPhi;
+  mutable k4::recCalo::ThreadLocalHistogram m_hPhi;
   /// Number of cells inside cluster
-  TH1F* m_hNumCells;
+  mutable k4::recCalo::ThreadLocalHistogram m_hNumCells;
   /// Di-particle pT
-  TH1F* m_hDiPT;
+  mutable k4::recCalo::ThreadLocalHistogram m_hDiPT;
   /// Di-particle pT with cluster energy scaled to 1/*response*
-  TH1F* m_hDiPTScaled;
+  mutable k4::recCalo::ThreadLocalHistogram m_hDiPTScaled;
   /// Di-particle invariant mass
-  TH1F* m_hMassInv;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInv;
   /// Di-particle invariant mass with cluster energy scaled to 1/*response*
-  TH1F* m_hMassInvScaled;
-  TH1F* m_hMassInvScaled100;
-  TH1F* m_hMassInvScaled200;
-  TH1F* m_hMassInvScaled300;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaled;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaled100;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaled200;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaled300;
   /// Di-particle invariant mass with cluster energy scaled to 1/*response*
-  TH1F* m_hMassInvScaledIsolated;
-  TH1F* m_hMassInvScaledIsolated100;
-  TH1F* m_hMassInvScaledIsolated200;
-  TH1F* m_hMassInvScaledIsolated300;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated100;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated200;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated300;
   /// Di-particle invariant mass with cluster energy scaled to 1/*response*
-  TH1F* m_hMassInvScaledIsolated2;
-  TH1F* m_hMassInvScaledIsolated2100;
-  TH1F* m_hMassInvScaledIsolated2200;
-  TH1F* m_hMassInvScaledIsolated2300;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated2;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated2100;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated2200;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated2300;
   /// Di-particle invariant mass with cluster energy scaled to 1/*response*
-  TH1F* m_hMassInvScaledIsolated3;
-  TH1F* m_hMassInvScaledIsolated3100;
-  TH1F* m_hMassInvScaledIsolated3200;
-  TH1F* m_hMassInvScaledIsolated3300;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated3;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated3100;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated3200;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated3300;
   /// Di-particle invariant mass with cluster energy scaled to 1/*response*
-  TH1F* m_hMassInvScaledIsolated4;
-  TH1F* m_hMassInvScaledIsolated4100;
-  TH1F* m_hMassInvScaledIsolated4200;
-  TH1F* m_hMassInvScaledIsolated4300;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated4;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated4100;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated4200;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated4300;
   /// Di-particle invariant mass with cluster energy scaled to 1/*response*
-  TH1F* m_hMassInvScaledIsolated5;
-  TH1F* m_hMassInvScaledIsolated5100;
-  TH1F* m_hMassInvScaledIsolated5200;
-  TH1F* m_hMassInvScaledIsolated5300;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated5;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated5100;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated5200;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledIsolated5300;
   /// Di-particle invariant mass with cluster energy scaled to 1/*response*
-  TH2F* m_hMassInvScaledPt;
+  mutable k4::recCalo::ThreadLocalHistogram m_hMassInvScaledPt;
   /// Energy of the centre of energy distribution histograms
   Gaudi::Property<double> m_response{this, "response", 0.95, "Reconstructed energy (in the cluster) used for scaling"};
   /// Energy of the centre of energy distribution histograms
@@ -192,7 +200,7 @@ private:
   /// map of system Id to decoder, created based on m_readoutName and m_systemId
   mutable std::map<uint, dd4hep::DDSegmentation::BitFieldCoder*> m_decoder;
   /// Histogram of pileup noise added to energy of clusters
-  TH1F* m_hPileupEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_hPileupEnergy;
   /// Random Number Service
   SmartIF<IRndmGenSvc> m_randSvc;
   /// Gaussian random number generator used for the generation of random noise hits
@@ -239,7 +247,7 @@ private:
   /// segmentation of detetor in phi (for number of bins in histograms)
   Gaudi::Property<double> m_dPhi{this, "dPhi", 2 * M_PI / 704, "Segmentation in phi"};
   /// Histogram of upstream energy added to energy of clusters
-  TH1F* m_hUpstreamEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_hUpstreamEnergy;
   /// Size of the window in phi for the final cluster building, optimised for each layer  (in units of cell size)
   /// If empty use same size for each layer, as in *nPhiFinal*
   Gaudi::Property<std::vector<int>> m_nPhiFinal{this, "nPhiOptimFinal", {}};
@@ -278,8 +286,8 @@ private:
   Gaudi::Property<float> m_hcalEnergyThreshold{this, "isolationEnergy", 1,
                                                "Requirement for energy in HCal to be smaller than"};
   /// Histogram of total HCal energy
-  TH1F* m_hHCalEnergy;
-  TH1F* m_hHCalTotalEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_hHCalEnergy;
+  mutable k4::recCalo::ThreadLocalHistogram m_hHCalTotalEnergy;
 };
 
 #endif /* RECCALORIMETER_CORRECTCLUSTER_H */
@@ -5,6 +5,10 @@
 #include "detectorCommon/DetUtils_k4geo.h"
 #include "k4Interface/IGeoSvc.h"
 
+// k4RecCalorimeter
+#include "RecCaloCommon/CellListCache.h"
+#include "RecCaloCommon/Hash.h"
+
 DECLARE_COMPONENT(NestedVolumesCaloTool)
 
 NestedVolumesCaloTool::NestedVolumesCaloTool(const std::string& type, const std::string& name, const IInterface* parent)
@@ -34,6 +38,19 @@ StatusCode NestedVolumesCaloTool::initialize() {
 StatusCode NestedVolumesCaloTool::finalize() { return AlgTool::finalize(); }
 
 StatusCode NestedVolumesCaloTool::prepareEmptyCells(std::unordered_map<uint64_t, double>& aCells) {
+  if (m_cellCacheDirectory.empty()) {
+    return enumerateCells(aCells);
+  }
+  uint64_t key = k4::recCalo::CellListCache::geometryKey(*m_geoSvc->getDetector(), m_readoutName);
+  key = k4::recCalo::hashCombine(key, type());
+  key = k4::recCalo::CellListCache::combine(key, {&m_readoutName, &m_activeVolumeName, &m_activeFieldName,
+                                                  &m_fieldNames, &m_fieldValues});
+  k4::recCalo::CellListCache cache(m_cellCacheDirectory, m_readoutName, key);
+  return cache.prepareEmptyCells(aCells, m_validateCellCache, msgStream(),
+                                 [this](std::unordered_map<uint64_t, double>& cells) { return enumerateCells(cells); });
+}
+
+StatusCode NestedVolumesCaloTool::enumerateCells(std::unordered_map<uint64_t, double>& aCells) {
   // Take readout bitfield decoder from GeoSvc
   auto decoder = m_geoSvc->getDetector()->readout(m_readoutName).idSpec().decoder();
   if (m_fieldNames.size() != m_fieldValues.size()) {
@@ -30,12 +30,17 @@ public:
    *   Corresponding bitfield name is given in '\b activeFieldName'.
    *   If more than one name is given, it is assumed that volumes are nested.
    *   For more explanation please [see reconstruction documentation](@ref md_reconstruction_doc_reccalorimeter).
+   *   If '\b cellCacheDirectory' is set, the sorted list of cellIDs is read from a cache file keyed by the geometry
+   *   and the configuration of the tool, and written there if it does not exist yet.
    *   @param[out] aCells map of existing cells (and deposited energy, set to 0)
    *   return Status code.
    */
   virtual StatusCode prepareEmptyCells(std::unordered_map<uint64_t, double>& aCells) final;
 
 private:
+  /// Enumerate all existing cells from the geometry
+  StatusCode enumerateCells(std::unordered_map<uint64_t, double>& aCells);
+
   /// Pointer to the geometry service
   ServiceHandle<IGeoSvc> m_geoSvc;
   /// Name of the detector readout
@@ -52,6 +57,13 @@ private:
   /// Values of the fields describing the segmented volume
   Gaudi::Property<std::vector<int>> m_fieldValues{
       this, "fieldValues", {}, "Values of the fields describing the segmented volume"};
+  /// Directory of the cache of cellIDs, no cache if empty
+  Gaudi::Property<std::string> m_cellCacheDirectory{this, "cellCacheDirectory", "",
+                                                    "Directory of the cache of cellIDs, no cache if empty"};
+  /// Enumerate the cells even if they are found in the cache, and check that they agree
+  Gaudi::Property<bool> m_validateCellCache{
+      this, "validateCellCache", false,
+      "Enumerate the cells even if they are found in the cache, and check that they agree"};
 };
 
 #endif /* RECCALORIMETER_NESTEDVOLUMESCALOTOOL_H */
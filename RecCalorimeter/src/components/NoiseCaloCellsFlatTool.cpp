@@ -1,12 +1,16 @@
 #include "NoiseCaloCellsFlatTool.h"
 #include <GaudiKernel/StatusCode.h>
 
+// k4RecCalorimeter
+#include "RecCaloCommon/CompactIndices.h"
+
 DECLARE_COMPONENT(NoiseCaloCellsFlatTool)
 
 NoiseCaloCellsFlatTool::NoiseCaloCellsFlatTool(const std::string& type, const std::string& name,
                                                const IInterface* parent)
     : AlgTool(type, name, parent) {
   declareInterface<INoiseCaloCellsTool>(this);
+  declareInterface<IDenseNoiseCaloCellsTool>(this);
 }
 
 StatusCode NoiseCaloCellsFlatTool::initialize() {
@@ -29,6 +33,10 @@ StatusCode NoiseCaloCellsFlatTool::initialize() {
     }
   }
 
+  if (m_noiseSource.initialize().isFailure()) {
+    return StatusCode::FAILURE;
+  }
+
   info() << "RMS of the cell noise: " << m_cellNoiseRMS * 1.e3 << " MeV" << endmsg;
   info() << "Offset of the cell noise: " << m_cellNoiseOffset * 1.e3 << " MeV" << endmsg;
   info() << "Filter noise threshold: " << m_filterThreshold << "*sigma" << endmsg;
@@ -36,20 +44,49 @@ StatusCode NoiseCaloCellsFlatTool::initialize() {
 }
 
 void NoiseCaloCellsFlatTool::addRandomCellNoise(std::unordered_map<uint64_t, double>& aCells) {
+  if (m_noiseSource.isEnabled()) {
+    auto noise = m_noiseSource.gaussians(aCells).begin();
+    for (auto& cell : aCells) {
+      cell.second += m_cellNoiseOffset + (*noise++) * m_cellNoiseRMS;
+    }
+    return;
+  }
   std::for_each(aCells.begin(), aCells.end(), [this](std::pair<const uint64_t, double>& p) {
     p.second += (m_cellNoiseOffset + (m_gauss.shoot() * m_cellNoiseRMS));
   });
 }
 
-void NoiseCaloCellsFlatTool::filterCellNoise(std::unordered_map<uint64_t, double>& aCells) {
-  // Erase a cell if it has energy below a threshold
-  double threshold = m_cellNoiseOffset + m_filterThreshold * m_cellNoiseRMS;
-  auto it = aCells.begin();
-  while ((it = std::find_if(it, aCells.end(), [&threshold](std::pair<const uint64_t, double>& p) {
-            return bool(p.second < threshold);
-          })) != aCells.end()) {
-    aCells.erase(it++);
+void NoiseCaloCellsFlatTool::addRandomCellNoise(std::span<const uint64_t> aCellIds, std::span<double> aEnergies,
+                                                size_t aFirst) {
+  if (m_noiseSource.isEnabled()) {
+    auto noise = m_noiseSource.gaussians(aCellIds, aFirst);
+    for (size_t i = 0; i < aEnergies.size(); i++) {
+      aEnergies[i] += m_cellNoiseOffset + noise[i] * m_cellNoiseRMS;
+    }
+    return;
+  }
+  for (auto& energy : aEnergies) {
+    energy += m_cellNoiseOffset + (m_gauss.shoot() * m_cellNoiseRMS);
   }
 }
 
-StatusCode NoiseCaloCellsFlatTool::finalize() { return AlgTool::finalize(); }
+void NoiseCaloCellsFlatTool::filterCellNoise(std::unordered_map<uint64_t, double>& aCells) {
+  // Erase the cells with energy below the threshold, in a single pass over the map
+  std::erase_if(aCells,
+                [this](const std::pair<const uint64_t, double>& p) { return isBelowThreshold(p.first, p.second); });
+}
+
+void NoiseCaloCellsFlatTool::selectCells(std::span<const uint64_t> aCellIds, std::span<const double> aEnergies,
+                                         std::vector<uint32_t>& aSelected) {
+  k4::recCalo::compactIndices(aCellIds.size(), aSelected,
+                              [&](size_t i) { return !isBelowThreshold(aCellIds[i], aEnergies[i]); });
+}
+
+bool NoiseCaloCellsFlatTool::isBelowThreshold(uint64_t, double aEnergy) {
+  return aEnergy < m_cellNoiseOffset + m_filterThreshold * m_cellNoiseRMS;
+}
+
+StatusCode NoiseCaloCellsFlatTool::finalize() {
+  m_noiseSource.finalize();
+  return AlgTool::finalize();
+}
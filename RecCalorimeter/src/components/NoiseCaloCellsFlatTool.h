@@ -9,6 +9,10 @@
 // k4FWCore
 #include "k4Interface/INoiseCaloCellsTool.h"
 
+// k4RecCalorimeter
+#include "RecCaloCommon/IDenseNoiseCaloCellsTool.h"
+#include "RecCaloCommon/NoiseSource.h"
+
 /** @class NoiseCaloCellsFlatTool
  *
  *  Very simple tool for calorimeter noise using a single noise value for all cells
@@ -22,7 +26,9 @@
  *  @date   2024-07
  */
 
-class NoiseCaloCellsFlatTool : public AlgTool, virtual public INoiseCaloCellsTool {
+class NoiseCaloCellsFlatTool : public AlgTool,
+                               virtual public INoiseCaloCellsTool,
+                               virtual public IDenseNoiseCaloCellsTool {
 public:
   NoiseCaloCellsFlatTool(const std::string& type, const std::string& name, const IInterface* parent);
   virtual ~NoiseCaloCellsFlatTool() = default;
@@ -36,8 +42,22 @@ public:
   /** @brief Remove cells with energy below threshold*sigma from the vector of cells
    */
   virtual void filterCellNoise(std::unordered_map<uint64_t, double>& aCells) final;
+  /** @brief Add random noise to a block of cells stored in dense arrays
+   */
+  virtual void addRandomCellNoise(std::span<const uint64_t> aCellIds, std::span<double> aEnergies,
+                                  size_t aFirst) final;
+  /** @brief Select the cells with energy above threshold from dense arrays of cells, without modifying them
+   */
+  virtual void selectCells(std::span<const uint64_t> aCellIds, std::span<const double> aEnergies,
+                           std::vector<uint32_t>& aSelected) final;
+  /** @brief Check if the noise is drawn without the RndmGenSvc (counter-based generator or noise pool)
+   */
+  virtual bool isThreadSafe() const final { return m_noiseSource.isEnabled(); }
 
 private:
+  /// Filter condition shared by filterCellNoise and selectCells
+  bool isBelowThreshold(uint64_t aCellId, double aEnergy);
+
   /// RMS of noise -- uniform RMS per cell in GeV
   Gaudi::Property<double> m_cellNoiseRMS{this, "cellNoiseRMS", 0.003, "uniform noise RMS per cell in GeV"};
   /// Offset of noise -- uniform offset per cell in GeV
@@ -49,6 +69,9 @@ private:
   SmartIF<IRndmGenSvc> m_randSvc;
   /// Gaussian random number generator used for smearing with a constant resolution (m_sigma)
   Rndm::Numbers m_gauss;
+
+  /// Noise drawn independently of the RndmGenSvc (counter-based generator or noise pool)
+  k4::recCalo::NoiseSource m_noiseSource{this};
 };
 
 #endif /* RECCALORIMETER_NOISECALOCELLSFLATTOOL_H */
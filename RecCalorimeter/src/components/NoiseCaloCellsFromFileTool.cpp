@@ -1,5 +1,8 @@
 #include "NoiseCaloCellsFromFileTool.h"
 
+// k4RecCalorimeter
+#include "RecCaloCommon/CompactIndices.h"
+
 // k4geo
 #include "detectorCommon/DetUtils_k4geo.h"
 
@@ -21,6 +24,7 @@ NoiseCaloCellsFromFileTool::NoiseCaloCellsFromFileTool(const std::string& type,
                                                        const IInterface* parent)
     : AlgTool(type, name, parent), m_geoSvc("GeoSvc", name) {
   declareInterface<INoiseCaloCellsTool>(this);
+  declareInterface<IDenseNoiseCaloCellsTool>(this);
   declareProperty("cellPositionsTool", m_cellPositionsTool, "Handle for tool to retrieve cell positions");
 }
 
@@ -44,6 +48,10 @@ StatusCode NoiseCaloCellsFromFileTool::initialize() {
     return StatusCode::FAILURE;
   }
 
+  if (m_noiseSource.initialize().isFailure()) {
+    return StatusCode::FAILURE;
+  }
+
   // open and check file, read the histograms with noise constants
   if (initNoiseFromFile().isFailure()) {
     error() << "Couldn't open file with noise constants!!!" << endmsg;
@@ -98,23 +106,51 @@ StatusCode NoiseCaloCellsFromFileTool::initialize() {
 }
 
 void NoiseCaloCellsFromFileTool::addRandomCellNoise(std::unordered_map<uint64_t, double>& aCells) {
+  if (m_noiseSource.isEnabled()) {
+    auto noise = m_noiseSource.gaussians(aCells).begin();
+    for (auto& cell : aCells) {
+      cell.second += getNoiseRMSPerCell(cell.first) * (*noise++);
+    }
+    return;
+  }
   std::for_each(aCells.begin(), aCells.end(), [this](std::pair<const uint64_t, double>& p) {
     p.second += (getNoiseRMSPerCell(p.first) * m_gauss.shoot());
   });
 }
 
-void NoiseCaloCellsFromFileTool::filterCellNoise(std::unordered_map<uint64_t, double>& aCells) {
-  // Erase a cell if it has energy bellow a threshold from the vector
-  auto it = aCells.begin();
-  while ((it = std::find_if(it, aCells.end(), [this](std::pair<const uint64_t, double>& p) {
-            return m_useAbsInFilter ? bool(std::abs(p.second) < m_filterThreshold * getNoiseRMSPerCell(p.first))
-                                    : bool(p.second < m_filterThreshold * getNoiseRMSPerCell(p.first));
-          })) != aCells.end()) {
-    aCells.erase(it++);
+void NoiseCaloCellsFromFileTool::addRandomCellNoise(std::span<const uint64_t> aCellIds, std::span<double> aEnergies,
+                                                    size_t aFirst) {
+  if (m_noiseSource.isEnabled()) {
+    auto noise = m_noiseSource.gaussians(aCellIds, aFirst);
+    for (size_t i = 0; i < aEnergies.size(); i++) {
+      aEnergies[i] += getNoiseRMSPerCell(aCellIds[i]) * noise[i];
+    }
+    return;
   }
+  for (size_t i = 0; i < aEnergies.size(); i++) {
+    aEnergies[i] += getNoiseRMSPerCell(aCellIds[i]) * m_gauss.shoot();
+  }
+}
+
+void NoiseCaloCellsFromFileTool::filterCellNoise(std::unordered_map<uint64_t, double>& aCells) {
+  // Erase the cells with energy below the threshold, in a single pass over the map
+  std::erase_if(aCells,
+                [this](const std::pair<const uint64_t, double>& p) { return isBelowThreshold(p.first, p.second); });
+}
+
+void NoiseCaloCellsFromFileTool::selectCells(std::span<const uint64_t> aCellIds, std::span<const double> aEnergies,
+                                             std::vector<uint32_t>& aSelected) {
+  k4::recCalo::compactIndices(aCellIds.size(), aSelected,
+                              [&](size_t i) { return !isBelowThreshold(aCellIds[i], aEnergies[i]); });
+}
+
+bool NoiseCaloCellsFromFileTool::isBelowThreshold(uint64_t aCellId, double aEnergy) {
+  return m_useAbsInFilter ? bool(std::abs(aEnergy) < m_filterThreshold * getNoiseRMSPerCell(aCellId))
+                          : bool(aEnergy < m_filterThreshold * getNoiseRMSPerCell(aCellId));
 }
 
 StatusCode NoiseCaloCellsFromFileTool::finalize() {
+  m_noiseSource.finalize();
   StatusCode sc = AlgTool::finalize();
   return sc;
 }
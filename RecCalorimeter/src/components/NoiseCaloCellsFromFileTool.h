@@ -20,6 +20,10 @@ class IGeoSvc;
 // Root
 class TH1F;
 
+// k4RecCalorimeter
+#include "RecCaloCommon/IDenseNoiseCaloCellsTool.h"
+#include "RecCaloCommon/NoiseSource.h"
+
 /** @class NoiseCaloCellsFromFileTool
  *
  *  Tool for calorimeter noise
@@ -32,7 +36,9 @@ class TH1F;
  *
  */
 
-class NoiseCaloCellsFromFileTool : public AlgTool, virtual public INoiseCaloCellsTool {
+class NoiseCaloCellsFromFileTool : public AlgTool,
+                                   virtual public INoiseCaloCellsTool,
+                                   virtual public IDenseNoiseCaloCellsTool {
 public:
   NoiseCaloCellsFromFileTool(const std::string& type, const std::string& name, const IInterface* parent);
   virtual ~NoiseCaloCellsFromFileTool() = default;
@@ -46,6 +52,17 @@ public:
   /** @brief Remove cells with energy bellow threshold*sigma from the vector of cells
    */
   virtual void filterCellNoise(std::unordered_map<uint64_t, double>& aCells) final;
+  /** @brief Add random noise to a block of cells stored in dense arrays
+   */
+  virtual void addRandomCellNoise(std::span<const uint64_t> aCellIds, std::span<double> aEnergies,
+                                  size_t aFirst) final;
+  /** @brief Select the cells with energy above threshold from dense arrays of cells, without modifying them
+   */
+  virtual void selectCells(std::span<const uint64_t> aCellIds, std::span<const double> aEnergies,
+                           std::vector<uint32_t>& aSelected) final;
+  /** @brief Check if the noise is drawn without the RndmGenSvc (counter-based generator or noise pool)
+   */
+  virtual bool isThreadSafe() const final { return m_noiseSource.isEnabled(); }
 
   /// Open file and read noise histograms in the memory
   StatusCode initNoiseFromFile();
@@ -53,6 +70,9 @@ public:
   double getNoiseRMSPerCell(uint64_t aCellID);
 
 private:
+  /// Filter condition shared by filterCellNoise and selectCells
+  bool isBelowThreshold(uint64_t aCellId, double aEnergy);
+
   /// Handle for tool to get cell positions
   ToolHandle<ICellPositionsTool> m_cellPositionsTool{"CellPositionsDummyTool", this};
 
@@ -97,6 +117,9 @@ private:
   /// Gaussian random number generator used for the generation of random noise hits
   Rndm::Numbers m_gauss;
 
+  /// Noise drawn independently of the RndmGenSvc (counter-based generator or noise pool)
+  k4::recCalo::NoiseSource m_noiseSource{this};
+
   /// Pointer to the geometry service
   ServiceHandle<IGeoSvc> m_geoSvc;
   /// PhiEta segmentation
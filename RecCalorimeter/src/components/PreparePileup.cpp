@@ -63,10 +63,13 @@ StatusCode PreparePileup::initialize() {
   }
   // Prepare histograms - 2D histograms per layer, abs(eta) on x-axis, energy in cell on y-axis
   for (uint i = 0; i < m_numLayers; i++) {
-    m_energyVsAbsEta.push_back(new TH2F((m_histogramName + std::to_string(i)).c_str(),
-                                        ("energy per cell vs fabs cell eta in layer " + std::to_string(i)).c_str(), 60,
-                                        0, 6.0, 5000, -1, m_maxEnergy));
-    if (m_histSvc->regHist("/rec/" + m_histogramName + std::to_string(i), m_energyVsAbsEta.back()).isFailure()) {
+    m_energyVsAbsEta.emplace_back().book(
+        new TH2F((m_histogramName + std::to_string(i)).c_str(),
+                 ("energy per cell vs fabs cell eta in layer " + std::to_string(i)).c_str(), 60, 0, 6.0, 5000, -1,
+                 m_maxEnergy),
+        m_histograms);
+    if (m_histSvc->regHist("/rec/" + m_histogramName + std::to_string(i), m_energyVsAbsEta.back().histogram())
+            .isFailure()) {
       error() << "Couldn't register hist" << endmsg;
       return StatusCode::FAILURE;
     }
@@ -82,27 +85,29 @@ StatusCode PreparePileup::initialize() {
     }
   }
   for (uint iCluster = 0; iCluster < m_etaSizes.size(); iCluster++) {
-    m_energyVsAbsEtaClusters.push_back(
+    m_energyVsAbsEtaClusters.emplace_back().book(
         new TH2F((m_histogramName + "_clusterEta" + std::to_string(m_etaSizes[iCluster]) + "Phi" +
                   std::to_string(m_phiSizes[iCluster]))
                      .c_str(),
                  ("energy per cluster #Delta#eta#times#Delta#varphi = " + std::to_string(m_etaSizes[iCluster]) +
                   "#times" + std::to_string(m_phiSizes[iCluster]) + " vs fabs centre-cell eta ")
                      .c_str(),
-                 60, 0, 6.0, 5000, -1, m_maxEnergy));
+                 60, 0, 6.0, 5000, -1, m_maxEnergy),
+        m_histograms);
     if (m_histSvc
             ->regHist("/rec/" + m_histogramName + "_clusterEta" + std::to_string(m_etaSizes[iCluster]) + "Phi" +
                           std::to_string(m_phiSizes[iCluster]),
-                      m_energyVsAbsEtaClusters.back())
+                      m_energyVsAbsEtaClusters.back().histogram())
             .isFailure()) {
       error() << "Couldn't register hist" << endmsg;
       return StatusCode::FAILURE;
     }
   }
-  m_energyVsAbsEtaClusterOptimised =
+  m_energyVsAbsEtaClusterOptimised.book(
       new TH2F((m_histogramName + "_optimisedCluster").c_str(), "energy per optimised cluster vs fabs centre-cell eta ",
-               60, 0, 6.0, 5000, -1, m_maxEnergy);
-  if (m_histSvc->regHist("/rec/" + m_histogramName + "_optimisedCluster", m_energyVsAbsEtaClusterOptimised)
+               60, 0, 6.0, 5000, -1, m_maxEnergy),
+      m_histograms);
+  if (m_histSvc->regHist("/rec/" + m_histogramName + "_optimisedCluster", m_energyVsAbsEtaClusterOptimised.histogram())
           .isFailure()) {
     error() << "Couldn't register hist" << endmsg;
     return StatusCode::FAILURE;
@@ -175,7 +180,7 @@ StatusCode PreparePileup::execute(const EventContext&) const {
                 << ". Filling the last histogram." << endmsg;
     }
     double cellEta = m_segmentation->eta(cID);
-    m_energyVsAbsEta[layerId]->Fill(fabs(cellEta), cellEnergy);
+    m_energyVsAbsEta[layerId].fill2D(fabs(cellEta), cellEnergy);
     // add energy of this cell to any optimised cluster where it is included
     if (!(m_nEtaFinal.size() == 0 && m_nPhiFinal.size() == 0)) {
       int etaId = m_decoder->get(cID, "eta");
@@ -202,7 +207,7 @@ StatusCode PreparePileup::execute(const EventContext&) const {
   double etaGridOffset = m_segmentation->offsetEta();
   for (int iEta = 0; iEta < m_nEtaTower; iEta++) {
     for (int iPhi = 0; iPhi < m_nPhiTower; iPhi++) {
-      m_energyVsAbsEtaClusterOptimised->Fill(fabs(iEta * etaGridSize + etaGridOffset), m_energyOptimised[iEta][iPhi]);
+      m_energyVsAbsEtaClusterOptimised.fill2D(fabs(iEta * etaGridSize + etaGridOffset), m_energyOptimised[iEta][iPhi]);
     }
   }
 
@@ -230,8 +235,8 @@ StatusCode PreparePileup::execute(const EventContext&) const {
       }
       // loop over all the phi slices
       for (int iPhi = 0; iPhi < m_nPhiTower; iPhi++) {
-        m_energyVsAbsEtaClusters[iCluster]->Fill(fabs(m_towerTool->eta(iEta)),
-                                                 sumWindow * cosh(fabs(m_towerTool->eta(iEta))));
+        m_energyVsAbsEtaClusters[iCluster].fill2D(fabs(m_towerTool->eta(iEta)),
+                                                  sumWindow * cosh(fabs(m_towerTool->eta(iEta))));
         // finish processing that window in phi, shift window to the next phi tower
         // substract first phi tower in current window
         sumWindow -= sumOverEta[phiNeighbour(iPhi - halfPhiWin)];
@@ -264,6 +269,8 @@ unsigned int PreparePileup::phiNeighbour(int aIPhi) const {
 }
 
 StatusCode PreparePileup::finalize() {
+  // add the fills of all threads to the histograms written by the histogram service
+  m_histograms.merge();
   // Fill 2D histogram per layer (sum of energy in all events per cell)
   for (const auto& cell : m_sumEnergyCellsMap) {
     double cellEnergy = cell.second;
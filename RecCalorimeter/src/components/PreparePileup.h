@@ -20,8 +20,13 @@ class IGeoSvc;
 
 #include "DDSegmentation/BitFieldCoder.h"
 
+// RecCaloCommon
+#include "RecCaloCommon/ThreadLocalHistogram.h"
+
+// std
+#include <deque>
+
 class TH2F;
-class TH1F;
 class ITHistSvc;
 
 /** @class PreparePileup
@@ -85,13 +90,15 @@ private:
   SmartIF<ITHistSvc> m_histSvc;
   /// Pointer to the geometry service
   SmartIF<IGeoSvc> m_geoSvc;
+  /// Histograms filled per thread, merged in finalize
+  k4::recCalo::ThreadLocalHistogram::Registry m_histograms;
   /// 2D histogram with abs(eta) on x-axis and energy per cell per event on y-axis
-  std::vector<TH2F*> m_energyVsAbsEta;
+  mutable std::deque<k4::recCalo::ThreadLocalHistogram> m_energyVsAbsEta;
   /// 2D histogram with abs(eta) on x-axis and energy per cell per file on y-axis
   std::vector<TH2F*> m_energyAllEventsVsAbsEta;
   /// 2D histogram with abs(eta) on x-axis and energy per cluster(s) per event on y-axis
-  std::vector<TH2F*> m_energyVsAbsEtaClusters;
-  TH2F* m_energyVsAbsEtaClusterOptimised;
+  mutable std::deque<k4::recCalo::ThreadLocalHistogram> m_energyVsAbsEtaClusters;
+  mutable k4::recCalo::ThreadLocalHistogram m_energyVsAbsEtaClusterOptimised;
 
   /// Maximum energy in the m_energyVsAbsEta histogram, in GeV
   Gaudi::Property<uint> m_maxEnergy{this, "maxEnergy", 20., "Maximum energy in the pile-up plot"};
@@ -5,6 +5,8 @@
 #include "TSystem.h"
 #include "TTree.h"
 
+#include "RecCaloCommon/CrosstalkMatrix.h"
+
 DECLARE_COMPONENT(ReadCaloCrosstalkMap)
 
 ReadCaloCrosstalkMap::ReadCaloCrosstalkMap(const std::string& type, const std::string& name, const IInterface* parent)
@@ -36,6 +38,24 @@ StatusCode ReadCaloCrosstalkMap::initialize() {
     error() << "File path: " << m_fileName.value() << endmsg;
     return StatusCode::FAILURE;
   }
+
+  // crosstalk matrix in CSR form, as written by CreateFCCeeCaloXTalkNeighbours
+  k4::recCalo::CrosstalkMatrix matrix;
+  if (matrix.load(m_fileName.value())) {
+    m_mapNeighbours.reserve(matrix.size());
+    m_mapCrosstalks.reserve(matrix.size());
+    for (size_t row = 0; row < matrix.size(); row++) {
+      auto neighbours = matrix.neighbours(row);
+      auto crosstalks = matrix.crosstalks(row);
+      m_mapNeighbours.emplace(matrix.cellIds()[row], std::vector<uint64_t>(neighbours.begin(), neighbours.end()));
+      m_mapCrosstalks.emplace(matrix.cellIds()[row], std::vector<double>(crosstalks.begin(), crosstalks.end()));
+    }
+    info() << "Crosstalk input (CSR): " << m_fileName.value() << endmsg;
+    info() << "Total number of cells = " << matrix.size() << ", number of crosstalk neighbours = " << matrix.entries()
+           << endmsg;
+    return StatusCode::SUCCESS;
+  }
+
   std::unique_ptr<TFile> xtalkFile(TFile::Open(m_fileName.value().c_str(), "READ"));
   if (xtalkFile->IsZombie()) {
     error() << "Unable to read the file with the crosstalk map!" << endmsg;
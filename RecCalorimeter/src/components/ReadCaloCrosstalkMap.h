@@ -15,6 +15,7 @@ class IGeoSvc;
  *  Tool that reads a ROOT file containing the TTree with branches "cellId", "list_crosstalk_neighbours" and
  *"list_crosstalks". This tools reads the tree, creates two maps, and allows a lookup of all crosstalk neighbours as
  *well as the corresponding crosstalk coefficients for a given cell.
+ *  The file can also be a crosstalk matrix in CSR form (see k4::recCalo::CrosstalkMatrix), recognised by its header.
  *
  *  @author Zhibo Wu
  */
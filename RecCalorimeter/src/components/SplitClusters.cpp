@@ -13,10 +13,13 @@
 #include "TH1F.h"
 #include "TH2F.h"
 #include "TLorentzVector.h"
+#include "TVector2.h"
 #include "TVector3.h"
 
 #include <algorithm>
+#include <cmath>
 #include <map>
+#include <numeric>
 #include <utility>
 #include <vector>
 
@@ -76,6 +79,92 @@ StatusCode SplitClusters::initialize() {
   return StatusCode::SUCCESS;
 }
 
+namespace {
+/// Flat state of one cluster during splitting, all arrays are indexed by the local cell index (position in hit list)
+struct SplitWorkspace {
+  std::vector<uint64_t> cellIDs;
+  std::vector<double> energies;
+  std::vector<int> types;
+  /// cell position (x, y, z) and energy
+  std::vector<TLorentzVector> positions;
+  /// pseudorapidity and azimuth of the cell positions, cached for the distance to the sub-cluster centres
+  std::vector<double> etas;
+  std::vector<double> phis;
+  /// index of the sub-cluster the cell is assigned to, -1 if not assigned
+  std::vector<int> owners;
+  /// local indices sorted by cellID, used to translate cellIDs into local indices
+  std::vector<uint> sortedByID;
+  /// neighbours within the cluster in CSR form, neighbours of cell i are
+  /// neighbourIndices[neighbourOffsets[i]] ... neighbourIndices[neighbourOffsets[i + 1] - 1]
+  std::vector<uint> neighbourOffsets;
+  std::vector<uint> neighbourIndices;
+  /// cells for which no neighbours are found in the neighbours map
+  std::vector<bool> noNeighbours;
+  /// four-vectors of the sub-clusters under construction
+  std::vector<TLorentzVector> clusterPositions;
+
+  void clear() {
+    cellIDs.clear();
+    energies.clear();
+    types.clear();
+    positions.clear();
+    etas.clear();
+    phis.clear();
+    owners.clear();
+    sortedByID.clear();
+    neighbourOffsets.clear();
+    neighbourIndices.clear();
+    noNeighbours.clear();
+    clusterPositions.clear();
+  }
+
+  /// Local index of the cell, -1 if the cell is not part of the cluster
+  int localIndex(uint64_t aCellId) const {
+    auto it = std::lower_bound(sortedByID.begin(), sortedByID.end(), aCellId,
+                               [this](uint lhs, uint64_t rhs) { return cellIDs[lhs] < rhs; });
+    if (it == sortedByID.end() || cellIDs[*it] != aCellId)
+      return -1;
+    return *it;
+  }
+};
+
+/// Same as TLorentzVector::DeltaR, with pseudorapidity and azimuth of the cell taken from the cache
+double deltaR(const TLorentzVector& aCluster, double aEta, double aPhi) {
+  double deta = aCluster.Eta() - aEta;
+  double dphi = TVector2::Phi_mpi_pi(aCluster.Phi() - aPhi);
+  return std::sqrt(deta * deta + dphi * dphi);
+}
+
+/** Add neighbours of a cell to the sub-cluster.
+ * Unassigned neighbours are added to the sub-cluster, neighbours assigned to a different sub-cluster are moved if they
+ * are closer (in deltaR) to the centre-of-gravity of this sub-cluster.
+ *   @param[in] aWs, the cluster workspace.
+ *   @param[in] aCell, the local index of the cell for which to find the neighbours.
+ *   @param[in] aCluster, the index of the current sub-cluster.
+ *   @param[out] aAdded, local indices of the cells added to the sub-cluster, appended.
+ */
+void addNeighbours(SplitWorkspace& aWs, uint aCell, int aCluster, std::vector<uint>& aAdded) {
+  for (uint k = aWs.neighbourOffsets[aCell]; k < aWs.neighbourOffsets[aCell + 1]; ++k) {
+    uint neighbour = aWs.neighbourIndices[k];
+    int otherCluster = aWs.owners[neighbour];
+    if (otherCluster < 0) {
+      aWs.clusterPositions[aCluster] += aWs.positions[neighbour];
+      aWs.owners[neighbour] = aCluster;
+      aAdded.push_back(neighbour);
+    } else if (otherCluster != aCluster) {
+      // test if the cell is closer to the current cluster
+      if (deltaR(aWs.clusterPositions[aCluster], aWs.etas[neighbour], aWs.phis[neighbour]) <=
+          deltaR(aWs.clusterPositions[otherCluster], aWs.etas[neighbour], aWs.phis[neighbour])) {
+        aAdded.push_back(neighbour);
+        aWs.clusterPositions[otherCluster] -= aWs.positions[neighbour];
+        aWs.clusterPositions[aCluster] += aWs.positions[neighbour];
+        aWs.owners[neighbour] = aCluster;
+      }
+    }
+  }
+}
+} // namespace
+
 StatusCode SplitClusters::execute(const EventContext&) const {
   // Get the input collection with Geant4 hits
   const edm4hep::ClusterCollection* clusters = m_clusters.get();
@@ -92,27 +181,29 @@ StatusCode SplitClusters::execute(const EventContext&) const {
   double totEnergyBefore = 0.;
   double totEnergyAfter = 0.;
 
+  // reused for all clusters of the event
+  SplitWorkspace ws;
+  std::vector<uint> cellsByEnergy;
+  std::vector<uint> newSeeds;
+  std::vector<std::vector<uint>> frontier;
+  std::vector<std::vector<uint>> nextFrontier;
+  std::vector<std::vector<uint>> subClusterCells;
+  std::vector<uint> leftOverCells;
+
   for (auto cluster : *clusters) {
     // sanity checks
     totEnergyBefore += cluster.getEnergy();
     totCellsBefore += cluster.hits_size();
 
-    std::map<uint64_t, int> cellsType;
-    std::vector<std::pair<uint64_t, double>> cellsEnergy;
-    std::map<uint64_t, TLorentzVector> cellsPosition;
-    // used later for new cluster building
-    std::map<uint, std::vector<std::pair<uint64_t, int>>> preClusterCollection;
-    std::map<uint, TLorentzVector> clusterPositions;
-
-    // number of new clusters
-    uint newClusters = 0;
-    std::vector<std::pair<uint64_t, double>> newSeeds;
+    ws.clear();
+    newSeeds.clear();
 
-    // Loop over cluster cells
+    // Loop over cluster cells and fill the local arrays
     for (auto it = cluster.hits_begin(); it != cluster.hits_end(); ++it) {
       auto cell = *it;
-      cellsType.emplace(cell.getCellID(), cell.getType());
-      cellsEnergy.push_back(std::make_pair(cell.getCellID(), cell.getEnergy()));
+      ws.cellIDs.push_back(cell.getCellID());
+      ws.energies.push_back(cell.getEnergy());
+      ws.types.push_back(cell.getType());
 
       // get cell position by cellID
       // identify calo system
@@ -129,48 +220,60 @@ StatusCode SplitClusters::execute(const EventContext&) const {
       } else
         warning() << "No cell positions tool found for system id " << systemId << ". " << endmsg;
 
-      cellsPosition.emplace(std::pair<uint64_t, TLorentzVector>(
-          cell.getCellID(), TLorentzVector(posCell.X(), posCell.Y(), posCell.Z(), cell.getEnergy())));
+      ws.positions.emplace_back(posCell.X(), posCell.Y(), posCell.Z(), cell.getEnergy());
+      ws.etas.push_back(ws.positions.back().Eta());
+      ws.phis.push_back(ws.positions.back().Phi());
       allCells.emplace(cell.getCellID(), cell.getType());
     }
+    const uint numCells = ws.cellIDs.size();
+    ws.owners.assign(numCells, -1);
+    ws.sortedByID.resize(numCells);
+    std::iota(ws.sortedByID.begin(), ws.sortedByID.end(), 0);
+    std::stable_sort(ws.sortedByID.begin(), ws.sortedByID.end(),
+                     [&ws](uint lhs, uint rhs) { return ws.cellIDs[lhs] < ws.cellIDs[rhs]; });
+
+    // resolve the neighbours within the cluster once
+    ws.neighbourOffsets.reserve(numCells + 1);
+    ws.neighbourOffsets.push_back(0);
+    ws.noNeighbours.assign(numCells, false);
+    for (uint iCell = 0; iCell < numCells; iCell++) {
+      const auto& neighboursVector = m_neighboursTool->neighbours(ws.cellIDs[iCell]);
+      ws.noNeighbours[iCell] = neighboursVector.empty();
+      for (auto nCellId : neighboursVector) {
+        int neighbour = ws.localIndex(nCellId);
+        if (neighbour >= 0)
+          ws.neighbourIndices.push_back(neighbour);
+      }
+      ws.neighbourOffsets.push_back(ws.neighbourIndices.size());
+    }
 
     // sort cells by energy
-    std::sort(cellsEnergy.begin(), cellsEnergy.end(),
-              [](const std::pair<uint64_t, double>& lhs, const std::pair<uint64_t, double>& rhs) {
-                return lhs.second < rhs.second;
-              });
+    cellsByEnergy.resize(numCells);
+    std::iota(cellsByEnergy.begin(), cellsByEnergy.end(), 0);
+    std::stable_sort(cellsByEnergy.begin(), cellsByEnergy.end(),
+                     [&ws](uint lhs, uint rhs) { return ws.energies[lhs] < ws.energies[rhs]; });
 
-    debug() << "..... with " << cellsEnergy.size() << " cells:" << endmsg;
+    debug() << "..... with " << numCells << " cells:" << endmsg;
 
     // loop through cells, find neighbouring cells with status "neighbour" (above 2nd topo-cluster threshold)
-    for (auto cell : cellsEnergy) {
+    for (auto iCell : cellsByEnergy) {
       // test if cell is seed
-      auto itCell = cellsType.find(cell.first);
-      auto fCell = *itCell;
-
-      if (itCell != cellsType.end() && fCell.second == 1 && cell.second > m_threshold) {
-
-        verbose() << "..... ... cell is seed type. " << fCell.second << endmsg;
+      if (ws.types[iCell] == 1 && ws.energies[iCell] > m_threshold) {
+        verbose() << "..... ... cell is seed type. " << ws.types[iCell] << endmsg;
         // start counting neighbours
         int countNeighbours = 0;
-        auto neighboursVector = m_neighboursTool->neighbours(fCell.first);
-        verbose() << "..... ... found " << neighboursVector.size() << " neighbours." << endmsg;
+        verbose() << "..... ... found " << ws.neighbourOffsets[iCell + 1] - ws.neighbourOffsets[iCell]
+                  << " neighbours in cluster." << endmsg;
         // test if neighbouring cells are of type 2, and lower energy
-        for (auto nCellId : neighboursVector) {
-          // check if neighbours are hit
-          auto itNeighbour = cellsType.find(nCellId);
-          auto fNeighbour = *itNeighbour;
+        for (uint k = ws.neighbourOffsets[iCell]; k < ws.neighbourOffsets[iCell + 1]; ++k) {
+          uint neighbour = ws.neighbourIndices[k];
           // if the neighbour is of type 2, count up
-          if (fNeighbour.second == 2) {
+          if (ws.types[neighbour] == 2) {
             countNeighbours++;
           }
           // if neighbour is seed, check energy
-          else if (fNeighbour.second == 1) {
-            auto fNeighbourEnergy = std::find_if(
-                cellsEnergy.begin(), cellsEnergy.end(),
-                [&nCellId](const std::pair<uint64_t, double>& elem) { return bool(elem.first == nCellId); });
-            auto fNEnergy = *fNeighbourEnergy;
-            if (fNEnergy.second > cell.second) {
+          else if (ws.types[neighbour] == 1) {
+            if (ws.energies[neighbour] > ws.energies[iCell]) {
               // checking next cell of cluster
               verbose() << "Neighbouring cell with higher energy found. " << endmsg;
               break;
@@ -184,160 +287,119 @@ StatusCode SplitClusters::execute(const EventContext&) const {
         if (countNeighbours > 4) {
           debug() << "..... ... found " << countNeighbours << " neighbouring, type 2 cells. " << endmsg;
           // collect cells to be used as seeds for new cluster
-          newSeeds.push_back(std::make_pair(cell.first, cell.second));
-          newClusters++;
+          newSeeds.push_back(iCell);
         } else {
-          verbose() << "..... cell with energy " << cell.second << ", does not have >4 neighbouring cells." << endmsg;
+          verbose() << "..... cell with energy " << ws.energies[iCell] << ", does not have >4 neighbouring cells."
+                    << endmsg;
         }
       }
     }
-    if (newClusters != newSeeds.size()) {
-      error() << "Number of new seeds not num found cells qualifying for sub-cluster!!! " << endmsg;
-    }
-    verbose() << "Elements in cells types before sub-cluster building: " << cellsType.size() << endmsg;
 
     // Build new clusters, if more than 2 new seeds have been found.
-    if (newClusters > 1) {
+    if (newSeeds.size() > 1) {
       totSplitClusters++;
+      const uint numSubClusters = newSeeds.size();
 
-      debug() << "..... split cluster into " << newSeeds.size() << ". " << endmsg;
+      debug() << "..... split cluster into " << numSubClusters << ". " << endmsg;
       debug() << "################################### " << endmsg;
       debug() << "##  Start building sub-clusters ###" << endmsg;
       debug() << "################################### " << endmsg;
 
-      // build clusters in multiple iterations
-      int iter = 0;
-      uint clusterID = clusters->size() + 1;
-      std::map<uint64_t, uint> clusterOfCell;
-      // map of clusterID to next neighbours vector to find next cells
-      std::map<uint, std::vector<std::vector<std::pair<uint64_t, uint>>>> mapVecNextNeighbours;
+      ws.clusterPositions.assign(numSubClusters, TLorentzVector());
+      frontier.resize(numSubClusters);
+      nextFrontier.resize(numSubClusters);
+      for (uint iSub = 0; iSub < numSubClusters; iSub++) {
+        frontier[iSub].clear();
+        nextFrontier[iSub].clear();
+      }
 
+      // build clusters in multiple iterations
       debug() << "Iteration 0: " << endmsg;
-      while (iter == 0) {
-        for (auto& seed : newSeeds) {
-          // start cluster with seed, add to all maps, erase from vector
-          clusterOfCell.emplace(seed.first, clusterID);
-
-          preClusterCollection[clusterID].reserve(cluster.hits_size());
-          clusterPositions.emplace(clusterID, cellsPosition[seed.first]);
-
-          debug() << "Number of cells in clusters before filling : " << clusterOfCell.size() << endmsg;
-          debug() << "Old Cluster (" << clusterID << ") position(x,y,z) / energy(GeV) : ("
-                  << clusterPositions[clusterID].X() << ", " << clusterPositions[clusterID].X() << ", "
-                  << clusterPositions[clusterID].X() << ") " << clusterPositions[clusterID].Energy() << " . " << endmsg;
-
-          // collect neighbouring cells has type, in parallel for each seed!!!
-          auto vec = SplitClusters::searchForNeighbours(seed.first, clusterID, cellsType, clusterOfCell, cellsPosition,
-                                                        clusterPositions);
-          std::vector<std::vector<std::pair<uint64_t, uint>>> vecVec;
-          vecVec.resize(1000); // number of maximum iterations
-          vecVec.insert(vecVec.begin(), vec);
-
-          mapVecNextNeighbours.emplace(clusterID, vecVec);
-
-          debug() << "Found " << mapVecNextNeighbours[clusterID][0].size() << " more neighbours.." << endmsg;
-          debug() << "Left cells in vector " << cellsType.size() << ". " << endmsg;
-          debug() << "New Cluster (" << clusterID << ") position(x,y,z) / energy(GeV) : ("
-                  << clusterPositions[clusterID].X() << ", " << clusterPositions[clusterID].X() << ", "
-                  << clusterPositions[clusterID].X() << ") " << clusterPositions[clusterID].Energy() << " . " << endmsg;
-          //
-          clusterID++;
+      for (uint iSub = 0; iSub < numSubClusters; iSub++) {
+        uint seed = newSeeds[iSub];
+        // start cluster with seed, unless it was already collected by a previous seed
+        if (ws.owners[seed] < 0)
+          ws.owners[seed] = iSub;
+        ws.clusterPositions[iSub] = ws.positions[seed];
+        if (ws.noNeighbours[seed]) {
+          error() << "No neighbours for cellID found! " << endmsg;
+          error() << "to cellID :  " << ws.cellIDs[seed] << endmsg;
+          error() << "Building of cluster is stopped due to missing id in neighbours map." << endmsg;
+          return StatusCode::FAILURE;
         }
-        iter++;
+        // collect neighbouring cells, in parallel for each seed!!!
+        addNeighbours(ws, seed, iSub, frontier[iSub]);
+        debug() << "Found " << frontier[iSub].size() << " more neighbours.." << endmsg;
       }
 
       debug() << "Start iteration: ";
-
-      while (iter > 0) {
+      int iter = 1;
+      bool foundNewNeighbours = true;
+      while (foundNewNeighbours) {
         // iterate for adding cells to clusters
         debug() << iter << endmsg;
-        bool foundNewNeighbours = false;
+        foundNewNeighbours = false;
         // loop through new clusters for every iteration
-        for (uint newCluster = 1; newCluster <= newSeeds.size(); newCluster++) {
-          clusterID = clusters->size() + newCluster;
+        for (uint iSub = 0; iSub < numSubClusters; iSub++) {
           // if neighbours have been found, continue...
-          if (mapVecNextNeighbours[clusterID][iter - 1].size() > 0) {
-            foundNewNeighbours = true;
-            debug() << mapVecNextNeighbours[clusterID][iter - 1].size()
-                    << ".. neighbours assigned to clusterId : " << clusterID << endmsg;
-            for (auto& id : mapVecNextNeighbours[clusterID][iter - 1]) {
-              if (id.first == 0) {
-                error() << "Building of cluster is stopped due to missing id in neighbours map." << endmsg;
-                return StatusCode::FAILURE;
-              }
-              if (id.second != clusterID) {
-                error() << "Building of cluster is stopped due to wrong cell id in neighbours map." << endmsg;
-                return StatusCode::FAILURE;
-              }
-              // find next neighbours
-              auto vec = SplitClusters::searchForNeighbours(id.first, clusterID, cellsType, clusterOfCell,
-                                                            cellsPosition, clusterPositions);
-              // add the next neighbours at end of already found neighbours in this round.
-              verbose() << "Size before additional vec : " << mapVecNextNeighbours[clusterID][iter].size() << endmsg;
-              mapVecNextNeighbours[clusterID][iter].reserve(mapVecNextNeighbours[clusterID][iter].size() + vec.size());
-              mapVecNextNeighbours[clusterID][iter].insert(mapVecNextNeighbours[clusterID][iter].end(),
-                                                           std::make_move_iterator(vec.begin()),
-                                                           std::make_move_iterator(vec.end()));
-              verbose() << "Size after additional vec : " << mapVecNextNeighbours[clusterID][iter].size() << endmsg;
+          if (frontier[iSub].empty())
+            continue;
+          foundNewNeighbours = true;
+          debug() << frontier[iSub].size() << ".. neighbours assigned to sub-cluster : " << iSub << endmsg;
+          for (auto iCell : frontier[iSub]) {
+            if (ws.noNeighbours[iCell]) {
+              error() << "No neighbours for cellID found! " << endmsg;
+              error() << "to cellID :  " << ws.cellIDs[iCell] << endmsg;
+              error() << "Building of cluster is stopped due to missing id in neighbours map." << endmsg;
+              return StatusCode::FAILURE;
             }
+            // find next neighbours
+            addNeighbours(ws, iCell, iSub, nextFrontier[iSub]);
           }
         }
-        iter++;
-        if (!foundNewNeighbours) {
-          debug() << "Stopped cluster building at iteration : " << iter - 1 << endmsg;
-          iter = -1;
+        for (uint iSub = 0; iSub < numSubClusters; iSub++) {
+          frontier[iSub].swap(nextFrontier[iSub]);
+          nextFrontier[iSub].clear();
         }
+        iter++;
       }
-      // TEST NEW CLUSTERS
-      uint allClusteredCells = 0;
-      for (auto i : clusterOfCell) {
-        allClusteredCells++;
-        preClusterCollection[i.second].push_back(std::make_pair(i.first, allCells[i.first]));
-        cellsType.erase(i.first);
+      debug() << "Stopped cluster building at iteration : " << iter - 1 << endmsg;
+
+      // collect cells of each sub-cluster, ordered by cellID
+      subClusterCells.resize(numSubClusters);
+      for (uint iSub = 0; iSub < numSubClusters; iSub++)
+        subClusterCells[iSub].clear();
+      leftOverCells.clear();
+      for (auto iCell : ws.sortedByID) {
+        if (ws.owners[iCell] < 0)
+          leftOverCells.push_back(iCell);
+        else
+          subClusterCells[ws.owners[iCell]].push_back(iCell);
       }
+
       // in case not all cells have been assigned to new cluster, fill into seperate cluster and mark them with cell
       // type=4.
-      if (allClusteredCells != cluster.hits_size()) {
-        warning() << "NUMBER OF CELLS BEFORE " << cluster.hits_size() << " AND AFTER CLUSTER SPLITTING (map) "
-                  << clusterOfCell.size() << "!!" << endmsg;
-        warning() << "Elements in cells types after sub-cluster building: " << cellsType.size() << endmsg;
+      if (!leftOverCells.empty()) {
+        warning() << "NUMBER OF CELLS BEFORE " << cluster.hits_size() << " AND AFTER CLUSTER SPLITTING "
+                  << numCells - leftOverCells.size() << "!!" << endmsg;
+        warning() << "Elements in cells types after sub-cluster building: " << leftOverCells.size() << endmsg;
 
         auto l_cluster = edmClusters->create();
         double posX = 0.;
         double posY = 0.;
         double posZ = 0.;
         double energy = 0.;
-        std::map<uint64_t, int>::iterator it;
-        for (it = cellsType.begin(); it != cellsType.end(); it++) {
+        for (auto iCell : leftOverCells) {
           totCellsAfter++;
-          dd4hep::DDSegmentation::CellID cID = it->first;
           auto newCell = edmClusterCells->create();
-          auto fNeighbourEnergy =
-              std::find_if(cellsEnergy.begin(), cellsEnergy.end(), [&cID](const std::pair<uint64_t, double>& elem) {
-                return bool(elem.first == uint64_t(cID));
-              });
-          auto fNEnergy = *fNeighbourEnergy;
-          newCell.setEnergy(fNEnergy.second);
-          newCell.setCellID(cID);
-          // get cell position by cellID
-          // identify calo system
-          auto systemId = m_decoder->get(cID, "system");
-          dd4hep::Position posCell;
-          if (systemId == 5) // ECAL BARREL system id
-            posCell = m_cellPositionsECalBarrelTool->xyzPosition(cID);
-          else if (systemId == 8) { // HCAL BARREL system id
-            if (m_noSegmentationHCalUsed)
-              posCell = m_cellPositionsHCalBarrelNoSegTool->xyzPosition(cID);
-            else {
-              posCell = m_cellPositionsHCalBarrelTool->xyzPosition(cID);
-            }
-          }
-          posX += posCell.X() * newCell.getEnergy();
-          posY += posCell.Y() * newCell.getEnergy();
-          posZ += posCell.Z() * newCell.getEnergy();
+          newCell.setEnergy(ws.energies[iCell]);
+          newCell.setCellID(ws.cellIDs[iCell]);
+          posX += ws.positions[iCell].X() * newCell.getEnergy();
+          posY += ws.positions[iCell].Y() * newCell.getEnergy();
+          posZ += ws.positions[iCell].Z() * newCell.getEnergy();
           // left over cells
           newCell.setType(4);
-          energy += fNEnergy.second;
+          energy += ws.energies[iCell];
         }
         l_cluster.setType(3);
         l_cluster.setEnergy(energy);
@@ -349,48 +411,25 @@ StatusCode SplitClusters::execute(const EventContext&) const {
       }
 
       // fill clusters into edm format
-      for (auto i : preClusterCollection) {
+      for (uint iSub = 0; iSub < numSubClusters; iSub++) {
         edm4hep::MutableCluster local_cluster;
         double posX = 0.;
         double posY = 0.;
         double posZ = 0.;
         double energy = 0.;
-        std::map<int, int> system;
 
-        for (auto pair : i.second) {
+        for (auto iCell : subClusterCells[iSub]) {
           totCellsAfter++;
-          dd4hep::DDSegmentation::CellID cID = pair.first;
-          // get CaloHit by cellID
+          uint64_t cID = ws.cellIDs[iCell];
           auto newCell = edmClusterCells->create();
-          auto fNeighbourEnergy =
-              std::find_if(cellsEnergy.begin(), cellsEnergy.end(), [&cID](const std::pair<uint64_t, double>& elem) {
-                return bool(elem.first == uint64_t(cID));
-              });
-          auto fNEnergy = *fNeighbourEnergy;
-          newCell.setEnergy(fNEnergy.second);
+          newCell.setEnergy(ws.energies[iCell]);
           newCell.setCellID(cID);
-          newCell.setType(pair.second);
-          energy += fNEnergy.second;
-
-          // get cell position by cellID
-          // identify calo system
-          auto systemId = m_decoder->get(cID, "system");
-          system[int(systemId)]++;
-          dd4hep::Position posCell;
-          if (systemId == 5) // ECAL BARREL system id
-            posCell = m_cellPositionsECalBarrelTool->xyzPosition(cID);
-          else if (systemId == 8) { // HCAL BARREL system id
-            if (m_noSegmentationHCalUsed)
-              posCell = m_cellPositionsHCalBarrelNoSegTool->xyzPosition(cID);
-            else {
-              posCell = m_cellPositionsHCalBarrelTool->xyzPosition(cID);
-            }
-          } else
-            warning() << "No cell positions tool found for system id " << systemId << ". " << endmsg;
+          newCell.setType(allCells[cID]);
+          energy += ws.energies[iCell];
 
-          posX += posCell.X() * newCell.getEnergy();
-          posY += posCell.Y() * newCell.getEnergy();
-          posZ += posCell.Z() * newCell.getEnergy();
+          posX += ws.positions[iCell].X() * newCell.getEnergy();
+          posY += ws.positions[iCell].Y() * newCell.getEnergy();
+          posZ += ws.positions[iCell].Z() * newCell.getEnergy();
 
           local_cluster.addToHits(newCell);
           auto check = allCells.erase(cID);
@@ -405,12 +444,8 @@ StatusCode SplitClusters::execute(const EventContext&) const {
         totEnergyAfter += energy;
         edmClusters->push_back(local_cluster);
       }
-      if (cellsType.size() > 0)
-        info() << "Not all cluster cells have been assigned. " << cellsType.size() << endmsg;
-
-      // clear maps
-      clusterOfCell.clear();
-      mapVecNextNeighbours.clear();
+      if (!leftOverCells.empty())
+        info() << "Not all cluster cells have been assigned. " << leftOverCells.size() << endmsg;
     }
 
     else {
@@ -428,13 +463,6 @@ StatusCode SplitClusters::execute(const EventContext&) const {
           error() << "Cell id is not deleted from map. " << endmsg;
       }
     }
-
-    // Clear maps and vectors
-    cellsType.clear();
-    cellsEnergy.clear();
-    cellsPosition.clear();
-    clusterPositions.clear();
-    preClusterCollection.clear();
   }
 
   // sanity checks per event
@@ -456,78 +484,4 @@ StatusCode SplitClusters::execute(const EventContext&) const {
   return StatusCode::SUCCESS;
 }
 
-std::vector<std::pair<uint64_t, uint>>
-SplitClusters::searchForNeighbours(const uint64_t aCellId, const uint aClusterID,
-                                   const std::map<uint64_t, int> aCellsType, std::map<uint64_t, uint>& aClusterOfCell,
-                                   std::map<uint64_t, TLorentzVector> aCellPosition,
-                                   std::map<uint, TLorentzVector>& aClusterPosition) const {
-  // Fill vector to be returned, next cell ids and cluster id for which neighbours are found
-  std::vector<std::pair<uint64_t, uint>> addedNeighbourIds;
-
-  // Retrieve cellIds of neighbours
-  auto neighboursVec = m_neighboursTool->neighbours(aCellId);
-  if (neighboursVec.size() == 0) {
-    error() << "No neighbours for cellID found! " << endmsg;
-    error() << "to cellID :  " << aCellId << endmsg;
-    error() << "in system:   " << m_decoder->get(aCellId, "system") << endmsg;
-    addedNeighbourIds.resize(0);
-    addedNeighbourIds.push_back(std::make_pair(0, 0));
-  } else {
-    verbose() << "For cluster: " << aClusterID << endmsg;
-    // loop over neighbours
-    for (auto& itr : neighboursVec) {
-      uint64_t neighbourID = itr;
-      // Find the neighbour in the Calo cells list
-      auto itAllCellTypes = aCellsType.find(neighbourID);
-      auto fCellType = *itAllCellTypes;
-      auto itAllUsedCells = aClusterOfCell.find(neighbourID);
-      auto fCellCluster = *itAllUsedCells;
-
-      // If cell has type.. is found in the list of clustered cells
-      if (itAllCellTypes != aCellsType.end()) {
-        verbose() << "Found neighbour with CellID: " << neighbourID << endmsg;
-        verbose() << "Neighbour is of cell type " << fCellType.second << ". " << endmsg;
-
-        // and is not assigned to a cluster
-        if (itAllUsedCells == aClusterOfCell.end()) {
-          verbose() << "Add neighbour to cluster " << aClusterID << endmsg;
-          // add neighbour to cells of cluster
-          aClusterPosition[aClusterID] += aCellPosition[neighbourID]; // add lorentz vector
-          aClusterOfCell.emplace(neighbourID, aClusterID);
-
-          addedNeighbourIds.push_back(std::make_pair(neighbourID, aClusterID));
-        }
-        // and is already assigned to cluster, check if its assigned to different clusterID
-        else if (itAllUsedCells != aClusterOfCell.end() && fCellCluster.second != aClusterID) {
-          uint clusterIDToMerge = fCellCluster.second;
-          verbose() << "This neighbour was found in cluster " << clusterIDToMerge << ", and cluster " << aClusterID
-                    << ". It will be evaluate which one has higher geomertrical significance!" << endmsg;
-          verbose() << "Distances to cluster core: "
-                    << aClusterPosition[clusterIDToMerge].DeltaR(aCellPosition[neighbourID])
-                    << ", and this cluster: " << aClusterPosition[aClusterID].DeltaR(aCellPosition[neighbourID])
-                    << endmsg;
-
-          // get distance of cell from cog of clusters, and test if the cell is closer to current cluster
-          if (aClusterPosition[aClusterID].DeltaR(aCellPosition[neighbourID]) <=
-              aClusterPosition[clusterIDToMerge].DeltaR(aCellPosition[neighbourID])) {
-            verbose() << "Neighbour is assigned to cluster1. " << endmsg;
-            addedNeighbourIds.push_back(std::make_pair(neighbourID, aClusterID));
-            // remove the cell from the other cluster
-            aClusterPosition[clusterIDToMerge] -= aCellPosition[neighbourID]; // remove lorentz vector
-            // add cell to correct cluster
-            aClusterPosition[aClusterID] += aCellPosition[neighbourID]; // add lorentz vector
-
-            aClusterOfCell[neighbourID] = aClusterID;
-          } else {
-            verbose() << "Neighbour stays assigned to cluster2. " << endmsg;
-            aClusterOfCell[neighbourID] = clusterIDToMerge;
-          }
-          // if the cell is assigned to current cluster.. nevermind.
-        }
-      }
-    }
-  }
-  return addedNeighbourIds;
-}
-
 StatusCode SplitClusters::finalize() { return Gaudi::Algorithm::finalize(); }
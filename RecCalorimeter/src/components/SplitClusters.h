@@ -47,6 +47,10 @@ class TLorentzVector;
  * (b) collect neighbouring cells for all clusters within same iteration
  * (c) if cell has been identified for two clusters, distance from the centre-of-gravity of thecluster is determined,
  * and the cell gets assigned to the closest cluster.
+ * The splitting works on flat per-cluster arrays: every cell of the cluster gets a local index (its position in the
+ * hit list) under which energy, position, type and sub-cluster owner are stored, and the neighbour relations within
+ * the cluster are resolved once into a CSR table. Each cell is therefore visited a fixed number of times, which keeps
+ * the splitting linear in the cluster size.
  * 3. finalisation:
  * (a) check of energy and number cells conservation
  * (b) write new collection of clusters
@@ -67,21 +71,6 @@ public:
 
   StatusCode initialize();
 
-  /** Search for neighbours and add them to preClusterCollection
-   * The
-   *   @param[in] aCellId, the cell ID for which to find the neighbours.
-   *   @param[in] aClusterID, the current cluster ID.
-   *   @param[in] aClusterOfCell, map of all cells->cluster.
-   *   @param[in] aCellPosition, map of cellID to cell position.
-   *   @param[in] aClusterPositions, map of clusterID to four vector of cluster.
-   *   return vector of pairs with cellID and clusterID.
-   */
-  std::vector<std::pair<uint64_t, uint>> searchForNeighbours(const uint64_t aCellId, uint aClusterID,
-                                                             const std::map<uint64_t, int> aCellType,
-                                                             std::map<uint64_t, uint>& aClusterOfCell,
-                                                             std::map<uint64_t, TLorentzVector> aCellPosition,
-                                                             std::map<uint, TLorentzVector>& aClusterPositions) const;
-
   StatusCode execute(const EventContext&) const;
 
   StatusCode finalize();
@@ -1,10 +1,20 @@
 #include "TopoCaloNoisyCells.h"
 
+// std
+#include <filesystem>
+#include <span>
+#include <tuple>
+#include <vector>
+
 #include "TBranch.h"
 #include "TFile.h"
 #include "TSystem.h"
 #include "TTree.h"
 
+// RecCaloCommon
+#include "RecCaloCommon/Hash.h"
+#include "RecCaloCommon/NoiseLevelTable.h"
+
 DECLARE_COMPONENT(TopoCaloNoisyCells)
 
 TopoCaloNoisyCells::TopoCaloNoisyCells(const std::string& type, const std::string& name, const IInterface* parent)
@@ -19,6 +29,25 @@ StatusCode TopoCaloNoisyCells::initialize() {
       return sc;
   }
 
+  // the binary table is read if it was written from the same file, otherwise it is written after reading the TTree
+  uint64_t key = sourceKey();
+  if (!m_tableFileName.empty()) {
+    k4::recCalo::NoiseLevelTable table;
+    if (table.load(m_tableFileName, key)) {
+      m_map.reserve(table.size());
+      for (size_t i = 0; i < table.size(); i++) {
+        m_map.emplace(table.cellIds()[i], std::make_pair(table.noiseRMS()[i], table.noiseOffset()[i]));
+      }
+      info() << "Read the noise of " << table.size() << " cells from the table " << m_tableFileName.value() << endmsg;
+      return StatusCode::SUCCESS;
+    }
+    std::error_code errorCode;
+    if (std::filesystem::exists(m_tableFileName.value(), errorCode)) {
+      info() << "The noise table " << m_tableFileName.value() << " was not written from " << m_fileName.value()
+             << " or is corrupted, it is written again" << endmsg;
+    }
+  }
+
   // Check if file exists
   if (m_fileName.empty()) {
     error() << "Name of the file with the noisy cells not provided!" << endmsg;
@@ -55,9 +84,40 @@ StatusCode TopoCaloNoisyCells::initialize() {
   delete tree;
   inFile->Close();
 
+  if (!m_tableFileName.empty()) {
+    std::vector<uint64_t> cellIds;
+    cellIds.reserve(m_map.size());
+    for (const auto& cell : m_map) {
+      cellIds.push_back(cell.first);
+    }
+    k4::recCalo::NoiseLevelTable table;
+    table.addCells(std::move(cellIds),
+                   [this](std::span<const uint64_t> aIds, std::span<double> aRMS, std::span<double> aOffset) {
+                     for (size_t i = 0; i < aIds.size(); i++) {
+                       std::tie(aRMS[i], aOffset[i]) = m_map.at(aIds[i]);
+                     }
+                   });
+    table.evaluate(1, m_map.size());
+    if (table.save(m_tableFileName, key)) {
+      info() << "Noise table written to " << m_tableFileName.value() << endmsg;
+    } else {
+      warning() << "Unable to write the noise table to " << m_tableFileName.value() << endmsg;
+    }
+  }
+
   return StatusCode::SUCCESS;
 }
 
+uint64_t TopoCaloNoisyCells::sourceKey() const {
+  // the file is identified by its name, size and modification time, rather than by hashing its content
+  std::error_code errorCode;
+  uint64_t key = k4::recCalo::hashCombine(0, m_fileName.value());
+  key = k4::recCalo::hashCombineValue(key, uint64_t(std::filesystem::file_size(m_fileName.value(), errorCode)));
+  key = k4::recCalo::hashCombineValue(
+      key, int64_t(std::filesystem::last_write_time(m_fileName.value(), errorCode).time_since_epoch().count()));
+  return key;
+}
+
 StatusCode TopoCaloNoisyCells::finalize() { return AlgTool::finalize(); }
 
 double TopoCaloNoisyCells::getNoiseRMSPerCell(uint64_t aCellId) { return m_map[aCellId].first; }
@@ -14,6 +14,9 @@ class IGeoSvc;
  *
  *  Tool that reads a ROOT file containing the TTree with branchs "cellId", "noiseLevel", and "noiseOffset".
  *  This tool reads the tree, creates a map, and allows a lookup of noise level and mean noise of a cell, by its cellID.
+ *  If tableFileName is set, the noise is read from this binary table (see k4::recCalo::NoiseLevelTable), much faster
+ *  to read than the TTree. The table is keyed by the name, size and modification time of fileName: if it does not
+ *  exist yet or was written from another file, it is written from the TTree for the next jobs.
  *
  *  @author Coralie Neubueser
  */
@@ -41,9 +44,17 @@ public:
   virtual double getNoiseOffsetPerCell(uint64_t aCellId) final;
 
 private:
+  /// Key of fileName, stored in the binary table
+  uint64_t sourceKey() const;
+
   /// Name
   Gaudi::Property<std::string> m_fileName{this, "fileName",
                                           "/afs/cern.ch/user/c/cneubuse/public/FCChh/cellNoise_map_segHcal.root"};
+  /// Binary table of the noise, read instead of the TTree if it was written from fileName, from the TTree otherwise
+  Gaudi::Property<std::string> m_tableFileName{
+      this, "tableFileName", "",
+      "Binary noise table read instead of the TTree of fileName, or written from it if missing or written from another "
+      "file (none if empty)"};
   std::unordered_map<uint64_t, std::pair<double, double>> m_map;
 };
 
@@ -6,6 +6,10 @@
 #include "detectorCommon/DetUtils_k4geo.h"
 #include "k4Interface/IGeoSvc.h"
 
+// k4RecCalorimeter
+#include "RecCaloCommon/CellListCache.h"
+#include "RecCaloCommon/Hash.h"
+
 DECLARE_COMPONENT(TubeLayerPhiEtaCaloTool)
 
 TubeLayerPhiEtaCaloTool::TubeLayerPhiEtaCaloTool(const std::string& type, const std::string& name,
@@ -38,6 +42,19 @@ StatusCode TubeLayerPhiEtaCaloTool::initialize() {
 StatusCode TubeLayerPhiEtaCaloTool::finalize() { return AlgTool::finalize(); }
 
 StatusCode TubeLayerPhiEtaCaloTool::prepareEmptyCells(std::unordered_map<uint64_t, double>& aCells) {
+  if (m_cellCacheDirectory.empty()) {
+    return enumerateCells(aCells);
+  }
+  uint64_t key = k4::recCalo::CellListCache::geometryKey(*m_geoSvc->getDetector(), m_readoutName);
+  key = k4::recCalo::hashCombine(key, type());
+  key = k4::recCalo::CellListCache::combine(key, {&m_readoutName, &m_activeVolumeName, &m_activeFieldName,
+                                                  &m_fieldNames, &m_fieldValues, &m_activeVolumesNumber});
+  k4::recCalo::CellListCache cache(m_cellCacheDirectory, m_readoutName, key);
+  return cache.prepareEmptyCells(aCells, m_validateCellCache, msgStream(),
+                                 [this](std::unordered_map<uint64_t, double>& cells) { return enumerateCells(cells); });
+}
+
+StatusCode TubeLayerPhiEtaCaloTool::enumerateCells(std::unordered_map<uint64_t, double>& aCells) {
   // Get the total number of active volumes in the geometry
   auto highestVol = gGeoManager->GetTopVolume();
   unsigned int numLayers;
@@ -19,6 +19,15 @@
 #include "TString.h"
 #include "TVector3.h"
 
+// std
+#include <algorithm>
+#include <limits>
+#include <span>
+
+// TBB
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
 DECLARE_COMPONENT(AugmentClustersFCCee)
 
 AugmentClustersFCCee::AugmentClustersFCCee(const std::string& name, ISvcLocator* svcLoc)
@@ -28,14 +37,13 @@ AugmentClustersFCCee::AugmentClustersFCCee(const std::string& name, ISvcLocator*
 }
 
 void AugmentClustersFCCee::PrintDebugMessage(MsgStream stream, const std::string& text) const {
-  if (debugIter < m_maxDebugPrint) {
+  // the clusters may be processed concurrently, each message takes its own iteration
+  const uint iter = debugIter++;
+  if (iter < m_maxDebugPrint) {
     stream << text << endmsg;
-    debugIter++;
-  } else if (debugIter == m_maxDebugPrint) {
+  } else if (iter == m_maxDebugPrint) {
     stream << "Maximum number of messages reached, suppressing further output" << endmsg;
-    debugIter++;
-  } else
-    debugIter++;
+  }
 }
 
 StatusCode AugmentClustersFCCee::initialize() {
@@ -113,9 +121,28 @@ StatusCode AugmentClustersFCCee::initialize() {
     }
   }
 
+  // resolve the fields of the cellIDs once, and the position of the layers of each system in the per-layer sums
+  m_systemDecoding.clear();
+  m_numLayersTotal = 0;
+  for (size_t k = 0; k < m_readoutNames.size(); k++) {
+    dd4hep::DDSegmentation::BitFieldCoder* decoder =
+        m_geoSvc->getDetector()->readout(m_readoutNames[k]).idSpec().decoder();
+    SystemDecoding system;
+    system.systemID = m_systemIDs[k];
+    system.systemField = &(*decoder)["system"];
+    system.layerField = &(*decoder)[m_layerFieldNames[k]];
+    system.thetaField = &(*decoder)[m_thetaFieldNames[k]];
+    system.moduleField = &(*decoder)[m_moduleFieldNames[k]];
+    system.startPosition = m_numLayersTotal;
+    m_systemDecoding.push_back(system);
+    m_numLayersTotal += m_numLayers[k];
+  }
+  m_scratch.clear();
+
   // initialise the list of metadata for the clusters
   // append to the metadata of the input clusters (if any)
   std::vector<std::string> showerShapeDecorations = m_inShapeParameterHandle.get({});
+  const size_t numInputShapeParameters = showerShapeDecorations.size();
   for (size_t k = 0; k < m_detectorNames.size(); k++) {
     const char* detector = m_detectorNames[k].c_str();
     for (unsigned layer = 0; layer < m_numLayers[k]; layer++) {
@@ -145,41 +172,128 @@ StatusCode AugmentClustersFCCee::initialize() {
   showerShapeDecorations.push_back("ncells"); // number of cells in cluster with E>0
 
   m_showerShapeHandle.put(showerShapeDecorations);
+  m_numShapeParameters = showerShapeDecorations.size() - numInputShapeParameters;
+
+  if (m_numThreads != 1) {
+    m_arena.initialize(m_numThreads > 0 ? int(m_numThreads) : tbb::task_arena::automatic);
+    info() << "Clusters processed concurrently on " << m_arena.max_concurrency() << " threads" << endmsg;
+  }
 
   return StatusCode::SUCCESS;
 }
 
-// for all cells in a certain layer: vec A is theta_id, vec B is E_cell
-// make a 1D projection to theta: sum up the E_cell over modules with the same theta_id
-// then sort the theta vec (for finding theta neighbors), update the E vec simultaneously
-// return a pair of vectors: theta_id (in ascending order) and E (summed over modules)
-std::pair<std::vector<int>, std::vector<double>> MergeSumAndSort(const std::vector<int>& A,
-                                                                 const std::vector<double>& B) {
-  std::unordered_map<int, double> elementSum;
-  // merge the same elements in vec A and sum up the corresponding elements in vec B
-  for (size_t i = 0; i < A.size(); i++) {
-    elementSum[A[i]] += B[i];
+namespace {
+// for all cells in a certain layer: aIds is theta_id (or module_id), aEnergies is E_cell
+// make a 1D projection to theta: sum up the E_cell over modules with the same theta_id, in ascending order of theta_id
+// (for finding theta neighbors), and fill the zero energy bins every aStep IDs between the first and last theta_id
+void BuildProfile(std::span<const int> aIds, std::span<const double> aEnergies, int aStep,
+                  std::vector<std::pair<int, double>>& aCells, std::vector<int>& aProfileIds,
+                  std::vector<double>& aProfileEnergies) {
+  aCells.clear();
+  for (size_t i = 0; i < aIds.size(); i++) {
+    aCells.emplace_back(aIds[i], aEnergies[i]);
   }
-  std::vector<int> A_new;
-  std::vector<double> B_new;
-  // re-build vec A and vec B from elementSum
-  for (const auto& entry : elementSum) {
-    A_new.push_back(entry.first);
-    B_new.push_back(entry.second);
+  // stable, so that the cells of a bin are summed in their order in the cluster
+  std::stable_sort(aCells.begin(), aCells.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+  aProfileIds.clear();
+  aProfileEnergies.clear();
+  if (aCells.empty()) {
+    return;
   }
-  std::vector<int> vec_1(A_new.size());
-  std::vector<double> vec_2(B_new.size());
-  std::vector<size_t> indices(A_new.size());
-  for (size_t i = 0; i < indices.size(); ++i) {
-    indices[i] = i;
+  int emptyBin = aCells.front().first;
+  for (size_t i = 0; i < aCells.size();) {
+    const int id = aCells[i].first;
+    for (; emptyBin < id; emptyBin += aStep) {
+      aProfileIds.push_back(emptyBin);
+      aProfileEnergies.push_back(0.);
+    }
+    if (emptyBin == id) {
+      emptyBin += aStep;
+    }
+    double energy = 0.;
+    for (; i < aCells.size() && aCells[i].first == id; i++) {
+      energy += aCells[i].second;
+    }
+    aProfileIds.push_back(id);
+    aProfileEnergies.push_back(energy);
   }
-  // sort the theta vec, update the E vec simultaneously
-  std::sort(indices.begin(), indices.end(), [&](size_t a, size_t b) { return A_new[a] < A_new[b]; });
-  for (size_t i = 0; i < indices.size(); ++i) {
-    vec_1[i] = A_new[indices[i]];
-    vec_2[i] = B_new[indices[i]];
+}
+
+// E and ID of 1st and 2nd local max in a 1D profile, and E of minimum between them
+struct ProfileMaxima {
+  size_t numMaxima = 0;
+  double E_Max = 0.;
+  double E_secMax = 0.;
+  double E_Min = 0.;
+  int Max_id = 0;
+  int secMax_id = 0;
+};
+
+// find the local maxima (bins with more energy than their neighbours, a single bin if its energy is positive) and
+// keep the two highest ones, the first one in the profile in case of equal energies
+ProfileMaxima FindMaxima(std::span<const int> aIds, std::span<const double> aEnergies) {
+  ProfileMaxima maxima;
+  const size_t n = aEnergies.size();
+  size_t index_Max = 0;
+  size_t index_secMax = 0;
+  double E_secMax = -std::numeric_limits<double>::max();
+  for (size_t i = 0; i < n; i++) {
+    bool isLocalMax = (n == 1) ? aEnergies[i] > 0.
+                               : (i == 0 || aEnergies[i] > aEnergies[i - 1]) &&
+                                     (i == n - 1 || aEnergies[i] > aEnergies[i + 1]);
+    if (!isLocalMax) {
+      continue;
+    }
+    if (maxima.numMaxima == 0 || aEnergies[i] > maxima.E_Max) {
+      if (maxima.numMaxima > 0) {
+        E_secMax = maxima.E_Max;
+        index_secMax = index_Max;
+      }
+      maxima.E_Max = aEnergies[i];
+      index_Max = i;
+    } else if (aEnergies[i] > E_secMax) {
+      E_secMax = aEnergies[i];
+      index_secMax = (aEnergies[i] == maxima.E_Max) ? index_Max : i;
+    }
+    maxima.numMaxima++;
+  }
+
+  if (maxima.numMaxima == 0) {
+    return maxima;
+  }
+  maxima.Max_id = aIds[index_Max];
+  if (maxima.numMaxima < 2) {
+    maxima.secMax_id = maxima.Max_id;
+    return maxima;
+  }
+  maxima.E_secMax = E_secMax;
+  maxima.secMax_id = aIds[index_secMax];
+  // find the E_min inside the ID range of E_Max and E_secMax, the profile is sorted in ascending order of ID
+  maxima.E_Min = std::numeric_limits<double>::max();
+  for (size_t i = 0; i < n; i++) {
+    if (aIds[i] > std::min(maxima.Max_id, maxima.secMax_id) && aIds[i] < std::max(maxima.Max_id, maxima.secMax_id) &&
+        aEnergies[i] < maxima.E_Min) {
+      maxima.E_Min = aEnergies[i];
+    }
+  }
+  if (maxima.E_Min > 1e12)
+    maxima.E_Min = 0.; // check E_Min
+  return maxima;
+}
+} // namespace
+
+AugmentClustersFCCee::ShapeScratch::ShapeScratch(size_t aNumLayers)
+    : sumEnLayer(aNumLayers), maxCellEnergyInLayer(aNumLayers), sumThetaLayer(aNumLayers), sumPhiLayer(aNumLayers),
+      sumWeightLayer(aNumLayers), theta2_E_layer(aNumLayers), theta_E_layer(aNumLayers), module2_E_layer(aNumLayers),
+      module_E_layer(aNumLayers), layerOffsets(aNumLayers + 1), layerFill(aNumLayers + 1) {}
+
+void AugmentClustersFCCee::ShapeScratch::clear() {
+  cells.clear();
+  for (auto* sums : {&sumEnLayer, &maxCellEnergyInLayer, &sumThetaLayer, &sumPhiLayer, &sumWeightLayer, &theta2_E_layer,
+                     &theta_E_layer, &module2_E_layer, &module_E_layer}) {
+    std::fill(sums->begin(), sums->end(), 0.);
   }
-  return std::make_pair(vec_1, vec_2);
+  std::fill(layerOffsets.begin(), layerOffsets.end(), 0);
 }
 
 StatusCode AugmentClustersFCCee::finalize() { return Gaudi::Algorithm::finalize(); }
@@ -190,765 +304,424 @@ StatusCode AugmentClustersFCCee::execute([[maybe_unused]] const EventContext& ev
   // create the new output collection
   edm4hep::ClusterCollection* outClusters = m_outClusters.createAndPut();
 
-  // total number of layers
-  size_t numLayersTotal = 0;
-  for (size_t i = 0; i < m_numLayers.size(); ++i) {
-    numLayersTotal += m_numLayers[i];
+  // calculate the shape parameters of all clusters, each thread with its own scratch memory reused for its clusters
+  const size_t numClusters = inClusters->size();
+  std::vector<float> shapeParameters(numClusters * m_numShapeParameters);
+  auto computeClusters = [&](size_t aBegin, size_t aEnd) {
+    ShapeScratch& scratch = m_scratch.local();
+    for (size_t i = aBegin; i < aEnd; i++) {
+      computeShapeParameters((*inClusters)[i], scratch,
+                             std::span<float>(shapeParameters).subspan(i * m_numShapeParameters, m_numShapeParameters));
+    }
+  };
+  if (m_numThreads != 1 && numClusters > 1) {
+    m_arena.execute([&] {
+      tbb::parallel_for(tbb::blocked_range<size_t>(0, numClusters), [&](const tbb::blocked_range<size_t>& aRange) {
+        computeClusters(aRange.begin(), aRange.end());
+      });
+    });
+  } else {
+    computeClusters(0, numClusters);
   }
 
-  // loop over the clusters, clone them, and calculate the shape parameters to store with them
-  for (const auto& cluster : *inClusters) {
-    // clone original cluster
-    auto newCluster = cluster.clone();
+  // clone the clusters and store their shape parameters, in the order of the input collection
+  for (size_t i = 0; i < numClusters; i++) {
+    auto newCluster = (*inClusters)[i].clone();
     outClusters->push_back(newCluster);
+    for (size_t j = 0; j < m_numShapeParameters; j++) {
+      newCluster.addToShapeParameters(shapeParameters[i * m_numShapeParameters + j]);
+    }
+  }
 
-    // loop over all cells to:
-    // - calculate the cluster invariant mass
-    // - calculate the energy deposited in each layer
-    // - find out the energy of the cells with largest energy in each layer
-    // - find out if cluster is around -pi..pi transition and/or max module .. 0 transition
-    double E(0.0);
-    TLorentzVector p4cl(0.0, 0.0, 0.0, 0.0);
-    unsigned int nCells(0);
-    std::vector<double> sumEnLayer(numLayersTotal, 0.);
-    std::vector<double> maxCellEnergyInLayer(numLayersTotal, 0.);
-    double phiMin = 9999.;
-    double phiMax = -9999.;
-    int module_id_Min = 9999;
-    int module_id_Max = -9999;
-
-    // loop over each system/readout
-    int startPositionToFill = 0;
-    for (size_t k = 0; k < m_readoutNames.size(); k++) {
-      if (k > 0)
-        startPositionToFill += m_numLayers[k - 1];
-      int systemID = m_systemIDs[k];
-      std::string layerField = m_layerFieldNames[k];
-      std::string moduleField = m_moduleFieldNames[k];
-      std::string readoutName = m_readoutNames[k];
-      dd4hep::DDSegmentation::BitFieldCoder* decoder = m_geoSvc->getDetector()->readout(readoutName).idSpec().decoder();
-
-      // loop over the cells to get E_layer, E_cluster, max and min phi of cluster cells
-      for (auto cell = newCluster.hits_begin(); cell != newCluster.hits_end(); cell++) {
-        dd4hep::DDSegmentation::CellID cID = cell->getCellID();
-
-        // skip cells with wrong system ID
-        int sysId = decoder->get(cID, "system");
-        if (sysId != systemID)
-          continue;
-
-        // retrieve layer and module ID
-        uint layer = decoder->get(cID, layerField);
-        int module_id = decoder->get(cID, moduleField);
-
-        // retrieve cell energy, update sum of cell energies per layer, total energy, and max cell energy
-        double eCell = cell->getEnergy();
-        sumEnLayer[layer + startPositionToFill] += eCell;
-        E += eCell;
-        if (maxCellEnergyInLayer[layer + startPositionToFill] < eCell)
-          maxCellEnergyInLayer[layer + startPositionToFill] = eCell;
-
-        // compute phi and module of cell to determine min/max phi and module ID of cluster
-        TVector3 v = TVector3(cell->getPosition().x, cell->getPosition().y, cell->getPosition().z);
-        double phi = v.Phi();
-        if (phi < phiMin)
-          phiMin = phi;
-        if (phi > phiMax)
-          phiMax = phi;
-        if (module_id > module_id_Max)
-          module_id_Max = module_id;
-        if (module_id < module_id_Min)
-          module_id_Min = module_id;
-
-        // add cell 4-momentum to cluster 4-momentum
-        TVector3 pCell = v * (eCell / v.Mag());
-        TLorentzVector p4cell(pCell.X(), pCell.Y(), pCell.Z(), eCell);
-        p4cl += p4cell;
-        nCells++;
-      } // end of loop over cells
-    } // end of loop over system / readout
-
-    // any number close to two pi should do, because if a cluster contains
-    // the -pi<->pi transition, phiMin should be close to -pi and phiMax close to pi
-    bool isClusterPhiNearPi = false;
-    if (phiMax - phiMin > 6.)
-      isClusterPhiNearPi = true;
-
-    debug() << "phiMin, phiMax : " << phiMin << " " << phiMax << endmsg;
-    debug() << "Cluster is near phi=pi : " << isClusterPhiNearPi << endmsg;
-
-    bool isResetModuleID = false;
-    // near the 1535..0 transition, reset module ID
-    if (module_id_Max - module_id_Min > nModules[0] * .9)
-      isResetModuleID = true;
-
-    // calculate the theta positions with log(E) weighting in each layer
-    // for phi use standard E weighting
-    std::vector<double> sumThetaLayer;
-    std::vector<double> sumPhiLayer;
-    std::vector<double> sumWeightLayer;
-    sumThetaLayer.assign(numLayersTotal, 0);
-    sumPhiLayer.assign(numLayersTotal, 0);
-    sumWeightLayer.assign(numLayersTotal, 0);
-
-    // vectors for photon/pi0 discrimination
-    // vectors to calculate theta/module width vs layer - using all cells
-    std::vector<double> theta2_E_layer(numLayersTotal, 0.);
-    std::vector<double> theta_E_layer(numLayersTotal, 0.);
-    std::vector<double> module2_E_layer(numLayersTotal, 0.);
-    std::vector<double> module_E_layer(numLayersTotal, 0.);
-
-    // E, theta and module ID of cells in each layer
-    std::vector<std::vector<double>> vec_E_cell_layer(numLayersTotal, std::vector<double>());
-    std::vector<std::vector<int>> vec_theta_cell_layer(numLayersTotal, std::vector<int>());
-    std::vector<std::vector<int>> vec_module_cell_layer(numLayersTotal, std::vector<int>());
-
-    // E and theta of 1st and 2nd local max in 1D theta profile, and E of minimum between them
-    std::vector<double> E_cell_Max(numLayersTotal, 0.);
-    std::vector<double> E_cell_secMax(numLayersTotal, 0.);
-    std::vector<int> E_cell_Max_theta(numLayersTotal, 0.);
-    std::vector<int> E_cell_secMax_theta(numLayersTotal, 0.);
-    std::vector<double> E_cell_Min(numLayersTotal, std::numeric_limits<double>::max());
-
-    // E and theta of 1st and 2nd local max in 1D module profile, and E of minimum between them
-    std::vector<double> E_cell_vs_phi_Max(numLayersTotal, 0.);
-    std::vector<double> E_cell_vs_phi_secMax(numLayersTotal, 0.);
-    std::vector<int> E_cell_vs_phi_Max_module(numLayersTotal, 0.);
-    std::vector<int> E_cell_vs_phi_secMax_module(numLayersTotal, 0.);
-    std::vector<double> E_cell_vs_phi_Min(numLayersTotal, std::numeric_limits<double>::max());
-
-    // theta/module width using all cells
-    std::vector<double> width_theta(numLayersTotal, 0.);
-    std::vector<double> width_module(numLayersTotal, 0.);
-    // theta width using only cells within deltaThetaBin = +-1, +-2, +-3, +-4
-    std::vector<double> width_theta_3Bin(numLayersTotal, 0.);
-    std::vector<double> width_theta_5Bin(numLayersTotal, 0.);
-    std::vector<double> width_theta_7Bin(numLayersTotal, 0.);
-    std::vector<double> width_theta_9Bin(numLayersTotal, 0.);
-
-    // E_fr_side_N, (E around maxE +- N bins) / (E around maxE +- 1 bins) - 1.
-    std::vector<double> E_fr_side_pm2(numLayersTotal, 0.);
-    std::vector<double> E_fr_side_pm3(numLayersTotal, 0.);
-    std::vector<double> E_fr_side_pm4(numLayersTotal, 0.);
-
-    // (Emax - E2ndmax)/(Emax + E2ndmax) where 2nd max must be a local maximum
-    std::vector<double> Ratio_E_max_2ndmax(numLayersTotal, 0.);
-    // (E2ndmax - Emin) where Emin is the energy with minimum energy in the theta range defined by 1st and 2nd (local)
-    // max
-    std::vector<double> Delta_E_2ndmax_min(numLayersTotal, 0.);
-    // (Emax - E2ndmax)/(Emax + E2ndmax) where 2nd max must be a local maximum - in phi profile
-    std::vector<double> Ratio_E_max_2ndmax_vs_phi(numLayersTotal, 0.);
-    // (E2ndmax - Emin) where Emin is the energy with minimum energy in the module range defined by 1st and 2nd (local)
-    // max
-    std::vector<double> Delta_E_2ndmax_min_vs_phi(numLayersTotal, 0.);
-
-    // loop over each system/readout
-    startPositionToFill = 0;
-    // rather than a loop over the systems, could first determine systemID
-    // from cellID, match it against the systemIDs and skip cell if match not found
-    // can do it in a separate PR
-    for (size_t k = 0; k < m_readoutNames.size(); k++) {
-      if (k > 0)
-        startPositionToFill += m_numLayers[k - 1];
-      int systemID = m_systemIDs[k];
-      std::string layerField = m_layerFieldNames[k];
-      std::string thetaField = m_thetaFieldNames[k];
-      std::string moduleField = m_moduleFieldNames[k];
-      std::string readoutName = m_readoutNames[k];
-      dd4hep::DDSegmentation::BitFieldCoder* decoder = m_geoSvc->getDetector()->readout(readoutName).idSpec().decoder();
-
-      // loop over the cells
-      for (auto cell = newCluster.hits_begin(); cell != newCluster.hits_end(); cell++) {
-        dd4hep::DDSegmentation::CellID cID = cell->getCellID();
-        int sysId = decoder->get(cID, "system");
-        if (sysId != systemID)
-          continue;
-        uint layer = decoder->get(cID, layerField);
-        int theta_id = decoder->get(cID, thetaField);
-        int module_id = decoder->get(cID, moduleField);
-
-        double eCell = cell->getEnergy();
-        double weightLog =
-            std::max(0., m_thetaRecalcLayerWeights[k][layer] + log(eCell / sumEnLayer[layer + startPositionToFill]));
-        TVector3 v = TVector3(cell->getPosition().x, cell->getPosition().y, cell->getPosition().z);
-        double theta = v.Theta();
-        double phi = v.Phi();
-
-        // for clusters that are around the -pi<->pi transition, we want to avoid averaging
-        // over phi values that might differ by 2pi. in that case, for cells with negative
-        // phi we add two pi, so that we average phi values all close to pi
-        if (isClusterPhiNearPi && phi < 0.) {
-          phi += TMath::TwoPi();
-        }
-        if (systemID == systemID_EMB && isResetModuleID && module_id > nModules[k] / 2) {
-          module_id -= nModules[k]; // transition near 1535..0, reset the module ID
-        }
+  return StatusCode::SUCCESS;
+}
 
-        if (m_thetaRecalcLayerWeights[k][layer] < 0)
-          sumThetaLayer[layer + startPositionToFill] += (eCell * theta);
-        else
-          sumThetaLayer[layer + startPositionToFill] += (weightLog * theta);
-        sumWeightLayer[layer + startPositionToFill] += weightLog;
-        sumPhiLayer[layer + startPositionToFill] += (eCell * phi);
-
-        // do pi0/photon shape var only for EMB
-        if (m_do_photon_shapeVar && systemID == systemID_EMB) {
-          // E, theta_id, and module_id of cells in layer
-          vec_E_cell_layer[layer + startPositionToFill].push_back(eCell);
-          vec_theta_cell_layer[layer + startPositionToFill].push_back(theta_id);
-          vec_module_cell_layer[layer + startPositionToFill].push_back(module_id);
-          // sum them for width in theta/module calculation
-          if (m_do_widthTheta_logE_weights) {
-            theta2_E_layer[layer + startPositionToFill] += theta_id * theta_id * weightLog;
-            theta_E_layer[layer + startPositionToFill] += theta_id * weightLog;
-          } else {
-            theta2_E_layer[layer + startPositionToFill] += theta_id * theta_id * eCell;
-            theta_E_layer[layer + startPositionToFill] += theta_id * eCell;
-          }
-          module2_E_layer[layer + startPositionToFill] += module_id * module_id * eCell;
-          module_E_layer[layer + startPositionToFill] += module_id * eCell;
-        }
-      } // end of loop over cells
-    } // end of loop over each system / readout
-
-    // local maxima (could be more than one) and the corresponding theta
-    std::vector<std::pair<std::vector<int>, std::vector<double>>> theta_E_pair;
-    std::vector<std::vector<double>> local_E_Max(numLayersTotal, std::vector<double>());
-    std::vector<std::vector<int>> local_E_Max_theta(numLayersTotal, std::vector<int>());
-
-    startPositionToFill = 0;
-    for (size_t k = 0; k < m_readoutNames.size(); k++) {
-      if (!m_do_photon_shapeVar)
-        break;
-      if (m_systemIDs[k] != systemID_EMB)
-        continue; // do pi0/photon shape var only for EMB
-      if (k > 0)
-        startPositionToFill += m_numLayers[k - 1];
-      // loop over layers
-      for (unsigned layer = 0; layer < m_numLayers[k]; layer++) {
-        // in case there's no cell in this layer (sometimes in layer 0)
-        if (vec_E_cell_layer[layer + startPositionToFill].empty()) {
-          vec_E_cell_layer[layer + startPositionToFill].push_back(0);
-          vec_theta_cell_layer[layer + startPositionToFill].push_back(0);
-          vec_module_cell_layer[layer + startPositionToFill].push_back(0);
-        }
-        auto result = MergeSumAndSort(vec_theta_cell_layer[layer + startPositionToFill],
-                                      vec_E_cell_layer[layer + startPositionToFill]);
-
-        // fill the zero energy cells in 1D theta-E profile
-        for (int i = result.first.front(); i <= result.first.back();
-             i += nMergedThetaCells[layer + startPositionToFill]) {
-          if (std::find(result.first.begin(), result.first.end(), i) == result.first.end()) {
-            auto it = std::lower_bound(result.first.begin(), result.first.end(), i);
-            int idx = it - result.first.begin();
-            result.first.insert(it, i);
-            result.second.insert(result.second.begin() + idx, 0);
-          }
-        }
-        theta_E_pair.push_back(result);
-
-        // loop over theta IDs to find the local E maxima
-        for (size_t i = 0; i < theta_E_pair[layer + startPositionToFill].second.size(); i++) {
-          // std::cout << i << " " << theta_E_pair[layer+startPositionToFill].first[i] << " " <<
-          // theta_E_pair[layer+startPositionToFill].second[i] << std::endl;
-          if ((i == 0 && theta_E_pair[layer + startPositionToFill].second[i] >
-                             theta_E_pair[layer + startPositionToFill].second[i + 1]) ||
-              (i == theta_E_pair[layer + startPositionToFill].second.size() - 1 &&
-               theta_E_pair[layer + startPositionToFill].second[i] >
-                   theta_E_pair[layer + startPositionToFill].second[i - 1]) ||
-              (i != 0 && i != (theta_E_pair[layer + startPositionToFill].second.size() - 1) &&
-               theta_E_pair[layer + startPositionToFill].second[i] >
-                   theta_E_pair[layer + startPositionToFill].second[i - 1] &&
-               theta_E_pair[layer + startPositionToFill].second[i] >
-                   theta_E_pair[layer + startPositionToFill].second[i + 1])) {
-            local_E_Max[layer + startPositionToFill].push_back(theta_E_pair[layer + startPositionToFill].second[i]);
-            local_E_Max_theta[layer + startPositionToFill].push_back(
-                theta_E_pair[layer + startPositionToFill].first[i]);
-          }
-        } // end of loop over theta IDs
-
-        if (local_E_Max[layer + startPositionToFill].empty()) {
-          E_cell_Max[layer + startPositionToFill] = 0.;
-          E_cell_secMax[layer + startPositionToFill] = 0.;
-          E_cell_Max_theta[layer + startPositionToFill] = 0.;
-          E_cell_secMax_theta[layer + startPositionToFill] = 0.;
-          E_cell_Min[layer + startPositionToFill] = 0.;
-        } else if (local_E_Max[layer + startPositionToFill].size() < 2) {
-          E_cell_Max[layer + startPositionToFill] = local_E_Max[layer + startPositionToFill][0];
-          E_cell_secMax[layer + startPositionToFill] = 0.;
-          E_cell_Max_theta[layer + startPositionToFill] = local_E_Max_theta[layer + startPositionToFill][0];
-          E_cell_secMax_theta[layer + startPositionToFill] = local_E_Max_theta[layer + startPositionToFill][0];
-          E_cell_Min[layer + startPositionToFill] = 0.;
-        } else {
-          std::vector<double> sortedVec = local_E_Max[layer + startPositionToFill];
-          // move the top 2 max to the beginning
-          std::partial_sort(sortedVec.begin(), sortedVec.begin() + 2, sortedVec.end(), std::greater<double>());
-          E_cell_Max[layer + startPositionToFill] = sortedVec[0];
-          E_cell_secMax[layer + startPositionToFill] = sortedVec[1];
-          // get the corresponding theta IDs
-          auto it_Max = std::find(local_E_Max[layer + startPositionToFill].begin(),
-                                  local_E_Max[layer + startPositionToFill].end(), sortedVec[0]);
-          int index_Max = std::distance(local_E_Max[layer + startPositionToFill].begin(), it_Max);
-          auto it_secMax = std::find(local_E_Max[layer + startPositionToFill].begin(),
-                                     local_E_Max[layer + startPositionToFill].end(), sortedVec[1]);
-          int index_secMax = std::distance(local_E_Max[layer + startPositionToFill].begin(), it_secMax);
-          E_cell_Max_theta[layer + startPositionToFill] = local_E_Max_theta[layer + startPositionToFill][index_Max];
-          E_cell_secMax_theta[layer + startPositionToFill] =
-              local_E_Max_theta[layer + startPositionToFill][index_secMax];
-          // find the E_min inside the theta range of E_cell_Max and E_cell_secMax
-          // the theta_E_pair are sorted in ascending order of thetaID
-          for (size_t i = 0; i < theta_E_pair[layer + startPositionToFill].second.size(); i++) {
-            if ((theta_E_pair[layer + startPositionToFill].first[i] >
-                 std::min(E_cell_Max_theta[layer + startPositionToFill],
-                          E_cell_secMax_theta[layer + startPositionToFill])) &&
-                (theta_E_pair[layer + startPositionToFill].first[i] <
-                 std::max(E_cell_Max_theta[layer + startPositionToFill],
-                          E_cell_secMax_theta[layer + startPositionToFill])) &&
-                (theta_E_pair[layer + startPositionToFill].second[i] < E_cell_Min[layer + startPositionToFill])) {
-              E_cell_Min[layer + startPositionToFill] = theta_E_pair[layer + startPositionToFill].second[i];
-            }
-          }
-        }
-        if (E_cell_Min[layer + startPositionToFill] > 1e12)
-          E_cell_Min[layer + startPositionToFill] = 0.; // check E_cell_Min
-      } // end of loop over layers
+void AugmentClustersFCCee::computeShapeParameters(const edm4hep::Cluster& aCluster, ShapeScratch& aScratch,
+                                                  std::span<float> aShapeParameters) const {
+  aScratch.clear();
+  auto& sumEnLayer = aScratch.sumEnLayer;
+  auto& maxCellEnergyInLayer = aScratch.maxCellEnergyInLayer;
+  auto& sumThetaLayer = aScratch.sumThetaLayer;
+  auto& sumPhiLayer = aScratch.sumPhiLayer;
+  auto& sumWeightLayer = aScratch.sumWeightLayer;
+  auto& theta2_E_layer = aScratch.theta2_E_layer;
+  auto& theta_E_layer = aScratch.theta_E_layer;
+  auto& module2_E_layer = aScratch.module2_E_layer;
+  auto& module_E_layer = aScratch.module_E_layer;
+  // the shape parameters are written in the order of the metadata
+  size_t iShape = 0;
+  auto addToShapeParameters = [&](float aValue) { aShapeParameters[iShape++] = aValue; };
+
+  // single loop over all cells to:
+  // - decode the cells and calculate their theta and phi
+  // - calculate the cluster invariant mass
+  // - calculate the energy deposited in each layer
+  // - find out the energy of the cells with largest energy in each layer
+  // - find out if cluster is around -pi..pi transition and/or max module .. 0 transition
+  double E(0.0);
+  TLorentzVector p4cl(0.0, 0.0, 0.0, 0.0);
+  unsigned int nCells(0);
+  double phiMin = 9999.;
+  double phiMax = -9999.;
+  int module_id_Min = 9999;
+  int module_id_Max = -9999;
+
+  for (auto cell = aCluster.hits_begin(); cell != aCluster.hits_end(); cell++) {
+    dd4hep::DDSegmentation::CellID cID = cell->getCellID();
+
+    // skip cells with wrong system ID
+    unsigned k = 0;
+    while (k < m_systemDecoding.size() && m_systemDecoding[k].systemField->value(cID) != m_systemDecoding[k].systemID) {
+      k++;
+    }
+    if (k == m_systemDecoding.size())
+      continue;
+    const SystemDecoding& system = m_systemDecoding[k];
+
+    // retrieve layer, theta and module ID
+    uint layer = system.layerField->value(cID);
+    if (layer >= m_numLayers[k]) {
+      PrintDebugMessage(warning(), "Layer " + std::to_string(layer) + " of cell " + std::to_string(cID) +
+                                       " is out of range, cell ignored");
+      continue;
     }
+    unsigned index = layer + system.startPosition;
+    int theta_id = system.thetaField->value(cID);
+    int module_id = system.moduleField->value(cID);
+
+    // retrieve cell energy, update sum of cell energies per layer, total energy, and max cell energy
+    double eCell = cell->getEnergy();
+    sumEnLayer[index] += eCell;
+    E += eCell;
+    if (maxCellEnergyInLayer[index] < eCell)
+      maxCellEnergyInLayer[index] = eCell;
+
+    // compute phi and module of cell to determine min/max phi and module ID of cluster
+    TVector3 v = TVector3(cell->getPosition().x, cell->getPosition().y, cell->getPosition().z);
+    double phi = v.Phi();
+    if (phi < phiMin)
+      phiMin = phi;
+    if (phi > phiMax)
+      phiMax = phi;
+    if (module_id > module_id_Max)
+      module_id_Max = module_id;
+    if (module_id < module_id_Min)
+      module_id_Min = module_id;
+
+    // add cell 4-momentum to cluster 4-momentum
+    TVector3 pCell = v * (eCell / v.Mag());
+    TLorentzVector p4cell(pCell.X(), pCell.Y(), pCell.Z(), eCell);
+    p4cl += p4cell;
+    nCells++;
+
+    aScratch.cells.push_back({k, index, theta_id, module_id, eCell, v.Theta(), phi});
+    // count the cells of each layer for the pi0/photon shape var (only for EMB)
+    if (m_do_photon_shapeVar && system.systemID == systemID_EMB)
+      aScratch.layerOffsets[index + 1]++;
+  } // end of loop over cells
+
+  // any number close to two pi should do, because if a cluster contains
+  // the -pi<->pi transition, phiMin should be close to -pi and phiMax close to pi
+  bool isClusterPhiNearPi = false;
+  if (phiMax - phiMin > 6.)
+    isClusterPhiNearPi = true;
+
+  debug() << "phiMin, phiMax : " << phiMin << " " << phiMax << endmsg;
+  debug() << "Cluster is near phi=pi : " << isClusterPhiNearPi << endmsg;
+
+  bool isResetModuleID = false;
+  // near the 1535..0 transition, reset module ID
+  if (module_id_Max - module_id_Min > nModules[0] * .9)
+    isResetModuleID = true;
+
+  // group the cells of each layer for the pi0/photon shape var
+  if (m_do_photon_shapeVar) {
+    for (size_t index = 0; index < m_numLayersTotal; index++) {
+      aScratch.layerOffsets[index + 1] += aScratch.layerOffsets[index];
+    }
+    aScratch.layerFill.assign(aScratch.layerOffsets.begin(), aScratch.layerOffsets.end());
+    aScratch.layerEnergies.resize(aScratch.layerOffsets.back());
+    aScratch.layerThetaIds.resize(aScratch.layerOffsets.back());
+    aScratch.layerModuleIds.resize(aScratch.layerOffsets.back());
+  }
 
-    // local maxima of E vs phi (could be more than one) and the corresponding module
-    std::vector<std::pair<std::vector<int>, std::vector<double>>> module_E_pair;
-    std::vector<std::vector<double>> local_E_Max_vs_phi(numLayersTotal, std::vector<double>());
-    std::vector<std::vector<int>> local_E_Max_vs_phi_module(numLayersTotal, std::vector<int>());
-
-    startPositionToFill = 0;
-    for (size_t k = 0; k < m_readoutNames.size(); k++) {
-      if (!m_do_photon_shapeVar)
-        break;
-      if (m_systemIDs[k] != systemID_EMB)
-        continue; // do pi0/photon shape var only for EMB
-      if (k > 0)
-        startPositionToFill += m_numLayers[k - 1];
-      // loop over layers
-      for (unsigned layer = 0; layer < m_numLayers[k]; layer++) {
-        auto result_2 = MergeSumAndSort(vec_module_cell_layer[layer + startPositionToFill],
-                                        vec_E_cell_layer[layer + startPositionToFill]);
-        // fill the zero energy cells in 1D module-E profile
-        for (int i = result_2.first.front(); i <= result_2.first.back();
-             i += nMergedModules[layer + startPositionToFill]) {
-          if (std::find(result_2.first.begin(), result_2.first.end(), i) == result_2.first.end()) {
-            auto it = std::lower_bound(result_2.first.begin(), result_2.first.end(), i);
-            int idx = it - result_2.first.begin();
-            result_2.first.insert(it, i);
-            result_2.second.insert(result_2.second.begin() + idx, 0);
-          }
-        }
-        module_E_pair.push_back(result_2);
-
-        // loop over module IDs to find the local E maxima
-        for (size_t i = 0; i < module_E_pair[layer + startPositionToFill].second.size(); i++) {
-          // std::cout << i << " " << module_E_pair[layer+startPositionToFill].first[i] << " " <<
-          // module_E_pair[layer+startPositionToFill].second[i] << std::endl;
-          if ((i == 0 && module_E_pair[layer + startPositionToFill].second[i] >
-                             module_E_pair[layer + startPositionToFill].second[i + 1]) ||
-              (i == module_E_pair[layer + startPositionToFill].second.size() - 1 &&
-               module_E_pair[layer + startPositionToFill].second[i] >
-                   module_E_pair[layer + startPositionToFill].second[i - 1]) ||
-              (i != 0 && i != (module_E_pair[layer + startPositionToFill].second.size() - 1) &&
-               module_E_pair[layer + startPositionToFill].second[i] >
-                   module_E_pair[layer + startPositionToFill].second[i - 1] &&
-               module_E_pair[layer + startPositionToFill].second[i] >
-                   module_E_pair[layer + startPositionToFill].second[i + 1])) {
-            local_E_Max_vs_phi[layer + startPositionToFill].push_back(
-                module_E_pair[layer + startPositionToFill].second[i]);
-            local_E_Max_vs_phi_module[layer + startPositionToFill].push_back(
-                module_E_pair[layer + startPositionToFill].first[i]);
-          }
-        } // end of loop over module IDs
-
-        if (local_E_Max_vs_phi[layer + startPositionToFill].empty()) {
-          E_cell_vs_phi_Max[layer + startPositionToFill] = 0.;
-          E_cell_vs_phi_secMax[layer + startPositionToFill] = 0.;
-          E_cell_vs_phi_Max_module[layer + startPositionToFill] = 0;
-          E_cell_vs_phi_secMax_module[layer + startPositionToFill] = 0;
-          E_cell_vs_phi_Min[layer + startPositionToFill] = 0.;
-        } else if (local_E_Max_vs_phi[layer + startPositionToFill].size() < 2) {
-          E_cell_vs_phi_Max[layer + startPositionToFill] = local_E_Max_vs_phi[layer + startPositionToFill][0];
-          E_cell_vs_phi_secMax[layer + startPositionToFill] = 0.;
-          E_cell_vs_phi_Max_module[layer + startPositionToFill] =
-              local_E_Max_vs_phi_module[layer + startPositionToFill][0];
-          E_cell_vs_phi_secMax_module[layer + startPositionToFill] = 0;
-          E_cell_vs_phi_Min[layer + startPositionToFill] = 0.;
-        } else {
-          std::vector<double> sortedVec = local_E_Max_vs_phi[layer + startPositionToFill];
-          // move the top 2 max to the beginning
-          std::partial_sort(sortedVec.begin(), sortedVec.begin() + 2, sortedVec.end(), std::greater<double>());
-          E_cell_vs_phi_Max[layer + startPositionToFill] = sortedVec[0];
-          E_cell_vs_phi_secMax[layer + startPositionToFill] = sortedVec[1];
-          // get the corresponding module IDs
-          auto it_Max = std::find(local_E_Max_vs_phi[layer + startPositionToFill].begin(),
-                                  local_E_Max_vs_phi[layer + startPositionToFill].end(), sortedVec[0]);
-          int index_Max = std::distance(local_E_Max_vs_phi[layer + startPositionToFill].begin(), it_Max);
-          auto it_secMax = std::find(local_E_Max_vs_phi[layer + startPositionToFill].begin(),
-                                     local_E_Max_vs_phi[layer + startPositionToFill].end(), sortedVec[1]);
-          int index_secMax = std::distance(local_E_Max_vs_phi[layer + startPositionToFill].begin(), it_secMax);
-          E_cell_vs_phi_Max_module[layer + startPositionToFill] =
-              local_E_Max_vs_phi_module[layer + startPositionToFill][index_Max];
-          E_cell_vs_phi_secMax_module[layer + startPositionToFill] =
-              local_E_Max_vs_phi_module[layer + startPositionToFill][index_secMax];
-          // find the E_min inside the module range of E_cell_Max and E_cell_secMax
-          for (size_t i = 0; i < module_E_pair[layer + startPositionToFill].second.size(); i++) {
-            if ((module_E_pair[layer + startPositionToFill].first[i] >
-                 std::min(E_cell_vs_phi_Max_module[layer + startPositionToFill],
-                          E_cell_vs_phi_secMax_module[layer + startPositionToFill])) &&
-                (module_E_pair[layer + startPositionToFill].first[i] <
-                 std::max(E_cell_vs_phi_Max_module[layer + startPositionToFill],
-                          E_cell_vs_phi_secMax_module[layer + startPositionToFill])) &&
-                (module_E_pair[layer + startPositionToFill].second[i] <
-                 E_cell_vs_phi_Min[layer + startPositionToFill])) {
-              E_cell_vs_phi_Min[layer + startPositionToFill] = module_E_pair[layer + startPositionToFill].second[i];
-            }
-          }
-        }
-        if (E_cell_vs_phi_Min[layer + startPositionToFill] > 1e12)
-          E_cell_vs_phi_Min[layer + startPositionToFill] = 0.; // check E_cell_Min
-      } // end of loop over layers
+  // loop over the decoded cells to calculate the theta positions with log(E) weighting in each layer
+  // for phi use standard E weighting
+  for (const CellShape& cell : aScratch.cells) {
+    const unsigned k = cell.system;
+    const unsigned layer = cell.layer - m_systemDecoding[k].startPosition;
+    const int systemID = m_systemIDs[k];
+    int module_id = cell.module_id;
+
+    double eCell = cell.energy;
+    double weightLog = std::max(0., m_thetaRecalcLayerWeights[k][layer] + log(eCell / sumEnLayer[cell.layer]));
+    double phi = cell.phi;
+
+    // for clusters that are around the -pi<->pi transition, we want to avoid averaging
+    // over phi values that might differ by 2pi. in that case, for cells with negative
+    // phi we add two pi, so that we average phi values all close to pi
+    if (isClusterPhiNearPi && phi < 0.) {
+      phi += TMath::TwoPi();
+    }
+    if (systemID == systemID_EMB && isResetModuleID && module_id > nModules[k] / 2) {
+      module_id -= nModules[k]; // transition near 1535..0, reset the module ID
     }
 
-    // save energy and theta/phi positions per layer in shape parameters
-    startPositionToFill = 0;
-    for (size_t k = 0; k < m_readoutNames.size(); k++) {
-      if (k > 0)
-        startPositionToFill += m_numLayers[k - 1];
-
-      int systemID = m_systemIDs[k];
-      // loop over layers
-      for (unsigned layer = 0; layer < m_numLayers[k]; layer++) {
-        // theta
-        if (m_thetaRecalcLayerWeights[k][layer] < 0) {
-          if (sumEnLayer[layer + startPositionToFill] != 0.0) {
-            sumThetaLayer[layer + startPositionToFill] /= sumEnLayer[layer + startPositionToFill];
-          } else {
-            sumThetaLayer[layer + startPositionToFill] = 0.;
-          }
-        } else {
-          if (sumWeightLayer[layer + startPositionToFill] != 0.0) {
-            sumThetaLayer[layer + startPositionToFill] /= sumWeightLayer[layer + startPositionToFill];
-          } else {
-            sumThetaLayer[layer + startPositionToFill] = 0.;
-          }
-        }
+    if (m_thetaRecalcLayerWeights[k][layer] < 0)
+      sumThetaLayer[cell.layer] += (eCell * cell.theta);
+    else
+      sumThetaLayer[cell.layer] += (weightLog * cell.theta);
+    sumWeightLayer[cell.layer] += weightLog;
+    sumPhiLayer[cell.layer] += (eCell * phi);
+
+    // do pi0/photon shape var only for EMB
+    if (m_do_photon_shapeVar && systemID == systemID_EMB) {
+      // E, theta_id, and module_id of cells in layer
+      size_t position = aScratch.layerFill[cell.layer]++;
+      aScratch.layerEnergies[position] = eCell;
+      aScratch.layerThetaIds[position] = cell.theta_id;
+      aScratch.layerModuleIds[position] = module_id;
+      // sum them for width in theta/module calculation
+      if (m_do_widthTheta_logE_weights) {
+        theta2_E_layer[cell.layer] += cell.theta_id * cell.theta_id * weightLog;
+        theta_E_layer[cell.layer] += cell.theta_id * weightLog;
+      } else {
+        theta2_E_layer[cell.layer] += cell.theta_id * cell.theta_id * eCell;
+        theta_E_layer[cell.layer] += cell.theta_id * eCell;
+      }
+      module2_E_layer[cell.layer] += module_id * module_id * eCell;
+      module_E_layer[cell.layer] += module_id * eCell;
+    }
+  } // end of loop over cells
 
-        // phi
+  // save energy and theta/phi positions per layer in shape parameters
+  for (size_t k = 0; k < m_readoutNames.size(); k++) {
+    const size_t startPositionToFill = m_systemDecoding[k].startPosition;
+
+    int systemID = m_systemIDs[k];
+    // loop over layers
+    for (unsigned layer = 0; layer < m_numLayers[k]; layer++) {
+      // theta
+      if (m_thetaRecalcLayerWeights[k][layer] < 0) {
         if (sumEnLayer[layer + startPositionToFill] != 0.0) {
-          sumPhiLayer[layer + startPositionToFill] /= sumEnLayer[layer + startPositionToFill];
+          sumThetaLayer[layer + startPositionToFill] /= sumEnLayer[layer + startPositionToFill];
         } else {
-          sumPhiLayer[layer + startPositionToFill] = 0.;
+          sumThetaLayer[layer + startPositionToFill] = 0.;
         }
-        // make sure phi is in range -pi..pi
-        if (sumPhiLayer[layer + startPositionToFill] > TMath::Pi())
-          sumPhiLayer[layer + startPositionToFill] -= TMath::TwoPi();
-
-        newCluster.addToShapeParameters(sumEnLayer[layer + startPositionToFill] / E); // E fraction of layer
-        newCluster.addToShapeParameters(sumThetaLayer[layer + startPositionToFill]);
-        newCluster.addToShapeParameters(sumPhiLayer[layer + startPositionToFill]);
+      } else {
+        if (sumWeightLayer[layer + startPositionToFill] != 0.0) {
+          sumThetaLayer[layer + startPositionToFill] /= sumWeightLayer[layer + startPositionToFill];
+        } else {
+          sumThetaLayer[layer + startPositionToFill] = 0.;
+        }
+      }
 
-        // do pi0/photon shape var only for EMB
-        if (m_do_photon_shapeVar && systemID == systemID_EMB) {
-          if (m_do_widthTheta_logE_weights) {
-            double w_theta2(0.0);
-            if (sumWeightLayer[layer + startPositionToFill] != 0.) {
-              w_theta2 =
-                  theta2_E_layer[layer + startPositionToFill] / sumWeightLayer[layer + startPositionToFill] -
-                  std::pow(theta_E_layer[layer + startPositionToFill] / sumWeightLayer[layer + startPositionToFill], 2);
-            }
-            // Negative values can happen when noise is on and not filtered
-            // Negative values very close to zero can happen due to numerical precision
-            if (w_theta2 < 0.) {
-              PrintDebugMessage(warning(),
-                                "w_theta2 in theta width calculation is negative: " + std::to_string(w_theta2) +
-                                    " , will set theta width to zero (this might happen when noise simulation is on)");
-              width_theta[layer + startPositionToFill] = 0.;
-            } else {
-              width_theta[layer + startPositionToFill] = std::sqrt(w_theta2);
-            }
+      // phi
+      if (sumEnLayer[layer + startPositionToFill] != 0.0) {
+        sumPhiLayer[layer + startPositionToFill] /= sumEnLayer[layer + startPositionToFill];
+      } else {
+        sumPhiLayer[layer + startPositionToFill] = 0.;
+      }
+      // make sure phi is in range -pi..pi
+      if (sumPhiLayer[layer + startPositionToFill] > TMath::Pi())
+        sumPhiLayer[layer + startPositionToFill] -= TMath::TwoPi();
+
+      addToShapeParameters(sumEnLayer[layer + startPositionToFill] / E); // E fraction of layer
+      addToShapeParameters(sumThetaLayer[layer + startPositionToFill]);
+      addToShapeParameters(sumPhiLayer[layer + startPositionToFill]);
+
+      // do pi0/photon shape var only for EMB
+      if (m_do_photon_shapeVar && systemID == systemID_EMB) {
+        // theta/module width using all cells
+        double width_theta = 0.;
+        double width_module = 0.;
+        if (m_do_widthTheta_logE_weights) {
+          double w_theta2(0.0);
+          if (sumWeightLayer[layer + startPositionToFill] != 0.) {
+            w_theta2 =
+                theta2_E_layer[layer + startPositionToFill] / sumWeightLayer[layer + startPositionToFill] -
+                std::pow(theta_E_layer[layer + startPositionToFill] / sumWeightLayer[layer + startPositionToFill], 2);
+          }
+          // Negative values can happen when noise is on and not filtered
+          // Negative values very close to zero can happen due to numerical precision
+          if (w_theta2 < 0.) {
+            PrintDebugMessage(warning(),
+                              "w_theta2 in theta width calculation is negative: " + std::to_string(w_theta2) +
+                                  " , will set theta width to zero (this might happen when noise simulation is on)");
+            width_theta = 0.;
           } else {
-            double w_theta2(0.0);
-            if (sumEnLayer[layer + startPositionToFill] != 0.) {
-              w_theta2 =
-                  theta2_E_layer[layer + startPositionToFill] / sumEnLayer[layer + startPositionToFill] -
-                  std::pow(theta_E_layer[layer + startPositionToFill] / sumEnLayer[layer + startPositionToFill], 2);
-            }
-            // Negative values can happen when noise is on and not filtered
-            // Negative values very close to zero can happen due to numerical precision
-            if (w_theta2 < 0.) {
-              PrintDebugMessage(warning(),
-                                "w_theta2 in theta width calculation is negative: " + std::to_string(w_theta2) +
-                                    " , will set theta width to zero (this might happen when noise simulation is on)");
-              width_theta[layer + startPositionToFill] = 0.;
-            } else {
-              width_theta[layer + startPositionToFill] = std::sqrt(w_theta2);
-            }
+            width_theta = std::sqrt(w_theta2);
           }
-          double w_module2(0.0);
+        } else {
+          double w_theta2(0.0);
           if (sumEnLayer[layer + startPositionToFill] != 0.) {
-            w_module2 =
-                module2_E_layer[layer + startPositionToFill] / sumEnLayer[layer + startPositionToFill] -
-                std::pow(module_E_layer[layer + startPositionToFill] / sumEnLayer[layer + startPositionToFill], 2);
+            w_theta2 =
+                theta2_E_layer[layer + startPositionToFill] / sumEnLayer[layer + startPositionToFill] -
+                std::pow(theta_E_layer[layer + startPositionToFill] / sumEnLayer[layer + startPositionToFill], 2);
           }
           // Negative values can happen when noise is on and not filtered
           // Negative values very close to zero can happen due to numerical precision
-          if (w_module2 < 0) {
+          if (w_theta2 < 0.) {
             PrintDebugMessage(warning(),
-                              "w_module2 in module width calculation is negative: " + std::to_string(w_module2) +
-                                  " , will set module width to zero (this might happen when noise simulation is on)");
-            width_module[layer + startPositionToFill] = 0.;
+                              "w_theta2 in theta width calculation is negative: " + std::to_string(w_theta2) +
+                                  " , will set theta width to zero (this might happen when noise simulation is on)");
+            width_theta = 0.;
           } else {
-            width_module[layer + startPositionToFill] = std::sqrt(w_module2);
+            width_theta = std::sqrt(w_theta2);
           }
+        }
+        double w_module2(0.0);
+        if (sumEnLayer[layer + startPositionToFill] != 0.) {
+          w_module2 =
+              module2_E_layer[layer + startPositionToFill] / sumEnLayer[layer + startPositionToFill] -
+              std::pow(module_E_layer[layer + startPositionToFill] / sumEnLayer[layer + startPositionToFill], 2);
+        }
+        // Negative values can happen when noise is on and not filtered
+        // Negative values very close to zero can happen due to numerical precision
+        if (w_module2 < 0) {
+          PrintDebugMessage(warning(),
+                            "w_module2 in module width calculation is negative: " + std::to_string(w_module2) +
+                                " , will set module width to zero (this might happen when noise simulation is on)");
+          width_module = 0.;
+        } else {
+          width_module = std::sqrt(w_module2);
+        }
 
-          double Ratio_E = (E_cell_Max[layer + startPositionToFill] - E_cell_secMax[layer + startPositionToFill]) /
-                           (E_cell_Max[layer + startPositionToFill] + E_cell_secMax[layer + startPositionToFill]);
-          if (E_cell_Max[layer + startPositionToFill] + E_cell_secMax[layer + startPositionToFill] == 0)
-            Ratio_E = 1.;
-          Ratio_E_max_2ndmax[layer + startPositionToFill] = Ratio_E;
-          Delta_E_2ndmax_min[layer + startPositionToFill] =
-              E_cell_secMax[layer + startPositionToFill] - E_cell_Min[layer + startPositionToFill];
-
-          double Ratio_E_vs_phi =
-              (E_cell_vs_phi_Max[layer + startPositionToFill] - E_cell_vs_phi_secMax[layer + startPositionToFill]) /
-              (E_cell_vs_phi_Max[layer + startPositionToFill] + E_cell_vs_phi_secMax[layer + startPositionToFill]);
-          if (E_cell_vs_phi_Max[layer + startPositionToFill] + E_cell_vs_phi_secMax[layer + startPositionToFill] == 0.)
-            Ratio_E_vs_phi = 1.;
-          Ratio_E_max_2ndmax_vs_phi[layer + startPositionToFill] = Ratio_E_vs_phi;
-          Delta_E_2ndmax_min_vs_phi[layer + startPositionToFill] =
-              E_cell_vs_phi_secMax[layer + startPositionToFill] - E_cell_vs_phi_Min[layer + startPositionToFill];
-
-          if (local_E_Max[layer + startPositionToFill].size() > 0) {
-            double E_m1 = 0.;
-            double E_p1 = 0.;
-            int theta_m1 = 0;
-            int theta_p1 = 0;
-            double E_m2 = 0.;
-            double E_p2 = 0.;
-            int theta_m2 = 0;
-            int theta_p2 = 0;
-            double E_m3 = 0.;
-            double E_p3 = 0.;
-            int theta_m3 = 0;
-            int theta_p3 = 0;
-            double E_m4 = 0.;
-            double E_p4 = 0.;
-            int theta_m4 = 0;
-            int theta_p4 = 0;
-            auto it_1 = std::find(theta_E_pair[layer + startPositionToFill].second.begin(),
-                                  theta_E_pair[layer + startPositionToFill].second.end(),
-                                  E_cell_Max[layer + startPositionToFill]);
-            int ind_1 = std::distance(theta_E_pair[layer + startPositionToFill].second.begin(), it_1);
-
-            if (ind_1 - 1 >= 0) {
-              E_m1 = theta_E_pair[layer].second[ind_1 - 1];
-              theta_m1 = theta_E_pair[layer].first[ind_1 - 1];
-            } else {
-              E_m1 = 0;
-              theta_m1 = 0;
-            }
-            if (static_cast<size_t>(ind_1 + 1) < theta_E_pair[layer].second.size()) {
-              E_p1 = theta_E_pair[layer].second[ind_1 + 1];
-              theta_p1 = theta_E_pair[layer].first[ind_1 + 1];
-            } else {
-              E_p1 = 0;
-              theta_p1 = 0;
-            }
-
-            if (ind_1 - 2 >= 0) {
-              E_m2 = theta_E_pair[layer].second[ind_1 - 2];
-              theta_m2 = theta_E_pair[layer].first[ind_1 - 2];
-            } else {
-              E_m2 = 0;
-              theta_m2 = 0;
-            }
-            if (static_cast<size_t>(ind_1 + 2) < theta_E_pair[layer].second.size()) {
-              E_p2 = theta_E_pair[layer].second[ind_1 + 2];
-              theta_p2 = theta_E_pair[layer].first[ind_1 + 2];
-            } else {
-              E_p2 = 0;
-              theta_p2 = 0;
-            }
+        // cells of the layer, a single cell with zero energy in case there's no cell in this layer (sometimes in
+        // layer 0)
+        const size_t begin = aScratch.layerOffsets[layer + startPositionToFill];
+        const size_t numCellsInLayer = aScratch.layerOffsets[layer + startPositionToFill + 1] - begin;
+        static const int noCellId = 0;
+        static const double noCellEnergy = 0.;
+        std::span<const double> energies(&noCellEnergy, 1);
+        std::span<const int> thetaIds(&noCellId, 1);
+        std::span<const int> moduleIds(&noCellId, 1);
+        if (numCellsInLayer > 0) {
+          energies = std::span<const double>(aScratch.layerEnergies).subspan(begin, numCellsInLayer);
+          thetaIds = std::span<const int>(aScratch.layerThetaIds).subspan(begin, numCellsInLayer);
+          moduleIds = std::span<const int>(aScratch.layerModuleIds).subspan(begin, numCellsInLayer);
+        }
 
-            if (ind_1 - 3 >= 0) {
-              E_m3 = theta_E_pair[layer].second[ind_1 - 3];
-              theta_m3 = theta_E_pair[layer].first[ind_1 - 3];
-            } else {
-              E_m3 = 0;
-              theta_m3 = 0;
+        // local maxima of the 1D theta-E profile
+        BuildProfile(thetaIds, energies, nMergedThetaCells[layer + startPositionToFill], aScratch.profileCells,
+                     aScratch.profileIds, aScratch.profileEnergies);
+        const ProfileMaxima thetaMaxima = FindMaxima(aScratch.profileIds, aScratch.profileEnergies);
+
+        // (Emax - E2ndmax)/(Emax + E2ndmax) where 2nd max must be a local maximum
+        double Ratio_E = (thetaMaxima.E_Max - thetaMaxima.E_secMax) / (thetaMaxima.E_Max + thetaMaxima.E_secMax);
+        if (thetaMaxima.E_Max + thetaMaxima.E_secMax == 0)
+          Ratio_E = 1.;
+        // (E2ndmax - Emin) where Emin is the energy with minimum energy in the theta range defined by 1st and 2nd
+        // (local) max
+        double Delta_E_2ndmax_min = thetaMaxima.E_secMax - thetaMaxima.E_Min;
+
+        // theta width using only cells within deltaThetaBin = +-1, +-2, +-3, +-4 (index 1 to 4)
+        double width_theta_nBin[5] = {0., 0., 0., 0., 0.};
+        // E_fr_side_N, (E around maxE +- N bins) / (E around maxE +- 1 bins) - 1. (index 2 to 4)
+        double E_fr_side_pmN[5] = {0., 0., 0., 0., 0.};
+        if (thetaMaxima.numMaxima > 0) {
+          const auto& profileIds = aScratch.profileIds;
+          const auto& profileEnergies = aScratch.profileEnergies;
+          auto it_1 = std::find(profileEnergies.begin(), profileEnergies.end(), thetaMaxima.E_Max);
+          int ind_1 = std::distance(profileEnergies.begin(), it_1);
+
+          // E and theta of the bins at -N and +N bins from the maximum, zero outside the profile
+          double E_m[5] = {0., 0., 0., 0., 0.};
+          double E_p[5] = {0., 0., 0., 0., 0.};
+          int theta_m[5] = {0, 0, 0, 0, 0};
+          int theta_p[5] = {0, 0, 0, 0, 0};
+          for (int n = 1; n <= 4; n++) {
+            if (ind_1 - n >= 0) {
+              E_m[n] = profileEnergies[ind_1 - n];
+              theta_m[n] = profileIds[ind_1 - n];
             }
-            if (static_cast<size_t>(ind_1 + 3) < theta_E_pair[layer].second.size()) {
-              E_p3 = theta_E_pair[layer].second[ind_1 + 3];
-              theta_p3 = theta_E_pair[layer].first[ind_1 + 3];
-            } else {
-              E_p3 = 0;
-              theta_p3 = 0;
+            if (static_cast<size_t>(ind_1 + n) < profileEnergies.size()) {
+              E_p[n] = profileEnergies[ind_1 + n];
+              theta_p[n] = profileIds[ind_1 + n];
             }
+          }
+          // calculate energy fraction outside core of 3 inner theta strips
+          double sum_E_nBin[5];
+          sum_E_nBin[1] = E_m[1] + thetaMaxima.E_Max + E_p[1];
+          for (int n = 2; n <= 4; n++) {
+            sum_E_nBin[n] = sum_E_nBin[n - 1] + E_m[n] + E_p[n];
+            E_fr_side_pmN[n] = (sum_E_nBin[1] > 0.) ? (sum_E_nBin[n] / sum_E_nBin[1] - 1.) : 0.;
+          }
 
-            if (ind_1 - 4 >= 0) {
-              E_m4 = theta_E_pair[layer].second[ind_1 - 4];
-              theta_m4 = theta_E_pair[layer].first[ind_1 - 4];
-            } else {
-              E_m4 = 0;
-              theta_m4 = 0;
-            }
-            if (static_cast<size_t>(ind_1 + 4) < theta_E_pair[layer].second.size()) {
-              E_p4 = theta_E_pair[layer].second[ind_1 + 4];
-              theta_p4 = theta_E_pair[layer].first[ind_1 + 4];
-            } else {
-              E_p4 = 0;
-              theta_p4 = 0;
-            }
-            // calculate energy fraction outside core of 3 inner theta strips
-            double sum_E_3Bin = E_m1 + E_cell_Max[layer + startPositionToFill] + E_p1;
-            double sum_E_5Bin = sum_E_3Bin + E_m2 + E_p2;
-            double sum_E_7Bin = sum_E_5Bin + E_m3 + E_p3;
-            double sum_E_9Bin = sum_E_7Bin + E_m4 + E_p4;
-            E_fr_side_pm2[layer + startPositionToFill] = (sum_E_3Bin > 0.) ? (sum_E_5Bin / sum_E_3Bin - 1.) : 0.;
-            E_fr_side_pm3[layer + startPositionToFill] = (sum_E_3Bin > 0.) ? (sum_E_7Bin / sum_E_3Bin - 1.) : 0.;
-            E_fr_side_pm4[layer + startPositionToFill] = (sum_E_3Bin > 0.) ? (sum_E_9Bin / sum_E_3Bin - 1.) : 0.;
-
-            // calculate width along theta in core
-            double _w_theta_3Bin2(0.), _w_theta_5Bin2(0.), _w_theta_7Bin2(0.), _w_theta_9Bin2(0.);
-            if (m_do_widthTheta_logE_weights) {
-              double weightLog_E_max =
-                  std::max(0., m_thetaRecalcLayerWeights[k][layer] + log(E_cell_Max[layer + startPositionToFill] /
-                                                                         sumEnLayer[layer + startPositionToFill]));
-              double weightLog_m1 = std::max(0., m_thetaRecalcLayerWeights[k][layer] +
-                                                     log(E_m1 / sumEnLayer[layer + startPositionToFill]));
-              double weightLog_m2 = std::max(0., m_thetaRecalcLayerWeights[k][layer] +
-                                                     log(E_m2 / sumEnLayer[layer + startPositionToFill]));
-              double weightLog_m3 = std::max(0., m_thetaRecalcLayerWeights[k][layer] +
-                                                     log(E_m3 / sumEnLayer[layer + startPositionToFill]));
-              double weightLog_m4 = std::max(0., m_thetaRecalcLayerWeights[k][layer] +
-                                                     log(E_m4 / sumEnLayer[layer + startPositionToFill]));
-              double weightLog_p1 = std::max(0., m_thetaRecalcLayerWeights[k][layer] +
-                                                     log(E_p1 / sumEnLayer[layer + startPositionToFill]));
-              double weightLog_p2 = std::max(0., m_thetaRecalcLayerWeights[k][layer] +
-                                                     log(E_p2 / sumEnLayer[layer + startPositionToFill]));
-              double weightLog_p3 = std::max(0., m_thetaRecalcLayerWeights[k][layer] +
-                                                     log(E_p3 / sumEnLayer[layer + startPositionToFill]));
-              double weightLog_p4 = std::max(0., m_thetaRecalcLayerWeights[k][layer] +
-                                                     log(E_p4 / sumEnLayer[layer + startPositionToFill]));
-
-              double sum_weightLog_3Bin = weightLog_E_max + weightLog_m1 + weightLog_p1;
-              double sum_weightLog_5Bin = sum_weightLog_3Bin + weightLog_m2 + weightLog_p2;
-              double sum_weightLog_7Bin = sum_weightLog_5Bin + weightLog_m3 + weightLog_p3;
-              double sum_weightLog_9Bin = sum_weightLog_7Bin + weightLog_m4 + weightLog_p4;
-
-              double theta2_E_3Bin = theta_m1 * theta_m1 * weightLog_m1 +
-                                     E_cell_Max_theta[layer + startPositionToFill] *
-                                         E_cell_Max_theta[layer + startPositionToFill] * weightLog_E_max +
-                                     theta_p1 * theta_p1 * weightLog_p1;
-              double theta_E_3Bin = theta_m1 * weightLog_m1 +
-                                    E_cell_Max_theta[layer + startPositionToFill] * weightLog_E_max +
-                                    theta_p1 * weightLog_p1;
-              double theta2_E_5Bin =
-                  theta2_E_3Bin + theta_m2 * theta_m2 * weightLog_m2 + theta_p2 * theta_p2 * weightLog_p2;
-              double theta_E_5Bin = theta_E_3Bin + theta_m2 * weightLog_m2 + theta_p2 * weightLog_p2;
-              double theta2_E_7Bin =
-                  theta2_E_5Bin + theta_m3 * theta_m3 * weightLog_m3 + theta_p3 * theta_p3 * weightLog_p3;
-              double theta_E_7Bin = theta_E_5Bin + theta_m3 * weightLog_m3 + theta_p3 * weightLog_p3;
-              double theta2_E_9Bin =
-                  theta2_E_7Bin + theta_m4 * theta_m4 * weightLog_m4 + theta_p4 * theta_p4 * weightLog_p4;
-              double theta_E_9Bin = theta_E_7Bin + theta_m4 * weightLog_m4 + theta_p4 * weightLog_p4;
-
-              _w_theta_3Bin2 = theta2_E_3Bin / sum_weightLog_3Bin - std::pow(theta_E_3Bin / sum_weightLog_3Bin, 2);
-              _w_theta_5Bin2 = theta2_E_5Bin / sum_weightLog_5Bin - std::pow(theta_E_5Bin / sum_weightLog_5Bin, 2);
-              _w_theta_7Bin2 = theta2_E_7Bin / sum_weightLog_7Bin - std::pow(theta_E_7Bin / sum_weightLog_7Bin, 2);
-              _w_theta_9Bin2 = theta2_E_9Bin / sum_weightLog_9Bin - std::pow(theta_E_9Bin / sum_weightLog_9Bin, 2);
-            } else {
-              double theta2_E_3Bin = theta_m1 * theta_m1 * E_m1 +
-                                     E_cell_Max_theta[layer + startPositionToFill] *
-                                         E_cell_Max_theta[layer + startPositionToFill] *
-                                         E_cell_Max[layer + startPositionToFill] +
-                                     theta_p1 * theta_p1 * E_p1;
-              double theta_E_3Bin =
-                  theta_m1 * E_m1 +
-                  E_cell_Max_theta[layer + startPositionToFill] * E_cell_Max[layer + startPositionToFill] +
-                  theta_p1 * E_p1;
-              double theta2_E_5Bin = theta2_E_3Bin + theta_m2 * theta_m2 * E_m2 + theta_p2 * theta_p2 * E_p2;
-              double theta_E_5Bin = theta_E_3Bin + theta_m2 * E_m2 + theta_p2 * E_p2;
-              double theta2_E_7Bin = theta2_E_5Bin + theta_m3 * theta_m3 * E_m3 + theta_p3 * theta_p3 * E_p3;
-              double theta_E_7Bin = theta_E_5Bin + theta_m3 * E_m3 + theta_p3 * E_p3;
-              double theta2_E_9Bin = theta2_E_7Bin + theta_m4 * theta_m4 * E_m4 + theta_p4 * theta_p4 * E_p4;
-              double theta_E_9Bin = theta_E_7Bin + theta_m4 * E_m4 + theta_p4 * E_p4;
-
-              _w_theta_3Bin2 = theta2_E_3Bin / sum_E_3Bin - std::pow(theta_E_3Bin / sum_E_3Bin, 2);
-              _w_theta_5Bin2 = theta2_E_5Bin / sum_E_5Bin - std::pow(theta_E_5Bin / sum_E_5Bin, 2);
-              _w_theta_7Bin2 = theta2_E_7Bin / sum_E_7Bin - std::pow(theta_E_7Bin / sum_E_7Bin, 2);
-              _w_theta_9Bin2 = theta2_E_9Bin / sum_E_9Bin - std::pow(theta_E_9Bin / sum_E_9Bin, 2);
-            }
-            // Negative values of the RMS can be caused by computational precision or cells with E<0 (in case of noise)
-            if (_w_theta_3Bin2 < 0) {
-              PrintDebugMessage(
-                  warning(),
-                  "_w_theta_3Bin2 in theta width calculation is negative: " + std::to_string(_w_theta_3Bin2) +
-                      " , will set theta width to zero (this might happen when noise simulation is on)");
-              width_theta_3Bin[layer + startPositionToFill] = 0.;
-            } else {
-              width_theta_3Bin[layer + startPositionToFill] = std::sqrt(_w_theta_3Bin2);
-            }
-            if (_w_theta_5Bin2 < 0) {
-              PrintDebugMessage(
-                  warning(),
-                  "_w_theta_5Bin2 in theta width calculation is negative: " + std::to_string(_w_theta_5Bin2) +
-                      " , will set theta width to zero (this might happen when noise simulation is on)");
-              width_theta_5Bin[layer + startPositionToFill] = 0.;
-            } else {
-              width_theta_5Bin[layer + startPositionToFill] = std::sqrt(_w_theta_5Bin2);
+          // calculate width along theta in core, with log(E) or E weights
+          double weight_Max = thetaMaxima.E_Max;
+          double weight_m[5], weight_p[5];
+          std::copy(E_m, E_m + 5, weight_m);
+          std::copy(E_p, E_p + 5, weight_p);
+          if (m_do_widthTheta_logE_weights) {
+            auto weightLog = [&](double aEnergy) {
+              return std::max(0., m_thetaRecalcLayerWeights[k][layer] +
+                                      log(aEnergy / sumEnLayer[layer + startPositionToFill]));
+            };
+            weight_Max = weightLog(thetaMaxima.E_Max);
+            for (int n = 1; n <= 4; n++) {
+              weight_m[n] = weightLog(E_m[n]);
+              weight_p[n] = weightLog(E_p[n]);
             }
-            if (_w_theta_7Bin2 < 0) {
-              PrintDebugMessage(
-                  warning(),
-                  "_w_theta_7Bin2 in theta width calculation is negative: " + std::to_string(_w_theta_7Bin2) +
-                      " , will set theta width to zero (this might happen when noise simulation is on)");
-              width_theta_7Bin[layer + startPositionToFill] = 0.;
-            } else {
-              width_theta_7Bin[layer + startPositionToFill] = std::sqrt(_w_theta_7Bin2);
+          }
+          const int theta_Max = thetaMaxima.Max_id;
+          double sum_weight = weight_m[1] + weight_Max + weight_p[1];
+          double theta2_E = theta_m[1] * theta_m[1] * weight_m[1] + theta_Max * theta_Max * weight_Max +
+                            theta_p[1] * theta_p[1] * weight_p[1];
+          double theta_E = theta_m[1] * weight_m[1] + theta_Max * weight_Max + theta_p[1] * weight_p[1];
+          for (int n = 1; n <= 4; n++) {
+            if (n > 1) {
+              sum_weight = sum_weight + weight_m[n] + weight_p[n];
+              theta2_E = theta2_E + theta_m[n] * theta_m[n] * weight_m[n] + theta_p[n] * theta_p[n] * weight_p[n];
+              theta_E = theta_E + theta_m[n] * weight_m[n] + theta_p[n] * weight_p[n];
             }
-            if (_w_theta_9Bin2 < 0) {
-              PrintDebugMessage(
-                  warning(),
-                  "_w_theta_9Bin2 in theta width calculation is negative: " + std::to_string(_w_theta_9Bin2) +
-                      " , will set theta width to zero (this might happen when noise simulation is on)");
-              width_theta_9Bin[layer + startPositionToFill] = 0.;
+            double _w_theta_nBin2 = theta2_E / sum_weight - std::pow(theta_E / sum_weight, 2);
+            // Negative values of the RMS can be caused by computational precision or cells with E<0 (in case of
+            // noise)
+            if (_w_theta_nBin2 < 0) {
+              PrintDebugMessage(warning(), "_w_theta_" + std::to_string(2 * n + 1) +
+                                               "Bin2 in theta width calculation is negative: " +
+                                               std::to_string(_w_theta_nBin2) +
+                                               " , will set theta width to zero (this might happen when noise "
+                                               "simulation is on)");
+              width_theta_nBin[n] = 0.;
             } else {
-              width_theta_9Bin[layer + startPositionToFill] = std::sqrt(_w_theta_9Bin2);
+              width_theta_nBin[n] = std::sqrt(_w_theta_nBin2);
             }
-          } else {
-            width_theta_3Bin[layer + startPositionToFill] = 0.;
-            width_theta_5Bin[layer + startPositionToFill] = 0.;
-            width_theta_7Bin[layer + startPositionToFill] = 0.;
-            width_theta_9Bin[layer + startPositionToFill] = 0.;
-            E_fr_side_pm2[layer + startPositionToFill] = 0.;
-            E_fr_side_pm3[layer + startPositionToFill] = 0.;
-            E_fr_side_pm4[layer + startPositionToFill] = 0.;
           }
-          newCluster.addToShapeParameters(maxCellEnergyInLayer[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(width_theta[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(width_module[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(Ratio_E_max_2ndmax[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(Delta_E_2ndmax_min[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(Ratio_E_max_2ndmax_vs_phi[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(Delta_E_2ndmax_min_vs_phi[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(width_theta_3Bin[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(width_theta_5Bin[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(width_theta_7Bin[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(width_theta_9Bin[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(E_fr_side_pm2[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(E_fr_side_pm3[layer + startPositionToFill]);
-          newCluster.addToShapeParameters(E_fr_side_pm4[layer + startPositionToFill]);
         }
-      } // end of loop over layers
-    } // end of loop over system/readout
-    newCluster.addToShapeParameters(p4cl.M());
-    newCluster.addToShapeParameters(nCells);
-  } // end of loop over clusters
 
-  return StatusCode::SUCCESS;
+        // local maxima of the 1D module-E profile
+        BuildProfile(moduleIds, energies, nMergedModules[layer + startPositionToFill], aScratch.profileCells,
+                     aScratch.profileIds, aScratch.profileEnergies);
+        const ProfileMaxima moduleMaxima = FindMaxima(aScratch.profileIds, aScratch.profileEnergies);
+
+        // (Emax - E2ndmax)/(Emax + E2ndmax) where 2nd max must be a local maximum - in phi profile
+        double Ratio_E_vs_phi =
+            (moduleMaxima.E_Max - moduleMaxima.E_secMax) / (moduleMaxima.E_Max + moduleMaxima.E_secMax);
+        if (moduleMaxima.E_Max + moduleMaxima.E_secMax == 0.)
+          Ratio_E_vs_phi = 1.;
+        // (E2ndmax - Emin) where Emin is the energy with minimum energy in the module range defined by 1st and 2nd
+        // (local) max
+        double Delta_E_2ndmax_min_vs_phi = moduleMaxima.E_secMax - moduleMaxima.E_Min;
+
+        addToShapeParameters(maxCellEnergyInLayer[layer + startPositionToFill]);
+        addToShapeParameters(width_theta);
+        addToShapeParameters(width_module);
+        addToShapeParameters(Ratio_E);
+        addToShapeParameters(Delta_E_2ndmax_min);
+        addToShapeParameters(Ratio_E_vs_phi);
+        addToShapeParameters(Delta_E_2ndmax_min_vs_phi);
+        addToShapeParameters(width_theta_nBin[1]);
+        addToShapeParameters(width_theta_nBin[2]);
+        addToShapeParameters(width_theta_nBin[3]);
+        addToShapeParameters(width_theta_nBin[4]);
+        addToShapeParameters(E_fr_side_pmN[2]);
+        addToShapeParameters(E_fr_side_pmN[3]);
+        addToShapeParameters(E_fr_side_pmN[4]);
+      }
+    } // end of loop over layers
+  } // end of loop over system/readout
+  addToShapeParameters(p4cl.M());
+  addToShapeParameters(nCells);
 }
@@ -15,15 +15,25 @@ class IGeoSvc;
 // DD4HEP
 // #include "DDSegmentation/Segmentation.h"
 
+// TBB
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/task_arena.h>
+
+// std
+#include <atomic>
+#include <span>
+
 // EDM4HEP
 namespace edm4hep {
+class Cluster;
 class ClusterCollection;
-}
+} // namespace edm4hep
 
 // DD4HEP
 namespace dd4hep {
 namespace DDSegmentation {
   class BitFieldCoder;
+  class BitFieldElement;
   class Segmentation;
 } // namespace DDSegmentation
 } // namespace dd4hep
@@ -31,7 +41,13 @@ namespace DDSegmentation {
 /** @class AugmentClustersFCCee
  *
  *  Add to the cluster shape parameters the sum of the cluster cells energy and barycenter theta/phi coordinates
- *  per layer. The theta position is calculated with a log(E) weighting
+ *  per layer. The theta position is calculated with a log(E) weighting.
+ *  The cells of a cluster are decoded once, with the fields resolved at initialize, and all per-layer sums are
+ *  accumulated in per-thread scratch memory reused for all clusters. The two highest local maxima of the theta and
+ *  module energy profiles of a layer are selected in a single pass over the profile.
+ *  With numThreads different from 1, the clusters of an event are processed concurrently, each thread with its own
+ *  scratch memory, and the output clusters are written in the order of the input clusters, so the output does not
+ *  depend on the number of threads.
  *
  *  @author Alexis Maloizel
  *  @author Giovanni Marchiori
@@ -99,12 +115,75 @@ private:
   // the number of modules / phi cells
   std::vector<int> nModules;
 
+  /// Number of threads processing the clusters of an event
+  Gaudi::Property<int> m_numThreads{this, "numThreads", 1,
+                                    "Number of threads processing the clusters (0: TBB default, 1: serial)"};
+  mutable tbb::task_arena m_arena;
+
   /// Limit of debug printing
-  mutable uint debugIter = 0;
+  mutable std::atomic<uint> debugIter = 0;
   Gaudi::Property<uint> m_maxDebugPrint{this, "maxDebugPrint", 10,
                                         "maximum number of debug/warning messages from execute()"};
 
   void PrintDebugMessage(MsgStream stream, const std::string& text) const;
+
+  /// Fields of the cellIDs of one system, resolved at initialize
+  struct SystemDecoding {
+    int systemID = 0;
+    const dd4hep::DDSegmentation::BitFieldElement* systemField = nullptr;
+    const dd4hep::DDSegmentation::BitFieldElement* layerField = nullptr;
+    const dd4hep::DDSegmentation::BitFieldElement* thetaField = nullptr;
+    const dd4hep::DDSegmentation::BitFieldElement* moduleField = nullptr;
+    /// Position of the first layer of the system in the per-layer sums
+    size_t startPosition = 0;
+  };
+  std::vector<SystemDecoding> m_systemDecoding;
+  /// Total number of layers of all systems
+  size_t m_numLayersTotal = 0;
+  /// Number of shape parameters added to each cluster
+  size_t m_numShapeParameters = 0;
+
+  /// Cell of the cluster, decoded
+  struct CellShape {
+    /// index of the system, and layer + start position of the system
+    unsigned system;
+    unsigned layer;
+    int theta_id;
+    int module_id;
+    double energy;
+    double theta;
+    double phi;
+  };
+  /// Scratch memory of the computation of the shape parameters of one cluster
+  struct ShapeScratch {
+    explicit ShapeScratch(size_t aNumLayers);
+    /// Reset the per-layer sums for a new cluster
+    void clear();
+    std::vector<CellShape> cells;
+    /// per-layer sums
+    std::vector<double> sumEnLayer, maxCellEnergyInLayer, sumThetaLayer, sumPhiLayer, sumWeightLayer;
+    std::vector<double> theta2_E_layer, theta_E_layer, module2_E_layer, module_E_layer;
+    /// cells for the pi0/photon shape variables grouped by layer: the cells of layer l are [offsets[l], offsets[l+1])
+    std::vector<size_t> layerOffsets, layerFill;
+    std::vector<int> layerThetaIds, layerModuleIds;
+    std::vector<double> layerEnergies;
+    /// 1D energy profile of one layer along theta or module ID
+    std::vector<std::pair<int, double>> profileCells;
+    std::vector<int> profileIds;
+    std::vector<double> profileEnergies;
+  };
+  /// Scratch memory of each thread, sized at the first use after initialize
+  mutable tbb::enumerable_thread_specific<ShapeScratch> m_scratch{[this]() { return ShapeScratch(m_numLayersTotal); }};
+
+  /**
+   * Compute the shape parameters of one cluster.
+   *
+   * @param[in]  aCluster          Cluster.
+   * @param[in]  aScratch          Scratch memory of the calling thread.
+   * @param[out] aShapeParameters  Shape parameters added to the cluster, in the order of the metadata.
+   */
+  void computeShapeParameters(const edm4hep::Cluster& aCluster, ShapeScratch& aScratch,
+                              std::span<float> aShapeParameters) const;
 };
 
 #endif /* RECFCCEECALORIMETER_AUGMENTCLUSTERSFCCEE_H */
@@ -17,11 +17,13 @@
 
 #include "OnnxruntimeUtilities.h"
 
+// TBB
+#include <tbb/parallel_for.h>
+
 DECLARE_COMPONENT(CalibrateCaloClusters)
 
 CalibrateCaloClusters::CalibrateCaloClusters(const std::string& name, ISvcLocator* svcLoc)
-    : Gaudi::Algorithm(name, svcLoc), m_geoSvc("GeoSvc", "CalibrateCaloClusters"),
-      m_ortMemInfo(Ort::MemoryInfo::CreateCpu(OrtAllocatorType::OrtArenaAllocator, OrtMemType::OrtMemTypeDefault)) {
+    : Gaudi::Algorithm(name, svcLoc), m_geoSvc("GeoSvc", "CalibrateCaloClusters") {
   declareProperty("inClusters", m_inClusters, "Input cluster collection");
   declareProperty("outClusters", m_outClusters, "Calibrated (output) cluster collection");
 }
@@ -62,12 +64,39 @@ StatusCode CalibrateCaloClusters::initialize() {
     return StatusCode::FAILURE;
   }
 
+  if (m_batchSize == 0) {
+    error() << "The batch size has to be at least 1, exiting!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+
   // calculate total number of layers summed over the various subsystems
   m_numLayersTotal = 0;
   for (unsigned short int i = 0; i < m_numLayers.size(); ++i) {
     m_numLayersTotal += m_numLayers[i];
   }
 
+  // resolve the decoders once: offsets and masks of the system and layer fields of each readout, and position of its
+  // first layer in the inputs of the MVA
+  m_layerDecoding.clear();
+  unsigned short int startPosition = 0;
+  for (unsigned short int k = 0; k < m_readoutNames.size(); k++) {
+    dd4hep::DDSegmentation::BitFieldCoder* decoder =
+        m_geoSvc->getDetector()->readout(m_readoutNames[k]).idSpec().decoder();
+    const auto& systemField = (*decoder)["system"];
+    const auto& layerField = (*decoder)[m_layerFieldNames[k]];
+    LayerDecoding readout;
+    readout.systemID = m_systemIDs[k];
+    readout.systemOffset = systemField.offset();
+    readout.systemMask = (uint64_t(1) << systemField.width()) - 1;
+    readout.layerOffset = layerField.offset();
+    readout.layerMask = (uint64_t(1) << layerField.width()) - 1;
+    readout.firstLayer = m_firstLayerIDs[k];
+    readout.numLayers = m_numLayers[k];
+    readout.startPosition = startPosition;
+    m_layerDecoding.push_back(readout);
+    startPosition += m_numLayers[k];
+  }
+
   // Initialize the calibration tool
   StatusCode sc = readCalibrationFile(m_calibrationFile);
   if (sc.isFailure()) {
@@ -107,6 +136,11 @@ StatusCode CalibrateCaloClusters::initialize() {
     }
   }
 
+  if (m_numThreads != 1) {
+    m_arena.initialize(m_numThreads > 0 ? int(m_numThreads) : tbb::task_arena::automatic);
+    info() << "Clusters calibrated concurrently on " << m_arena.max_concurrency() << " threads" << endmsg;
+  }
+
   info() << "Initialized the calibration" << endmsg;
   return StatusCode::SUCCESS;
 }
@@ -141,23 +175,7 @@ StatusCode CalibrateCaloClusters::execute(const EventContext& evtCtx) const {
   return StatusCode::SUCCESS;
 }
 
-StatusCode CalibrateCaloClusters::finalize() {
-  if (m_ortSession)
-    delete m_ortSession;
-
-  if (m_ortEnv)
-    delete m_ortEnv;
-
-  for (auto& name : m_input_names) {
-    delete name;
-  }
-
-  for (auto& name : m_output_names) {
-    delete name;
-  }
-
-  return Gaudi::Algorithm::finalize();
-}
+StatusCode CalibrateCaloClusters::finalize() { return Gaudi::Algorithm::finalize(); }
 
 edm4hep::ClusterCollection*
 CalibrateCaloClusters::initializeOutputClusters(const edm4hep::ClusterCollection* inClusters) const {
@@ -172,65 +190,33 @@ CalibrateCaloClusters::initializeOutputClusters(const edm4hep::ClusterCollection
 }
 
 StatusCode CalibrateCaloClusters::readCalibrationFile(const std::string& calibrationFile) {
-  // set logging level based on output level of this alg
-  OrtLoggingLevel loggingLevel = ORT_LOGGING_LEVEL_WARNING;
-  MSG::Level outputLevel = this->msgStream().level();
-  switch (outputLevel) {
-  case MSG::Level::FATAL:                   // 6
-    loggingLevel = ORT_LOGGING_LEVEL_FATAL; // 4
-    break;
-  case MSG::Level::ERROR:                   // 5
-    loggingLevel = ORT_LOGGING_LEVEL_ERROR; // 3
-    break;
-  case MSG::Level::WARNING:                   // 4
-    loggingLevel = ORT_LOGGING_LEVEL_WARNING; // 2
-    break;
-  case MSG::Level::INFO:                      // 3
-    loggingLevel = ORT_LOGGING_LEVEL_WARNING; // 2 (ORT_LOGGING_LEVEL_INFO too verbose..)
-    break;
-  case MSG::Level::DEBUG:                  // 2
-    loggingLevel = ORT_LOGGING_LEVEL_INFO; // 1
-    break;
-  case MSG::Level::VERBOSE:                   // 1
-    loggingLevel = ORT_LOGGING_LEVEL_VERBOSE; // 0
-    break;
-  default:
-    break;
+  // the session is owned by the ONNX session service, and shared with the other clients of the same file
+  if (!m_onnxSvc.retrieve()) {
+    error() << "Unable to retrieve the ONNX session service!" << endmsg;
+    return StatusCode::FAILURE;
   }
-  try {
-    m_ortEnv = new Ort::Env(loggingLevel, "ONNX runtime environment");
-    Ort::SessionOptions session_options;
-    session_options.SetIntraOpNumThreads(1);
-    m_ortSession = new Ort::Session(*m_ortEnv, calibrationFile.data(), session_options);
-  } catch (const Ort::Exception& exception) {
-    error() << "ERROR setting up ONNX runtime environment: " << exception.what() << endmsg;
+  m_model = m_onnxSvc->model(calibrationFile);
+  if (!m_model) {
+    error() << "Unable to load the calibration model " << calibrationFile << endmsg;
     return StatusCode::FAILURE;
   }
 
   // print name/shape of inputs
-  // use default allocator (CPU)
-  Ort::AllocatorWithDefaultOptions allocator;
-  debug() << "Input Node Name/Shape (" << m_input_names.size() << "):" << endmsg;
-#if ORT_API_VERSION < 13
-  // Before 1.13 we have to roll our own unique_ptr wrapper here
-  auto allocDeleter = [&allocator](char* p) { allocator.Free(p); };
-  using AllocatedStringPtr = std::unique_ptr<char, decltype(allocDeleter)>;
-#endif
-
-  for (std::size_t i = 0; i < m_ortSession->GetInputCount(); i++) {
-#if ORT_API_VERSION < 13
-    m_input_names.emplace_back(AllocatedStringPtr(m_ortSession->GetInputName(i, allocator), allocDeleter).release());
-#else
-    m_input_names.emplace_back(m_ortSession->GetInputNameAllocated(i, allocator).release());
-#endif
-    m_input_shapes = m_ortSession->GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
-    debug() << "\t" << m_input_names.at(i) << " : ";
+  debug() << "Input Node Name/Shape (" << m_model->inputNames.size() << "):" << endmsg;
+  for (std::size_t i = 0; i < m_model->inputNames.size(); i++) {
+    m_input_shapes = m_model->inputShapes[i];
+    debug() << "\t" << m_model->inputNames[i] << " : ";
     for (std::size_t k = 0; k < m_input_shapes.size() - 1; k++) {
       debug() << m_input_shapes[k] << "x";
     }
     debug() << m_input_shapes[m_input_shapes.size() - 1] << endmsg;
   }
   // some models might have negative shape values to indicate dynamic shape, e.g., for variable batch size.
+  // Batches of several clusters can only be passed to models with a dynamic batch size.
+  if (!m_input_shapes.empty() && m_input_shapes[0] >= 0 && m_batchSize > 1) {
+    info() << "The calibration model has a fixed batch size, the clusters will be calibrated one at a time" << endmsg;
+    m_batchSize = 1;
+  }
   for (auto& s : m_input_shapes) {
     if (s < 0) {
       s = 1;
@@ -238,15 +224,10 @@ StatusCode CalibrateCaloClusters::readCalibrationFile(const std::string& calibra
   }
 
   // print name/shape of outputs
-  debug() << "Output Node Name/Shape (" << m_output_names.size() << "):" << endmsg;
-  for (std::size_t i = 0; i < m_ortSession->GetOutputCount(); i++) {
-#if ORT_API_VERSION < 13
-    m_output_names.emplace_back(AllocatedStringPtr(m_ortSession->GetOutputName(i, allocator), allocDeleter).release());
-#else
-    m_output_names.emplace_back(m_ortSession->GetOutputNameAllocated(i, allocator).release());
-#endif
-    m_output_shapes = m_ortSession->GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
-    debug() << "\t" << m_output_names.at(i) << " : ";
+  debug() << "Output Node Name/Shape (" << m_model->outputNames.size() << "):" << endmsg;
+  for (std::size_t i = 0; i < m_model->outputNames.size(); i++) {
+    m_output_shapes = m_model->outputShapes[i];
+    debug() << "\t" << m_model->outputNames[i] << " : ";
     for (std::size_t k = 0; k < m_output_shapes.size() - 1; k++) {
       debug() << m_output_shapes[k] << "x";
     }
@@ -257,7 +238,7 @@ StatusCode CalibrateCaloClusters::readCalibrationFile(const std::string& calibra
   // and the inputs should be n(layers)+1 (fractions + total E)
   // the first dimension of the tensors are the number of clusters
   // to be calibrated simultaneously (-1 = dynamic)
-  // we will calibrate once at a time
+  // we will calibrate up to batchSize clusters at a time
   if (m_input_shapes.size() != 2 || m_output_shapes.size() != 2 || m_input_shapes[1] != (m_numLayersTotal + 1) ||
       m_output_shapes[1] != 1) {
     error() << "The input or output shapes in the calibration files do not match the expected architecture" << endmsg;
@@ -270,63 +251,98 @@ StatusCode CalibrateCaloClusters::readCalibrationFile(const std::string& calibra
 StatusCode CalibrateCaloClusters::calibrateClusters(const edm4hep::ClusterCollection* inClusters,
                                                     edm4hep::ClusterCollection* outClusters) const {
 
-  // this vector will contain the input features for the calibration
-  // i.e. the fraction of energy in each layer and the total energy
-  std::vector<float> energiesInLayers(m_numLayersTotal + 1);
-
-  // loop over the input clusters and perform the calibration
+  // the clusters with positive energy are calibrated
+  std::vector<unsigned int> calibratedClusters;
+  calibratedClusters.reserve(inClusters->size());
   for (unsigned int j = 0; j < inClusters->size(); ++j) {
-
     // retrieve total cluster energy
     float ecl = (inClusters->at(j)).getEnergy();
     if (ecl <= 0.) {
       warning() << "Energy in calorimeter <= 0, ignoring energy correction!" << endmsg;
-      continue;
+    } else {
+      calibratedClusters.push_back(j);
     }
-    verbose() << "Cluster energy before calibration: " << ecl << endmsg;
-
-    // calculate cluster energy in each layer and normalize by total cluster energy
-    calcEnergiesInLayers(inClusters->at(j), energiesInLayers);
-    verbose() << "Calibration inputs:" << endmsg;
-    for (unsigned short int k = 0; k < energiesInLayers.size(); ++k) {
-      verbose() << "    f" << k << " : " << energiesInLayers[k] << endmsg;
+  }
+  const size_t numClusters = calibratedClusters.size();
+
+  // run aFunction(i) for i in [0, aSize), concurrently if several threads are used
+  auto forEach = [this](size_t aSize, const auto& aFunction) {
+    if (m_numThreads != 1 && aSize > 1) {
+      m_arena.execute([&] { tbb::parallel_for(size_t(0), aSize, aFunction); });
+    } else {
+      for (size_t i = 0; i < aSize; i++) {
+        aFunction(i);
+      }
     }
+  };
 
-    // run the MVA calibration and correct the cluster energy
-    float corr = 1.0;
-    // Create a single Ort tensor
+  // the input features for the calibration, one row per cluster
+  // i.e. the fraction of energy in each layer and the total energy
+  const size_t numFeatures = m_numLayersTotal + 1;
+  std::vector<float> features(numClusters * numFeatures);
+  forEach(numClusters, [&](size_t i) {
+    calcEnergiesInLayers(inClusters->at(calibratedClusters[i]),
+                         std::span<float>(features).subspan(i * numFeatures, numFeatures));
+  });
+
+  // the clusters are calibrated in batches of up to m_batchSize clusters: the features of the clusters of a batch are
+  // the rows of one [nClusters, nFeatures] input tensor, and the model is run once per batch
+  const size_t batchSize = m_batchSize;
+  const size_t numBatches = (numClusters + batchSize - 1) / batchSize;
+  std::vector<float> corrections(numClusters);
+  std::vector<std::string> batchErrors(numBatches);
+  forEach(numBatches, [&](size_t iBatch) {
+    const size_t begin = iBatch * batchSize;
+    const size_t batchClusters = std::min(batchSize, numClusters - begin);
+    std::vector<std::int64_t> batchShape = m_input_shapes;
+    batchShape[0] = batchClusters;
     std::vector<Ort::Value> input_tensors;
-    input_tensors.emplace_back(vec_to_tensor<float>(energiesInLayers, m_input_shapes, m_ortMemInfo));
-
-    // double-check the dimensions of the input tensor
-    // assert(input_tensors[0].IsTensor() && input_tensors[0].GetTensorTypeAndShapeInfo().GetShape() == m_input_shapes);
+    input_tensors.emplace_back(vec_to_tensor<float>(
+        std::span<float>(features).subspan(begin * numFeatures, batchClusters * numFeatures), batchShape,
+        m_onnxSvc->memoryInfo()));
 
     // pass data through model
     try {
-      auto output_tensors = m_ortSession->Run(Ort::RunOptions{nullptr}, m_input_names.data(), input_tensors.data(),
-                                              input_tensors.size(), m_output_names.data(), m_output_names.size());
+      auto output_tensors = m_onnxSvc->run(*m_model, input_tensors);
 
       // double-check the dimensions of the output tensors
       // NOTE: the number of output tensors is equal to the number of output nodes specifed in the Run() call
       // assert(output_tensors.size() == output_names.size() && output_tensors[0].IsTensor());
 
-      float* outputData = output_tensors[0].GetTensorMutableData<float>();
-      corr = outputData[0];
+      // the corrections, one per row
+      const float* outputData = output_tensors[0].GetTensorData<float>();
+      std::copy(outputData, outputData + batchClusters, corrections.begin() + begin);
     } catch (const Ort::Exception& exception) {
-      error() << "ERROR running model inference: " << exception.what() << endmsg;
+      batchErrors[iBatch] = exception.what();
+    }
+  });
+  for (const auto& batchError : batchErrors) {
+    if (!batchError.empty()) {
+      error() << "ERROR running model inference: " << batchError << endmsg;
       return StatusCode::FAILURE;
     }
+  }
 
+  // apply the corrections to the output clusters, in the order of the clusters
+  for (size_t i = 0; i < numClusters; i++) {
+    unsigned int iCluster = calibratedClusters[i];
+    float clusterEnergy = inClusters->at(iCluster).getEnergy();
+    float corr = corrections[i];
+    verbose() << "Cluster energy before calibration: " << clusterEnergy << endmsg;
+    verbose() << "Calibration inputs:" << endmsg;
+    for (unsigned short int k = 0; k < numFeatures; ++k) {
+      verbose() << "    f" << k << " : " << features[i * numFeatures + k] << endmsg;
+    }
     verbose() << "Calibration output: " << corr << endmsg;
-    outClusters->at(j).setEnergy(ecl * corr);
-    outClusters->at(j).addToShapeParameters(ecl);
-    verbose() << "Corrected cluster energy: " << ecl * corr << endmsg;
+    outClusters->at(iCluster).setEnergy(clusterEnergy * corr);
+    outClusters->at(iCluster).addToShapeParameters(clusterEnergy);
+    verbose() << "Corrected cluster energy: " << clusterEnergy * corr << endmsg;
   }
 
   return StatusCode::SUCCESS;
 }
 
-void CalibrateCaloClusters::calcEnergiesInLayers(edm4hep::Cluster cluster, std::vector<float>& energiesInLayers) const {
+void CalibrateCaloClusters::calcEnergiesInLayers(edm4hep::Cluster cluster, std::span<float> energiesInLayers) const {
   // reset vector with energies per layer
   std::fill(energiesInLayers.begin(), energiesInLayers.end(), 0.0);
 
@@ -343,28 +359,18 @@ void CalibrateCaloClusters::calcEnergiesInLayers(edm4hep::Cluster cluster, std::
     // add as last input the total raw cluster energy
     energiesInLayers[m_numLayersTotal] = ecl;
   } else {
-    // calculate the energy fractions from the cells
-    // loop over the various readouts/subsystems/...
-    unsigned short int startPositionToFill = 0;
-    for (unsigned short int k = 0; k < m_readoutNames.size(); k++) {
-      if (k > 0) {
-        startPositionToFill += m_numLayers[k - 1];
-      }
-      int systemID = m_systemIDs[k];
-      unsigned short int firstLayer = m_firstLayerIDs[k];
-      std::string layerField = m_layerFieldNames[k];
-      std::string readoutName = m_readoutNames[k];
-      dd4hep::DDSegmentation::BitFieldCoder* decoder = m_geoSvc->getDetector()->readout(readoutName).idSpec().decoder();
-
-      // for each readout, loop over the cells and calculate the energies in the layers
-      // of that subsystem
-      for (auto cell = cluster.hits_begin(); cell != cluster.hits_end(); ++cell) {
-        dd4hep::DDSegmentation::CellID cellID = cell->getCellID();
-        if (decoder->get(cellID, "system") != systemID) {
+    // calculate the energy fractions from the cells, in one pass over the cells
+    // the system and layer fields of each readout are decoded with the shifts and masks computed at initialisation
+    for (const auto& cell : cluster.getHits()) {
+      uint64_t cellID = cell.getCellID();
+      for (const auto& readout : m_layerDecoding) {
+        if (((cellID >> readout.systemOffset) & readout.systemMask) != readout.systemID) {
           continue;
         }
-        int layer = decoder->get(cellID, layerField);
-        energiesInLayers[startPositionToFill + layer - firstLayer] += cell->getEnergy();
+        unsigned int layer = ((cellID >> readout.layerOffset) & readout.layerMask) - readout.firstLayer;
+        if (layer < readout.numLayers) {
+          energiesInLayers[readout.startPosition + layer] += cell.getEnergy();
+        }
       }
     }
     // divide by the cluster energy to prepare the inputs for the MVA
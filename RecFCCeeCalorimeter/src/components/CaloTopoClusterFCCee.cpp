@@ -14,6 +14,8 @@
 // EDM4hep
 #include "edm4hep/CalorimeterHitCollection.h"
 #include "edm4hep/ClusterCollection.h"
+#include "edm4hep/MCParticleCollection.h"
+#include "edm4hep/ReconstructedParticleCollection.h"
 
 // DD4hep
 #include "DD4hep/Readout.h"
@@ -46,6 +48,23 @@ StatusCode CaloTopoClusterFCCee::initialize() {
     }
   }
 
+  // create handles for the collections defining the region of interest
+  if (m_roiMode) {
+    for (const auto& col : m_roiParticles) {
+      m_roiParticleHandles.push_back(
+          new k4FWCore::DataHandle<edm4hep::MCParticleCollection>(col, Gaudi::DataHandle::Reader, this));
+    }
+    for (const auto& col : m_roiRecoParticles) {
+      m_roiRecoParticleHandles.push_back(
+          new k4FWCore::DataHandle<edm4hep::ReconstructedParticleCollection>(col, Gaudi::DataHandle::Reader, this));
+    }
+    if (m_roiParticleHandles.empty() && m_roiRecoParticleHandles.empty()) {
+      error() << "Region-of-interest mode requires at least one collection in roiParticles or roiRecoParticles!"
+              << endmsg;
+      return StatusCode::FAILURE;
+    }
+  }
+
   // use pre-calculated neighbor map i.e. TTree to retrieve neighbors
   if (m_useNeighborMap) {
     // retrieve cells neighbours tool
@@ -74,6 +93,12 @@ StatusCode CaloTopoClusterFCCee::initialize() {
 
     // get segmentation
     m_segmentation = m_geoSvc->getDetector()->readout(m_readoutName).segmentation().segmentation();
+
+    if (m_neighbourCacheSize > 0) {
+      m_neighbourCache = std::make_unique<NeighbourCache>(m_neighbourCacheSize, m_neighbourCacheSlotSize);
+      info() << "Caching segmentation neighbours of up to " << m_neighbourCacheSize.value() << " cells ("
+             << m_neighbourCacheSize * m_neighbourCacheSlotSize * sizeof(uint64_t) / (1024 * 1024) << " MB)" << endmsg;
+    }
   }
 
   // retrieve cells noise tool
@@ -120,8 +145,24 @@ StatusCode CaloTopoClusterFCCee::execute(const EventContext&) const {
 
   debug() << "Number of active cells                               : " << inCells->size() << endmsg;
 
+  // Define the region of interest
+  k4::recCalo::ConeRoI roi(m_roiConeSize);
+  if (m_roiMode) {
+    for (auto handle : m_roiParticleHandles) {
+      for (const auto& part : *handle->get()) {
+        roi.addDirection(part.getMomentum().x, part.getMomentum().y, part.getMomentum().z);
+      }
+    }
+    for (auto handle : m_roiRecoParticleHandles) {
+      for (const auto& part : *handle->get()) {
+        roi.addDirection(part.getMomentum().x, part.getMomentum().y, part.getMomentum().z);
+      }
+    }
+    debug() << "Number of RoI cones: " << roi.axes().size() << endmsg;
+  }
+
   // Find seeds
-  edm4hep::CalorimeterHitCollection seedCells = findSeeds(inCells);
+  edm4hep::CalorimeterHitCollection seedCells = findSeeds(inCells, m_roiMode ? &roi : nullptr);
   debug() << "Number of seeds found                                : " << seedCells.size() << endmsg;
 
   // Build protoclusters (find neighbouring cells)
@@ -225,7 +266,8 @@ StatusCode CaloTopoClusterFCCee::execute(const EventContext&) const {
 }
 
 edm4hep::CalorimeterHitCollection
-CaloTopoClusterFCCee::findSeeds(const edm4hep::CalorimeterHitCollection* allCells) const {
+CaloTopoClusterFCCee::findSeeds(const edm4hep::CalorimeterHitCollection* allCells,
+                                const k4::recCalo::ConeRoI* aRoI) const {
 
   std::vector<edm4hep::CalorimeterHit> seedCellsVec;
 
@@ -233,6 +275,14 @@ CaloTopoClusterFCCee::findSeeds(const edm4hep::CalorimeterHitCollection* allCell
 
     verbose() << "cellID   = " << cell.getCellID() << endmsg;
 
+    // skip cells outside of the region of interest
+    if (aRoI) {
+      auto cellPos = dd4hep::Position(cell.getPosition().x, cell.getPosition().y, cell.getPosition().z);
+      if (!aRoI->contains(cellPos.Theta(), cellPos.Phi())) {
+        continue;
+      }
+    }
+
     // retrieve the noise const and offset assigned to cell
     double offset = m_noiseTool->getNoiseOffsetPerCell(cell.getCellID());
     double rms = m_noiseTool->getNoiseRMSPerCell(cell.getCellID());
@@ -363,10 +413,17 @@ std::vector<std::pair<uint64_t, uint32_t>> CaloTopoClusterFCCee::searchForNeighb
   }
 
   if (!m_useNeighborMap) {
-    // DDSegmentation returns std::set
-    std::set<dd4hep::DDSegmentation::CellID> outputNeighbors;
-    m_segmentation->neighbours(aCellId, outputNeighbors);
-    neighboursVec = std::vector<uint64_t>(outputNeighbors.begin(), outputNeighbors.end());
+    auto segmentationNeighbours = [this](uint64_t aId, std::vector<uint64_t>& aNeighbours) {
+      // DDSegmentation returns std::set
+      std::set<dd4hep::DDSegmentation::CellID> outputNeighbors;
+      m_segmentation->neighbours(aId, outputNeighbors);
+      aNeighbours.assign(outputNeighbors.begin(), outputNeighbors.end());
+    };
+    if (m_neighbourCache) {
+      m_neighbourCache->neighbours(aCellId, neighboursVec, segmentationNeighbours);
+    } else {
+      segmentationNeighbours(aCellId, neighboursVec);
+    }
   }
 
   verbose() << "For cluster: " << aClusterID << endmsg;
@@ -444,9 +501,17 @@ std::vector<std::pair<uint64_t, uint32_t>> CaloTopoClusterFCCee::searchForNeighb
 }
 
 StatusCode CaloTopoClusterFCCee::finalize() {
+  if (m_neighbourCache) {
+    info() << "Neighbour cache: " << m_neighbourCache->hits() << " hits, " << m_neighbourCache->misses()
+           << " misses, " << m_neighbourCache->evictions() << " evictions" << endmsg;
+  }
   delete m_decoder;
   for (size_t ih = 0; ih < m_cellCollectionHandles.size(); ih++)
     delete m_cellCollectionHandles[ih];
+  for (auto handle : m_roiParticleHandles)
+    delete handle;
+  for (auto handle : m_roiRecoParticleHandles)
+    delete handle;
 
   return Gaudi::Algorithm::finalize();
 }
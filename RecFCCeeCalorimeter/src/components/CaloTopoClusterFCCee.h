@@ -4,6 +4,7 @@
 // std
 #include <cstdint>
 #include <map>
+#include <memory>
 #include <sys/types.h>
 #include <vector>
 
@@ -20,11 +21,18 @@
 #include "k4Interface/IGeoSvc.h"
 #include "k4Interface/INoiseConstTool.h"
 
+// RecCaloCommon
+#include "RecCaloCommon/ConeRoI.h"
+
+#include "NeighbourCache.h"
+
 // EDM4HEP
 namespace edm4hep {
 class CalorimeterHit;
 class CalorimeterHitCollection;
 class ClusterCollection;
+class MCParticleCollection;
+class ReconstructedParticleCollection;
 } // namespace edm4hep
 
 // DD4HEP
@@ -48,6 +56,9 @@ namespace DDSegmentation {
  * "lastNeighbourSigma". In case that a neighbour is found that has already been assigned to another cluster, both
  * clusters are merged and assigned to the "older" clusterID, this is the one originating from a higher seed energy. The
  * iteration over neighburing cellIDs is continued.
+ *  In region-of-interest mode (roiMode = true) only seeds within cones of size roiConeSize (in theta-phi) around the
+ *  momenta of the objects in the roiParticles and roiRecoParticles collections are used, so that the clusters around
+ *  these objects are identical to the ones of the full reconstruction.
  *  @author Coralie Neubueser
  *  @author Giovanni Marchiori, based on code from Juraj Smiesko
  */
@@ -63,9 +74,11 @@ public:
 
   /**  Find cells with a signal to noise ratio > m_seedSigma.
    *   @param[in] allCells, the map of all cells.
+   *   @param[in] aRoI, if not null, only cells within the region of interest are used as seeds.
    *   @param[out] the collection of seed cells to build proto-clusters.
    */
-  edm4hep::CalorimeterHitCollection findSeeds(const edm4hep::CalorimeterHitCollection* allCells) const;
+  edm4hep::CalorimeterHitCollection findSeeds(const edm4hep::CalorimeterHitCollection* allCells,
+                                              const k4::recCalo::ConeRoI* aRoI = nullptr) const;
 
   /** Build proto-clusters from the found seeds.
    * First the function initialises a cluster in the preClusterCollection for the seed cells,
@@ -130,6 +143,15 @@ private:
                                              "name of the readout (needed if useNeighborMap=false)"};
   // pointer to the segmentation object
   dd4hep::DDSegmentation::Segmentation* m_segmentation = nullptr;
+  /// Maximum number of cells in the neighbour cache (only used if useNeighborMap is set to false), off by default
+  Gaudi::Property<size_t> m_neighbourCacheSize{
+      this, "neighbourCacheSize", 0,
+      "max number of cells for which segmentation neighbours are cached (0, the default, disables the cache)"};
+  /// Maximum number of neighbours stored per cached cell
+  Gaudi::Property<size_t> m_neighbourCacheSlotSize{
+      this, "neighbourCacheSlotSize", 32, "max number of neighbours per cell stored in the neighbour cache"};
+  /// Cache of the segmentation neighbours, filled on first use
+  std::unique_ptr<NeighbourCache> m_neighbourCache;
 
   /// Seed threshold in sigma
   Gaudi::Property<int> m_seedSigma{this, "seedSigma", 4, "number of sigma in noise threshold"};
@@ -140,6 +162,20 @@ private:
   /// Cluster energy threshold
   Gaudi::Property<float> m_minClusterEnergy{this, "minClusterEnergy", 0., "minimum cluster energy"};
 
+  /// Build clusters only in a region of interest?
+  Gaudi::Property<bool> m_roiMode{this, "roiMode", false, "Use only seeds within cones around the RoI objects?"};
+  /// Size of the region of interest cones
+  Gaudi::Property<double> m_roiConeSize{this, "roiConeSize", 0.4, "Size of the RoI cones in theta-phi"};
+  /// Names of the MCParticle collections defining the region of interest
+  Gaudi::Property<std::vector<std::string>> m_roiParticles{
+      this, "roiParticles", {}, "Names of MCParticle collections with the RoI directions"};
+  /// Names of the ReconstructedParticle collections defining the region of interest
+  Gaudi::Property<std::vector<std::string>> m_roiRecoParticles{
+      this, "roiRecoParticles", {}, "Names of ReconstructedParticle collections with the RoI directions"};
+  /// Input handles for the RoI collections
+  std::vector<k4FWCore::DataHandle<edm4hep::MCParticleCollection>*> m_roiParticleHandles;
+  std::vector<k4FWCore::DataHandle<edm4hep::ReconstructedParticleCollection>*> m_roiRecoParticleHandles;
+
   /// System encoding string
   Gaudi::Property<std::string> m_systemEncoding{this, "systemEncoding", "system:4", "System encoding string"};
   /// General decoder to encode the calorimeter sub-system to determine which
@@ -20,6 +20,13 @@
 #include "TSystem.h"
 #include "TTree.h"
 
+// TBB
+#include <tbb/parallel_for.h>
+
+// std
+#include <algorithm>
+#include <type_traits>
+
 DECLARE_COMPONENT(CreateFCCeeCaloNeighbours)
 
 CreateFCCeeCaloNeighbours::CreateFCCeeCaloNeighbours(const std::string& aName, ISvcLocator* aSL)
@@ -41,7 +48,11 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
             << "Make sure you have GeoSvc and SimSvc in the right order in the configuration." << endmsg;
     return StatusCode::FAILURE;
   }
-  std::unordered_map<uint64_t, std::vector<uint64_t>> map;
+  if (m_numThreads != 1) {
+    m_arena.initialize(m_numThreads > 0 ? int(m_numThreads) : tbb::task_arena::automatic);
+    info() << "Cells enumerated on " << m_arena.max_concurrency() << " threads" << endmsg;
+  }
+  NeighbourMap map;
 
   // will be used for volume connecting
   int eCalLastLayer;
@@ -206,6 +217,8 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
     }
 
     // Loop over all cells in the calorimeter and retrieve existing cellIDs and find neihbours
+    // the cells of each layer are enumerated in a block, the blocks are run concurrently once all are defined
+    std::vector<std::function<void(CellNeighbours&)>> blocks;
     if (segmentationType == "FCCSWGridPhiTheta_k4geo") {
       // Loop over active layers
       std::vector<std::pair<int, int>> extrema;
@@ -269,18 +282,21 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
         debug() << "Extrema[2]: " << extrema[2].first << " , " << extrema[2].second << endmsg;
         debug() << "Number of segmentation cells in phi, in theta, and min theta ID, : " << numCells << endmsg;
         // Loop over segmentation cells
-        for (unsigned int iphi = 0; iphi < numCells[0]; iphi++) {
-          for (unsigned int itheta = 0; itheta < numCells[1]; itheta++) {
-            dd4hep::DDSegmentation::CellID cellId = volumeId;
-            decoder->set(cellId, "phi", iphi);
-            decoder->set(cellId, "theta",
-                         itheta + numCells[2]); // start from the minimum existing theta cell in this layer
-            uint64_t id = cellId;
-            map.insert(std::pair<uint64_t, std::vector<uint64_t>>(
-                id, det::utils::neighbours(*decoder, {m_activeFieldNamesSegmented[iSys], "phi", "theta"}, extrema, id,
-                                           {false, true, false}, m_includeDiagonalCells)));
+        blocks.emplace_back([=, this](CellNeighbours& aCells) {
+          for (unsigned int iphi = 0; iphi < numCells[0]; iphi++) {
+            for (unsigned int itheta = 0; itheta < numCells[1]; itheta++) {
+              dd4hep::DDSegmentation::CellID cellId = volumeId;
+              decoder->set(cellId, "phi", iphi);
+              decoder->set(cellId, "theta",
+                           itheta + numCells[2]); // start from the minimum existing theta cell in this layer
+              uint64_t id = cellId;
+              aCells.emplace_back(id, det::utils::neighbours(*decoder,
+                                                             {m_activeFieldNamesSegmented[iSys], "phi", "theta"},
+                                                             extrema, id, {false, true, false},
+                                                             m_includeDiagonalCells));
+            }
           }
-        }
+        });
       }
     }
 
@@ -319,17 +335,18 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
           debug() << "Number of segmentation cells in phi, in theta, and min theta ID, for HCal barrel : " << numCells
                   << endmsg;
           // Loop over segmentation cells
-          for (unsigned int iphi = 0; iphi < numCells[0]; iphi++) {
-            for (unsigned int itheta = 0; itheta < numCells[1]; itheta++) {
-              dd4hep::DDSegmentation::CellID cellId = volumeId;
-              decoder->set(cellId, "phi", iphi);
-              decoder->set(cellId, "theta",
-                           itheta + numCells[2]); // start from the minimum existing theta cell in this layer
-              uint64_t id = cellId;
-              map.insert(std::pair<uint64_t, std::vector<uint64_t>>(
-                  id, hcalPhiThetaSegmentation->neighbours(id, m_includeDiagonalCellsHCal)));
+          blocks.emplace_back([=, this](CellNeighbours& aCells) {
+            for (unsigned int iphi = 0; iphi < numCells[0]; iphi++) {
+              for (unsigned int itheta = 0; itheta < numCells[1]; itheta++) {
+                dd4hep::DDSegmentation::CellID cellId = volumeId;
+                decoder->set(cellId, "phi", iphi);
+                decoder->set(cellId, "theta",
+                             itheta + numCells[2]); // start from the minimum existing theta cell in this layer
+                uint64_t id = cellId;
+                aCells.emplace_back(id, hcalPhiThetaSegmentation->neighbours(id, m_includeDiagonalCellsHCal));
+              }
             }
-          }
+          });
         } // Barrel
 
         // For endcap, determine neighbours separately for positive- and negative-z part
@@ -349,17 +366,18 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
           debug() << "Number of segmentation cells in phi, in theta, and min theta ID, for positive-z HCal endcap : "
                   << numCells << endmsg;
           // Loop over segmentation cells
-          for (unsigned int iphi = 0; iphi < numCells[0]; iphi++) {
-            for (unsigned int itheta = 0; itheta < numCells[1]; itheta++) {
-              dd4hep::DDSegmentation::CellID cellId = volumeId;
-              decoder->set(cellId, "phi", iphi);
-              decoder->set(cellId, "theta",
-                           itheta + numCells[2]); // start from the minimum existing theta cell in this layer
-              uint64_t id = cellId;
-              map.insert(std::pair<uint64_t, std::vector<uint64_t>>(
-                  id, hcalPhiThetaSegmentation->neighbours(id, m_includeDiagonalCellsHCal)));
+          blocks.emplace_back([=, this](CellNeighbours& aCells) {
+            for (unsigned int iphi = 0; iphi < numCells[0]; iphi++) {
+              for (unsigned int itheta = 0; itheta < numCells[1]; itheta++) {
+                dd4hep::DDSegmentation::CellID cellId = volumeId;
+                decoder->set(cellId, "phi", iphi);
+                decoder->set(cellId, "theta",
+                             itheta + numCells[2]); // start from the minimum existing theta cell in this layer
+                uint64_t id = cellId;
+                aCells.emplace_back(id, hcalPhiThetaSegmentation->neighbours(id, m_includeDiagonalCellsHCal));
+              }
             }
-          }
+          });
 
           // ID of first cell theta bin (smallest theta) in the negative-z part of the endcap
           if (numCells[1] > 0)
@@ -369,17 +387,18 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
           debug() << "Number of segmentation cells in phi, in theta, and min theta ID, for negative-z HCal endcap : "
                   << numCells << endmsg;
           // Loop over segmentation cells
-          for (unsigned int iphi = 0; iphi < numCells[0]; iphi++) {
-            for (unsigned int itheta = 0; itheta < numCells[1]; itheta++) {
-              dd4hep::DDSegmentation::CellID cellId = volumeId;
-              decoder->set(cellId, "phi", iphi);
-              decoder->set(cellId, "theta",
-                           itheta + numCells[2]); // start from the minimum existing theta cell in this layer
-              uint64_t id = cellId;
-              map.insert(std::pair<uint64_t, std::vector<uint64_t>>(
-                  id, hcalPhiThetaSegmentation->neighbours(id, m_includeDiagonalCellsHCal)));
+          blocks.emplace_back([=, this](CellNeighbours& aCells) {
+            for (unsigned int iphi = 0; iphi < numCells[0]; iphi++) {
+              for (unsigned int itheta = 0; itheta < numCells[1]; itheta++) {
+                dd4hep::DDSegmentation::CellID cellId = volumeId;
+                decoder->set(cellId, "phi", iphi);
+                decoder->set(cellId, "theta",
+                             itheta + numCells[2]); // start from the minimum existing theta cell in this layer
+                uint64_t id = cellId;
+                aCells.emplace_back(id, hcalPhiThetaSegmentation->neighbours(id, m_includeDiagonalCellsHCal));
+              }
             }
-          }
+          });
         } // Endcap
       }
     }
@@ -419,16 +438,18 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
           debug() << "Number of segmentation cells in phi, in row, and min cell index, for HCal barrel : " << numCells
                   << endmsg;
           // Loop over segmentation cells
-          for (int iphi = 0; iphi < numCells[0]; iphi++) {
-            for (int irow = 0; irow < numCells[1]; irow++) {
-              dd4hep::DDSegmentation::CellID cellId = volumeId;
-              decoder->set(cellId, "phi", iphi);
-              decoder->set(cellId, "row",
-                           irow + numCells[2]); // start from the minimum existing cell index in this layer
-              uint64_t id = cellId;
-              map.insert(std::pair<uint64_t, std::vector<uint64_t>>(id, hcalPhiRowSegmentation->neighbours(id)));
+          blocks.emplace_back([=, this](CellNeighbours& aCells) {
+            for (int iphi = 0; iphi < numCells[0]; iphi++) {
+              for (int irow = 0; irow < numCells[1]; irow++) {
+                dd4hep::DDSegmentation::CellID cellId = volumeId;
+                decoder->set(cellId, "phi", iphi);
+                decoder->set(cellId, "row",
+                             irow + numCells[2]); // start from the minimum existing cell index in this layer
+                uint64_t id = cellId;
+                aCells.emplace_back(id, hcalPhiRowSegmentation->neighbours(id));
+              }
             }
-          }
+          });
         } // Barrel
 
         // For endcap, determine neighbours separately for positive- and negative-z part
@@ -448,16 +469,18 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
           debug() << "Number of segmentation cells in phi, in row, and min cell index, for positive-z HCal endcap : "
                   << numCells << endmsg;
           // Loop over segmentation cells
-          for (int iphi = 0; iphi < numCells[0]; iphi++) {
-            for (int irow = 0; irow < numCells[1]; irow++) {
-              dd4hep::DDSegmentation::CellID cellId = volumeId;
-              decoder->set(cellId, "phi", iphi);
-              decoder->set(cellId, "row",
-                           irow + numCells[2]); // start from the minimum existing cell index in this layer
-              uint64_t id = cellId;
-              map.insert(std::pair<uint64_t, std::vector<uint64_t>>(id, hcalPhiRowSegmentation->neighbours(id)));
+          blocks.emplace_back([=, this](CellNeighbours& aCells) {
+            for (int iphi = 0; iphi < numCells[0]; iphi++) {
+              for (int irow = 0; irow < numCells[1]; irow++) {
+                dd4hep::DDSegmentation::CellID cellId = volumeId;
+                decoder->set(cellId, "phi", iphi);
+                decoder->set(cellId, "row",
+                             irow + numCells[2]); // start from the minimum existing cell index in this layer
+                uint64_t id = cellId;
+                aCells.emplace_back(id, hcalPhiRowSegmentation->neighbours(id));
+              }
             }
-          }
+          });
 
           // minimum cell index in the negative-z part of the endcap
           if (numCells[1] > 0)
@@ -467,15 +490,17 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
           debug() << "Number of segmentation cells in phi, in row, and min cell index, for negative-z HCal endcap : "
                   << numCells << endmsg;
           // Loop over segmentation cells
-          for (int iphi = 0; iphi < numCells[0]; iphi++) {
-            for (int irow = 0; irow < numCells[1]; irow++) {
-              dd4hep::DDSegmentation::CellID cellId = volumeId;
-              decoder->set(cellId, "phi", iphi);
-              decoder->set(cellId, "row", irow + numCells[2]); // start from the minimum cell index in this layer
-              uint64_t id = cellId;
-              map.insert(std::pair<uint64_t, std::vector<uint64_t>>(id, hcalPhiRowSegmentation->neighbours(id)));
+          blocks.emplace_back([=, this](CellNeighbours& aCells) {
+            for (int iphi = 0; iphi < numCells[0]; iphi++) {
+              for (int irow = 0; irow < numCells[1]; irow++) {
+                dd4hep::DDSegmentation::CellID cellId = volumeId;
+                decoder->set(cellId, "phi", iphi);
+                decoder->set(cellId, "row", irow + numCells[2]); // start from the minimum cell index in this layer
+                uint64_t id = cellId;
+                aCells.emplace_back(id, hcalPhiRowSegmentation->neighbours(id));
+              }
             }
-          }
+          });
         } // Endcap
       }
     }
@@ -516,20 +541,22 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
         debug() << "Extrema[2]: " << extrema[2].first << " , " << extrema[2].second << endmsg;
         debug() << "Number of segmentation cells in (module,theta): " << numCells << endmsg;
         // Loop over segmentation cells to find neighbours in ECAL
-        for (int imodule = extrema[1].first; imodule <= extrema[1].second;
-             imodule += moduleThetaSegmentation->mergedModules(ilayer)) {
-          for (int itheta = extrema[2].first; itheta <= extrema[2].second;
-               itheta += moduleThetaSegmentation->mergedThetaCells(ilayer)) {
-            dd4hep::DDSegmentation::CellID cellId = volumeId;
-            decoder->set(cellId, "module", imodule);
-            decoder->set(cellId, "theta", itheta); // start from the minimum existing theta cell in this layer
-            uint64_t id = cellId;
-            map.insert(std::pair<uint64_t, std::vector<uint64_t>>(
-                id, det::utils::neighbours_ModuleThetaMerged(*moduleThetaSegmentation, *decoder,
-                                                             {m_activeFieldNamesSegmented[iSys], "module", "theta"},
-                                                             extrema, id, m_includeDiagonalCells)));
+        blocks.emplace_back([=, this](CellNeighbours& aCells) {
+          for (int imodule = extrema[1].first; imodule <= extrema[1].second;
+               imodule += moduleThetaSegmentation->mergedModules(ilayer)) {
+            for (int itheta = extrema[2].first; itheta <= extrema[2].second;
+                 itheta += moduleThetaSegmentation->mergedThetaCells(ilayer)) {
+              dd4hep::DDSegmentation::CellID cellId = volumeId;
+              decoder->set(cellId, "module", imodule);
+              decoder->set(cellId, "theta", itheta); // start from the minimum existing theta cell in this layer
+              uint64_t id = cellId;
+              aCells.emplace_back(id, det::utils::neighbours_ModuleThetaMerged(
+                                          *moduleThetaSegmentation, *decoder,
+                                          {m_activeFieldNamesSegmented[iSys], "module", "theta"}, extrema, id,
+                                          m_includeDiagonalCells));
+            }
           }
-        }
+        });
       }
     } else if (segmentationType == "FCCSWEndcapTurbine_k4geo") {
       // Loop over active layers
@@ -572,112 +599,114 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
           debug() << "Extrema[1]: " << extrema[1].first << " , " << extrema[1].second << endmsg;
           debug() << "Extrema[2]: " << extrema[2].first << " , " << extrema[2].second << endmsg;
           // Loop over segmentation cells
-          for (unsigned imodule = 0; imodule < numModules; imodule++) {
-            for (unsigned irho = 0; irho < numCellsRho; irho++) {
-              for (unsigned iz = 0; iz < numCellsZ; iz++) {
-                // check if we're at the boundary between wheels
-                bool atInnerBoundary = false, atOuterBoundary = false;
-                if (iWheel > 0 && irho == 0)
-                  atInnerBoundary = true;
-                if (iWheel < 2 && irho == numCellsRho - 1)
-                  atOuterBoundary = true;
-                dd4hep::DDSegmentation::CellID cellId = volumeId;
-                decoder->set(cellId, "wheel", iWheel);
-                decoder->set(cellId, "module", imodule);
-                decoder->set(cellId, "rho", irho);
-                decoder->set(cellId, "z", iz);
-
-                unsigned iLayerZ = iz / (numCellsZ / numCellsZCalib);
-                unsigned iLayerRho = irho / (numCellsRho / numCellsRhoCalib);
-                unsigned iLayer = layerOffset[iWheel] + iLayerRho * numCellsZCalib + iLayerZ;
-                decoder->set(cellId, "layer", iLayer);
-                uint64_t id = cellId;
-                debug() << "Mapping cell " << cellId << " " << std::hex << cellId << std::dec << endmsg;
-                auto neighborsList = det::utils::neighbours(*decoder, {"module", "rho", "z"}, extrema, id,
-                                                            {true, false, false}, m_includeDiagonalCells);
-                // now correct the layer index for the neighbours, since the
-                // rho and z indices change
-                unsigned idx = 0;
-                for (auto nCell : neighborsList) {
-                  unsigned lirho = decoder->get(nCell, "rho");
-                  unsigned liz = decoder->get(nCell, "z");
-                  unsigned correctLayer = layerOffset[iWheel] +
-                                          lirho / (numCellsRho / numCellsRhoCalib) * numCellsZCalib +
-                                          liz / (numCellsZ / numCellsZCalib);
-                  decoder->set(nCell, "layer", correctLayer);
-                  neighborsList[idx] = nCell;
-                  idx++;
-                }
-                // if we're at a boundary between wheels, add the
-                // appropriate cells in the neighboring wheel
-                if (atInnerBoundary || atOuterBoundary) {
-                  unsigned otherWheel, otherRho, newLayerOffset;
-                  if (atInnerBoundary) {
-                    otherWheel = iWheel - 1;
-                    otherRho = ecalEndcapTurbineSegmentation->numCellsRho(otherWheel);
-                  } else {
-                    otherWheel = iWheel + 1;
-                    otherRho = 0;
-                  }
-                  newLayerOffset = layerOffset[otherWheel];
-                  unsigned numModulesotherWheel = ecalEndcapTurbineSegmentation->nModules(otherWheel);
-                  unsigned numCellsZotherWheel = ecalEndcapTurbineSegmentation->numCellsZ(otherWheel);
-                  unsigned numCellsRhootherWheel = ecalEndcapTurbineSegmentation->numCellsRho(otherWheel);
-                  unsigned numCellsZCalibotherWheel = ecalEndcapTurbineSegmentation->numCellsZCalib(otherWheel);
-                  unsigned numCellsRhoCalibotherWheel = ecalEndcapTurbineSegmentation->numCellsRhoCalib(otherWheel);
-                  uint64_t newZ;
-                  int newModule;
-                  if (numCellsZ > numCellsZotherWheel) {
-                    newZ = decoder->get(cellId, "z") / ((1.0 * numCellsZ) / numCellsZotherWheel);
-                  } else {
-                    newZ = decoder->get(cellId, "z") * ((1.0 * numCellsZotherWheel) / numCellsZ);
-                  }
-                  // calculate offset in module index due to differences in
-                  // blade angle in different wheels
-                  double rho, z;
-                  if (atInnerBoundary) {
-                    rho = ecalEndcapTurbineSegmentation->offsetRho(iWheel);
-                  } else {
-                    rho = ecalEndcapTurbineSegmentation->offsetRho(otherWheel);
-                  }
-                  z = ((int)(iz - numCellsZ / 2)) * ecalEndcapTurbineSegmentation->gridSizeZ(iWheel);
-                  double alpha = ecalEndcapTurbineSegmentation->bladeAngle(iWheel);
-                  double alphaotherWheel = ecalEndcapTurbineSegmentation->bladeAngle(otherWheel);
-                  int moduleOffset = numModulesotherWheel * (z / (2 * TMath::Pi() * rho)) *
-                                     (1. / TMath::Tan(alpha) - 1. / TMath::Tan(alphaotherWheel));
-
-                  if (numModules > numModulesotherWheel) {
-                    newModule =
-                        decoder->get(cellId, "module") / ((1.0 * numModules) / numModulesotherWheel) + moduleOffset;
-                  } else {
-                    newModule =
-                        decoder->get(cellId, "module") * ((1.0 * numModulesotherWheel) / numModules) + moduleOffset;
+          blocks.emplace_back([=, this](CellNeighbours& aCells) {
+            for (unsigned imodule = 0; imodule < numModules; imodule++) {
+              for (unsigned irho = 0; irho < numCellsRho; irho++) {
+                for (unsigned iz = 0; iz < numCellsZ; iz++) {
+                  // check if we're at the boundary between wheels
+                  bool atInnerBoundary = false, atOuterBoundary = false;
+                  if (iWheel > 0 && irho == 0)
+                    atInnerBoundary = true;
+                  if (iWheel < 2 && irho == numCellsRho - 1)
+                    atOuterBoundary = true;
+                  dd4hep::DDSegmentation::CellID cellId = volumeId;
+                  decoder->set(cellId, "wheel", iWheel);
+                  decoder->set(cellId, "module", imodule);
+                  decoder->set(cellId, "rho", irho);
+                  decoder->set(cellId, "z", iz);
+
+                  unsigned iLayerZ = iz / (numCellsZ / numCellsZCalib);
+                  unsigned iLayerRho = irho / (numCellsRho / numCellsRhoCalib);
+                  unsigned iLayer = layerOffset[iWheel] + iLayerRho * numCellsZCalib + iLayerZ;
+                  decoder->set(cellId, "layer", iLayer);
+                  uint64_t id = cellId;
+                  auto neighborsList = det::utils::neighbours(*decoder, {"module", "rho", "z"}, extrema, id,
+                                                              {true, false, false}, m_includeDiagonalCells);
+                  // now correct the layer index for the neighbours, since the
+                  // rho and z indices change
+                  unsigned idx = 0;
+                  for (auto nCell : neighborsList) {
+                    unsigned lirho = decoder->get(nCell, "rho");
+                    unsigned liz = decoder->get(nCell, "z");
+                    unsigned correctLayer = layerOffset[iWheel] +
+                                            lirho / (numCellsRho / numCellsRhoCalib) * numCellsZCalib +
+                                            liz / (numCellsZ / numCellsZCalib);
+                    decoder->set(nCell, "layer", correctLayer);
+                    neighborsList[idx] = nCell;
+                    idx++;
                   }
-                  if (newModule < 0)
-                    newModule = numModulesotherWheel + newModule;
-                  unsigned newLayer =
-                      newLayerOffset +
-                      otherRho / (numCellsRhootherWheel / numCellsRhoCalibotherWheel) * numCellsZCalibotherWheel +
-                      newZ / (numCellsZotherWheel / numCellsZCalibotherWheel);
-                  for (int ibmod = 0; ibmod < 2; ibmod++) {
-                    for (int izmod = 0; izmod < 2; izmod++) {
-                      uint64_t newCellId = cellId;
-                      decoder->set(newCellId, "wheel", otherWheel);
-                      decoder->set(newCellId, "rho", otherRho);
-                      decoder->set(newCellId, "z", newZ + izmod / 1);
-                      decoder->set(newCellId, "module", newModule + ibmod / 1);
-                      decoder->set(newCellId, "layer", newLayer);
-                      neighborsList.push_back(newCellId);
+                  // if we're at a boundary between wheels, add the
+                  // appropriate cells in the neighboring wheel
+                  if (atInnerBoundary || atOuterBoundary) {
+                    unsigned otherWheel, otherRho, newLayerOffset;
+                    if (atInnerBoundary) {
+                      otherWheel = iWheel - 1;
+                      otherRho = ecalEndcapTurbineSegmentation->numCellsRho(otherWheel);
+                    } else {
+                      otherWheel = iWheel + 1;
+                      otherRho = 0;
+                    }
+                    newLayerOffset = layerOffset[otherWheel];
+                    unsigned numModulesotherWheel = ecalEndcapTurbineSegmentation->nModules(otherWheel);
+                    unsigned numCellsZotherWheel = ecalEndcapTurbineSegmentation->numCellsZ(otherWheel);
+                    unsigned numCellsRhootherWheel = ecalEndcapTurbineSegmentation->numCellsRho(otherWheel);
+                    unsigned numCellsZCalibotherWheel = ecalEndcapTurbineSegmentation->numCellsZCalib(otherWheel);
+                    unsigned numCellsRhoCalibotherWheel = ecalEndcapTurbineSegmentation->numCellsRhoCalib(otherWheel);
+                    uint64_t newZ;
+                    int newModule;
+                    if (numCellsZ > numCellsZotherWheel) {
+                      newZ = decoder->get(cellId, "z") / ((1.0 * numCellsZ) / numCellsZotherWheel);
+                    } else {
+                      newZ = decoder->get(cellId, "z") * ((1.0 * numCellsZotherWheel) / numCellsZ);
+                    }
+                    // calculate offset in module index due to differences in
+                    // blade angle in different wheels
+                    double rho, z;
+                    if (atInnerBoundary) {
+                      rho = ecalEndcapTurbineSegmentation->offsetRho(iWheel);
+                    } else {
+                      rho = ecalEndcapTurbineSegmentation->offsetRho(otherWheel);
+                    }
+                    z = ((int)(iz - numCellsZ / 2)) * ecalEndcapTurbineSegmentation->gridSizeZ(iWheel);
+                    double alpha = ecalEndcapTurbineSegmentation->bladeAngle(iWheel);
+                    double alphaotherWheel = ecalEndcapTurbineSegmentation->bladeAngle(otherWheel);
+                    int moduleOffset = numModulesotherWheel * (z / (2 * TMath::Pi() * rho)) *
+                                       (1. / TMath::Tan(alpha) - 1. / TMath::Tan(alphaotherWheel));
+
+                    if (numModules > numModulesotherWheel) {
+                      newModule =
+                          decoder->get(cellId, "module") / ((1.0 * numModules) / numModulesotherWheel) + moduleOffset;
+                    } else {
+                      newModule =
+                          decoder->get(cellId, "module") * ((1.0 * numModulesotherWheel) / numModules) + moduleOffset;
+                    }
+                    if (newModule < 0)
+                      newModule = numModulesotherWheel + newModule;
+                    unsigned newLayer =
+                        newLayerOffset +
+                        otherRho / (numCellsRhootherWheel / numCellsRhoCalibotherWheel) * numCellsZCalibotherWheel +
+                        newZ / (numCellsZotherWheel / numCellsZCalibotherWheel);
+                    for (int ibmod = 0; ibmod < 2; ibmod++) {
+                      for (int izmod = 0; izmod < 2; izmod++) {
+                        uint64_t newCellId = cellId;
+                        decoder->set(newCellId, "wheel", otherWheel);
+                        decoder->set(newCellId, "rho", otherRho);
+                        decoder->set(newCellId, "z", newZ + izmod / 1);
+                        decoder->set(newCellId, "module", newModule + ibmod / 1);
+                        decoder->set(newCellId, "layer", newLayer);
+                        neighborsList.push_back(newCellId);
+                      }
                     }
                   }
+                  aCells.emplace_back(id, std::move(neighborsList));
                 }
-                map.insert(std::pair<uint64_t, std::vector<uint64_t>>(id, neighborsList));
               }
             }
-          }
+          });
         }
       }
     }
+    fillNeighbours(map, blocks);
 
     if (msgLevel() <= MSG::DEBUG) {
       std::vector<int> counter;
@@ -704,568 +733,19 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
   }
   // FCCSWHCalPhiTheta segmentation
   else if (m_connectHCal && hcalBarrelSegmentation && hcalEndcapSegmentation) {
-    debug() << "Linking the HCal Barrel and HCal Endcap" << endmsg;
-
-    // Get the part1 and part2 endcap layer indexes that will be used to connect Barrel cells to the Endcap cells
-    std::vector<int> minLayerIdEndcap = {0, 0};
-    std::vector<int> maxLayerIdEndcap = {0, 0};
-    std::vector<std::pair<uint, uint>> minMaxLayerId(hcalEndcapSegmentation->getMinMaxLayerId());
-    if (minMaxLayerId.empty()) {
-      error() << "hcalEndcap segmentation is not configured correctly, cannot link Endcap and Barrel!" << endmsg;
+    if (connectHCalBarrelEndcap(map, *hcalBarrelSegmentation, *hcalEndcapSegmentation, *decoderHCalBarrel,
+                                *decoderHCalEndcap, hcalBarrelId, hcalEndcapId)
+            .isFailure()) {
       return StatusCode::FAILURE;
     }
-
-    // Loop over active layers
-    for (unsigned int ilayer = 0; ilayer < m_activeVolumesNumbersSegmented[hcalBarrelId]; ilayer++) {
-      debug() << "HCal Barrel Layer: " << ilayer << endmsg;
-      std::array<dd4hep::DDSegmentation::CellID, 2> barrelCellID = {0, 0};
-      (*decoderHCalBarrel)[m_fieldNamesSegmented[hcalBarrelId]].set(barrelCellID[0],
-                                                                    m_fieldValuesSegmented[hcalBarrelId]);
-      (*decoderHCalBarrel)[m_activeFieldNamesSegmented[hcalBarrelId]].set(barrelCellID[0], ilayer);
-      (*decoderHCalBarrel)["theta"].set(barrelCellID[0], 0);
-      (*decoderHCalBarrel)["phi"].set(barrelCellID[0], 0);
-      (*decoderHCalBarrel)[m_fieldNamesSegmented[hcalBarrelId]].set(barrelCellID[1],
-                                                                    m_fieldValuesSegmented[hcalBarrelId]);
-      (*decoderHCalBarrel)[m_activeFieldNamesSegmented[hcalBarrelId]].set(barrelCellID[1], ilayer);
-      (*decoderHCalBarrel)["theta"].set(barrelCellID[1], 0);
-      (*decoderHCalBarrel)["phi"].set(barrelCellID[1], 0);
-
-      std::vector<int> thetaBins(hcalBarrelSegmentation->thetaBins(ilayer));
-      int minCellId = thetaBins.front(); // first cell (lowest theta bin) in the barrel layer
-      int maxCellId = thetaBins.back();  // last cell (highest theta bin) in the barrel layer
-      int nPhiBins = hcalBarrelSegmentation->phiBins();
-      for (int iphi = 0; iphi < nPhiBins; iphi++) {
-        // set the final bits for the first cell in the barrel layer
-        decoderHCalBarrel->set(barrelCellID[0], "phi", iphi);
-        decoderHCalBarrel->set(barrelCellID[0], "theta", minCellId);
-        // set the final bits for the last cell in the barrel layer
-        decoderHCalBarrel->set(barrelCellID[1], "phi", iphi);
-        decoderHCalBarrel->set(barrelCellID[1], "theta", maxCellId);
-
-        // Number of neighbours for the first and the last cell in the barrel layer
-        std::array<uint64_t, 2> numberOfNeighbours = {map[barrelCellID[0]].size(), map[barrelCellID[1]].size()};
-
-        // min and max polar angle for the first cell in the barrel layer
-        std::array<double, 2> minCellIdTheta = hcalBarrelSegmentation->cellTheta(barrelCellID[0]);
-        // min and max polar angle for the last cell in the barrel layer
-        std::array<double, 2> maxCellIdTheta = hcalBarrelSegmentation->cellTheta(barrelCellID[1]);
-
-        // part1 min and max layer index
-        minLayerIdEndcap[0] = minMaxLayerId[0].first;
-        maxLayerIdEndcap[0] = minMaxLayerId[0].second;
-        // part2 min and max layer index
-        minLayerIdEndcap[1] = minMaxLayerId[1].first;
-        maxLayerIdEndcap[1] = minMaxLayerId[1].second;
-
-        // create the endcap cellID that should become the neighbour for the barrel cell
-        dd4hep::DDSegmentation::CellID endcapCellID;
-        (*decoderHCalEndcap)[m_fieldNamesSegmented[hcalEndcapId]].set(endcapCellID,
-                                                                      m_fieldValuesSegmented[hcalEndcapId]);
-        (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-
-        // loop over the part1 layers
-        for (int part1LayerId = minLayerIdEndcap[0]; part1LayerId <= maxLayerIdEndcap[0]; part1LayerId++) {
-          // set the layer bit field for part1 layer
-          (*decoderHCalEndcap)[m_activeFieldNamesSegmented[hcalEndcapId]].set(endcapCellID, part1LayerId);
-
-          // get cell indexes in the given endcap layer
-          std::vector<int> endcapThetaBins(hcalEndcapSegmentation->thetaBins(part1LayerId));
-
-          // consider all cells in the first layer of part1 endcap
-          if (part1LayerId == minLayerIdEndcap[0]) {
-            for (auto bin : endcapThetaBins) {
-              decoderHCalEndcap->set(endcapCellID, "theta", bin);
-              // get thetaMin and thetaMax of the endcap cell
-              std::array<double, 2> cTheta = hcalEndcapSegmentation->cellTheta(endcapCellID);
-              // add in the neighbours list if it overlaps with first barrel cell in theta
-              if ((cTheta[0] <= minCellIdTheta[0] && cTheta[1] > minCellIdTheta[0]) ||
-                  (cTheta[0] > minCellIdTheta[0] && cTheta[0] < minCellIdTheta[1])) {
-                map[barrelCellID[0]].push_back(
-                    endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[0]); // add the first barrel cell to the list of the endcap cell neighbours
-                // add the next and previous phi modules as well
-                // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-                map[barrelCellID[0]].push_back(
-                    endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-                // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-                // current + 1
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-                map[barrelCellID[0]].push_back(
-                    endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-                // restore back the iphi value
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-              }
-              // add in the neighbours list if it overlaps with first barrel cell in theta
-              if ((cTheta[0] <= maxCellIdTheta[0] && cTheta[1] > maxCellIdTheta[0]) ||
-                  (cTheta[0] > maxCellIdTheta[0] && cTheta[0] < maxCellIdTheta[1])) {
-                map[barrelCellID[1]].push_back(
-                    endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-                // add the next and previous phi modules as well
-                // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-                map[barrelCellID[1]].push_back(
-                    endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-                // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-                // current + 1
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-                map[barrelCellID[1]].push_back(
-                    endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-                // restore back the iphi value
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-              }
-            }
-          } else // consider only the first cell
-          {
-            std::array<double, 2> cTheta;
-            decoderHCalEndcap->set(
-                endcapCellID, "theta",
-                endcapThetaBins[endcapThetaBins.size() / 2 -
-                                1]); // first cell (highest theta bin) in the positive-z part endcap layer
-            // add in the neighbours list if it overlaps with first barrel cell in theta
-            cTheta = hcalEndcapSegmentation->cellTheta(endcapCellID); // get thetaMin and thetaMax of the endcap cell
-            if ((cTheta[0] <= minCellIdTheta[0] && cTheta[1] > minCellIdTheta[0]) ||
-                (cTheta[0] > minCellIdTheta[0] && cTheta[0] < minCellIdTheta[1])) {
-              map[barrelCellID[0]].push_back(
-                  endcapCellID); // add to the neighbours list of the first (lowest theta bin) cell in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[0]); // add the first barrel cell to the list of the endcap cell neighbours
-              // add the next and previous phi modules as well
-              // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-              map[barrelCellID[0]].push_back(
-                  endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-              // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-              // current + 1
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-              map[barrelCellID[0]].push_back(
-                  endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-              // restore back the iphi value
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-            }
-            decoderHCalEndcap->set(endcapCellID, "theta",
-                                   endcapThetaBins[endcapThetaBins.size() / 2]); // first cell (lowest theta bin) in the
-                                                                                 // negative-z part endcap layer
-            // add in the neighbours list if it overlaps with the last barrel cell in theta
-            cTheta = hcalEndcapSegmentation->cellTheta(endcapCellID); // get thetaMin and thetaMax of the endcap cell
-            if ((cTheta[0] <= maxCellIdTheta[0] && cTheta[1] > maxCellIdTheta[0]) ||
-                (cTheta[0] > maxCellIdTheta[0] && cTheta[0] < maxCellIdTheta[1])) {
-              map[barrelCellID[1]].push_back(
-                  endcapCellID); // add to the neighbours list of the last cell (highest theta bin) in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-              // add the next and previous phi modules as well
-              // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-              map[barrelCellID[1]].push_back(
-                  endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-              // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-              // current + 1
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-              map[barrelCellID[1]].push_back(
-                  endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-              // restore back the iphi value
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-            }
-          }
-        }
-
-        // loop over the part2 layers
-        // consider only the first cell of each layer
-        for (int part2LayerId = minLayerIdEndcap[1]; part2LayerId <= maxLayerIdEndcap[1]; part2LayerId++) {
-          // set the layer bit field for part2 layer
-          (*decoderHCalEndcap)[m_activeFieldNamesSegmented[hcalEndcapId]].set(endcapCellID, part2LayerId);
-
-          // get cell indexes in the given endcap layer
-          std::vector<int> endcapThetaBins(hcalEndcapSegmentation->thetaBins(part2LayerId));
-
-          std::array<double, 2> cTheta;
-          decoderHCalEndcap->set(endcapCellID, "theta",
-                                 endcapThetaBins[endcapThetaBins.size() / 2 - 1]); // first cell (highest theta bin) in
-                                                                                   // the positive-z part endcap layer
-
-          // we do not want to add the part2 layer cells that have part1 cells in the neighbours list
-          // try to find if there is a part1 cell in the list of neighbours
-          bool hasPart1Neighbour = false;
-          // loop over the neighbours of the first cell
-          for (auto nCellid : map[endcapCellID]) {
-            int nLayerId = decoderHCalEndcap->get(nCellid, "layer");
-            int systemId = decoderHCalEndcap->get(nCellid, "system");
-            // check if the neighbour cell is in the endcap part1 layer
-            if (nLayerId >= minLayerIdEndcap[0] && nLayerId <= maxLayerIdEndcap[0] && systemId == hcalEndcapId) {
-              hasPart1Neighbour = true;
-              break;
-            }
-          }
-
-          // add in the neighbours list if it overlaps with first barrel cell in theta
-          cTheta = hcalEndcapSegmentation->cellTheta(endcapCellID); // get thetaMin and thetaMax of the endcap cell
-          if ((cTheta[0] <= minCellIdTheta[0] && cTheta[1] > minCellIdTheta[0]) ||
-              (cTheta[0] > minCellIdTheta[0] && cTheta[0] < minCellIdTheta[1])) {
-            map[barrelCellID[0]].push_back(
-                endcapCellID); // add to the neighbours list of the first cell (lowest theta bin) in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[0]); // add the first barrel cell to the list of the endcap cell neighbours
-            // add the next and previous phi modules as well
-            // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-            map[barrelCellID[0]].push_back(
-                endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-            // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-            // current + 1
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-            map[barrelCellID[0]].push_back(
-                endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-            // restore back the iphi value
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-          }
-          decoderHCalEndcap->set(endcapCellID, "theta",
-                                 endcapThetaBins[endcapThetaBins.size() / 2]); // first cell (lowest theta bin) in the
-                                                                               // negative-z part endcap layer
-          // add in the neighbours list if it overlaps with the last barrel cell in theta
-          cTheta = hcalEndcapSegmentation->cellTheta(endcapCellID); // get thetaMin and thetaMax of the endcap cell
-          if ((cTheta[0] <= maxCellIdTheta[0] && cTheta[1] > maxCellIdTheta[0]) ||
-              (cTheta[0] > maxCellIdTheta[0] && cTheta[0] < maxCellIdTheta[1])) {
-            map[barrelCellID[1]].push_back(
-                endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-            // add the next and previous phi modules as well
-            // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-            map[barrelCellID[1]].push_back(
-                endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-            // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-            // current + 1
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-            map[barrelCellID[1]].push_back(
-                endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-            // restore back the iphi value
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-          }
-
-          // if the cell in this layer has a neighbour in the part1 layers, then stop here the part2 layers loop
-          if (hasPart1Neighbour)
-            break;
-        }
-        debug() << "Layer: " << ilayer << " iphi: " << iphi << " First Barrel CellID: " << barrelCellID[0] << ": "
-                << map[barrelCellID[0]].size() - numberOfNeighbours[0]
-                << " neighbours added after connecting Barrel+Endcap." << endmsg;
-        debug() << "Layer: " << ilayer << " iphi: " << iphi << " Last Barrel CellID: " << barrelCellID[1] << ": "
-                << map[barrelCellID[1]].size() - numberOfNeighbours[1]
-                << " neighbours added after connecting Barrel+Endcap." << endmsg;
-      } // iphi loop
-    } // loop over the barrel layers
   }
   // FCCSWHCalPhiRow segmentation
   else if (m_connectHCal && hcalBarrelPhiRowSegmentation && hcalEndcapPhiRowSegmentation) {
-    debug() << "Linking the HCal Barrel and HCal Endcap" << endmsg;
-
-    // Get the part1 and part2 endcap layer indexes that will be used to connect Barrel cells to the Endcap cells
-    std::vector<int> minLayerIdEndcap = {0, 0};
-    std::vector<int> maxLayerIdEndcap = {0, 0};
-    std::vector<std::pair<uint, uint>> minMaxLayerId(hcalEndcapPhiRowSegmentation->getMinMaxLayerId());
-    if (minMaxLayerId.empty()) {
-      error() << "hcalEndcap segmentation is not configured correctly, cannot link Endcap and Barrel!" << endmsg;
+    if (connectHCalBarrelEndcap(map, *hcalBarrelPhiRowSegmentation, *hcalEndcapPhiRowSegmentation,
+                                *decoderHCalBarrel, *decoderHCalEndcap, hcalBarrelId, hcalEndcapId)
+            .isFailure()) {
       return StatusCode::FAILURE;
     }
-
-    // Loop over active layers
-    for (unsigned int ilayer = 0; ilayer < m_activeVolumesNumbersSegmented[hcalBarrelId]; ilayer++) {
-      debug() << "HCal Barrel Layer: " << ilayer << endmsg;
-      std::array<dd4hep::DDSegmentation::CellID, 2> barrelCellID = {0, 0};
-      (*decoderHCalBarrel)[m_fieldNamesSegmented[hcalBarrelId]].set(barrelCellID[0],
-                                                                    m_fieldValuesSegmented[hcalBarrelId]);
-      (*decoderHCalBarrel)[m_activeFieldNamesSegmented[hcalBarrelId]].set(barrelCellID[0], ilayer);
-      (*decoderHCalBarrel)["row"].set(barrelCellID[0], 0);
-      (*decoderHCalBarrel)["phi"].set(barrelCellID[0], 0);
-      (*decoderHCalBarrel)[m_fieldNamesSegmented[hcalBarrelId]].set(barrelCellID[1],
-                                                                    m_fieldValuesSegmented[hcalBarrelId]);
-      (*decoderHCalBarrel)[m_activeFieldNamesSegmented[hcalBarrelId]].set(barrelCellID[1], ilayer);
-      (*decoderHCalBarrel)["row"].set(barrelCellID[1], 0);
-      (*decoderHCalBarrel)["phi"].set(barrelCellID[1], 0);
-
-      std::vector<int> cellIndexes(hcalBarrelPhiRowSegmentation->cellIndexes(ilayer));
-      int minCellId = cellIndexes.front(); // first cell in the barrel layer
-      int maxCellId = cellIndexes.back();  // last cell in the barrel layer
-      int nPhiBins = hcalBarrelPhiRowSegmentation->phiBins();
-      for (int iphi = 0; iphi < nPhiBins; iphi++) {
-        // set the final bits for the first cell in the barrel layer
-        decoderHCalBarrel->set(barrelCellID[0], "phi", iphi);
-        decoderHCalBarrel->set(barrelCellID[0], "row", minCellId);
-        // set the final bits for the last cell in the barrel layer
-        decoderHCalBarrel->set(barrelCellID[1], "phi", iphi);
-        decoderHCalBarrel->set(barrelCellID[1], "row", maxCellId);
-
-        // Number of neighbours for the first and the last cell in the barrel layer
-        std::array<uint64_t, 2> numberOfNeighbours = {map[barrelCellID[0]].size(), map[barrelCellID[1]].size()};
-
-        // min and max polar angle for the first cell in the barrel layer
-        std::array<double, 2> minCellIdTheta = hcalBarrelPhiRowSegmentation->cellTheta(barrelCellID[0]);
-        // min and max polar angle for the last cell in the barrel layer
-        std::array<double, 2> maxCellIdTheta = hcalBarrelPhiRowSegmentation->cellTheta(barrelCellID[1]);
-
-        // part1 min and max layer index
-        minLayerIdEndcap[0] = minMaxLayerId[0].first;
-        maxLayerIdEndcap[0] = minMaxLayerId[0].second;
-        // part2 min and max layer index
-        minLayerIdEndcap[1] = minMaxLayerId[1].first;
-        maxLayerIdEndcap[1] = minMaxLayerId[1].second;
-
-        // create the endcap cellID that should become the neighbour for the barrel cell
-        dd4hep::DDSegmentation::CellID endcapCellID;
-        (*decoderHCalEndcap)[m_fieldNamesSegmented[hcalEndcapId]].set(endcapCellID,
-                                                                      m_fieldValuesSegmented[hcalEndcapId]);
-        (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-
-        // loop over the part1 layers
-        for (int part1LayerId = minLayerIdEndcap[0]; part1LayerId <= maxLayerIdEndcap[0]; part1LayerId++) {
-          // set the layer bit field for part1 layer
-          (*decoderHCalEndcap)[m_activeFieldNamesSegmented[hcalEndcapId]].set(endcapCellID, part1LayerId);
-
-          // get cell indexes in the given endcap layer
-          std::vector<int> endcapCellIndexes(hcalEndcapPhiRowSegmentation->cellIndexes(part1LayerId));
-
-          // consider all cells in the first layer of part1 endcap
-          if (part1LayerId == minLayerIdEndcap[0]) {
-            for (auto idx : endcapCellIndexes) {
-              decoderHCalEndcap->set(endcapCellID, "row", idx);
-              // get thetaMin and thetaMax of the endcap cell
-              std::array<double, 2> cTheta = hcalEndcapPhiRowSegmentation->cellTheta(endcapCellID);
-              // add in the neighbours list if it overlaps with first barrel cell in theta
-              if ((cTheta[0] <= minCellIdTheta[0] && cTheta[1] > minCellIdTheta[0]) ||
-                  (cTheta[0] > minCellIdTheta[0] && cTheta[0] < minCellIdTheta[1])) {
-                map[barrelCellID[0]].push_back(
-                    endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[0]); // add the first barrel cell to the list of the endcap cell neighbours
-                // add the next and previous phi modules as well
-                // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-                map[barrelCellID[0]].push_back(
-                    endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-                // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-                // current + 1
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-                map[barrelCellID[0]].push_back(
-                    endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-                // restore back the iphi value
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-              }
-              // add in the neighbours list if it overlaps with first barrel cell in theta
-              if ((cTheta[0] <= maxCellIdTheta[0] && cTheta[1] > maxCellIdTheta[0]) ||
-                  (cTheta[0] > maxCellIdTheta[0] && cTheta[0] < maxCellIdTheta[1])) {
-                map[barrelCellID[1]].push_back(
-                    endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-                // add the next and previous phi modules as well
-                // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-                map[barrelCellID[1]].push_back(
-                    endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-                // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-                // current + 1
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-                map[barrelCellID[1]].push_back(
-                    endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-                map[endcapCellID].push_back(
-                    barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-                // restore back the iphi value
-                (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-              }
-            }
-          } else // consider only the first cell
-          {
-            std::array<double, 2> cTheta;
-            decoderHCalEndcap->set(
-                endcapCellID, "row",
-                endcapCellIndexes[endcapCellIndexes.size() / 2]); // first cell in the negative-z part endcap layer
-            // add in the neighbours list if it overlaps with first barrel cell in theta
-            cTheta =
-                hcalEndcapPhiRowSegmentation->cellTheta(endcapCellID); // get thetaMin and thetaMax of the endcap cell
-            if ((cTheta[0] <= minCellIdTheta[0] && cTheta[1] > minCellIdTheta[0]) ||
-                (cTheta[0] > minCellIdTheta[0] && cTheta[0] < minCellIdTheta[1])) {
-              map[barrelCellID[0]].push_back(
-                  endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[0]); // add the first barrel cell to the list of the endcap cell neighbours
-              // add the next and previous phi modules as well
-              // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-              map[barrelCellID[0]].push_back(
-                  endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-              // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-              // current + 1
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-              map[barrelCellID[0]].push_back(
-                  endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-              // restore back the iphi value
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-            }
-            decoderHCalEndcap->set(endcapCellID, "row",
-                                   endcapCellIndexes[0]); // first cell in the positive-z part endcap layer
-            // add in the neighbours list if it overlaps with the last barrel cell in theta
-            cTheta =
-                hcalEndcapPhiRowSegmentation->cellTheta(endcapCellID); // get thetaMin and thetaMax of the endcap cell
-            if ((cTheta[0] <= maxCellIdTheta[0] && cTheta[1] > maxCellIdTheta[0]) ||
-                (cTheta[0] > maxCellIdTheta[0] && cTheta[0] < maxCellIdTheta[1])) {
-              map[barrelCellID[1]].push_back(
-                  endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-              // add the next and previous phi modules as well
-              // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-              map[barrelCellID[1]].push_back(
-                  endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-              // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-              // current + 1
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-              map[barrelCellID[1]].push_back(
-                  endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-              map[endcapCellID].push_back(
-                  barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-              // restore back the iphi value
-              (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-            }
-          }
-        }
-
-        // loop over the part2 layers
-        // consider only the first cell of each layer
-        for (int part2LayerId = minLayerIdEndcap[1]; part2LayerId <= maxLayerIdEndcap[1]; part2LayerId++) {
-          // set the layer bit field for part2 layer
-          (*decoderHCalEndcap)[m_activeFieldNamesSegmented[hcalEndcapId]].set(endcapCellID, part2LayerId);
-
-          // get cell indexes in the given endcap layer
-          std::vector<int> endcapCellIndexes(hcalEndcapPhiRowSegmentation->cellIndexes(part2LayerId));
-
-          std::array<double, 2> cTheta;
-          decoderHCalEndcap->set(
-              endcapCellID, "row",
-              endcapCellIndexes[endcapCellIndexes.size() / 2]); // first cell in the negative-z part endcap layer
-
-          // we do not want to add the part2 layer cells that have part1 cells in the neighbours list
-          // try to find if there is a part1 cell in the list of neighbours
-          bool hasPart1Neighbour = false;
-          // loop over the neighbours of the first cell
-          for (auto nCellid : map[endcapCellID]) {
-            int nLayerId = decoderHCalEndcap->get(nCellid, "layer");
-            int systemId = decoderHCalEndcap->get(nCellid, "system");
-            // check if the neighbour cell is in the endcap part1 layer
-            if (nLayerId >= minLayerIdEndcap[0] && nLayerId <= maxLayerIdEndcap[0] && systemId == hcalEndcapId) {
-              hasPart1Neighbour = true;
-              break;
-            }
-          }
-
-          // add in the neighbours list if it overlaps with first barrel cell in theta
-          cTheta =
-              hcalEndcapPhiRowSegmentation->cellTheta(endcapCellID); // get thetaMin and thetaMax of the endcap cell
-          if ((cTheta[0] <= minCellIdTheta[0] && cTheta[1] > minCellIdTheta[0]) ||
-              (cTheta[0] > minCellIdTheta[0] && cTheta[0] < minCellIdTheta[1])) {
-            map[barrelCellID[0]].push_back(
-                endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[0]); // add the first barrel cell to the list of the endcap cell neighbours
-            // add the next and previous phi modules as well
-            // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-            map[barrelCellID[0]].push_back(
-                endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-            // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-            // current + 1
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-            map[barrelCellID[0]].push_back(
-                endcapCellID); // add to the neighbours list of the first cell in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[0]); // add the last barrel cell to the list of the endcap cell neighbours
-            // restore back the iphi value
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-          }
-          decoderHCalEndcap->set(endcapCellID, "row",
-                                 endcapCellIndexes[0]); // first cell in the positive-z part endcap layer
-          // add in the neighbours list if it overlaps with the last barrel cell in theta
-          cTheta =
-              hcalEndcapPhiRowSegmentation->cellTheta(endcapCellID); // get thetaMin and thetaMax of the endcap cell
-          if ((cTheta[0] <= maxCellIdTheta[0] && cTheta[1] > maxCellIdTheta[0]) ||
-              (cTheta[0] > maxCellIdTheta[0] && cTheta[0] < maxCellIdTheta[1])) {
-            map[barrelCellID[1]].push_back(
-                endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-            // add the next and previous phi modules as well
-            // previous: if the current is 0 then previous is the last bin (id = phiBins - 1) else current - 1
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == 0) ? (nPhiBins - 1) : (iphi - 1));
-            map[barrelCellID[1]].push_back(
-                endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-            // next: if the current is the last bin (id = phiBins - 1) then the next is the first bin (id = 0) else
-            // current + 1
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, (iphi == (nPhiBins - 1)) ? 0 : (iphi + 1));
-            map[barrelCellID[1]].push_back(
-                endcapCellID); // add to the neighbours list of the last cell in the barrel layer
-            map[endcapCellID].push_back(
-                barrelCellID[1]); // add the last barrel cell to the list of the endcap cell neighbours
-            // restore back the iphi value
-            (*decoderHCalEndcap)["phi"].set(endcapCellID, iphi);
-          }
-
-          // if the cell in this layer has a neighbour in the part1 layers, then stop here the part2 layers loop
-          if (hasPart1Neighbour)
-            break;
-        }
-        debug() << "Layer: " << ilayer << " iphi: " << iphi << " First Barrel CellID: " << barrelCellID[0] << ": "
-                << map[barrelCellID[0]].size() - numberOfNeighbours[0]
-                << " neighbours added after connecting Barrel+Endcap." << endmsg;
-        debug() << "Layer: " << ilayer << " iphi: " << iphi << " Last Barrel CellID: " << barrelCellID[1] << ": "
-                << map[barrelCellID[1]].size() - numberOfNeighbours[1]
-                << " neighbours added after connecting Barrel+Endcap." << endmsg;
-      } // iphi loop
-    } // loop over the barrel layers
   } else if (m_connectHCal)
     error() << "Unable to connect the HCal Barrel and HCal Endcap! segmentations are not handled correctly." << endmsg;
 
@@ -1345,8 +825,13 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
     dd4hep::DDSegmentation::CellID cellIdECal = volumeIdECal;
     dd4hep::DDSegmentation::CellID cellIdHCal = volumeIdHCal;
 
-    // Loop over HCAL segmentation cells to find neighbours in ECAL
-    // Loop on phi
+    // The overlap in phi does not depend on theta and vice versa: find the ECAL cells overlapping with each HCAL
+    // phi bin and with each HCAL theta bin (or row) once, then connect the cells from the two tables
+    // ECAL modules (or phi bins) overlapping with each HCAL phi bin
+    int eCalPhiStep = (ecalBarrelModuleThetaSegmentation)
+                          ? ecalBarrelModuleThetaSegmentation->mergedModules(eCalLastLayer)
+                          : 1;
+    std::vector<std::vector<int>> eCalPhiCells;
     for (int iphi = extremaHCalFirstLayerPhi.first; iphi <= extremaHCalFirstLayerPhi.second; iphi++) {
       // determine phi extent of HCAL cell
       (*decoderHCalBarrel)["phi"].set(cellIdHCal, iphi);
@@ -1355,198 +840,96 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
       double phiMin = phi - 0.5 * hCalPhiSize;
       double phiMax = phi + 0.5 * hCalPhiSize;
 
-      // find ECAL barrel modules corresponding to this phi range
-      int minModuleECal(-1), maxModuleECal(-1), minPhiECal(-1), maxPhiECal(-1);
+      // find ECAL barrel modules (or phi bins) corresponding to this phi range
+      int minPhiECal = int(floor((phiMin - eCalPhiOffset + 0.5 * eCalPhiSize) / eCalPhiSize));
+      int maxPhiECal = int(floor((phiMax - eCalPhiOffset + 0.5 * eCalPhiSize) / eCalPhiSize));
       if (ecalBarrelModuleThetaSegmentation) {
-        minModuleECal = int(floor((phiMin - eCalPhiOffset + 0.5 * eCalPhiSize) / eCalPhiSize));
-        if (minModuleECal < 0)
-          minModuleECal +=
-              eCalModules; // need module to be >=0 so that subtracting module%mergedModules gives the correct result
-        minModuleECal -= minModuleECal % ecalBarrelModuleThetaSegmentation->mergedModules(eCalLastLayer);
-        maxModuleECal = int(floor((phiMax - eCalPhiOffset + 0.5 * eCalPhiSize) / eCalPhiSize));
-        if (maxModuleECal < 0)
-          maxModuleECal += eCalModules;
-        maxModuleECal -= maxModuleECal % ecalBarrelModuleThetaSegmentation->mergedModules(eCalLastLayer);
+        // need module to be >=0 so that subtracting module%mergedModules gives the correct result
+        if (minPhiECal < 0)
+          minPhiECal += eCalModules;
+        minPhiECal -= minPhiECal % eCalPhiStep;
+        if (maxPhiECal < 0)
+          maxPhiECal += eCalModules;
+        maxPhiECal -= maxPhiECal % eCalPhiStep;
         // due to ciclic behaviour of modules, one could have e.g min = 1534 and max = 2 (for N=1536)
-        if (maxModuleECal < minModuleECal)
-          maxModuleECal += eCalModules;
-      } else {
-        minPhiECal = int(floor((phiMin - eCalPhiOffset + 0.5 * eCalPhiSize) / eCalPhiSize));
-        maxPhiECal = int(floor((phiMax - eCalPhiOffset + 0.5 * eCalPhiSize) / eCalPhiSize));
+        if (maxPhiECal < minPhiECal)
+          maxPhiECal += eCalModules;
       }
+      debug() << "HCAL phi bin " << iphi << ": phiMin = " << phiMin << " phiMax = " << phiMax << ", "
+              << ((ecalBarrelModuleThetaSegmentation) ? "module" : "phi bin")
+              << " of neighbours in ECAL layer max = " << minPhiECal << " - " << maxPhiECal << endmsg;
+
+      std::vector<int>& cells = eCalPhiCells.emplace_back();
+      for (int iphiECal = minPhiECal; iphiECal <= maxPhiECal; iphiECal += eCalPhiStep) {
+        // bring module (phi bin) in 0..nbins-1 range
+        int nBins = (ecalBarrelModuleThetaSegmentation) ? eCalModules : eCalPhiBins;
+        int cell = iphiECal;
+        if (cell < 0)
+          cell += nBins;
+        if (cell >= nBins)
+          cell -= nBins;
+        const auto& eCalExtrema =
+            (ecalBarrelModuleThetaSegmentation) ? extremaECalLastLayerModule : extremaECalLastLayerPhi;
+        if (cell < eCalExtrema.first || cell > eCalExtrema.second) {
+          warning() << ((ecalBarrelModuleThetaSegmentation) ? "module " : "phi bin ") << cell
+                    << " out of range, skipping" << endmsg;
+          continue;
+        }
+        cells.push_back(cell);
+      }
+    }
 
-      if (thetaSegHCal) {
-        // get all cells (theta bins) from the first layer of HCal barrel
-        std::vector<int> hcalThetaBins(hcalBarrelSegmentation->thetaBins(0));
-
-        for (auto itheta : hcalThetaBins) {
-          (*decoderHCalBarrel)["theta"].set(cellIdHCal, itheta);
-          // min and max polar angle of the hcal cell
-          std::array<double, 2> hcalCellTheta = hcalBarrelSegmentation->cellTheta(cellIdHCal);
-          double theta = hcalBarrelSegmentation->theta(cellIdHCal);
-          double thetaMin = hcalCellTheta[0];
-          double thetaMax = hcalCellTheta[1];
-
-          // find ECAL barrel theta bins corresponding to this theta range
-          int minThetaECal = int(floor((thetaMin - eCalThetaOffset + 0.5 * eCalThetaSize) / eCalThetaSize));
-          int maxThetaECal = int(floor((thetaMax - eCalThetaOffset + 0.5 * eCalThetaSize) / eCalThetaSize));
-          if (ecalBarrelModuleThetaSegmentation) {
-            minThetaECal -= minThetaECal % ecalBarrelModuleThetaSegmentation->mergedThetaCells(eCalLastLayer);
-            maxThetaECal -= maxThetaECal % ecalBarrelModuleThetaSegmentation->mergedThetaCells(eCalLastLayer);
-          }
-          // print out some debug info
-          debug() << "HCAL cell: cellId = " << cellIdHCal << " phi bin = " << iphi << " theta bin = " << itheta
-                  << endmsg;
-          debug() << "HCAL cell: phi = " << phi << " theta = " << theta << endmsg;
-          debug() << "HCAL cell: thetaMin = " << thetaMin << " thetaMax = " << thetaMax << endmsg;
-          debug() << "HCAL cell: phiMin = " << phiMin << " phiMax = " << phiMax << endmsg;
-          debug() << "HCAL cell: theta bin of neighbours in ECAL layer max = " << minThetaECal << " - " << maxThetaECal
-                  << endmsg;
-          if (ecalBarrelModuleThetaSegmentation) {
-            debug() << "HCAL cell: module of neighbours in ECAL layer max = " << minModuleECal << " - " << maxModuleECal
-                    << endmsg;
-          } else {
-            debug() << "HCAL cell: phi bin of neighbours in ECAL layer max = " << minPhiECal << " - " << maxPhiECal
-                    << endmsg;
-          }
-
-          // add the neighbours if within the acceptance of the layer
-          int thetaStep = (ecalBarrelModuleThetaSegmentation)
-                              ? ecalBarrelModuleThetaSegmentation->mergedThetaCells(eCalLastLayer)
-                              : 1;
-          for (int ithetaECal = minThetaECal; ithetaECal <= maxThetaECal; ithetaECal += thetaStep) {
-            if (ithetaECal < extremaECalLastLayerTheta.first || ithetaECal > extremaECalLastLayerTheta.second) {
-              debug() << "theta bin " << ithetaECal << " out of range, skipping" << endmsg;
-              continue;
-            }
-            (*decoderECalBarrel)["theta"].set(cellIdECal, ithetaECal);
-            if (ecalBarrelModuleThetaSegmentation) {
-              for (int iModule = minModuleECal; iModule <= maxModuleECal;
-                   iModule += ecalBarrelModuleThetaSegmentation->mergedModules(eCalLastLayer)) {
-                int module = iModule;
-                if (module < 0)
-                  module += eCalModules;
-                if (module >= eCalModules)
-                  module -= eCalModules;
-                if (module < extremaECalLastLayerModule.first || module > extremaECalLastLayerModule.second) {
-                  warning() << "module " << module << " out of range, skipping" << endmsg;
-                  continue;
-                }
-                (*decoderECalBarrel)["module"].set(cellIdECal, module);
-                debug() << "HCAL cell: neighbour in ECAL has cellID = " << cellIdECal << endmsg;
-                map.find((uint64_t)cellIdHCal)->second.push_back((uint64_t)cellIdECal);
-                map.find((uint64_t)cellIdECal)->second.push_back((uint64_t)cellIdHCal);
-                linkedCells.insert(cellIdHCal);
-                linkedCells.insert(cellIdECal);
-              }
-            } else {
-              for (int iphiECal = minPhiECal; iphiECal <= maxPhiECal; iphiECal++) {
-                int phiBinECal = iphiECal;
-                // bring phi bin in 0..nbins-1 range
-                if (phiBinECal < 0)
-                  phiBinECal += eCalPhiBins;
-                if (phiBinECal >= eCalPhiBins)
-                  phiBinECal -= eCalPhiBins;
-                if (phiBinECal < extremaECalLastLayerPhi.first || phiBinECal > extremaECalLastLayerPhi.second) {
-                  warning() << "phi bin " << phiBinECal << " out of range, skipping" << endmsg;
-                  continue;
-                }
-                (*decoderECalBarrel)["phi"].set(cellIdECal, phiBinECal);
-                debug() << "HCAL cell: neighbour in ECAL has cellID = " << cellIdECal << endmsg;
-                map.find((uint64_t)cellIdHCal)->second.push_back((uint64_t)cellIdECal);
-                map.find((uint64_t)cellIdECal)->second.push_back((uint64_t)cellIdHCal);
-                linkedCells.insert(cellIdHCal);
-                linkedCells.insert(cellIdECal);
-              }
-            }
-          }
+    // ECAL theta bins overlapping with each cell of the first HCAL layer
+    const std::string hCalCellField = (thetaSegHCal) ? "theta" : "row";
+    std::vector<int> hcalCells((thetaSegHCal) ? hcalBarrelSegmentation->thetaBins(0)
+                                              : hcalBarrelPhiRowSegmentation->cellIndexes(0));
+    int eCalThetaStep = (ecalBarrelModuleThetaSegmentation)
+                            ? ecalBarrelModuleThetaSegmentation->mergedThetaCells(eCalLastLayer)
+                            : 1;
+    std::vector<std::vector<int>> eCalThetaCells(hcalCells.size());
+    for (size_t icell = 0; icell < hcalCells.size(); icell++) {
+      (*decoderHCalBarrel)[hCalCellField].set(cellIdHCal, hcalCells[icell]);
+      // min and max polar angle of the hcal cell
+      std::array<double, 2> hcalCellTheta = (thetaSegHCal) ? hcalBarrelSegmentation->cellTheta(cellIdHCal)
+                                                           : hcalBarrelPhiRowSegmentation->cellTheta(cellIdHCal);
+      double thetaMin = hcalCellTheta[0];
+      double thetaMax = hcalCellTheta[1];
+
+      // find ECAL barrel theta bins corresponding to this theta range
+      int minThetaECal = int(floor((thetaMin - eCalThetaOffset + 0.5 * eCalThetaSize) / eCalThetaSize));
+      int maxThetaECal = int(floor((thetaMax - eCalThetaOffset + 0.5 * eCalThetaSize) / eCalThetaSize));
+      minThetaECal -= minThetaECal % eCalThetaStep;
+      maxThetaECal -= maxThetaECal % eCalThetaStep;
+      debug() << "HCAL " << hCalCellField << " index " << hcalCells[icell] << ": thetaMin = " << thetaMin
+              << " thetaMax = " << thetaMax << ", theta bin of neighbours in ECAL layer max = " << minThetaECal
+              << " - " << maxThetaECal << endmsg;
+
+      // add the neighbours if within the acceptance of the layer
+      for (int ithetaECal = minThetaECal; ithetaECal <= maxThetaECal; ithetaECal += eCalThetaStep) {
+        if (ithetaECal < extremaECalLastLayerTheta.first || ithetaECal > extremaECalLastLayerTheta.second) {
+          debug() << "theta bin " << ithetaECal << " out of range, skipping" << endmsg;
+          continue;
         }
-      } else // HCal phi-row segmentaion
-      {
-        // get all cell indexes from the first layer of HCal barrel
-        std::vector<int> hcalCellIndexes(hcalBarrelPhiRowSegmentation->cellIndexes(0));
-
-        // find which HCal cells overlap in theta with the ECal cell
-        for (auto idx : hcalCellIndexes) {
-          (*decoderHCalBarrel)["row"].set(cellIdHCal, idx);
-          // min and max polar angle of the hcal cell
-          std::array<double, 2> hcalCellTheta = hcalBarrelPhiRowSegmentation->cellTheta(cellIdHCal);
-          double theta = hcalBarrelPhiRowSegmentation->theta(cellIdHCal);
-          double thetaMin = hcalCellTheta[0];
-          double thetaMax = hcalCellTheta[1];
-
-          // find ECAL barrel theta bins corresponding to this theta range
-          int minThetaECal = int(floor((thetaMin - eCalThetaOffset + 0.5 * eCalThetaSize) / eCalThetaSize));
-          int maxThetaECal = int(floor((thetaMax - eCalThetaOffset + 0.5 * eCalThetaSize) / eCalThetaSize));
-          if (ecalBarrelModuleThetaSegmentation) {
-            minThetaECal -= minThetaECal % ecalBarrelModuleThetaSegmentation->mergedThetaCells(eCalLastLayer);
-            maxThetaECal -= maxThetaECal % ecalBarrelModuleThetaSegmentation->mergedThetaCells(eCalLastLayer);
-          }
-          // print out some debug info
-          debug() << "HCAL cell: cellId = " << cellIdHCal << " phi bin = " << iphi << " row/cell index = " << idx
-                  << endmsg;
-          debug() << "HCAL cell: phi = " << phi << " theta = " << theta << endmsg;
-          debug() << "HCAL cell: thetaMin = " << thetaMin << " thetaMax = " << thetaMax << endmsg;
-          debug() << "HCAL cell: phiMin = " << phiMin << " phiMax = " << phiMax << endmsg;
-          debug() << "HCAL cell: theta bin of neighbours in ECAL layer max = " << minThetaECal << " - " << maxThetaECal
-                  << endmsg;
-          if (ecalBarrelModuleThetaSegmentation) {
-            debug() << "HCAL cell: module of neighbours in ECAL layer max = " << minModuleECal << " - " << maxModuleECal
-                    << endmsg;
-          } else {
-            debug() << "HCAL cell: phi bin of neighbours in ECAL layer max = " << minPhiECal << " - " << maxPhiECal
-                    << endmsg;
-          }
+        eCalThetaCells[icell].push_back(ithetaECal);
+      }
+    }
 
-          // add the neighbours if within the acceptance of the layer
-          int thetaStep = (ecalBarrelModuleThetaSegmentation)
-                              ? ecalBarrelModuleThetaSegmentation->mergedThetaCells(eCalLastLayer)
-                              : 1;
-          for (int ithetaECal = minThetaECal; ithetaECal <= maxThetaECal; ithetaECal += thetaStep) {
-            if (ithetaECal < extremaECalLastLayerTheta.first || ithetaECal > extremaECalLastLayerTheta.second) {
-              debug() << "theta bin " << ithetaECal << " out of range, skipping" << endmsg;
-              continue;
-            }
-            (*decoderECalBarrel)["theta"].set(cellIdECal, ithetaECal);
-            if (ecalBarrelModuleThetaSegmentation) {
-              for (int iModule = minModuleECal; iModule <= maxModuleECal;
-                   iModule += ecalBarrelModuleThetaSegmentation->mergedModules(eCalLastLayer)) {
-                int module = iModule;
-                if (module < 0)
-                  module += eCalModules;
-                if (module >= eCalModules)
-                  module -= eCalModules;
-                if (module < extremaECalLastLayerModule.first || module > extremaECalLastLayerModule.second) {
-                  warning() << "module " << module << " out of range, skipping" << endmsg;
-                  continue;
-                }
-                (*decoderECalBarrel)["module"].set(cellIdECal, module);
-                debug() << "HCAL cell: neighbour in ECAL has cellID = " << cellIdECal << endmsg;
-                map.find((uint64_t)cellIdHCal)->second.push_back((uint64_t)cellIdECal);
-                map.find((uint64_t)cellIdECal)->second.push_back((uint64_t)cellIdHCal);
-                linkedCells.insert(cellIdHCal);
-                linkedCells.insert(cellIdECal);
-              }
-            } else {
-              for (int iphiECal = minPhiECal; iphiECal <= maxPhiECal; iphiECal++) {
-                int phiBinECal = iphiECal;
-                // bring phi bin in 0..nbins-1 range
-                if (phiBinECal < 0)
-                  phiBinECal += eCalPhiBins;
-                if (phiBinECal >= eCalPhiBins)
-                  phiBinECal -= eCalPhiBins;
-                if (phiBinECal < extremaECalLastLayerPhi.first || phiBinECal > extremaECalLastLayerPhi.second) {
-                  warning() << "phi bin " << phiBinECal << " out of range, skipping" << endmsg;
-                  continue;
-                }
-                (*decoderECalBarrel)["phi"].set(cellIdECal, phiBinECal);
-                debug() << "HCAL cell: neighbour in ECAL has cellID = " << cellIdECal << endmsg;
-                map.find((uint64_t)cellIdHCal)->second.push_back((uint64_t)cellIdECal);
-                map.find((uint64_t)cellIdECal)->second.push_back((uint64_t)cellIdHCal);
-                linkedCells.insert(cellIdHCal);
-                linkedCells.insert(cellIdECal);
-              }
-            }
+    // Loop over HCAL segmentation cells and link them to the ECAL cells overlapping in theta and phi
+    const std::string eCalPhiField = (ecalBarrelModuleThetaSegmentation) ? "module" : "phi";
+    for (int iphi = extremaHCalFirstLayerPhi.first; iphi <= extremaHCalFirstLayerPhi.second; iphi++) {
+      (*decoderHCalBarrel)["phi"].set(cellIdHCal, iphi);
+      const auto& eCalPhiCellsHCal = eCalPhiCells[iphi - extremaHCalFirstLayerPhi.first];
+      for (size_t icell = 0; icell < hcalCells.size(); icell++) {
+        (*decoderHCalBarrel)[hCalCellField].set(cellIdHCal, hcalCells[icell]);
+        auto& hcalNeighbours = map.find((uint64_t)cellIdHCal)->second;
+        for (int ithetaECal : eCalThetaCells[icell]) {
+          (*decoderECalBarrel)["theta"].set(cellIdECal, ithetaECal);
+          for (int iphiECal : eCalPhiCellsHCal) {
+            (*decoderECalBarrel)[eCalPhiField].set(cellIdECal, iphiECal);
+            hcalNeighbours.push_back((uint64_t)cellIdECal);
+            map.find((uint64_t)cellIdECal)->second.push_back((uint64_t)cellIdHCal);
+            linkedCells.insert(cellIdHCal);
+            linkedCells.insert(cellIdECal);
           }
         }
       }
@@ -1581,9 +964,16 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
   std::vector<uint64_t> saveNeighbours;
   tree.Branch("cellId", &saveCellId, "cellId/l");
   tree.Branch("neighbours", &saveNeighbours);
+  // write the cells ordered by cellID, so that the file does not depend on the iteration order of the map
+  std::vector<uint64_t> cellIds;
+  cellIds.reserve(map.size());
   for (const auto& item : map) {
-    saveCellId = item.first;
-    saveNeighbours = item.second;
+    cellIds.push_back(item.first);
+  }
+  std::sort(cellIds.begin(), cellIds.end());
+  for (auto cellId : cellIds) {
+    saveCellId = cellId;
+    saveNeighbours = map[cellId];
     tree.Fill();
   }
   outFile->Write();
@@ -1592,4 +982,189 @@ StatusCode CreateFCCeeCaloNeighbours::initialize() {
   return StatusCode::SUCCESS;
 }
 
+void CreateFCCeeCaloNeighbours::fillNeighbours(NeighbourMap& aMap,
+                                               const std::vector<std::function<void(CellNeighbours&)>>& aBlocks) {
+  std::vector<CellNeighbours> cells(aBlocks.size());
+  if (m_numThreads != 1) {
+    m_arena.execute([&] {
+      tbb::parallel_for(size_t(0), aBlocks.size(), [&](size_t iBlock) { aBlocks[iBlock](cells[iBlock]); });
+    });
+  } else {
+    for (size_t iBlock = 0; iBlock < aBlocks.size(); iBlock++) {
+      aBlocks[iBlock](cells[iBlock]);
+    }
+  }
+  // insert in the order of the blocks, as the serial enumeration would (a cell already in the map is kept)
+  size_t numCells = aMap.size();
+  for (const auto& block : cells) {
+    numCells += block.size();
+  }
+  aMap.reserve(numCells);
+  for (auto& block : cells) {
+    for (auto& cell : block) {
+      aMap.insert(std::move(cell));
+    }
+  }
+}
+
+template <typename Segmentation>
+StatusCode CreateFCCeeCaloNeighbours::connectHCalBarrelEndcap(
+    NeighbourMap& aMap, Segmentation& aBarrelSegmentation, Segmentation& aEndcapSegmentation,
+    const dd4hep::DDSegmentation::BitFieldCoder& aBarrelDecoder,
+    const dd4hep::DDSegmentation::BitFieldCoder& aEndcapDecoder, int aBarrelId, int aEndcapId) {
+  debug() << "Linking the HCal Barrel and HCal Endcap" << endmsg;
+  // the cells are indexed by theta bin in the phi-theta segmentation, and by row in the phi-row segmentation
+  constexpr bool phiTheta = std::is_same_v<Segmentation, dd4hep::DDSegmentation::FCCSWHCalPhiTheta_k4geo>;
+  const std::string cellField = phiTheta ? "theta" : "row";
+  auto cellIndexes = [](Segmentation& aSegmentation, uint aLayer) {
+    if constexpr (phiTheta) {
+      return aSegmentation.thetaBins(aLayer);
+    } else {
+      return aSegmentation.cellIndexes(aLayer);
+    }
+  };
+
+  // Get the part1 and part2 endcap layer indexes that will be used to connect Barrel cells to the Endcap cells
+  std::vector<std::pair<uint, uint>> minMaxLayerId(aEndcapSegmentation.getMinMaxLayerId());
+  if (minMaxLayerId.empty()) {
+    error() << "hcalEndcap segmentation is not configured correctly, cannot link Endcap and Barrel!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+  const int minLayerIdPart1 = minMaxLayerId[0].first;
+  const int maxLayerIdPart1 = minMaxLayerId[0].second;
+  const int nPhiBins = aBarrelSegmentation.phiBins();
+
+  auto endcapCell = [&](int aLayer, int aIndex, int aPhi) {
+    dd4hep::DDSegmentation::CellID cellId = 0;
+    aEndcapDecoder[m_fieldNamesSegmented[aEndcapId]].set(cellId, m_fieldValuesSegmented[aEndcapId]);
+    aEndcapDecoder[m_activeFieldNamesSegmented[aEndcapId]].set(cellId, aLayer);
+    aEndcapDecoder[cellField].set(cellId, aIndex);
+    aEndcapDecoder["phi"].set(cellId, aPhi);
+    return cellId;
+  };
+  // cells of an endcap layer facing the first and the last cell of the barrel layers
+  auto endcapBoundaryCells = [&](int aLayer) -> std::array<int, 2> {
+    std::vector<int> indexes(cellIndexes(aEndcapSegmentation, aLayer));
+    if constexpr (phiTheta) {
+      // highest theta bin of the positive-z part, and lowest theta bin of the negative-z part
+      return {indexes[indexes.size() / 2 - 1], indexes[indexes.size() / 2]};
+    } else {
+      // first cell of the negative-z part, and first cell of the positive-z part
+      return {indexes[indexes.size() / 2], indexes[0]};
+    }
+  };
+  // the endcap cell overlaps in theta with the barrel cell
+  auto overlaps = [](const std::array<double, 2>& aEndcapTheta, const std::array<double, 2>& aBarrelTheta) {
+    return (aEndcapTheta[0] <= aBarrelTheta[0] && aEndcapTheta[1] > aBarrelTheta[0]) ||
+           (aEndcapTheta[0] > aBarrelTheta[0] && aEndcapTheta[0] < aBarrelTheta[1]);
+  };
+  // add the endcap cell, and the ones in the previous and next phi bins, to the neighbours of the barrel cell and the
+  // barrel cell to the neighbours of the endcap cells
+  auto connect = [&](uint64_t aBarrelCell, int aLayer, int aIndex, int aPhi) {
+    for (int phi : {aPhi, (aPhi == 0) ? (nPhiBins - 1) : (aPhi - 1), (aPhi == (nPhiBins - 1)) ? 0 : (aPhi + 1)}) {
+      uint64_t endcapCellId = endcapCell(aLayer, aIndex, phi);
+      aMap[aBarrelCell].push_back(endcapCellId);
+      aMap[endcapCellId].push_back(aBarrelCell);
+    }
+  };
+
+  /// Endcap cell connected to the first (0) or the last (1) cell of a barrel layer
+  struct Connection {
+    int layer;
+    int index;
+    int barrelCell;
+  };
+  // Loop over active layers
+  for (unsigned int ilayer = 0; ilayer < m_activeVolumesNumbersSegmented[aBarrelId]; ilayer++) {
+    debug() << "HCal Barrel Layer: " << ilayer << endmsg;
+    // first and last cell in the barrel layer
+    std::vector<int> barrelIndexes(cellIndexes(aBarrelSegmentation, ilayer));
+    std::array<dd4hep::DDSegmentation::CellID, 2> barrelCellID = {0, 0};
+    std::array<std::array<double, 2>, 2> barrelCellTheta;
+    for (int i = 0; i < 2; i++) {
+      aBarrelDecoder[m_fieldNamesSegmented[aBarrelId]].set(barrelCellID[i], m_fieldValuesSegmented[aBarrelId]);
+      aBarrelDecoder[m_activeFieldNamesSegmented[aBarrelId]].set(barrelCellID[i], ilayer);
+      aBarrelDecoder[cellField].set(barrelCellID[i], (i == 0) ? barrelIndexes.front() : barrelIndexes.back());
+      aBarrelDecoder["phi"].set(barrelCellID[i], 0);
+      // min and max polar angle of the barrel cell
+      barrelCellTheta[i] = aBarrelSegmentation.cellTheta(barrelCellID[i]);
+    }
+
+    // The polar angles of the cells do not depend on phi: find the overlapping endcap cells once per barrel layer.
+    // Part1 layers: consider all cells in the first layer, and only the boundary cells in the other layers
+    std::vector<Connection> part1Connections;
+    for (int part1LayerId = minLayerIdPart1; part1LayerId <= maxLayerIdPart1; part1LayerId++) {
+      if (part1LayerId == minLayerIdPart1) {
+        for (auto index : cellIndexes(aEndcapSegmentation, part1LayerId)) {
+          std::array<double, 2> cTheta = aEndcapSegmentation.cellTheta(endcapCell(part1LayerId, index, 0));
+          for (int i = 0; i < 2; i++) {
+            if (overlaps(cTheta, barrelCellTheta[i])) {
+              part1Connections.push_back({part1LayerId, index, i});
+            }
+          }
+        }
+      } else {
+        std::array<int, 2> indexes = endcapBoundaryCells(part1LayerId);
+        for (int i = 0; i < 2; i++) {
+          if (overlaps(aEndcapSegmentation.cellTheta(endcapCell(part1LayerId, indexes[i], 0)), barrelCellTheta[i])) {
+            part1Connections.push_back({part1LayerId, indexes[i], i});
+          }
+        }
+      }
+    }
+    // Part2 layers: consider only the boundary cells of each layer
+    std::vector<std::array<int, 2>> part2Indexes;
+    std::vector<std::array<bool, 2>> part2Overlaps;
+    for (int part2LayerId = minMaxLayerId[1].first; part2LayerId <= int(minMaxLayerId[1].second); part2LayerId++) {
+      std::array<int, 2> indexes = endcapBoundaryCells(part2LayerId);
+      part2Indexes.push_back(indexes);
+      part2Overlaps.push_back(
+          {overlaps(aEndcapSegmentation.cellTheta(endcapCell(part2LayerId, indexes[0], 0)), barrelCellTheta[0]),
+           overlaps(aEndcapSegmentation.cellTheta(endcapCell(part2LayerId, indexes[1], 0)), barrelCellTheta[1])});
+    }
+
+    for (int iphi = 0; iphi < nPhiBins; iphi++) {
+      for (auto& cellId : barrelCellID) {
+        aBarrelDecoder["phi"].set(cellId, iphi);
+      }
+      // Number of neighbours for the first and the last cell in the barrel layer
+      std::array<uint64_t, 2> numberOfNeighbours = {aMap[barrelCellID[0]].size(), aMap[barrelCellID[1]].size()};
+
+      for (const auto& connection : part1Connections) {
+        connect(barrelCellID[connection.barrelCell], connection.layer, connection.index, iphi);
+      }
+      for (size_t ipart2 = 0; ipart2 < part2Indexes.size(); ipart2++) {
+        int part2LayerId = minMaxLayerId[1].first + ipart2;
+        // we do not want to add the part2 layer cells that have part1 cells in the neighbours list
+        // try to find if there is a part1 cell in the list of neighbours of the first cell
+        bool hasPart1Neighbour = false;
+        for (auto nCellid : aMap[endcapCell(part2LayerId, part2Indexes[ipart2][0], iphi)]) {
+          int nLayerId = aEndcapDecoder.get(nCellid, "layer");
+          int systemId = aEndcapDecoder.get(nCellid, "system");
+          // check if the neighbour cell is in the endcap part1 layer
+          if (nLayerId >= minLayerIdPart1 && nLayerId <= maxLayerIdPart1 && systemId == aEndcapId) {
+            hasPart1Neighbour = true;
+            break;
+          }
+        }
+        for (int i = 0; i < 2; i++) {
+          if (part2Overlaps[ipart2][i]) {
+            connect(barrelCellID[i], part2LayerId, part2Indexes[ipart2][i], iphi);
+          }
+        }
+        // if the cell in this layer has a neighbour in the part1 layers, then stop here the part2 layers loop
+        if (hasPart1Neighbour)
+          break;
+      }
+      debug() << "Layer: " << ilayer << " iphi: " << iphi << " First Barrel CellID: " << barrelCellID[0] << ": "
+              << aMap[barrelCellID[0]].size() - numberOfNeighbours[0]
+              << " neighbours added after connecting Barrel+Endcap." << endmsg;
+      debug() << "Layer: " << ilayer << " iphi: " << iphi << " Last Barrel CellID: " << barrelCellID[1] << ": "
+              << aMap[barrelCellID[1]].size() - numberOfNeighbours[1]
+              << " neighbours added after connecting Barrel+Endcap." << endmsg;
+    } // iphi loop
+  } // loop over the barrel layers
+  return StatusCode::SUCCESS;
+}
+
 StatusCode CreateFCCeeCaloNeighbours::finalize() { return Service::finalize(); }
@@ -21,6 +21,12 @@
 // ROOT
 #include "TGeoManager.h"
 
+// TBB
+#include <tbb/task_arena.h>
+
+// std
+#include <functional>
+
 class IGeoSvc;
 
 /** @class CreateFCCeeCaloNeighbours
@@ -28,6 +34,11 @@ class IGeoSvc;
  *  Service building a map of neighbours for all existing cells in the geometry.
  *  The volumes for which the neighbour map is created can be either segmented in theta-module (e.g. ECal inclined),
  *
+ *  The cells of each layer (or wheel) of a segmentation are enumerated concurrently on numThreads threads and merged
+ *  in the order of the layers, so that the map does not depend on the number of threads. The connections between
+ *  systems (HCal barrel-endcap, ECal-HCal barrels) look up the overlapping cells in tables binned in theta and phi,
+ *  computed once per layer instead of once per cell. The map is written ordered by cellID.
+ *
  *  @author Giovanni Marchiori
  */
 
@@ -47,6 +58,25 @@ public:
   virtual StatusCode finalize() final;
 
 private:
+  using NeighbourMap = std::unordered_map<uint64_t, std::vector<uint64_t>>;
+  /// Cells of a block (layer, wheel) of a segmentation, with their neighbours
+  using CellNeighbours = std::vector<std::pair<uint64_t, std::vector<uint64_t>>>;
+
+  /** Enumerate the blocks of cells concurrently and insert them into the map in the order of the blocks.
+   *   @param[out] aMap, map of neighbours.
+   *   @param[in] aBlocks, functions filling the cells of each block, must only use const methods of the segmentation.
+   */
+  void fillNeighbours(NeighbourMap& aMap, const std::vector<std::function<void(CellNeighbours&)>>& aBlocks);
+  /** Connect the first and the last cell of each HCal barrel layer to the HCal endcap cells overlapping in theta.
+   *  Implemented for FCCSWHCalPhiTheta_k4geo (cells indexed by theta bin) and FCCSWHCalPhiRow_k4geo (row index).
+   */
+  template <typename Segmentation>
+  StatusCode connectHCalBarrelEndcap(NeighbourMap& aMap, Segmentation& aBarrelSegmentation,
+                                     Segmentation& aEndcapSegmentation,
+                                     const dd4hep::DDSegmentation::BitFieldCoder& aBarrelDecoder,
+                                     const dd4hep::DDSegmentation::BitFieldCoder& aEndcapDecoder, int aBarrelId,
+                                     int aEndcapId);
+
   /// Pointer to the geometry service
   SmartIF<IGeoSvc> m_geoSvc;
 
@@ -93,8 +123,14 @@ private:
   // For combination of barrels: offset of HCal modules in phi (lower edge)
   Gaudi::Property<double> m_hCalPhiOffset{this, "hCalPhiOffset"};
 
+  /// Number of threads enumerating the cells
+  Gaudi::Property<int> m_numThreads{this, "numThreads", 1,
+                                    "Number of threads enumerating the cells (0: TBB default, 1: serial)"};
+
   /// Name of output file
   std::string m_outputFileName;
+
+  tbb::task_arena m_arena;
 };
 
 #endif /* RECFCCEECALORIMETER_CREATEFCCEECALONEIGHBOURS_H */
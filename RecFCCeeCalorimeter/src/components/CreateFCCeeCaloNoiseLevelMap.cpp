@@ -12,6 +12,8 @@
 #include "TSystem.h"
 #include "TTree.h"
 
+#include "RecCaloCommon/NoiseLevelTable.h"
+
 DECLARE_COMPONENT(CreateFCCeeCaloNoiseLevelMap)
 
 CreateFCCeeCaloNoiseLevelMap::CreateFCCeeCaloNoiseLevelMap(const std::string& aName, ISvcLocator* aSL)
@@ -21,6 +23,8 @@ CreateFCCeeCaloNoiseLevelMap::CreateFCCeeCaloNoiseLevelMap(const std::string& aN
   declareProperty("HCalBarrelNoiseTool", m_hcalBarrelNoiseTool, "Handle for the cell noise tool of Barrel HCal");
   declareProperty("HCalEndcapNoiseTool", m_hcalEndcapNoiseTool, "Handle for the cell noise tool of Endcap HCal");
   declareProperty("outputFileName", m_outputFileName, "Name of the output file");
+  declareProperty("outputTableFileName", m_outputTableFileName,
+                  "Name of the output file of the binary noise table (not written if empty)");
 }
 
 CreateFCCeeCaloNoiseLevelMap::~CreateFCCeeCaloNoiseLevelMap() {}
@@ -65,7 +69,7 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
     }
   }
 
-  std::unordered_map<uint64_t, std::pair<double, double>> map;
+  k4::recCalo::NoiseLevelTable table;
 
   for (uint iSys = 0; iSys < m_readoutNamesSegmented.size(); iSys++) {
     // Check if readouts exist
@@ -124,6 +128,7 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
 
     // Loop over all cells in the calorimeter and retrieve existing cellIDs
     auto decoder = m_geoSvc->getDetector()->readout(m_readoutNamesSegmented[iSys]).idSpec().decoder();
+    std::vector<uint64_t> cellIds;
 
     if (segmentationType == "FCCSWGridPhiTheta_k4geo" || segmentationType == "FCCSWGridModuleThetaMerged_k4geo") {
       // Loop over active layers
@@ -188,19 +193,7 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
               decoder->set(cellId, "theta",
                            itheta + numCells[2]); // start from the minimum existing theta cell in this layer
               uint64_t id = cellId;
-              double noiseRMS = 0.;
-              double noiseOffset = 0.;
-              if (m_fieldValuesSegmented[iSys] == m_ecalBarrelSysId) {
-                noiseRMS = m_ecalBarrelNoiseTool->getNoiseRMSPerCell(id);
-                noiseOffset = m_ecalBarrelNoiseTool->getNoiseOffsetPerCell(id);
-              } else if (m_fieldValuesSegmented[iSys] == m_hcalBarrelSysId) {
-                noiseRMS = m_hcalBarrelNoiseTool->getNoiseRMSPerCell(id);
-                noiseOffset = m_hcalBarrelNoiseTool->getNoiseOffsetPerCell(id);
-              } else {
-                warning() << "Unexpected system value for phi-theta readout " << m_fieldValuesSegmented[iSys]
-                          << ", setting noise RMS and offset to 0.0" << endmsg;
-              }
-              map.insert(std::pair<uint64_t, std::pair<double, double>>(id, std::make_pair(noiseRMS, noiseOffset)));
+              cellIds.push_back(id);
             }
           }
         } else if (segmentationType == "FCCSWGridModuleThetaMerged_k4geo") {
@@ -229,16 +222,7 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
                                itheta * moduleThetaSegmentation->mergedThetaCells(
                                             ilayer)); // start from the minimum existing theta cell in this layer
               uint64_t id = cellId;
-              double noiseRMS = 0.;
-              double noiseOffset = 0.;
-              if (m_fieldValuesSegmented[iSys] == m_ecalBarrelSysId) {
-                noiseRMS = m_ecalBarrelNoiseTool->getNoiseRMSPerCell(id);
-                noiseOffset = m_ecalBarrelNoiseTool->getNoiseOffsetPerCell(id);
-              } else {
-                warning() << "Unexpected system value for module-theta readout " << m_fieldValuesSegmented[iSys]
-                          << ", setting noise RMS and offset to 0.0" << endmsg;
-              }
-              map.insert(std::pair<uint64_t, std::pair<double, double>>(id, std::make_pair(noiseRMS, noiseOffset)));
+              cellIds.push_back(id);
             }
           }
         }
@@ -297,9 +281,7 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
                 if (iSide == 1 && iWheel == 2 && imodule == 113 && irho == 19 && iz == 1) {
                   debug() << "in test cell, iLayer = " << iLayer << " and cell ID = " << id << endmsg;
                 }
-                double noiseRMS = m_ecalEndcapNoiseTool->getNoiseRMSPerCell(id);
-                double noiseOffset = m_ecalEndcapNoiseTool->getNoiseOffsetPerCell(id);
-                map.insert(std::pair<uint64_t, std::pair<double, double>>(id, std::make_pair(noiseRMS, noiseOffset)));
+                cellIds.push_back(id);
               } // end loop over z
             } // end loop over rho
           } // end loop over module
@@ -345,9 +327,7 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
                 decoder->set(cellId, "theta",
                              itheta + numCells[2]); // start from the minimum existing theta cell in this layer
                 uint64_t id = cellId;
-                double noiseRMS = m_hcalBarrelNoiseTool->getNoiseRMSPerCell(id);
-                double noiseOffset = m_hcalBarrelNoiseTool->getNoiseOffsetPerCell(id);
-                map.insert(std::pair<uint64_t, std::pair<double, double>>(id, std::make_pair(noiseRMS, noiseOffset)));
+                cellIds.push_back(id);
               }
             }
           } // barrel
@@ -378,9 +358,7 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
                 decoder->set(cellId, "theta",
                              itheta + numCells[2]); // start from the minimum existing theta cell in this layer
                 uint64_t id = cellId;
-                double noiseRMS = m_hcalEndcapNoiseTool->getNoiseRMSPerCell(id);
-                double noiseOffset = m_hcalEndcapNoiseTool->getNoiseOffsetPerCell(id);
-                map.insert(std::pair<uint64_t, std::pair<double, double>>(id, std::make_pair(noiseRMS, noiseOffset)));
+                cellIds.push_back(id);
               }
             }
 
@@ -398,9 +376,7 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
                 decoder->set(cellId, "theta",
                              itheta + numCells[2]); // start from the minimum existing theta cell in this layer
                 uint64_t id = cellId;
-                double noiseRMS = m_hcalEndcapNoiseTool->getNoiseRMSPerCell(id);
-                double noiseOffset = m_hcalEndcapNoiseTool->getNoiseOffsetPerCell(id);
-                map.insert(std::pair<uint64_t, std::pair<double, double>>(id, std::make_pair(noiseRMS, noiseOffset)));
+                cellIds.push_back(id);
               }
             }
           } // Endcap
@@ -442,9 +418,7 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
                 decoder->set(cellId, "row",
                              irow + numCells[2]); // start from the minimum existing cell index in this layer
                 uint64_t id = cellId;
-                double noiseRMS = m_hcalBarrelNoiseTool->getNoiseRMSPerCell(id);
-                double noiseOffset = m_hcalBarrelNoiseTool->getNoiseOffsetPerCell(id);
-                map.insert(std::pair<uint64_t, std::pair<double, double>>(id, std::make_pair(noiseRMS, noiseOffset)));
+                cellIds.push_back(id);
               }
             }
           } // barrel
@@ -474,9 +448,7 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
                 decoder->set(cellId, "row",
                              irow + numCells[2]); // start from the minimum existing cell index in this layer
                 uint64_t id = cellId;
-                double noiseRMS = m_hcalEndcapNoiseTool->getNoiseRMSPerCell(id);
-                double noiseOffset = m_hcalEndcapNoiseTool->getNoiseOffsetPerCell(id);
-                map.insert(std::pair<uint64_t, std::pair<double, double>>(id, std::make_pair(noiseRMS, noiseOffset)));
+                cellIds.push_back(id);
               }
             }
 
@@ -493,17 +465,39 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
                 decoder->set(cellId, "phi", iphi);
                 decoder->set(cellId, "row", irow + numCells[2]); // start from the minimum cell index in this layer
                 uint64_t id = cellId;
-                double noiseRMS = m_hcalEndcapNoiseTool->getNoiseRMSPerCell(id);
-                double noiseOffset = m_hcalEndcapNoiseTool->getNoiseOffsetPerCell(id);
-                map.insert(std::pair<uint64_t, std::pair<double, double>>(id, std::make_pair(noiseRMS, noiseOffset)));
+                cellIds.push_back(id);
               }
             }
           } // Endcap
         } // hcal phi-row segmentation
       } // layer loop
     } // hcal segmentations
+
+    // noise tool of the system, the noise is evaluated once all cells are known
+    bool hcalSegmentation =
+        (segmentationType == "FCCSWHCalPhiTheta_k4geo" || segmentationType == "FCCSWHCalPhiRow_k4geo");
+    INoiseConstTool* noiseTool = nullptr;
+    if (segmentationType == "FCCSWEndcapTurbine_k4geo") {
+      noiseTool = m_ecalEndcapNoiseTool.get();
+    } else if (m_fieldValuesSegmented[iSys] == m_ecalBarrelSysId && !hcalSegmentation) {
+      noiseTool = m_ecalBarrelNoiseTool.get();
+    } else if (m_fieldValuesSegmented[iSys] == m_hcalBarrelSysId &&
+               segmentationType != "FCCSWGridModuleThetaMerged_k4geo") {
+      noiseTool = m_hcalBarrelNoiseTool.get();
+    } else if (m_fieldValuesSegmented[iSys] == m_hcalEndcapSysId && hcalSegmentation) {
+      noiseTool = m_hcalEndcapNoiseTool.get();
+    }
+    if (noiseTool == nullptr && !cellIds.empty()) {
+      warning() << "Unexpected system value (or no noise tool) for " << segmentationType << " readout "
+                << m_fieldValuesSegmented[iSys] << ", setting noise RMS and offset to 0.0" << endmsg;
+    }
+    info() << "Number of cells: " << cellIds.size() << endmsg;
+    table.addCells(std::move(cellIds), noiseTool);
   }
 
+  table.evaluate(m_numThreads, m_batchSize);
+  info() << "Noise evaluated for " << table.size() << " cells" << endmsg;
+
   // Check if output directory exists
   std::string outDirPath = gSystem->DirName(m_outputFileName.c_str());
   if (!gSystem->OpenDirectory(outDirPath.c_str())) {
@@ -520,15 +514,23 @@ StatusCode CreateFCCeeCaloNoiseLevelMap::initialize() {
   tree.Branch("cellId", &saveCellId, "cellId/l");
   tree.Branch("noiseLevel", &saveNoiseRMS); // would be better to call it noiseRMS
   tree.Branch("noiseOffset", &saveNoiseOffset);
-  for (const auto& item : map) {
-    saveCellId = item.first;
-    saveNoiseRMS = item.second.first;
-    saveNoiseOffset = item.second.second;
+  for (size_t i = 0; i < table.size(); i++) {
+    saveCellId = table.cellIds()[i];
+    saveNoiseRMS = table.noiseRMS()[i];
+    saveNoiseOffset = table.noiseOffset()[i];
     tree.Fill();
   }
   outFile->Write();
   outFile->Close();
 
+  if (!m_outputTableFileName.empty()) {
+    if (!table.save(m_outputTableFileName)) {
+      error() << "Unable to write the noise table to " << m_outputTableFileName << endmsg;
+      return StatusCode::FAILURE;
+    }
+    info() << "Noise table written to " << m_outputTableFileName << endmsg;
+  }
+
   return StatusCode::SUCCESS;
 }
 
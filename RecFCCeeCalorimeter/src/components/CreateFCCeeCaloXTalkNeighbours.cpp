@@ -17,11 +17,23 @@
 #include "TSystem.h"
 #include "TTree.h"
 
+// TBB
+#include <tbb/parallel_for.h>
+
+// RecCaloCommon
+#include "RecCaloCommon/CrosstalkMatrix.h"
+
+// std
+#include <algorithm>
+#include <iterator>
+
 DECLARE_COMPONENT(CreateFCCeeCaloXTalkNeighbours)
 
 CreateFCCeeCaloXTalkNeighbours::CreateFCCeeCaloXTalkNeighbours(const std::string& aName, ISvcLocator* aSL)
     : base_class(aName, aSL) {
   declareProperty("outputFileName", m_outputFileName, "Name of the output file");
+  declareProperty("outputCSRFileName", m_outputCSRFileName,
+                  "Name of the output file of the crosstalk matrix in CSR form (not written if empty)");
 }
 
 CreateFCCeeCaloXTalkNeighbours::~CreateFCCeeCaloXTalkNeighbours() {}
@@ -41,7 +53,12 @@ StatusCode CreateFCCeeCaloXTalkNeighbours::initialize() {
   if(m_connectBarrels){
     warning() << "connectBarrels feature is not yet implemented!" <<endmsg;
   }
-  std::unordered_map<uint64_t, std::vector<std::pair<uint64_t, double>>> map;
+  if (m_numThreads != 1) {
+    m_arena.initialize(m_numThreads > 0 ? int(m_numThreads) : tbb::task_arena::automatic);
+    info() << "Crosstalk neighbours computed on " << m_arena.max_concurrency() << " threads" << endmsg;
+  }
+  // cells with their crosstalk neighbours, in the order of enumeration
+  CellCrosstalks cells;
 
   for (uint iSys = 0; iSys < m_readoutNamesSegmented.size(); iSys++) {
     // Check if readout exists
@@ -90,14 +107,13 @@ StatusCode CreateFCCeeCaloXTalkNeighbours::initialize() {
     // Loop over all cells in the calorimeter and retrieve existing cellIDs and find neihbours
     if (segmentationType == "FCCSWGridModuleThetaMerged_k4geo") {
       std::vector<std::vector<std::pair<int, int>>> extrema_layer;
+      std::vector<dd4hep::DDSegmentation::CellID> layerVolumeIds;
       for (unsigned int ilayer = 0; ilayer < m_activeVolumesNumbersSegmented[iSys]; ilayer++) {
         dd4hep::DDSegmentation::CellID volumeId = 0;
-        static_cast<dd4hep::DDSegmentation::BitFieldCoder>(*decoder)[m_fieldNamesSegmented[iSys]].set(
-            volumeId, m_fieldValuesSegmented[iSys]);
-        static_cast<dd4hep::DDSegmentation::BitFieldCoder>(*decoder)[m_activeFieldNamesSegmented[iSys]].set(volumeId,
-                                                                                                            ilayer);
-        static_cast<dd4hep::DDSegmentation::BitFieldCoder>(*decoder)["theta"].set(volumeId, 0);
-        static_cast<dd4hep::DDSegmentation::BitFieldCoder>(*decoder)["module"].set(volumeId, 0);
+        decoder->set(volumeId, m_fieldNamesSegmented[iSys], m_fieldValuesSegmented[iSys]);
+        decoder->set(volumeId, m_activeFieldNamesSegmented[iSys], ilayer);
+        decoder->set(volumeId, "theta", 0);
+        decoder->set(volumeId, "module", 0);
         auto numCells = det::utils::numberOfCells(volumeId, *moduleThetaSegmentation);
 
         std::vector<std::pair<int, int>> extrema;
@@ -114,40 +130,38 @@ StatusCode CreateFCCeeCaloXTalkNeighbours::initialize() {
         debug() << "Extrema[2]: " << extrema[2].first << " , " << extrema[2].second << endmsg;
         debug() << "Number of segmentation cells in (module,theta): " << numCells << endmsg;
         extrema_layer.emplace_back(extrema);
+        layerVolumeIds.push_back(volumeId);
       }
 
+      // Loop over segmentation cells to find crosstalk neighbours in ECAL, in blocks of one module of one layer
+      std::vector<std::pair<unsigned int, int>> blocks;
       for (unsigned int ilayer = 0; ilayer < m_activeVolumesNumbersSegmented[iSys]; ilayer++) {
-        dd4hep::DDSegmentation::CellID volumeId = 0;
-        // Get VolumeID
-        static_cast<dd4hep::DDSegmentation::BitFieldCoder>(*decoder)[m_fieldNamesSegmented[iSys]].set(
-            volumeId, m_fieldValuesSegmented[iSys]);
-        static_cast<dd4hep::DDSegmentation::BitFieldCoder>(*decoder)[m_activeFieldNamesSegmented[iSys]].set(volumeId,
-                                                                                                            ilayer);
-        static_cast<dd4hep::DDSegmentation::BitFieldCoder>(*decoder)["theta"].set(volumeId, 0);
-        static_cast<dd4hep::DDSegmentation::BitFieldCoder>(*decoder)["module"].set(volumeId, 0);
-        // Loop over segmentation cells to find crosstalk neighbours in ECAL
         for (int imodule = extrema_layer[ilayer][1].first; imodule <= extrema_layer[ilayer][1].second;
              imodule += moduleThetaSegmentation->mergedModules(ilayer)) {
-          for (int itheta = extrema_layer[ilayer][2].first; itheta <= extrema_layer[ilayer][2].second;
-               itheta += moduleThetaSegmentation->mergedThetaCells(ilayer)) {
-            dd4hep::DDSegmentation::CellID cellId = volumeId;
-            decoder->set(cellId, "module", imodule);
-            decoder->set(cellId, "theta", itheta); // start from the minimum existing theta cell in this layer
-            uint64_t id = cellId;
-            map.insert(std::pair<uint64_t, std::vector<std::pair<uint64_t, double>>>(
-                id, det::crosstalk::getNeighboursModuleThetaMerged(
-                        *moduleThetaSegmentation, *decoder, {m_activeFieldNamesSegmented[iSys], "module", "theta"},
-                        extrema_layer, id, m_xtalk_coef_radial, m_xtalk_coef_theta, m_xtalk_coef_diagonal,
-			m_xtalk_coef_tower)));
-          }
+          blocks.emplace_back(ilayer, imodule);
         }
       }
+      const std::vector<std::string> fieldNames{m_activeFieldNamesSegmented[iSys], "module", "theta"};
+      fillCrosstalks(cells, blocks.size(), [&](size_t iBlock, CellCrosstalks& aCells) {
+        auto [ilayer, imodule] = blocks[iBlock];
+        for (int itheta = extrema_layer[ilayer][2].first; itheta <= extrema_layer[ilayer][2].second;
+             itheta += moduleThetaSegmentation->mergedThetaCells(ilayer)) {
+          dd4hep::DDSegmentation::CellID cellId = layerVolumeIds[ilayer];
+          decoder->set(cellId, "module", imodule);
+          decoder->set(cellId, "theta", itheta); // start from the minimum existing theta cell in this layer
+          uint64_t id = cellId;
+          aCells.emplace_back(id, det::crosstalk::getNeighboursModuleThetaMerged(
+                                      *moduleThetaSegmentation, *decoder, fieldNames, extrema_layer, id,
+                                      m_xtalk_coef_radial, m_xtalk_coef_theta, m_xtalk_coef_diagonal,
+                                      m_xtalk_coef_tower));
+        }
+      });
     }
 
     if (msgLevel() <= MSG::DEBUG) {
       std::vector<int> counter;
       counter.assign(40, 0);
-      for (const auto& item : map) {
+      for (const auto& item : cells) {
         counter[item.second.size()]++;
       }
       for (uint iCount = 0; iCount < counter.size(); iCount++) {
@@ -156,13 +170,20 @@ StatusCode CreateFCCeeCaloXTalkNeighbours::initialize() {
         }
       }
     }
-    info() << "total number of cells:  " << map.size() << endmsg;
+    info() << "total number of cells:  " << cells.size() << endmsg;
   }
 
+  // order the cells by cellID, a cell enumerated more than once keeps its first neighbours
+  std::stable_sort(cells.begin(), cells.end(),
+                   [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+  cells.erase(std::unique(cells.begin(), cells.end(),
+                          [](const auto& lhs, const auto& rhs) { return lhs.first == rhs.first; }),
+              cells.end());
+
   if (msgLevel() <= MSG::DEBUG) {
     std::vector<int> counter;
     counter.assign(40, 0);
-    for (const auto& item : map) {
+    for (const auto& item : cells) {
       counter[item.second.size()]++;
     }
     for (uint iCount = 0; iCount < counter.size(); iCount++) {
@@ -192,47 +213,82 @@ StatusCode CreateFCCeeCaloXTalkNeighbours::initialize() {
 
   // Debug: save cell position
   std::vector<int> saveCellInfo;
-  if (m_debugCellInfo){
+  dd4hep::DDSegmentation::FCCSWGridModuleThetaMerged_k4geo* infoSegmentation = nullptr;
+  dd4hep::DDSegmentation::BitFieldCoder* infoDecoder = nullptr;
+  std::vector<std::string> infoFieldNames;
+  if (m_debugCellInfo) {
     tree.Branch("CellInfo", &saveCellInfo);
+    // the cell indices are decoded with the last readout
+    for (uint iSys = 0; iSys < m_readoutNamesSegmented.size(); iSys++) {
+      infoSegmentation = dynamic_cast<dd4hep::DDSegmentation::FCCSWGridModuleThetaMerged_k4geo*>(
+          m_geoSvc->getDetector()->readout(m_readoutNamesSegmented[iSys]).segmentation().segmentation());
+      infoDecoder = m_geoSvc->getDetector()->readout(m_readoutNamesSegmented[iSys]).idSpec().decoder();
+      infoFieldNames = {m_activeFieldNamesSegmented[iSys], "module", "theta"};
+    }
+  }
+
+  k4::recCalo::CrosstalkMatrix matrix;
+  if (!m_outputCSRFileName.empty()) {
+    size_t entries = 0;
+    for (const auto& item : cells) {
+      entries += item.second.size();
+    }
+    matrix.reserve(cells.size(), entries);
   }
 
-  int count_map = 0;
-  for (const auto& item : map) {
+  for (const auto& item : cells) {
     saveCellId = item.first;
-    std::vector<std::pair<uint64_t, double>> temp_pair = item.second;
-    std::vector<uint64_t> temp_neighbours;
-    std::vector<double> temp_crosstalks;
-    for (const auto& this_temp : temp_pair) {
-      temp_neighbours.push_back(this_temp.first);
-      temp_crosstalks.push_back(this_temp.second);
-    }
-    saveNeighbours = temp_neighbours;
-    saveCrosstalks = temp_crosstalks;
+    saveNeighbours.clear();
+    saveCrosstalks.clear();
+    for (const auto& this_temp : item.second) {
+      saveNeighbours.push_back(this_temp.first);
+      saveCrosstalks.push_back(this_temp.second);
+    }
     // Debug: save cell position
-    if (m_debugCellInfo){
-      for (uint iSys = 0; iSys < m_readoutNamesSegmented.size(); iSys++) {
-        dd4hep::DDSegmentation::Segmentation* aSegmentation =
-            m_geoSvc->getDetector()->readout(m_readoutNamesSegmented[iSys]).segmentation().segmentation();
-        std::string segmentationType = aSegmentation->type();
-        dd4hep::DDSegmentation::FCCSWGridModuleThetaMerged_k4geo* moduleThetaSegmentation = nullptr;
-        auto decoder = m_geoSvc->getDetector()->readout(m_readoutNamesSegmented[iSys]).idSpec().decoder();
-        if (segmentationType == "FCCSWGridModuleThetaMerged_k4geo") {
-          moduleThetaSegmentation =
-              dynamic_cast<dd4hep::DDSegmentation::FCCSWGridModuleThetaMerged_k4geo*>(aSegmentation);
-        }
-        saveCellInfo = det::crosstalk::getCellIndices(*moduleThetaSegmentation, *decoder,
-                                                      {m_activeFieldNamesSegmented[iSys], "module", "theta"}, saveCellId);
-      }
+    if (m_debugCellInfo && infoSegmentation != nullptr) {
+      saveCellInfo = det::crosstalk::getCellIndices(*infoSegmentation, *infoDecoder, infoFieldNames, saveCellId);
     }
     tree.Fill();
-    count_map++;
-    if (!count_map % 1000)
-      std::cout << "Number of cells: " << count_map << std::endl;
+    if (!m_outputCSRFileName.empty()) {
+      matrix.addRow(item.first, item.second);
+    }
   }
   outFile->Write();
   outFile->Close();
 
+  if (!m_outputCSRFileName.empty()) {
+    if (!matrix.save(m_outputCSRFileName)) {
+      error() << "Unable to write the crosstalk matrix to " << m_outputCSRFileName << endmsg;
+      return StatusCode::FAILURE;
+    }
+    info() << "Crosstalk matrix of " << matrix.size() << " cells and " << matrix.entries() << " neighbours written to "
+           << m_outputCSRFileName << endmsg;
+  }
+
   return StatusCode::SUCCESS;
 }
 
+void CreateFCCeeCaloXTalkNeighbours::fillCrosstalks(CellCrosstalks& aCells, size_t aNumBlocks,
+                                                    const std::function<void(size_t, CellCrosstalks&)>& aFillBlock) {
+  std::vector<CellCrosstalks> blocks(aNumBlocks);
+  if (m_numThreads != 1) {
+    m_arena.execute([&] {
+      tbb::parallel_for(size_t(0), aNumBlocks, [&](size_t iBlock) { aFillBlock(iBlock, blocks[iBlock]); });
+    });
+  } else {
+    for (size_t iBlock = 0; iBlock < aNumBlocks; iBlock++) {
+      aFillBlock(iBlock, blocks[iBlock]);
+    }
+  }
+  // append in the order of the blocks, as the serial enumeration would
+  size_t numCells = aCells.size();
+  for (const auto& block : blocks) {
+    numCells += block.size();
+  }
+  aCells.reserve(numCells);
+  for (auto& block : blocks) {
+    std::move(block.begin(), block.end(), std::back_inserter(aCells));
+  }
+}
+
 StatusCode CreateFCCeeCaloXTalkNeighbours::finalize() { return Service::finalize(); }
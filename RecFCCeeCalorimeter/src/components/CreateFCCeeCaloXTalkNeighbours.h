@@ -22,12 +22,22 @@
 // ROOT
 #include "TGeoManager.h"
 
+// TBB
+#include <tbb/task_arena.h>
+
+// std
+#include <functional>
+
 class IGeoSvc;
 
 /** @class CreateFCCeeCaloXTalkNeighbours
  *
  *  Service building a map of crosstalk neighbours for all existing cells in the geometry.
  *  Only applicable to the ALLEGRO ECAL barrel with the theta-merged segmentation
+ *  With numThreads different from 1, the neighbours are computed concurrently, in blocks of the theta cells of one
+ *  module of one layer, and the cells are written ordered by cellID, independently of the number of threads. Besides
+ *  the TTree of outputFileName, the map can be written as a sparse matrix in CSR form to outputCSRFileName (see
+ *  k4::recCalo::CrosstalkMatrix), which ReadCaloCrosstalkMap reads as well.
  *
  *  @author Zhibo Wu
  */
@@ -48,6 +58,16 @@ public:
   virtual StatusCode finalize() final;
 
 private:
+  /// Cells with their crosstalk neighbours and coefficients
+  using CellCrosstalks = std::vector<std::pair<uint64_t, std::vector<std::pair<uint64_t, double>>>>;
+  /** Fill the crosstalk neighbours of blocks of cells, concurrently, and append them in the order of the blocks.
+   *   @param[out] aCells, cells to which the cells of the blocks are appended.
+   *   @param[in] aNumBlocks, number of blocks.
+   *   @param[in] aFillBlock, function filling the cells of the block of given index.
+   */
+  void fillCrosstalks(CellCrosstalks& aCells, size_t aNumBlocks,
+                      const std::function<void(size_t, CellCrosstalks&)>& aFillBlock);
+
   /// Pointer to the geometry service
   SmartIF<IGeoSvc> m_geoSvc;
 
@@ -98,8 +118,15 @@ private:
   Gaudi::Property<double> m_hCalPhiOffset{this, "hCalPhiOffset"};
   
 
+  /// Number of threads computing the crosstalk neighbours
+  Gaudi::Property<int> m_numThreads{this, "numThreads", 1,
+                                    "Number of threads computing the crosstalk neighbours (0: TBB default, 1: serial)"};
+  tbb::task_arena m_arena;
+
   /// Name of output file
   std::string m_outputFileName;
+  /// Name of output file of the crosstalk matrix in CSR form
+  std::string m_outputCSRFileName;
 };
 
 #endif /* RECFCCEECALORIMETER_CREATEFCCEECALOXTALKNEIGHBOURS_H */
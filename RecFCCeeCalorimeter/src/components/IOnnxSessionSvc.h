@@ -0,0 +1,52 @@
+#ifndef RECFCCEECALORIMETER_IONNXSESSIONSVC_H
+#define RECFCCEECALORIMETER_IONNXSESSIONSVC_H
+
+// std
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+// Gaudi
+#include "GaudiKernel/IInterface.h"
+
+// ONNX
+#include "onnxruntime_cxx_api.h"
+
+/** @class IOnnxSessionSvc k4RecCalorimeter/RecFCCeeCalorimeter/src/components/IOnnxSessionSvc.h
+ *
+ *  Abstract interface of the service owning the ONNX runtime environment and the inference sessions.
+ *  A model file is loaded (and optimised) once per job, all clients asking for the same file share its session.
+ */
+
+class IOnnxSessionSvc : virtual public IInterface {
+public:
+  DeclareInterfaceID(IOnnxSessionSvc, 1, 0);
+
+  /// Model loaded in a shared session, with the names and shapes of its inputs and outputs (-1 for dynamic dimensions)
+  struct Model {
+    std::string fileName;
+    std::vector<std::string> inputNames;
+    std::vector<std::string> outputNames;
+    std::vector<std::vector<std::int64_t>> inputShapes;
+    std::vector<std::vector<std::int64_t>> outputShapes;
+  };
+
+  /** Model of the file, loaded at the first request of the file.
+   *   @param[in] aFileName, name of the ONNX file.
+   *   @return the model, valid until the service is finalized, nullptr if the file cannot be loaded.
+   */
+  virtual const Model* model(const std::string& aFileName) = 0;
+
+  /** Run the model, safe to call concurrently.
+   *   @param[in] aModel, model returned by model().
+   *   @param[in] aInputs, input tensors, one per input of the model.
+   *   @return the output tensors, one per output of the model. Throws Ort::Exception if the inference fails.
+   */
+  virtual std::vector<Ort::Value> run(const Model& aModel, std::span<const Ort::Value> aInputs) = 0;
+
+  /// Memory description of CPU tensors, to create the input tensors
+  virtual const Ort::MemoryInfo& memoryInfo() const = 0;
+};
+
+#endif /* RECFCCEECALORIMETER_IONNXSESSIONSVC_H */
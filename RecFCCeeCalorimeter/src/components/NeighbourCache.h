@@ -0,0 +1,143 @@
+#ifndef RECFCCEECALORIMETER_NEIGHBOURCACHE_H
+#define RECFCCEECALORIMETER_NEIGHBOURCACHE_H
+
+// std
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/** @class NeighbourCache k4RecCalorimeter/RecFCCeeCalorimeter/src/components/NeighbourCache.h
+ *
+ *  Bounded, thread-safe least-recently-used cache of cell neighbour lists.
+ *  Neighbour lists are computed lazily on the first request for a cellID and stored in a flat arena of fixed-size
+ *  slots, so that the memory used by the cache never exceeds maxCells * slotSize cellIDs. When the cache is full, the
+ *  least recently used entry is evicted. Lists longer than the slot size are returned but not cached.
+ */
+
+class NeighbourCache {
+public:
+  NeighbourCache(size_t aMaxCells, size_t aSlotSize) : m_maxCells(aMaxCells), m_slotSize(aSlotSize) {}
+
+  /** Retrieve the neighbours of a cell, computing them on a cache miss.
+   *   @param[in] aCellId, cellID of the cell of interest.
+   *   @param[out] aNeighbours, filled with the cellIDs of the neighbours.
+   *   @param[in] aCompute, callable (uint64_t, std::vector<uint64_t>&) filling the neighbours of a cell.
+   */
+  template <typename Compute>
+  void neighbours(uint64_t aCellId, std::vector<uint64_t>& aNeighbours, Compute&& aCompute) {
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_index.find(aCellId);
+      if (it != m_index.end()) {
+        uint32_t slot = it->second;
+        const uint64_t* begin = m_arena.data() + slot * m_slotSize;
+        aNeighbours.assign(begin, begin + m_counts[slot]);
+        touch(slot);
+        m_hits++;
+        return;
+      }
+      m_misses++;
+    }
+    // compute outside of the lock, the neighbours of a cell do not depend on the cache state
+    aNeighbours.clear();
+    aCompute(aCellId, aNeighbours);
+    if (aNeighbours.size() > m_slotSize || m_maxCells == 0) {
+      return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // another thread may have inserted the same cell in the meantime
+    if (m_index.find(aCellId) != m_index.end()) {
+      return;
+    }
+    uint32_t slot;
+    if (m_cellIds.size() < m_maxCells) {
+      slot = m_cellIds.size();
+      m_cellIds.push_back(aCellId);
+      m_counts.push_back(0);
+      m_prev.push_back(kNone);
+      m_next.push_back(kNone);
+      m_arena.resize(m_arena.size() + m_slotSize);
+    } else {
+      // evict the least recently used entry
+      slot = m_tail;
+      unlink(slot);
+      m_index.erase(m_cellIds[slot]);
+      m_cellIds[slot] = aCellId;
+      m_evictions++;
+    }
+    std::copy(aNeighbours.begin(), aNeighbours.end(), m_arena.begin() + slot * m_slotSize);
+    m_counts[slot] = aNeighbours.size();
+    m_index.emplace(aCellId, slot);
+    pushFront(slot);
+  }
+
+  /// Number of requests served from the cache
+  uint64_t hits() const { return m_hits; }
+  /// Number of requests that required the computation of the neighbours
+  uint64_t misses() const { return m_misses; }
+  /// Number of entries evicted to respect the memory limit
+  uint64_t evictions() const { return m_evictions; }
+  /// Number of cells currently cached
+  size_t size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_index.size();
+  }
+
+private:
+  static constexpr uint32_t kNone = UINT32_MAX;
+
+  void unlink(uint32_t aSlot) {
+    if (m_prev[aSlot] != kNone)
+      m_next[m_prev[aSlot]] = m_next[aSlot];
+    else
+      m_head = m_next[aSlot];
+    if (m_next[aSlot] != kNone)
+      m_prev[m_next[aSlot]] = m_prev[aSlot];
+    else
+      m_tail = m_prev[aSlot];
+    m_prev[aSlot] = kNone;
+    m_next[aSlot] = kNone;
+  }
+
+  void pushFront(uint32_t aSlot) {
+    m_prev[aSlot] = kNone;
+    m_next[aSlot] = m_head;
+    if (m_head != kNone)
+      m_prev[m_head] = aSlot;
+    m_head = aSlot;
+    if (m_tail == kNone)
+      m_tail = aSlot;
+  }
+
+  void touch(uint32_t aSlot) {
+    if (m_head == aSlot)
+      return;
+    unlink(aSlot);
+    pushFront(aSlot);
+  }
+
+  /// Maximum number of cached cells
+  const size_t m_maxCells;
+  /// Maximum number of neighbours stored per cell
+  const size_t m_slotSize;
+  mutable std::mutex m_mutex;
+  /// cellID -> slot
+  std::unordered_map<uint64_t, uint32_t> m_index;
+  /// neighbour lists, slot i occupies [i * m_slotSize, i * m_slotSize + m_counts[i])
+  std::vector<uint64_t> m_arena;
+  std::vector<uint32_t> m_counts;
+  std::vector<uint64_t> m_cellIds;
+  /// doubly-linked recency list over slots, head is the most recently used
+  std::vector<uint32_t> m_prev;
+  std::vector<uint32_t> m_next;
+  uint32_t m_head = kNone;
+  uint32_t m_tail = kNone;
+  uint64_t m_hits = 0;
+  uint64_t m_misses = 0;
+  uint64_t m_evictions = 0;
+};
+
+#endif /* RECFCCEECALORIMETER_NEIGHBOURCACHE_H */
@@ -0,0 +1,226 @@
+#include "OnnxSessionSvc.h"
+
+// std
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+// POSIX
+#include <unistd.h>
+
+// RecCaloCommon
+#include "RecCaloCommon/Hash.h"
+
+DECLARE_COMPONENT(OnnxSessionSvc)
+
+OnnxSessionSvc::OnnxSessionSvc(const std::string& aName, ISvcLocator* aSL)
+    : base_class(aName, aSL),
+      m_memoryInfo(Ort::MemoryInfo::CreateCpu(OrtAllocatorType::OrtArenaAllocator, OrtMemType::OrtMemTypeDefault)) {}
+
+StatusCode OnnxSessionSvc::initialize() {
+  {
+    StatusCode sc = Service::initialize();
+    if (sc.isFailure())
+      return sc;
+  }
+
+  // set ONNX logging level based on output level of this service
+  OrtLoggingLevel loggingLevel = ORT_LOGGING_LEVEL_WARNING;
+  switch (msgLevel()) {
+  case MSG::Level::FATAL:                   // 6
+    loggingLevel = ORT_LOGGING_LEVEL_FATAL; // 4
+    break;
+  case MSG::Level::ERROR:                   // 5
+    loggingLevel = ORT_LOGGING_LEVEL_ERROR; // 3
+    break;
+  case MSG::Level::WARNING:                   // 4
+    loggingLevel = ORT_LOGGING_LEVEL_WARNING; // 2
+    break;
+  case MSG::Level::INFO:                      // 3
+    loggingLevel = ORT_LOGGING_LEVEL_WARNING; // 2 (ORT_LOGGING_LEVEL_INFO too verbose..)
+    break;
+  case MSG::Level::DEBUG:                  // 2
+    loggingLevel = ORT_LOGGING_LEVEL_INFO; // 1
+    break;
+  case MSG::Level::VERBOSE:                   // 1
+    loggingLevel = ORT_LOGGING_LEVEL_VERBOSE; // 0
+    break;
+  default:
+    break;
+  }
+
+  GraphOptimizationLevel optimizationLevel;
+  if (m_optimizationLevel == "disable") {
+    optimizationLevel = GraphOptimizationLevel::ORT_DISABLE_ALL;
+  } else if (m_optimizationLevel == "basic") {
+    optimizationLevel = GraphOptimizationLevel::ORT_ENABLE_BASIC;
+  } else if (m_optimizationLevel == "extended") {
+    optimizationLevel = GraphOptimizationLevel::ORT_ENABLE_EXTENDED;
+  } else if (m_optimizationLevel == "all") {
+    optimizationLevel = GraphOptimizationLevel::ORT_ENABLE_ALL;
+  } else {
+    error() << "Unknown graph optimisation level " << m_optimizationLevel.value()
+            << ", use one of disable, basic, extended or all" << endmsg;
+    return StatusCode::FAILURE;
+  }
+
+  try {
+    if (m_globalThreadPools) {
+      Ort::ThreadingOptions threadingOptions;
+      threadingOptions.SetGlobalIntraOpNumThreads(m_intraOpNumThreads);
+      threadingOptions.SetGlobalInterOpNumThreads(m_interOpNumThreads);
+      m_env = std::make_unique<Ort::Env>(threadingOptions, loggingLevel, "ONNX runtime environment");
+      m_sessionOptions.DisablePerSessionThreads();
+    } else {
+      m_env = std::make_unique<Ort::Env>(loggingLevel, "ONNX runtime environment");
+      m_sessionOptions.SetIntraOpNumThreads(m_intraOpNumThreads);
+      m_sessionOptions.SetInterOpNumThreads(m_interOpNumThreads);
+    }
+    m_sessionOptions.SetGraphOptimizationLevel(optimizationLevel);
+  } catch (const Ort::Exception& exception) {
+    error() << "ERROR setting up ONNX runtime environment: " << exception.what() << endmsg;
+    return StatusCode::FAILURE;
+  }
+
+  info() << "ONNX runtime sessions use " << (m_globalThreadPools ? "global" : "per-session")
+         << " thread pools with " << m_intraOpNumThreads.value() << " intra-op and " << m_interOpNumThreads.value()
+         << " inter-op threads, graph optimisation level: " << m_optimizationLevel.value() << endmsg;
+  if (!m_cacheDirectory.empty()) {
+    info() << "Optimised models are cached in " << m_cacheDirectory.value() << endmsg;
+  }
+  return StatusCode::SUCCESS;
+}
+
+StatusCode OnnxSessionSvc::finalize() {
+  m_sessions.clear();
+  m_env.reset();
+  return Service::finalize();
+}
+
+const IOnnxSessionSvc::Model* OnnxSessionSvc::model(const std::string& aFileName) {
+  std::lock_guard<std::mutex> lock(m_sessionsMutex);
+  auto it = m_sessions.find(aFileName);
+  if (it != m_sessions.end()) {
+    debug() << "Sharing the session of " << aFileName << endmsg;
+    return it->second.get();
+  }
+  if (!m_env) {
+    error() << "The ONNX runtime environment is not initialized, unable to load " << aFileName << endmsg;
+    return nullptr;
+  }
+
+  // with the cache of optimised models, load the optimised model if it exists, otherwise write it
+  std::string modelFileName = aFileName;
+  Ort::SessionOptions sessionOptions = m_sessionOptions.Clone();
+  std::string cachedFileName, temporaryFileName;
+  if (!m_cacheDirectory.empty()) {
+    cachedFileName = optimizedModelFileName(aFileName);
+    std::error_code errorCode;
+    if (cachedFileName.empty()) {
+      warning() << "Unable to read " << aFileName << ", the optimised model is not cached" << endmsg;
+    } else if (std::filesystem::exists(cachedFileName, errorCode)) {
+      debug() << "Loading the optimised model " << cachedFileName << endmsg;
+      modelFileName = cachedFileName;
+      sessionOptions.SetGraphOptimizationLevel(GraphOptimizationLevel::ORT_DISABLE_ALL);
+    } else {
+      // written to a file private to this process and renamed, readers never see a partial file
+      std::filesystem::create_directories(m_cacheDirectory.value(), errorCode);
+      temporaryFileName = cachedFileName + ".tmp" + std::to_string(getpid());
+      sessionOptions.SetOptimizedModelFilePath(temporaryFileName.c_str());
+    }
+  }
+
+  auto session = std::make_unique<Session>();
+  session->fileName = aFileName;
+  try {
+    try {
+      session->session = std::make_unique<Ort::Session>(*m_env, modelFileName.c_str(), sessionOptions);
+    } catch (const Ort::Exception& exception) {
+      if (modelFileName == aFileName) {
+        throw;
+      }
+      // the cached model is corrupted or was written by an incompatible runtime: it is removed and written again
+      // from the source model
+      warning() << "Unable to load the optimised model " << modelFileName << " (" << exception.what()
+                << "), optimising " << aFileName << " again" << endmsg;
+      std::error_code errorCode;
+      std::filesystem::remove(cachedFileName, errorCode);
+      temporaryFileName = cachedFileName + ".tmp" + std::to_string(getpid());
+      sessionOptions = m_sessionOptions.Clone();
+      sessionOptions.SetOptimizedModelFilePath(temporaryFileName.c_str());
+      session->session = std::make_unique<Ort::Session>(*m_env, aFileName.c_str(), sessionOptions);
+    }
+    if (!temporaryFileName.empty()) {
+      std::error_code errorCode;
+      std::filesystem::rename(temporaryFileName, cachedFileName, errorCode);
+      if (errorCode) {
+        std::filesystem::remove(temporaryFileName, errorCode);
+        warning() << "Unable to write the optimised model " << cachedFileName << endmsg;
+      } else {
+        info() << "Wrote the optimised model " << cachedFileName << endmsg;
+      }
+    }
+
+    // use default allocator (CPU)
+    Ort::AllocatorWithDefaultOptions allocator;
+#if ORT_API_VERSION < 13
+    // Before 1.13 we have to roll our own unique_ptr wrapper here
+    auto allocDeleter = [&allocator](char* p) { allocator.Free(p); };
+    using AllocatedStringPtr = std::unique_ptr<char, decltype(allocDeleter)>;
+#endif
+    for (std::size_t i = 0; i < session->session->GetInputCount(); i++) {
+#if ORT_API_VERSION < 13
+      session->inputNames.emplace_back(
+          AllocatedStringPtr(session->session->GetInputName(i, allocator), allocDeleter).get());
+#else
+      session->inputNames.emplace_back(session->session->GetInputNameAllocated(i, allocator).get());
+#endif
+      session->inputShapes.push_back(session->session->GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape());
+    }
+    for (std::size_t i = 0; i < session->session->GetOutputCount(); i++) {
+#if ORT_API_VERSION < 13
+      session->outputNames.emplace_back(
+          AllocatedStringPtr(session->session->GetOutputName(i, allocator), allocDeleter).get());
+#else
+      session->outputNames.emplace_back(session->session->GetOutputNameAllocated(i, allocator).get());
+#endif
+      session->outputShapes.push_back(session->session->GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape());
+    }
+  } catch (const Ort::Exception& exception) {
+    error() << "ERROR loading the ONNX model " << aFileName << ": " << exception.what() << endmsg;
+    return nullptr;
+  }
+  for (const auto& name : session->inputNames) {
+    session->inputNamePointers.push_back(name.c_str());
+  }
+  for (const auto& name : session->outputNames) {
+    session->outputNamePointers.push_back(name.c_str());
+  }
+  info() << "Loaded ONNX model " << aFileName << " with " << session->inputNames.size() << " inputs and "
+         << session->outputNames.size() << " outputs" << endmsg;
+  return m_sessions.emplace(aFileName, std::move(session)).first->second.get();
+}
+
+std::string OnnxSessionSvc::optimizedModelFileName(const std::string& aFileName) const {
+  std::ifstream file(aFileName, std::ios::binary);
+  if (!file) {
+    return "";
+  }
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+  // the optimised model depends on the model, the version of the runtime and the optimisation level
+  uint64_t key = k4::recCalo::hashCombine(0, content);
+  key = k4::recCalo::hashCombine(key, OrtGetApiBase()->GetVersionString());
+  key = k4::recCalo::hashCombine(key, m_optimizationLevel.value());
+  char name[17];
+  std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+  std::string stem = std::filesystem::path(aFileName).stem().string();
+  return (std::filesystem::path(m_cacheDirectory.value()) / (stem + "_" + name + ".onnx")).string();
+}
+
+std::vector<Ort::Value> OnnxSessionSvc::run(const Model& aModel, std::span<const Ort::Value> aInputs) {
+  // the model was created by this service as a Session
+  const auto& session = static_cast<const Session&>(aModel);
+  return session.session->Run(Ort::RunOptions{nullptr}, session.inputNamePointers.data(), aInputs.data(),
+                              aInputs.size(), session.outputNamePointers.data(), session.outputNamePointers.size());
+}
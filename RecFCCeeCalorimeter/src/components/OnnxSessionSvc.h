@@ -0,0 +1,76 @@
+#ifndef RECFCCEECALORIMETER_ONNXSESSIONSVC_H
+#define RECFCCEECALORIMETER_ONNXSESSIONSVC_H
+
+// std
+#include <map>
+#include <memory>
+#include <mutex>
+
+// Gaudi
+#include "GaudiKernel/Service.h"
+
+#include "IOnnxSessionSvc.h"
+
+/** @class OnnxSessionSvc k4RecCalorimeter/RecFCCeeCalorimeter/src/components/OnnxSessionSvc.h
+ *
+ *  Service owning the single ONNX runtime environment of the job and one session per model file.
+ *  The threading and the graph optimisation of all sessions are configured here: each session has its own intra-op
+ *  and inter-op thread pools of intraOpNumThreads and interOpNumThreads threads, or, with globalThreadPools, all
+ *  sessions share the thread pools of the environment. Sessions are created on the first request of a file (by the
+ *  clients in initialize) and Ort::Session::Run is safe to call concurrently, so events can share the sessions.
+ *  With cacheDirectory set, the model optimised by the runtime is written to the directory, under a name containing a
+ *  hash of the model file, of the runtime version and of the optimisation level, and is loaded without optimisation
+ *  by the next jobs. A cached model which cannot be loaded is replaced by the model optimised again from the file.
+ *  Optimised models may be specific to the CPU, so the directory should not be shared between machines of different
+ *  architectures.
+ */
+
+class OnnxSessionSvc : public extends<Service, IOnnxSessionSvc> {
+public:
+  OnnxSessionSvc(const std::string& aName, ISvcLocator* aSL);
+  virtual ~OnnxSessionSvc() = default;
+
+  virtual StatusCode initialize() final;
+  virtual StatusCode finalize() final;
+
+  virtual const Model* model(const std::string& aFileName) final;
+  virtual std::vector<Ort::Value> run(const Model& aModel, std::span<const Ort::Value> aInputs) final;
+  virtual const Ort::MemoryInfo& memoryInfo() const final { return m_memoryInfo; }
+
+private:
+  /// Name of the cached optimised model of a file, empty if the file cannot be read
+  std::string optimizedModelFileName(const std::string& aFileName) const;
+
+  /// Model with its session
+  struct Session : public Model {
+    std::unique_ptr<Ort::Session> session;
+    std::vector<const char*> inputNamePointers;
+    std::vector<const char*> outputNamePointers;
+  };
+
+  /// Number of threads used to parallelise the execution within nodes
+  Gaudi::Property<int> m_intraOpNumThreads{this, "intraOpNumThreads", 1,
+                                           "Number of threads parallelising the execution within nodes (0: default)"};
+  /// Number of threads used to parallelise the execution of the graph
+  Gaudi::Property<int> m_interOpNumThreads{this, "interOpNumThreads", 1,
+                                           "Number of threads parallelising the execution of the graph (0: default)"};
+  /// Share the thread pools of the environment between all sessions
+  Gaudi::Property<bool> m_globalThreadPools{this, "globalThreadPools", false,
+                                            "Share one set of thread pools between all sessions"};
+  /// Graph optimisation level
+  Gaudi::Property<std::string> m_optimizationLevel{
+      this, "graphOptimizationLevel", "all", "Graph optimisation level: disable, basic, extended or all"};
+
+  /// Directory of the cache of optimised models
+  Gaudi::Property<std::string> m_cacheDirectory{this, "cacheDirectory", "",
+                                                "Directory of the cache of optimised models (no cache if empty)"};
+
+  std::unique_ptr<Ort::Env> m_env;
+  Ort::SessionOptions m_sessionOptions;
+  Ort::MemoryInfo m_memoryInfo;
+  /// Sessions by model file name
+  std::map<std::string, std::unique_ptr<Session>> m_sessions;
+  std::mutex m_sessionsMutex;
+};
+
+#endif /* RECFCCEECALORIMETER_ONNXSESSIONSVC_H */
@@ -3,11 +3,12 @@
 
 #include "onnxruntime_cxx_api.h"
 
+#include <span>
 #include <vector>
 
-// convert vector data with given shape into ONNX runtime tensor
+// convert vector data (or a contiguous part of it) with given shape into ONNX runtime tensor
 template <typename T>
-Ort::Value vec_to_tensor(std::vector<T>& data, const std::vector<std::int64_t>& shape,
+Ort::Value vec_to_tensor(std::span<T> data, const std::vector<std::int64_t>& shape,
                          const Ort::MemoryInfo& mem_info) {
   auto tensor = Ort::Value::CreateTensor<T>(mem_info, data.data(), data.size(), shape.data(), shape.size());
   return tensor;
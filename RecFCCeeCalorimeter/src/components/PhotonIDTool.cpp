@@ -4,6 +4,7 @@
 #include "edm4hep/Cluster.h"
 #include "edm4hep/ClusterCollection.h"
 
+#include <algorithm>
 #include <fstream>
 
 #include "nlohmann/json.hpp"
@@ -15,8 +16,7 @@ using json = nlohmann::json;
 DECLARE_COMPONENT(PhotonIDTool)
 
 PhotonIDTool::PhotonIDTool(const std::string& name, ISvcLocator* svcLoc)
-    : Gaudi::Algorithm(name, svcLoc),
-      m_ortMemInfo(Ort::MemoryInfo::CreateCpu(OrtAllocatorType::OrtArenaAllocator, OrtMemType::OrtMemTypeDefault)) {
+    : Gaudi::Algorithm(name, svcLoc) {
   declareProperty("inClusters", m_inClusters, "Input cluster collection");
   declareProperty("outClusters", m_outClusters, "Output cluster collection");
 }
@@ -30,6 +30,11 @@ StatusCode PhotonIDTool::initialize() {
     }
   }
 
+  if (m_batchSize == 0) {
+    error() << "The batch size has to be at least 1, exiting!" << endmsg;
+    return StatusCode::FAILURE;
+  }
+
   // read the files defining the model
   StatusCode sc = readMVAFiles(m_mvaInputsFile, m_mvaModelFile);
   if (sc.isFailure()) {
@@ -113,23 +118,7 @@ StatusCode PhotonIDTool::execute([[maybe_unused]] const EventContext& evtCtx) co
   return StatusCode::SUCCESS;
 }
 
-StatusCode PhotonIDTool::finalize() {
-  if (m_ortSession)
-    delete m_ortSession;
-
-  if (m_ortEnv)
-    delete m_ortEnv;
-
-  for (auto& name : m_input_names) {
-    delete name;
-  }
-
-  for (auto& name : m_output_names) {
-    delete name;
-  }
-
-  return Gaudi::Algorithm::finalize();
-}
+StatusCode PhotonIDTool::finalize() { return Gaudi::Algorithm::finalize(); }
 
 edm4hep::ClusterCollection* PhotonIDTool::initializeOutputClusters(const edm4hep::ClusterCollection* inClusters) const {
   edm4hep::ClusterCollection* outClusters = m_outClusters.createAndPut();
@@ -235,67 +224,33 @@ StatusCode PhotonIDTool::readMVAFiles(const std::string& mvaInputsFileName, cons
     }
   }
 
-  // 2. - read the file with the MVA model and setup the ONNX runtime
-  // set ONNX logging level based on output level of this alg
-  OrtLoggingLevel loggingLevel = ORT_LOGGING_LEVEL_WARNING;
-  MSG::Level outputLevel = this->msgStream().level();
-  switch (outputLevel) {
-  case MSG::Level::FATAL:                   // 6
-    loggingLevel = ORT_LOGGING_LEVEL_FATAL; // 4
-    break;
-  case MSG::Level::ERROR:                   // 5
-    loggingLevel = ORT_LOGGING_LEVEL_ERROR; // 3
-    break;
-  case MSG::Level::WARNING:                   // 4
-    loggingLevel = ORT_LOGGING_LEVEL_WARNING; // 2
-    break;
-  case MSG::Level::INFO:                      // 3
-    loggingLevel = ORT_LOGGING_LEVEL_WARNING; // 2 (ORT_LOGGING_LEVEL_INFO too verbose..)
-    break;
-  case MSG::Level::DEBUG:                  // 2
-    loggingLevel = ORT_LOGGING_LEVEL_INFO; // 1
-    break;
-  case MSG::Level::VERBOSE:                   // 1
-    loggingLevel = ORT_LOGGING_LEVEL_VERBOSE; // 0
-    break;
-  default:
-    break;
+  // 2. - get the session of the MVA model from the ONNX session service (shared with the other clients of the file)
+  if (!m_onnxSvc.retrieve()) {
+    error() << "Unable to retrieve the ONNX session service!" << endmsg;
+    return StatusCode::FAILURE;
   }
-  try {
-    m_ortEnv = new Ort::Env(loggingLevel, "ONNX runtime environment for photonID");
-    Ort::SessionOptions session_options;
-    session_options.SetIntraOpNumThreads(1);
-    m_ortSession = new Ort::Session(*m_ortEnv, mvaModelFileName.data(), session_options);
-  } catch (const Ort::Exception& exception) {
-    error() << "ERROR setting up ONNX runtime environment: " << exception.what() << endmsg;
+  m_model = m_onnxSvc->model(mvaModelFileName);
+  if (!m_model) {
+    error() << "Unable to load the MVA model " << mvaModelFileName << endmsg;
     return StatusCode::FAILURE;
   }
 
   // print name/shape of inputs
-  // use default allocator (CPU)
-  Ort::AllocatorWithDefaultOptions allocator;
-#if ORT_API_VERSION < 13
-  // Before 1.13 we have to roll our own unique_ptr wrapper here
-  auto allocDeleter = [&allocator](char* p) { allocator.Free(p); };
-  using AllocatedStringPtr = std::unique_ptr<char, decltype(allocDeleter)>;
-#endif
-
-  debug() << "Input Node Name/Shape (" << m_ortSession->GetInputCount() << "):" << endmsg;
-  for (std::size_t i = 0; i < m_ortSession->GetInputCount(); i++) {
-#if ORT_API_VERSION < 13
-    m_input_names.emplace_back(AllocatedStringPtr(m_ortSession->GetInputName(i, allocator), allocDeleter).release());
-#else
-    m_input_names.emplace_back(m_ortSession->GetInputNameAllocated(i, allocator).release());
-#endif
-
-    m_input_shapes = m_ortSession->GetInputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
-    debug() << "\t" << m_input_names.at(i) << " : ";
+  debug() << "Input Node Name/Shape (" << m_model->inputNames.size() << "):" << endmsg;
+  for (std::size_t i = 0; i < m_model->inputNames.size(); i++) {
+    m_input_shapes = m_model->inputShapes[i];
+    debug() << "\t" << m_model->inputNames[i] << " : ";
     for (std::size_t k = 0; k < m_input_shapes.size() - 1; k++) {
       debug() << m_input_shapes[k] << "x";
     }
     debug() << m_input_shapes[m_input_shapes.size() - 1] << endmsg;
   }
   // some models might have negative shape values to indicate dynamic shape, e.g., for variable batch size.
+  // Batches of several clusters can only be passed to models with a dynamic batch size.
+  if (!m_input_shapes.empty() && m_input_shapes[0] >= 0 && m_batchSize > 1) {
+    info() << "The photon-ID model has a fixed batch size, the clusters will be processed one at a time" << endmsg;
+    m_batchSize = 1;
+  }
   for (auto& s : m_input_shapes) {
     if (s < 0) {
       s = 1;
@@ -303,17 +258,11 @@ StatusCode PhotonIDTool::readMVAFiles(const std::string& mvaInputsFileName, cons
   }
 
   // print name/shape of outputs
-  debug() << "Output Node Name/Shape (" << m_ortSession->GetOutputCount() << "):" << endmsg;
-  for (std::size_t i = 0; i < m_ortSession->GetOutputCount(); i++) {
-#if ORT_API_VERSION < 13
-    m_output_names.emplace_back(AllocatedStringPtr(m_ortSession->GetOutputName(i, allocator), allocDeleter).release());
-#else
-    m_output_names.emplace_back(m_ortSession->GetOutputNameAllocated(i, allocator).release());
-#endif
-
-    m_output_shapes = m_ortSession->GetOutputTypeInfo(i).GetTensorTypeAndShapeInfo().GetShape();
+  debug() << "Output Node Name/Shape (" << m_model->outputNames.size() << "):" << endmsg;
+  for (std::size_t i = 0; i < m_model->outputNames.size(); i++) {
+    m_output_shapes = m_model->outputShapes[i];
     debug() << m_output_shapes.size() << endmsg;
-    debug() << "\t" << m_output_names.at(i) << " : ";
+    debug() << "\t" << m_model->outputNames[i] << " : ";
     for (std::size_t k = 0; k < m_output_shapes.size() - 1; k++) {
       debug() << m_output_shapes[k] << "x";
     }
@@ -327,54 +276,68 @@ StatusCode PhotonIDTool::readMVAFiles(const std::string& mvaInputsFileName, cons
 
 StatusCode PhotonIDTool::applyMVAtoClusters(const edm4hep::ClusterCollection* inClusters,
                                             edm4hep::ClusterCollection* outClusters) const {
-  size_t numShapeVars = m_internal_input_names.size();
-  std::vector<float> mvaInputs(numShapeVars);
-
-  // loop over the input clusters and perform the inference
-  for (unsigned int j = 0; j < inClusters->size(); ++j) {
-    // read the values of the input features
-    for (unsigned int i = 0; i < m_inputPositionsInShapeParameters.size(); i++) {
-      int position = m_inputPositionsInShapeParameters[i];
-      if (position == -1)
-        mvaInputs[i] = (inClusters->at(j)).getEnergy();
-      else
-        mvaInputs[i] = (inClusters->at(j)).getShapeParameters(position);
-    }
+  const size_t numShapeVars = m_internal_input_names.size();
+  const size_t numClusters = inClusters->size();
+
+  // the clusters are processed in batches of up to m_batchSize clusters: the features of the clusters of a batch are
+  // gathered into one [nClusters, nFeatures] buffer and the model is run once per batch
+  const size_t batchSize = std::min<size_t>(m_batchSize, std::max<size_t>(numClusters, 1));
+  std::vector<float> mvaInputs;
+  mvaInputs.reserve(batchSize * numShapeVars);
+  std::vector<std::int64_t> batchShape = m_input_shapes;
+
+  for (size_t first = 0; first < numClusters; first += batchSize) {
+    const size_t last = std::min(first + batchSize, numClusters);
+
+    // read the values of the input features, one row per cluster
+    mvaInputs.resize((last - first) * numShapeVars);
+    for (size_t j = first; j < last; ++j) {
+      const auto cluster = (*inClusters)[j];
+      const auto shapeParameters = cluster.getShapeParameters();
+      float* row = mvaInputs.data() + (j - first) * numShapeVars;
+      for (size_t i = 0; i < numShapeVars; i++) {
+        int position = m_inputPositionsInShapeParameters[i];
+        row[i] = (position == -1) ? cluster.getEnergy() : shapeParameters[position];
+      }
 
-    // print the values of the input features
-    verbose() << "MVA inputs:" << endmsg;
-    for (unsigned short int k = 0; k < numShapeVars; ++k) {
-      verbose() << "var " << k << " : " << mvaInputs[k] << endmsg;
+      // print the values of the input features
+      if (msgLevel() <= MSG::VERBOSE) {
+        verbose() << "MVA inputs:" << endmsg;
+        for (unsigned short int k = 0; k < numShapeVars; ++k) {
+          verbose() << "var " << k << " : " << row[k] << endmsg;
+        }
+      }
     }
 
-    // run the MVA and save the output score in output
-    float score = -1.0;
-    // Create a single Ort tensor
+    // run the MVA on the batch
+    batchShape[0] = last - first;
     std::vector<Ort::Value> input_tensors;
-    input_tensors.emplace_back(vec_to_tensor<float>(mvaInputs, m_input_shapes, m_ortMemInfo));
+    input_tensors.emplace_back(vec_to_tensor<float>(mvaInputs, batchShape, m_onnxSvc->memoryInfo()));
 
     // pass data through model
     try {
-      auto output_tensors = m_ortSession->Run(Ort::RunOptions{nullptr}, m_input_names.data(), input_tensors.data(),
-                                              input_tensors.size(), m_output_names.data(), m_output_names.size());
+      auto output_tensors = m_onnxSvc->run(*m_model, input_tensors);
 
       // double-check the dimensions of the output tensors
       // NOTE: the number of output tensors is equal to the number of output nodes specified in the Run() call
       // assert(output_tensors.size() == output_names.size() && output_tensors[0].IsTensor());
-      // the probabilities are in the 2nd entry of the output
+      // the probabilities are in the 2nd entry of the output, one row of class probabilities per cluster
+      auto outputShape = output_tensors[1].GetTensorTypeAndShapeInfo().GetShape();
       debug() << output_tensors.size() << endmsg;
-      debug() << output_tensors[1].GetTensorTypeAndShapeInfo().GetShape() << endmsg;
-      float* outputData = output_tensors[1].GetTensorMutableData<float>();
-      for (int i = 0; i < 2; i++)
-        debug() << i << " " << outputData[i] << endmsg;
-      score = outputData[1];
+      debug() << outputShape << endmsg;
+      const size_t numClasses = outputShape.size() > 1 ? outputShape[1] : 2;
+      const float* outputData = output_tensors[1].GetTensorData<float>();
+
+      // save the score (photon probability) of each cluster in output
+      for (size_t j = first; j < last; ++j) {
+        float score = outputData[(j - first) * numClasses + 1];
+        verbose() << "Photon ID score: " << score << endmsg;
+        outClusters->at(j).addToShapeParameters(score);
+      }
     } catch (const Ort::Exception& exception) {
       error() << "ERROR running model inference: " << exception.what() << endmsg;
       return StatusCode::FAILURE;
     }
-
-    verbose() << "Photon ID score: " << score << endmsg;
-    outClusters->at(j).addToShapeParameters(score);
   }
 
   return StatusCode::SUCCESS;
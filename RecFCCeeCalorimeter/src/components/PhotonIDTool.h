@@ -20,7 +20,7 @@ class ClusterCollection;
 } // namespace edm4hep
 
 // ONNX
-#include "onnxruntime_cxx_api.h"
+#include "IOnnxSessionSvc.h"
 
 /** @class PhotonIDTool
  *
@@ -29,6 +29,8 @@ class ClusterCollection;
  *  the variables in the shapeParameters of the input clusters, decorates the
  *  cluster with the photon probability (appended to the shapeParameters vector)
  *  and saves the cluster in a new output collection.
+ *  The features of up to batchSize clusters are gathered into one [nClusters, nFeatures]
+ *  input tensor and the model is run once per batch.
  *
  *  @author Giovanni Marchiori
  */
@@ -89,16 +91,17 @@ private:
   /// Files with the MVA model and list of inputs
   Gaudi::Property<std::string> m_mvaModelFile{this, "mvaModelFile", {}, "ONNX file with the mva model"};
   Gaudi::Property<std::string> m_mvaInputsFile{this, "mvaInputsFile", {}, "JSON file with the mva inputs"};
-
-  // the ONNX runtime session for running the inference,
-  // the environment, and the input and output shapes and names
-  Ort::Session* m_ortSession = nullptr;
-  Ort::Env* m_ortEnv = nullptr;
-  Ort::MemoryInfo m_ortMemInfo;
+  /// Maximum number of clusters processed in one run of the model
+  Gaudi::Property<unsigned int> m_batchSize{this, "batchSize", 256,
+                                            "Maximum number of clusters processed in one run of the model"};
+
+  // the service owning the ONNX runtime sessions, the MVA model,
+  // and the input and output shapes
+  mutable ServiceHandle<IOnnxSessionSvc> m_onnxSvc{this, "onnxSessionSvc", "OnnxSessionSvc",
+                                                   "Service providing the ONNX runtime sessions"};
+  const IOnnxSessionSvc::Model* m_model = nullptr;
   std::vector<std::int64_t> m_input_shapes;
   std::vector<std::int64_t> m_output_shapes;
-  std::vector<const char*> m_input_names;
-  std::vector<const char*> m_output_names;
   std::vector<std::string> m_internal_input_names;
 
   // the indices of the shapeParameters containing the inputs to the model (-1 if not found)
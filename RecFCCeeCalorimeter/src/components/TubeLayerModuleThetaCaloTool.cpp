@@ -10,6 +10,10 @@
 // k4FWCore
 #include "k4Interface/IGeoSvc.h"
 
+// k4RecCalorimeter
+#include "RecCaloCommon/CellListCache.h"
+#include "RecCaloCommon/Hash.h"
+
 DECLARE_COMPONENT(TubeLayerModuleThetaCaloTool)
 
 TubeLayerModuleThetaCaloTool::TubeLayerModuleThetaCaloTool(const std::string& type, const std::string& name,
@@ -42,6 +46,19 @@ StatusCode TubeLayerModuleThetaCaloTool::initialize() {
 StatusCode TubeLayerModuleThetaCaloTool::finalize() { return AlgTool::finalize(); }
 
 StatusCode TubeLayerModuleThetaCaloTool::prepareEmptyCells(std::unordered_map<uint64_t, double>& aCells) {
+  if (m_cellCacheDirectory.empty()) {
+    return enumerateCells(aCells);
+  }
+  uint64_t key = k4::recCalo::CellListCache::geometryKey(*m_geoSvc->getDetector(), m_readoutName);
+  key = k4::recCalo::hashCombine(key, type());
+  key = k4::recCalo::CellListCache::combine(key, {&m_readoutName, &m_activeVolumeName, &m_activeFieldName,
+                                                  &m_fieldNames, &m_fieldValues, &m_activeVolumesNumber});
+  k4::recCalo::CellListCache cache(m_cellCacheDirectory, m_readoutName, key);
+  return cache.prepareEmptyCells(aCells, m_validateCellCache, msgStream(),
+                                 [this](std::unordered_map<uint64_t, double>& cells) { return enumerateCells(cells); });
+}
+
+StatusCode TubeLayerModuleThetaCaloTool::enumerateCells(std::unordered_map<uint64_t, double>& aCells) {
   // Get the total number of active volumes in the geometry
   unsigned int numLayers = m_activeVolumesNumber;
   info() << "Number of active layers " << numLayers << endmsg;
@@ -34,12 +34,17 @@ public:
    *   n_theta is number of eta bins in that layer,
    *   n_phi is number of phi bins (the same for each layer).
    *   For more explanation please [see reconstruction documentation](@ref md_reconstruction_doc_reccalorimeter).
+   *   If '\b cellCacheDirectory' is set, the sorted list of cellIDs is read from a cache file keyed by the geometry
+   *   and the configuration of the tool, and written there if it does not exist yet.
    *   @param[out] aCells map of existing cells (and deposited energy, set to 0)
    *   return Status code.
    */
   virtual StatusCode prepareEmptyCells(std::unordered_map<uint64_t, double>& aCells) final;
 
 private:
+  /// Enumerate all existing cells from the geometry
+  StatusCode enumerateCells(std::unordered_map<uint64_t, double>& aCells);
+
   /// Pointer to the geometry service
   ServiceHandle<IGeoSvc> m_geoSvc;
   /// Name of the detector readout
@@ -54,6 +59,13 @@ private:
   Gaudi::Property<std::vector<int>> m_fieldValues{this, "fieldValues"};
   /// Number of layers
   Gaudi::Property<unsigned int> m_activeVolumesNumber{this, "activeVolumesNumber", 0};
+  /// Directory of the cache of cellIDs, no cache if empty
+  Gaudi::Property<std::string> m_cellCacheDirectory{this, "cellCacheDirectory", "",
+                                                    "Directory of the cache of cellIDs, no cache if empty"};
+  /// Enumerate the cells even if they are found in the cache, and check that they agree
+  Gaudi::Property<bool> m_validateCellCache{
+      this, "validateCellCache", false,
+      "Enumerate the cells even if they are found in the cache, and check that they agree"};
 };
 
 #endif /* RECFCCEECALORIMETER_TUBELAYERMODULETHETAMERGEDCALOTOOL_H */
@@ -8,6 +8,8 @@
 #include "TSystem.h"
 #include "TTree.h"
 
+#include "RecCaloCommon/NoiseLevelTable.h"
+
 DECLARE_COMPONENT(CreateFCChhCaloNoiseLevelMap)
 
 CreateFCChhCaloNoiseLevelMap::CreateFCChhCaloNoiseLevelMap(const std::string& aName, ISvcLocator* aSL)
@@ -15,6 +17,8 @@ CreateFCChhCaloNoiseLevelMap::CreateFCChhCaloNoiseLevelMap(const std::string& aN
   declareProperty("ECalBarrelNoiseTool", m_ecalBarrelNoiseTool, "Handle for the cells noise tool of Barrel ECal");
   declareProperty("HCalBarrelNoiseTool", m_hcalBarrelNoiseTool, "Handle for the cells noise tool of Barrel HCal");
   declareProperty("outputFileName", m_outputFileName, "Name of the output file");
+  declareProperty("outputTableFileName", m_outputTableFileName,
+                  "Name of the output file of the binary noise table (not written if empty)");
 }
 
 CreateFCChhCaloNoiseLevelMap::~CreateFCChhCaloNoiseLevelMap() {}
@@ -31,7 +35,7 @@ StatusCode CreateFCChhCaloNoiseLevelMap::initialize() {
             << "Make sure you have GeoSvc and SimSvc in the right order in the configuration." << endmsg;
     return StatusCode::FAILURE;
   }
-  std::unordered_map<uint64_t, std::pair<double, double>> map;
+  k4::recCalo::NoiseLevelTable table;
 
   //////////////////////////////////
   /// SEGMENTED ETA-PHI VOLUMES  ///
@@ -62,6 +66,7 @@ StatusCode CreateFCChhCaloNoiseLevelMap::initialize() {
     auto decoder = m_geoSvc->getDetector()->readout(m_readoutNamesSegmented[iSys]).idSpec().decoder();
     // Loop over all cells in the calorimeter and retrieve existing cellIDs
     // Loop over active layers
+    std::vector<uint64_t> cellIds;
     std::vector<std::pair<int, int>> extrema;
     extrema.push_back(std::make_pair(0, m_activeVolumesNumbersSegmented[iSys] - 1));
     extrema.push_back(std::make_pair(0, 0));
@@ -94,19 +99,18 @@ StatusCode CreateFCChhCaloNoiseLevelMap::initialize() {
           decoder->set(cellId, "phi", iphi);
           decoder->set(cellId, "eta", ieta + numCells[2]); // start from the minimum existing eta cell in this layer
           uint64_t id = cellId;
-          double noiseRMS = 0.;
-          double noiseOffset = 0.;
-          if (m_fieldValuesSegmented[iSys] == m_hcalBarrelSysId) {
-            noiseRMS = m_hcalBarrelNoiseTool->getNoiseRMSPerCell(id);
-            noiseOffset = m_hcalBarrelNoiseTool->getNoiseOffsetPerCell(id);
-          } else if (m_fieldValuesSegmented[iSys] == m_ecalBarrelSysId) {
-            noiseRMS = m_ecalBarrelNoiseTool->getNoiseRMSPerCell(id);
-            noiseOffset = m_ecalBarrelNoiseTool->getNoiseOffsetPerCell(id);
-          }
-          map.insert(std::pair<uint64_t, std::pair<double, double>>(id, std::make_pair(noiseRMS, noiseOffset)));
+          cellIds.push_back(id);
         }
       }
     }
+    // the noise is evaluated once all cells are known
+    INoiseConstTool* noiseTool = nullptr;
+    if (m_fieldValuesSegmented[iSys] == m_hcalBarrelSysId) {
+      noiseTool = m_hcalBarrelNoiseTool.get();
+    } else if (m_fieldValuesSegmented[iSys] == m_ecalBarrelSysId) {
+      noiseTool = m_ecalBarrelNoiseTool.get();
+    }
+    table.addCells(std::move(cellIds), noiseTool);
   }
 
   //////////////////////////////////
@@ -181,6 +185,7 @@ StatusCode CreateFCChhCaloNoiseLevelMap::initialize() {
 
     // Loop over all cells in the calorimeter and retrieve existing cellIDs
     // Loop over active layers
+    std::vector<uint64_t> cellIds;
     std::vector<std::pair<int, int>> extrema;
     extrema.push_back(std::make_pair(0, activeVolumesNumbersNested.find(m_activeFieldNamesNested[0])->second - 1));
     extrema.push_back(std::make_pair(0, activeVolumesNumbersNested.find(m_activeFieldNamesNested[1])->second - 1));
@@ -194,16 +199,16 @@ StatusCode CreateFCChhCaloNoiseLevelMap::initialize() {
           decoder->set(cID, m_activeFieldNamesNested[0], ilayer);
           decoder->set(cID, m_activeFieldNamesNested[1], iphi);
           decoder->set(cID, m_activeFieldNamesNested[2], iz);
-
-          double noiseRMS = m_hcalBarrelNoiseTool->getNoiseRMSPerCell(cID);
-          double noiseOffset = m_hcalBarrelNoiseTool->getNoiseOffsetPerCell(cID);
-
-          map.insert(std::pair<uint64_t, std::pair<double, double>>(cID, std::make_pair(noiseRMS, noiseOffset)));
+          cellIds.push_back(cID);
         }
       }
     }
+    table.addCells(std::move(cellIds), m_hcalBarrelNoiseTool.get());
   }
 
+  table.evaluate(m_numThreads, m_batchSize);
+  info() << "Noise evaluated for " << table.size() << " cells" << endmsg;
+
   // Check if output directory exists
   std::string outDirPath = gSystem->DirName(m_outputFileName.c_str());
   if (!gSystem->OpenDirectory(outDirPath.c_str())) {
@@ -220,15 +225,23 @@ StatusCode CreateFCChhCaloNoiseLevelMap::initialize() {
   tree.Branch("cellId", &saveCellId, "cellId/l");
   tree.Branch("noiseLevel", &saveNoiseLevel);
   tree.Branch("noiseOffset", &saveNoiseOffset);
-  for (const auto& item : map) {
-    saveCellId = item.first;
-    saveNoiseLevel = item.second.first;
-    saveNoiseOffset = item.second.second;
+  for (size_t i = 0; i < table.size(); i++) {
+    saveCellId = table.cellIds()[i];
+    saveNoiseLevel = table.noiseRMS()[i];
+    saveNoiseOffset = table.noiseOffset()[i];
     tree.Fill();
   }
   outFile->Write();
   outFile->Close();
 
+  if (!m_outputTableFileName.empty()) {
+    if (!table.save(m_outputTableFileName)) {
+      error() << "Unable to write the noise table to " << m_outputTableFileName << endmsg;
+      return StatusCode::FAILURE;
+    }
+    info() << "Noise table written to " << m_outputTableFileName << endmsg;
+  }
+
   return StatusCode::SUCCESS;
 }
 
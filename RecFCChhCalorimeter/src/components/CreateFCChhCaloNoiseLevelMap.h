@@ -14,6 +14,9 @@ class IGeoSvc;
  *  Service building a map from cellIds to noise level per cell.
  *  The volumes for which the neighbour map is created can be either segmented in eta-phi (e.g. ECal inclined),
  *  or can contain nested volumes (e.g. HCal barrel).
+ *  The noise of all cells is evaluated in batches of batchSize cells on numThreads threads (the noise tools must then
+ *  be safe to call concurrently) and written ordered by cellID, to the TTree of outputFileName and, if
+ *  outputTableFileName is set, to a binary table (see k4::recCalo::NoiseLevelTable).
  *
  *  @author Coralie Neubueser
  */
@@ -71,8 +74,16 @@ private:
   Gaudi::Property<std::vector<std::string>> m_activeVolumeNamesNested{
       this, "activeVolumeNamesNested", {"layerVolume", "moduleVolume", "wedgeVolume"}}; // to find out number of volumes
 
+  /// Number of threads evaluating the noise
+  Gaudi::Property<int> m_numThreads{this, "numThreads", 1,
+                                    "Number of threads evaluating the noise (0: TBB default, 1: serial)"};
+  /// Number of cells per batch of noise evaluation
+  Gaudi::Property<size_t> m_batchSize{this, "batchSize", 4096, "Number of cells per batch of noise evaluation"};
+
   /// Name of output file
   std::string m_outputFileName;
+  /// Name of output file of the binary noise table
+  std::string m_outputTableFileName;
 };
 
 #endif /* RECALORIMETER_CREATEFCCHHCALONOISELEVELMAP_H */